@@ -0,0 +1,3232 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <malloc.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "Env.h"
+#include "SimdBall.h"
+#include "Runner.h"
+#include "Raster.h"
+#include "Draw.h"
+#include "Loop.h"
+#include "Replay.h"
+#include "Netplay.h"
+#include "Server.h"
+#include "Spectate.h"
+#include "FrameDiff.h"
+#include "Scale.h"
+#include "Touch.h"
+#include "Measure.h"
+#include "Probe.h"
+#include "Input.h"
+#include "Handoff.h"
+#include "Profile.h"
+#include "Observe.h"
+
+/*
+ *Bench.c
+ *Throughput benchmarks for the headless game code. Runs on Linux:
+ *
+ *	gcc -O2 -pthread -o bench Bench.c Game.c Env.c SimdBall.c Runner.c Raster.c Render.c Draw.c Glyphs.c Loop.c FastForward.c Replay.c Netplay.c Server.c Spectate.c FrameDiff.c Measure.c Probe.c Input.c -lm
+ *	./bench [env|simd|runner|raster|render|text|loop|ai|sweep|fast|replay|net|server|spectate|diff|probe|input] [matches] [ticks]
+ *	./bench suite [results.json]
+ *	./bench compare baseline.json [tolerance in percent]
+ *
+ *The suite times the hot paths one operation at a time (see Measure.h) and
+ *writes JSON. Compare runs it again and exits with 1 when anything got
+ *slower than the baseline by more than the tolerance (10% by default).
+ *The benchmarks exit with 1 when any of their checks went wrong.
+*/
+
+//Checks that went wrong so far
+static unsigned int failures;
+
+
+/*
+ *double Now()
+ *This function returns a monotonic time in seconds
+*/
+static double Now(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*
+ *bool Check(bool)
+ *This function counts a check that went wrong and returns whether it went right
+*/
+static bool Check(bool ok) {
+	failures += !ok;
+
+	return ok;
+}
+
+/*
+ *void BenchEnv(unsigned int, unsigned int)
+ *This function steps n matches for a number of ticks with a player
+ *that simply follows the ball and reports the match ticks per second
+*/
+static void BenchEnv(unsigned int n, unsigned int ticks) {
+	Env e;
+	float *obs = malloc(sizeof(float) * ENV_OBS_SIZE * n), *rewards = malloc(sizeof(float) * n);
+	signed char *actions = malloc(n);
+	byte *dones = malloc(n);
+	unsigned int t, i, points = 0, matches = 0;
+	double start, elapsed;
+
+	memset(&e, 0, sizeof(e));
+	if (obs == NULL || rewards == NULL || actions == NULL || dones == NULL || !ResetEnv(&e, n, 1, obs)) {
+		printf("env: out of memory\n");
+		return;
+	}
+
+	start = Now();
+	for (t = 0; t < ticks; t++) {
+		for (i = 0; i < n; i++) {
+			float diff = obs[i*ENV_OBS_SIZE + 1] - obs[i*ENV_OBS_SIZE + 4];
+			actions[i] = diff > 1 ? ACTION_DOWN : (diff < -1 ? ACTION_UP : ACTION_STAY);
+		}
+
+		StepEnv(&e, actions, obs, rewards, dones);
+
+		for (i = 0; i < n; i++) {
+			points += rewards[i] != 0;
+			matches += dones[i];
+		}
+	}
+	elapsed = Now() - start;
+
+	printf("env: %u matches x %u ticks in %.3f s = %.2f M ticks/s (%u points, %u matches finished)\n",
+		n, ticks, elapsed, (double)n * ticks / elapsed * 1e-6, points, matches);
+
+	FreeEnv(&e);
+	free(obs);
+	free(rewards);
+	free(actions);
+	free(dones);
+}
+
+/*
+ *void RunBalls(int, float**, unsigned int, unsigned int, uint32_t*, uint32_t*)
+ *This function moves the balls for a number of ticks with one kernel.
+ *Balls that scored are put back in the middle so that they stay in play.
+*/
+static void RunBalls(int lanes, float **a, unsigned int n, unsigned int ticks, uint32_t *playerScored, uint32_t *player2Scored) {
+	unsigned int t, i;
+
+	for (t = 0; t < ticks; t++) {
+		MoveBallsWith(lanes, a[0], a[1], a[2], a[3], a[4], a[5], n, playerScored, player2Scored);
+
+		for (i = 0; i < SCORE_WORDS(n); i++) {
+			uint32_t scored = playerScored[i] | player2Scored[i];
+
+			while (scored) {
+				a[0][i*32 + __builtin_ctz(scored)] = RESOLUTION / 2.f;
+				scored &= scored - 1;
+			}
+		}
+	}
+}
+
+/*
+ *void BenchSimd(unsigned int, unsigned int)
+ *This function checks every supported MoveBalls kernel against the scalar
+ *one and then reports how many balls per second each of them moves
+*/
+static void BenchSimd(unsigned int n, unsigned int ticks) {
+	int widths[] = { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 }, w, k;
+	float *ref[6], *a[6];
+	uint32_t *masks = malloc(sizeof(uint32_t) * 4 * SCORE_WORDS(n));
+	unsigned int i;
+	double start, elapsed, scalar = 0;
+
+	srand(1);
+	for (k = 0; k < 6; k++) {
+		ref[k] = malloc(sizeof(float) * n);
+		a[k] = malloc(sizeof(float) * n);
+	}
+	for (i = 0; i < n; i++) {
+		ref[0][i] = rand() % RESOLUTION;
+		ref[1][i] = MARGIN + BALLSIZE + rand() % (RESOLUTION - MARGIN - 2*BALLSIZE);
+		ref[2][i] = (rand() % 2 ? 1 : -1) * (0.5f + rand() % 100 / 100.f);
+		ref[3][i] = (rand() % 200 - 100) / 100.f;
+		ref[4][i] = MARGIN + PADDLEHEIGHT / 2.f + rand() % (RESOLUTION - MARGIN - PADDLEHEIGHT);
+		ref[5][i] = MARGIN + PADDLEHEIGHT / 2.f + rand() % (RESOLUTION - MARGIN - PADDLEHEIGHT);
+	}
+
+	for (w = 0; w < 4; w++) {
+		if (!SimdSupported(widths[w]))
+			continue;
+
+		//Make sure the kernel matches the scalar one bit for bit
+		for (k = 0; k < 6; k++)
+			memcpy(a[k], ref[k], sizeof(float) * n);
+		for (i = 0; i < 500; i++) {
+			RunBalls(SIMD_SCALAR, ref, n, 1, masks, masks + SCORE_WORDS(n));
+			RunBalls(widths[w], a, n, 1, masks + 2*SCORE_WORDS(n), masks + 3*SCORE_WORDS(n));
+			for (k = 0; k < 4; k++)
+				if (memcmp(a[k], ref[k], sizeof(float) * n) != 0)
+					break;
+			if (k < 4 || memcmp(masks, masks + 2*SCORE_WORDS(n), sizeof(uint32_t) * 2 * SCORE_WORDS(n)) != 0) {
+				printf("simd: %2d lanes MISMATCH at tick %u\n", widths[w], i);
+				failures++;
+				break;
+			}
+		}
+
+		start = Now();
+		RunBalls(widths[w], a, n, ticks, masks, masks + SCORE_WORDS(n));
+		elapsed = Now() - start;
+
+		if (widths[w] == SIMD_SCALAR)
+			scalar = elapsed;
+		printf("simd: %2d lanes %8.2f M balls/s (%.2fx scalar)\n", widths[w],
+			(double)n * ticks / elapsed * 1e-6, scalar / elapsed);
+	}
+
+	for (k = 0; k < 6; k++) {
+		free(ref[k]);
+		free(a[k]);
+	}
+	free(masks);
+}
+
+/*
+ *void BenchRunner(unsigned int, unsigned int)
+ *This function plays the same AI against AI matches with more and more
+ *threads, checks that the results never change and reports matches per second
+*/
+static void BenchRunner(unsigned int matches, unsigned int maxTicks) {
+	unsigned int threads[] = { 1, 2, 4, 8, 0 }, i;
+	RunConfig cfg;
+	RunStats first, stats;
+	double start, elapsed;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.matches = matches;
+	cfg.seed = 1;
+	cfg.maxTicks = maxTicks;
+
+	for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+		cfg.threads = threads[i];
+
+		start = Now();
+		if (!RunMatches(&cfg, &stats)) {
+			printf("runner: could not start workers\n");
+			return;
+		}
+		elapsed = Now() - start;
+
+		if (i == 0)
+			first = stats;
+		printf("runner: %2u threads %10.0f matches/s %8.2f M ticks/s%s\n", threads[i],
+			stats.matches / elapsed, stats.ticks / elapsed * 1e-6,
+			Check(memcmp(&first, &stats, sizeof(stats)) == 0) ? "" : " RESULTS DIFFER");
+	}
+
+	printf("runner: %llu matches (%llu unfinished), points %llu:%llu, wins %llu:%llu, %.2f hits per point\n",
+		(unsigned long long)stats.matches, (unsigned long long)stats.unfinished,
+		(unsigned long long)stats.points[0], (unsigned long long)stats.points[1],
+		(unsigned long long)stats.wins[0], (unsigned long long)stats.wins[1],
+		(double)stats.hits / (stats.points[0] + stats.points[1]));
+}
+
+/*
+ *void BenchRaster(unsigned int)
+ *This function draws a match in progress into 8 and 32 bit buffers
+ *and reports frames per second
+*/
+static void BenchRaster(unsigned int frames) {
+	static uint32_t pixels[RESOLUTION * RESOLUTION];
+	byte formats[] = { RASTER_8, RASTER_32 };
+	unsigned int f, i;
+	double start, elapsed;
+	volatile uint32_t sink;
+	Raster r;
+	Game g;
+
+	for (f = 0; f < 2; f++) {
+		InitGame(&g, 1);
+		g.state = STATE_SERVE;
+		InitRaster(&r, pixels, formats[f]);
+
+		start = Now();
+		for (i = 0; i < frames; i++) {
+			TickGame(&g, 0, 0);
+			UpdateAI(&g.player, g.ball, g.state);
+			if (g.state != STATE_PLAY)
+				g.state = STATE_SERVE;
+			RasterTable(&r, g.ball, g.player, g.player2, STATE_PLAY);
+		}
+		elapsed = Now() - start;
+		sink = pixels[0];
+
+		printf("raster: %2d bit %8.2f M frames/s (with a tick per frame)\n", formats[f] * 8, frames / elapsed * 1e-6);
+	}
+	(void)sink;
+}
+
+/*
+ *void BenchRender(unsigned int)
+ *This function draws the touch controls of every state
+ *with the counting backend and reports how many fonts, pens and brushes
+ *were made and how many calls a frame takes
+*/
+static void BenchRender(unsigned int frames) {
+	byte states[] = { STATE_HOME, STATE_READY, STATE_SERVE, STATE_PLAY, STATE_END };
+	unsigned int f, k, calls;
+	unsigned long setup;
+	RenderStats backend;
+	Renderer r;
+	Game g;
+	double start, elapsed;
+
+	memset(&backend, 0, sizeof(backend));
+	InitRenderer(&r, &RecordBackend, &backend);
+	InitGame(&g, 1);
+	g.mode = MODE_TWO;
+
+	SetupDrawing(&r, 1920, 1080);
+	setup = backend.creations;
+
+	start = Now();
+	for (f = 0; f < frames; f++) {
+		byte state = states[f % 5];
+
+		SetupDrawing(&r, 1920, 1080);
+		DrawTouchControls(&r, 1920, 1080, state, g.mode, g.player, g.player2, g.physics.paddleHeight);
+	}
+	elapsed = Now() - start;
+
+	for (k = 0, calls = 0; k < OP_COUNT; k++)
+		calls += backend.ops[k];
+	printf("render: %lu resources at startup, %lu made in %u frames, %.1f calls per frame, %.2f M frames/s\n",
+		setup, backend.creations - setup, frames, (double)calls / frames, frames / elapsed * 1e-6);
+
+	//A resize has to make everything again, once
+	SetupDrawing(&r, 1280, 720);
+	SetupDrawing(&r, 1280, 720);
+	printf("render: %lu resources made after a resize\n", backend.creations - setup);
+
+	FreeRenderer(&r);
+}
+
+/*
+ *byte LegacyHit(long, long, unsigned short, unsigned short, byte, byte)
+ *This function is the chain of tests the touch handler used to run on
+ *every point, to check the touch map against. It returns the widget the
+ *first test that passes stands for. It is kept out of line so it is timed
+ *like the call to HitWidget.
+*/
+__attribute__((noinline))
+static byte LegacyHit(long x, long y, unsigned short width, unsigned short height, byte state, byte mode) {
+	unsigned int margin = (width - height) / 2;
+	short buttonShift = height / 30 - height / 15 * (state == STATE_HOME);
+
+	if (state == STATE_READY || state == STATE_SERVE || state == STATE_PLAY) {
+		if ((x >= (margin / 2 - 10 * TOUCH_WIDTH*margin)) && (x <= (margin / 2 + 10 * TOUCH_WIDTH*margin)) &&
+			(y >= (height / 3)) && (y <= (height * 2 / 3)))
+			return WIDGET_SLIDER1;
+		else if ((mode == MODE_TWO) && (x >= (width - margin / 2 - 10 * TOUCH_WIDTH*margin)) && (x <= (width - margin / 2 + 10 * TOUCH_WIDTH*margin)) &&
+			(y >= (height / 3)) && (y <= (height * 2 / 3)))
+			return WIDGET_SLIDER2;
+	}
+	if (state != STATE_PLAY && state != STATE_SERVE && (x >= (margin*TOUCH_WIDTH)) && (x <= (margin*TOUCH_WIDTH + margin / 4)) &&
+		(y >= (height / 2 - height / 30 + buttonShift)) && (y <= (height / 2 + height / 30 + buttonShift)))
+		return state == STATE_HOME ? WIDGET_GO_HOME : WIDGET_GO;
+	if (state == STATE_HOME) {
+		if ((x >= (margin / 2 - 5 * margin*TOUCH_WIDTH)) && (x <= (margin / 2 + 5 * margin*TOUCH_WIDTH)) &&
+			(y >= (height / 2 - 11 * margin*TOUCH_WIDTH)) && (y <= (height / 2 - margin*TOUCH_WIDTH)))
+			return WIDGET_MODE_ONE;
+		else if ((x >= (margin / 2 - 5 * margin*TOUCH_WIDTH)) && (x <= (margin / 2 + 5 * margin*TOUCH_WIDTH)) &&
+			(y >= (height / 2 + margin*TOUCH_WIDTH)) && (y <= (height / 2 + 11 * margin*TOUCH_WIDTH)))
+			return WIDGET_MODE_TWO;
+	}
+	if ((x >= (margin*TOUCH_WIDTH)) && (x <= (margin*TOUCH_WIDTH + margin / 3)) &&
+		(y >= (height - margin*TOUCH_WIDTH - height / 15)) && (y <= (height - margin*TOUCH_WIDTH)))
+		return WIDGET_CLOSE;
+
+	return WIDGET_NONE;
+}
+
+/*
+ *unsigned int MakeTouchTrace(InputEvent*, unsigned int, unsigned short, unsigned short, uint64_t)
+ *This function makes up a multi-touch session on a screen: a message
+ *every 10 ms with 1 to 10 fingers, mostly on and around the controls.
+ *The points of a message have the same time. It returns how many points
+ *there are.
+*/
+static unsigned int MakeTouchTrace(InputEvent *points, unsigned int max, unsigned short width, unsigned short height, uint64_t seed) {
+	unsigned int count = 0, message, k, fingers;
+	unsigned short margin = (width - height) / 2;
+
+	for (message = 0; count < max; message++) {
+		fingers = 1 + Random(seed, message * 2) % 10;
+		for (k = 0; k < fingers && count < max; k++) {
+			uint64_t r = Random(seed, message * 64 + k + 1);
+			InputEvent *e = &points[count++];
+
+			memset(e, 0, sizeof(InputEvent));
+			e->at = message * 10000000ull;
+			e->type = IN_TOUCH;
+			//Half on the bars beside the table, near the widgets' edges as often as not
+			if (r % 2 == 0) {
+				e->x = (short)(r >> 8) % margin;
+				if (r >> 40 & 1)
+					e->x = width - 1 - e->x;
+			}
+			else
+				e->x = (short)((r >> 8) % width);
+			e->y = (short)((r >> 24) % height);
+		}
+	}
+
+	return count;
+}
+
+/*
+ *void BenchTouch(const char*)
+ *This function plays multi-touch traces (made up ones, or the one in path
+ *recorded with -touchtrace) through the touch map on several screens,
+ *checks every point against the old chain of tests in every state and
+ *mode, times both, and resolves the messages as batches while checking
+ *that the heap doesn't grow
+*/
+static void BenchTouch(const char *path) {
+	unsigned short sizes[][2] = { { 1920, 1080 }, { 1366, 768 }, { 1280, 1024 }, { 2560, 1080 }, { 3840, 2160 } };
+	unsigned int max = 200000, count, z, i, state, mode, wrong, batches, largest, trips;
+	InputEvent *points = malloc(sizeof(InputEvent) * max), *back = malloc(sizeof(InputEvent) * max);
+	volatile byte sink = 0;
+	double start, grid, legacy;
+	struct mallinfo2 before, after;
+	TouchActions a;
+	TouchMap m;
+	FILE *file;
+
+	if (points == NULL || back == NULL) {
+		printf("touch: out of memory\n");
+		free(points);
+		free(back);
+		return;
+	}
+
+	for (z = 0; z < sizeof(sizes) / sizeof(sizes[0]); z++) {
+		unsigned short w = sizes[z][0], h = sizes[z][1];
+
+		//The trace goes through a file and back
+		count = 0;
+		if (path != NULL && (file = fopen(path, "rb")) != NULL) {
+			count = ReadTouchTrace(file, points, max);
+			fclose(file);
+		}
+		if (count == 0)
+			count = MakeTouchTrace(points, max, w, h, z + 1);
+		trips = 0;
+		file = tmpfile();
+		if (file != NULL) {
+			WriteTouchTrace(file, points, count);
+			rewind(file);
+			trips = ReadTouchTrace(file, back, max);
+			fclose(file);
+		}
+		for (i = 0; i < count && i < trips; i++)
+			if (back[i].at != points[i].at || back[i].x != points[i].x || back[i].y != points[i].y)
+				break;
+		trips = i;
+
+		InitTouchMap(&m, w, h);
+		wrong = 0;
+		grid = legacy = 0;
+		for (state = STATE_HOME; state <= STATE_END; state++)
+			for (mode = MODE_ONE; mode <= MODE_TWO; mode++) {
+				byte active = ActiveWidgets(state, mode);
+
+				for (i = 0; i < count; i++)
+					wrong += HitWidget(&m, points[i].x, points[i].y, active) != LegacyHit(points[i].x, points[i].y, w, h, state, mode);
+
+				start = Now();
+				for (i = 0; i < count; i++)
+					sink ^= HitWidget(&m, points[i].x, points[i].y, active);
+				grid += Now() - start;
+
+				start = Now();
+				for (i = 0; i < count; i++)
+					sink ^= LegacyHit(points[i].x, points[i].y, w, h, state, mode);
+				legacy += Now() - start;
+			}
+
+		//The points of each message at once, in play and on the home screen
+		before = mallinfo2();
+		batches = largest = 0;
+		for (i = 0; i < count; ) {
+			unsigned int first = i;
+
+			while (i < count && points[i].at == points[first].at)
+				i++;
+			ResolveTouches(&m, points + first, i - first, batches % 2 ? STATE_PLAY : STATE_HOME, MODE_TWO, &a);
+			batches++;
+			if (i - first > largest)
+				largest = i - first;
+		}
+		after = mallinfo2();
+
+		Check(wrong == 0);
+		printf("touch: %4ux%-4u %u points in %u messages (up to %u), %u of them through a trace file, %u hits differ from the old tests, "
+			"%.1f ns a point (old tests %.1f ns), heap %+lld bytes\n",
+			w, h, count, batches, largest, trips, wrong, grid / count / 10 * 1e9, legacy / count / 10 * 1e9,
+			(long long)after.uordblks - (long long)before.uordblks);
+	}
+
+	free(points);
+	free(back);
+}
+
+/*
+ *void LegacyPaddle(Paddle*, int, float) and friends
+ *These functions are the tick as it was when the physics were only the
+ *defines, to check the profiles against
+*/
+static void LegacyPaddle(Paddle *p, int dir, float step) {
+	p->height += PLAYER_SPEED * dir * step;
+	p->height = CLAMP(p->height, MARGIN + PADDLEHEIGHT / 2.f + 1, RESOLUTION - PADDLEHEIGHT / 2.f);
+}
+
+static void LegacyChase(Paddle *AI, Ball b, byte state, float step) {
+	float speed = b.y - AI->height, height;
+
+	if (state < STATE_SERVE)
+		return;
+
+	speed = CLAMP(speed, -AI_SPEED * step, AI_SPEED * step);
+	height = AI->height + speed;
+	AI->height = CLAMP(height, MARGIN + PADDLEHEIGHT/2.f, RESOLUTION - PADDLEHEIGHT/2.f);
+}
+
+static void LegacyEnglish(Ball *b, Paddle p) {
+	b->vy += -(p.height - b->y)*ENGLISHSCALE / 100;
+}
+
+static byte LegacyMove(Ball *b, Paddle player, Paddle player2, float step) {
+	b->x += b->vx * step;
+	b->y += b->vy * step;
+
+	if (b->y < (BALLSIZE + MARGIN)) {
+		b->y += 2*((BALLSIZE + MARGIN) - b->y);
+		b->vy = -b->vy;
+	}
+	else if (b->y > (RESOLUTION - BALLSIZE + 1)) {
+		b->y += 2 * ((RESOLUTION - BALLSIZE + 1) - b->y);
+		b->vy = -b->vy;
+	}
+
+	if (b->x < PADDLEWIDTH) {
+		if (b->y >= (player.height - PADDLEHEIGHT / 2.f - BALLSIZE) && b->y <= (player.height + PADDLEHEIGHT / 2.f + BALLSIZE)) {
+			b->x += 2 * (PADDLEWIDTH - b->x);
+			b->vx = -b->vx;
+			LegacyEnglish(b, player);
+		}
+		else
+			return SCORED_PLAYER2;
+	}
+	else if (b->x > (RESOLUTION - PADDLEWIDTH)) {
+		if (b->y >= (player2.height - PADDLEHEIGHT / 2.f - BALLSIZE) && b->y <= (player2.height + PADDLEHEIGHT / 2.f + BALLSIZE)) {
+			b->x += 2 * ((RESOLUTION - PADDLEWIDTH) - b->x);
+			b->vx = -b->vx;
+			LegacyEnglish(b, player2);
+		}
+		else
+			return SCORED_PLAYER;
+	}
+
+	return SCORED_NONE;
+}
+
+static void LegacyBall(Game *g) {
+	byte scored = LegacyMove(&g->ball, g->player, g->player2, g->step), points;
+
+	if (scored == SCORED_NONE)
+		return;
+	if (scored == SCORED_PLAYER) {
+		g->score = MAKE_SCORE(PLAYER_SCORE(g->score) + 1, PLAYER2_SCORE(g->score));
+		points = PLAYER_SCORE(g->score);
+	}
+	else {
+		g->score = MAKE_SCORE(PLAYER_SCORE(g->score), PLAYER2_SCORE(g->score) + 1);
+		points = PLAYER2_SCORE(g->score);
+	}
+	g->state = points >= MAXSCORE ? STATE_END : STATE_READY;
+	g->stateChange = true;
+}
+
+static void LegacyTick(Game *g, int playerDir, int player2Dir) {
+	if (g->state != STATE_HOME) {
+		LegacyPaddle(&g->player, playerDir, g->step);
+		if (g->mode == MODE_TWO)
+			LegacyPaddle(&g->player2, player2Dir, g->step);
+	}
+
+	if (g->state == STATE_SERVE) {
+		float theta = ServeAngle(g->seed, g->serves++) * 3.14f / 180.f;
+
+		g->ball.x = RESOLUTION / 2.f;
+		g->ball.y = (RESOLUTION - MARGIN) / 2.f + MARGIN;
+		g->ball.vx = (BALLSPEED / 100.f) * cos(theta);
+		g->ball.vy = (BALLSPEED / 100.f) * sin(theta);
+		g->state = STATE_PLAY;
+		g->stateChange = true;
+		LegacyBall(g);
+	}
+	else if (g->state == STATE_PLAY) {
+		LegacyBall(g);
+		if (g->mode == MODE_ONE)
+			LegacyChase(&g->player2, g->ball, g->state, g->step);
+	}
+}
+
+/*
+ *int FollowDir(const Game*, Paddle, uint64_t)
+ *This function is a player who heads for the ball and now and then
+ *presses the wrong key
+*/
+static int FollowDir(const Game *g, Paddle p, uint64_t r) {
+	int dir = g->ball.y > p.height + 2 ? 1 : (g->ball.y < p.height - 2 ? -1 : 0);
+
+	return r % 8 == 0 ? (int)(r >> 8) % 3 - 1 : dir;
+}
+
+/*
+ *uint64_t PlayPhysics(Game*, void (*)(Game*, int, int), unsigned int, byte*)
+ *This function plays matches back to back with the given tick, one or
+ *two players by turns, and returns a hash of every tick's state. It
+ *keeps the most points anybody got in best. Without best nothing is
+ *hashed, to time the ticks.
+*/
+static uint64_t PlayPhysics(Game *g, void (*tick)(Game*, int, int), unsigned int ticks, byte *best) {
+	uint64_t hash = 0;
+	uint32_t bits[6];
+	unsigned int t, matches = 0;
+
+	for (t = 0; t < ticks; t++) {
+		if (g->state == STATE_END || g->state == STATE_HOME) {
+			if (g->state == STATE_END)
+				AdvanceState(g);
+			g->mode = matches++ % 2 ? MODE_TWO : MODE_ONE;
+			AdvanceState(g);
+		}
+		if (g->state == STATE_READY)
+			AdvanceState(g);
+
+		tick(g, FollowDir(g, g->player, (g->seed + t) * 0x9E3779B97F4A7C15ull >> 32), FollowDir(g, g->player2, (g->seed - t) * 0xBF58476D1CE4E5B9ull >> 32));
+		if (best == NULL)
+			continue;
+
+		memcpy(bits, &g->ball, sizeof(Ball));
+		memcpy(bits + 4, &g->player.height, sizeof(float));
+		memcpy(bits + 5, &g->player2.height, sizeof(float));
+		hash = Random(hash, bits[0] ^ (uint64_t)bits[1] << 32);
+		hash = Random(hash, bits[2] ^ (uint64_t)bits[3] << 32);
+		hash = Random(hash, bits[4] ^ (uint64_t)bits[5] << 32);
+		hash = Random(hash, g->score | (uint64_t)g->state << 16);
+		if (PLAYER_SCORE(g->score) > *best)
+			*best = PLAYER_SCORE(g->score);
+		if (PLAYER2_SCORE(g->score) > *best)
+			*best = PLAYER2_SCORE(g->score);
+	}
+
+	return hash;
+}
+
+/*
+ *void BenchPhysics(unsigned int, unsigned int)
+ *This function plays the same matches with the old hard-coded tick, the
+ *code made for each known profile and the code that reads the physics
+ *from the match, checks that every tick comes out the same and times
+ *them. It also checks that profiles are read and kept in snapshots.
+*/
+static void BenchPhysics(unsigned int n, unsigned int ticks) {
+	static const char *good[] = { "classic", "fast", "long", "ballspeed=150 aispeed=1.5 playerspeed=2.25", "long paddle=16 # longer",
+		"fast,maxscore=10\nenglish=20", "maxscore=99 ballspeed=130 paddle=16 english=30" };
+	static const byte expected[] = { PROFILE_CLASSIC, PROFILE_FAST, PROFILE_LONG, PROFILE_FAST, PROFILE_CUSTOM, PROFILE_FAST, PROFILE_CUSTOM };
+	static const char *bad[] = { "quick", "maxscore=100", "paddle=1", "ballspeed=", "aispeed=0", "ballspeed=1.5", "=3" };
+	static const unsigned int rates[] = { TICK_RATE, 240 };
+	unsigned int i, k, r, wrong = 0, kept = 0;
+	byte snapshot[SNAPSHOT_SIZE];
+	Physics ph;
+	Game g;
+
+	for (i = 0; i < sizeof(good) / sizeof(good[0]); i++) {
+		ph = Profiles[PROFILE_CLASSIC];
+		wrong += !ParsePhysics(&ph, good[i]) || ph.profile != expected[i];
+	}
+	for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+		ph = Profiles[PROFILE_CLASSIC];
+		wrong += ParsePhysics(&ph, bad[i]) || ph.profile != PROFILE_CLASSIC;
+	}
+	for (i = 0; i < sizeof(good) / sizeof(good[0]); i++) {
+		ph = Profiles[PROFILE_CLASSIC];
+		ParsePhysics(&ph, good[i]);
+		InitGame(&g, i);
+		SetPhysics(&g, &ph);
+		SaveSnapshot(&g, snapshot);
+		LoadSnapshot(&g, snapshot);
+		kept += memcmp(&g.physics, &ph, sizeof(Physics)) == 0;
+	}
+	Check(wrong == 0 && kept == sizeof(good) / sizeof(good[0]));
+	printf("physics: %u of %u profiles read wrong, %u of %u kept by snapshots\n",
+		wrong, (unsigned int)(sizeof(good) / sizeof(good[0]) + sizeof(bad) / sizeof(bad[0])), kept, (unsigned int)(sizeof(good) / sizeof(good[0])));
+
+	//Every touch slider position, past both ends too, puts each paddle on the table
+	for (k = wrong = 0; k < PROFILE_COUNT; k++)
+		for (i = 0; i <= 1080; i++) {
+			Paddle p;
+			short tall = Profiles[k].paddleHeight;
+			int back;
+
+			SliderToPaddle((unsigned short)i, &p, tall, 1920, 1080);
+			back = PaddleToSlider(p, tall, 1920, 1080);
+			wrong += p.height < MARGIN + tall / 2.f + 1 || p.height > RESOLUTION - tall / 2.f || back < 1080 / 3 || back > 1080 / 3 * 2;
+		}
+	Check(wrong == 0);
+	printf("physics: %u touch slider positions put a paddle off the table\n", wrong);
+
+	for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+		for (k = 0; k <= PROFILE_COUNT; k++) {
+			double timed[3] = { 0 };
+			uint64_t hashes[3] = { 0 };
+			byte best = 0, ways = k == PROFILE_CLASSIC ? 3 : 2, w;
+
+			ph = Profiles[k < PROFILE_COUNT ? k : PROFILE_CLASSIC];
+			if (k == PROFILE_COUNT)
+				ParsePhysics(&ph, "maxscore=15 ballspeed=130 paddle=16 english=30");
+
+			//Way 0 is the code made for the profile, 1 the code reading the
+			//physics and 2 the old tick, which only knows the classic ones
+			for (w = 0; w < ways; w++)
+				for (i = 0; i < n; i++) {
+					double start;
+					Game timedGame;
+
+					InitGame(&g, MatchSeed(7, i));
+					SetTickRate(&g, rates[r]);
+					SetPhysics(&g, &ph);
+					if (w == 1)
+						g.physics.profile = PROFILE_CUSTOM;
+					timedGame = g;
+					hashes[w] ^= Random(i, PlayPhysics(&g, w == 2 ? LegacyTick : TickGame, ticks, &best));
+
+					start = Now();
+					PlayPhysics(&timedGame, w == 2 ? LegacyTick : TickGame, ticks, NULL);
+					timed[w] += Now() - start;
+				}
+
+			printf("physics: %-7s %4u Hz ", k == PROFILE_COUNT ? "custom" : ProfileName(k), rates[r]);
+			if (k < PROFILE_COUNT)
+				printf(" %5.2f ns a tick made for it,", timed[0] / n / ticks * 1e9);
+			printf(" %5.2f ns reading the physics", timed[1] / n / ticks * 1e9);
+			if (ways == 3)
+				printf(", %5.2f ns hard-coded", timed[2] / n / ticks * 1e9);
+			printf(", up to %u points, %s\n", best,
+				Check(hashes[1] == hashes[0] && (ways < 3 || hashes[2] == hashes[0])) ? "every tick the same" : "ticks DIFFER");
+		}
+}
+
+//The conformance matches (see BenchFixed) and the hash of all their ticks
+//in fixed point, which every build on every machine has to get
+#define CONFORMANCE_MATCHES	4
+#define CONFORMANCE_TICKS	20000
+#define CONFORMANCE_HASH	0x62f0aefc30e121c8ull
+
+/*
+ *uint64_t PlaySetups(bool, unsigned int, unsigned int)
+ *This function plays the same matches with every profile, at 100, 240
+ *and 10 Hz, with the tick rules and swept, against the chasing AI and the
+ *hard one, and returns a hash of every tick of all of them
+*/
+static uint64_t PlaySetups(bool fixed, unsigned int matches, unsigned int ticks) {
+	static const unsigned int rates[] = { TICK_RATE, 240, 10 };
+	Physics custom = Profiles[PROFILE_CLASSIC];
+	uint64_t hash = 0;
+	unsigned int k, r, s, a, i;
+	byte best = 0;
+	Game g;
+
+	ParsePhysics(&custom, "ballspeed=130 english=30 paddle=16 aispeed=1.2 playerspeed=2");
+	for (k = 0; k <= PROFILE_COUNT; k++)
+		for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+			for (s = 0; s < 2; s++)
+				for (a = 0; a < 2; a++)
+					for (i = 0; i < matches; i++) {
+						InitGame(&g, MatchSeed(k * 64 + r * 16 + s * 4 + a, i));
+						SetPhysics(&g, k < PROFILE_COUNT ? &Profiles[k] : &custom);
+						SetTickRate(&g, rates[r]);
+						SetSwept(&g, s == 1);
+						SetFixed(&g, fixed);
+						InitIntercept(&g.ai, false, a == 1 ? SKILL_HARD : SKILL_CHASE, g.seed);
+						g.ai.swept = g.swept;
+						hash = Random(hash, PlayPhysics(&g, TickGame, ticks, &best));
+					}
+
+	return hash;
+}
+
+/*
+ *void RunFixedBalls(int, Fixed**, unsigned int, unsigned int, uint32_t*, uint32_t*)
+ *This function is RunBalls for fixed point balls
+*/
+static void RunFixedBalls(int lanes, Fixed **a, unsigned int n, unsigned int ticks, uint32_t *playerScored, uint32_t *player2Scored) {
+	unsigned int t, i;
+
+	for (t = 0; t < ticks; t++) {
+		MoveFixedBallsWith(lanes, a[0], a[1], a[2], a[3], a[4], a[5], n, playerScored, player2Scored);
+
+		for (i = 0; i < SCORE_WORDS(n); i++) {
+			uint32_t scored = playerScored[i] | player2Scored[i];
+
+			while (scored) {
+				a[0][i*32 + __builtin_ctz(scored)] = RESOLUTION / 2 * FIXED_ONE;
+				scored &= scored - 1;
+			}
+		}
+	}
+}
+
+/*
+ *void BenchFixed(unsigned int, unsigned int)
+ *This function plays the conformance matches in fixed point and in floats
+ *and compares the fixed point hash with the one every build has to get,
+ *checks that snapshots keep the mode, times a tick both ways and checks
+ *and times every supported MoveFixedBalls kernel against the float ones
+*/
+static void BenchFixed(unsigned int n, unsigned int ticks) {
+	int widths[] = { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 }, w, k;
+	Fixed *init[6], *expect[6], *a[6];
+	float *f[6];
+	uint32_t *masks = malloc(sizeof(uint32_t) * 4 * SCORE_WORDS(n));
+	uint64_t hash;
+	unsigned int i;
+	double start, elapsed, timed[2];
+	byte snapshot[SNAPSHOT_SIZE];
+	Game g, loaded;
+
+	hash = PlaySetups(true, CONFORMANCE_MATCHES, CONFORMANCE_TICKS);
+	printf("fixed: conformance hash %016llx, %s\n", (unsigned long long)hash, Check(hash == CONFORMANCE_HASH) ? "the same as every build" : "DIFFERS from the reference");
+	printf("fixed: the same matches in floats %016llx (depends on the compiler and its flags)\n",
+		(unsigned long long)PlaySetups(false, CONFORMANCE_MATCHES, CONFORMANCE_TICKS));
+
+	//Snapshots keep the mode and every bit of a match
+	InitGame(&g, 5);
+	SetFixed(&g, true);
+	PlayPhysics(&g, TickGame, 1234, NULL);
+	SaveSnapshot(&g, snapshot);
+	LoadSnapshot(&loaded, snapshot);
+	PlayPhysics(&g, TickGame, 1000, NULL);
+	PlayPhysics(&loaded, TickGame, 1000, NULL);
+	printf("fixed: snapshots %s\n", Check(loaded.fixed && memcmp(&loaded.ball, &g.ball, sizeof(Ball)) == 0 && loaded.score == g.score) ? "keep the mode" : "LOSE the mode");
+
+	//Ticks both ways
+	for (k = 0; k < 2; k++) {
+		InitGame(&g, 7);
+		SetFixed(&g, k == 0);
+		start = Now();
+		PlayPhysics(&g, TickGame, ticks * 100, NULL);
+		timed[k] = Now() - start;
+	}
+	printf("fixed: %.2f ns a tick in fixed point, %.2f ns in floats\n", timed[0] / ticks / 100 * 1e9, timed[1] / ticks / 100 * 1e9);
+
+	//The kernels, from the balls BenchSimd starts with
+	srand(1);
+	for (k = 0; k < 6; k++) {
+		init[k] = malloc(sizeof(Fixed) * n);
+		expect[k] = malloc(sizeof(Fixed) * n);
+		a[k] = malloc(sizeof(Fixed) * n);
+		f[k] = malloc(sizeof(float) * n);
+	}
+	for (i = 0; i < n; i++) {
+		init[0][i] = rand() % RESOLUTION * FIXED_ONE;
+		init[1][i] = (MARGIN + BALLSIZE + rand() % (RESOLUTION - MARGIN - 2*BALLSIZE)) * FIXED_ONE;
+		init[2][i] = (rand() % 2 ? 1 : -1) * (FIXED_ONE / 2 + rand() % 100 * FIXED_ONE / 100);
+		init[3][i] = (rand() % 200 - 100) * FIXED_ONE / 100;
+		init[4][i] = MARGIN * FIXED_ONE + PADDLEHEIGHT * (FIXED_ONE / 2) + rand() % (RESOLUTION - MARGIN - PADDLEHEIGHT) * FIXED_ONE;
+		init[5][i] = MARGIN * FIXED_ONE + PADDLEHEIGHT * (FIXED_ONE / 2) + rand() % (RESOLUTION - MARGIN - PADDLEHEIGHT) * FIXED_ONE;
+		for (k = 0; k < 6; k++)
+			f[k][i] = FROM_FIXED(init[k][i]);
+	}
+	for (k = 0; k < 6; k++)
+		memcpy(expect[k], init[k], sizeof(Fixed) * n);
+	RunFixedBalls(SIMD_SCALAR, expect, n, 500, masks, masks + SCORE_WORDS(n));
+
+	for (w = 0; w < 4; w++) {
+		if (!SimdSupported(widths[w]))
+			continue;
+
+		//Bit for bit against MoveFixedBall, from the same balls every time
+		for (k = 0; k < 6; k++)
+			memcpy(a[k], init[k], sizeof(Fixed) * n);
+		RunFixedBalls(widths[w], a, n, 500, masks, masks + SCORE_WORDS(n));
+		for (k = 0; k < 4 && memcmp(a[k], expect[k], sizeof(Fixed) * n) == 0; k++)
+			;
+
+		start = Now();
+		RunFixedBalls(widths[w], a, n, ticks, masks, masks + SCORE_WORDS(n));
+		elapsed = Now() - start;
+		start = Now();
+		RunBalls(widths[w], f, n, ticks, masks, masks + SCORE_WORDS(n));
+		timed[0] = Now() - start;
+
+		printf("fixed: %2d lanes %s, %8.2f M balls/s (%8.2f M in floats)\n", widths[w], Check(k == 4) ? "the same as MoveFixedBall" : "DIFFER from MoveFixedBall",
+			(double)n * ticks / elapsed * 1e-6, (double)n * ticks / timed[0] * 1e-6);
+	}
+
+	for (k = 0; k < 6; k++) {
+		free(init[k]);
+		free(expect[k]);
+		free(a[k]);
+		free(f[k]);
+	}
+	free(masks);
+}
+
+/*
+ *void ReferenceFrame(const Env*, unsigned int, unsigned short, byte*)
+ *This function draws match i on a whole table with the raster and
+ *shrinks it to a size x size gray frame the slow way
+*/
+static void ReferenceFrame(const Env *e, unsigned int i, unsigned short size, byte *frame) {
+	static byte table[RESOLUTION * RESOLUTION];
+	unsigned int white[RESOLUTION * RESOLUTION], area[RESOLUTION * RESOLUTION], x, y;
+	Raster r;
+	Ball b;
+	Paddle player, player2;
+
+	memset(&b, 0, sizeof(b));
+	memset(&player, 0, sizeof(player));
+	memset(&player2, 0, sizeof(player2));
+	b.x = e->x[i];
+	b.y = e->y[i];
+	player.height = e->player[i];
+	player2.height = e->player2[i];
+	InitRaster(&r, table, RASTER_8);
+	RasterTable(&r, b, player, player2, e->state[i]);
+
+	memset(white, 0, sizeof(white));
+	memset(area, 0, sizeof(area));
+	for (y = 0; y < RESOLUTION; y++)
+		for (x = 0; x < RESOLUTION; x++) {
+			unsigned int at = (y * 2 + 1) * size / (2 * RESOLUTION) * size + (x * 2 + 1) * size / (2 * RESOLUTION);
+
+			white[at] += table[y * RESOLUTION + x] != 0;
+			area[at]++;
+		}
+	for (x = 0; x < (unsigned int)size * size; x++)
+		frame[x] = (byte)((white[x] * 255 + area[x] / 2) / area[x]);
+}
+
+/*
+ *void BenchObserve(unsigned int, unsigned int)
+ *This function checks the frames the observer renders for an env with
+ *random players against the raster, every stacked frame of a few
+ *matches included, and reports the frames per second for the usual
+ *sizes on one thread and on all of them
+*/
+static void BenchObserve(unsigned int n, unsigned int steps) {
+	unsigned short sizes[] = { RESOLUTION, 84, 64 };
+	byte planes[] = { 1, 3 }, *history = NULL, *tensor = NULL;
+	unsigned int threads[] = { 1, 0 }, watched = n < 4 ? n : 4, s, p, t, i, k, a;
+	signed char *actions = malloc(n);
+	Env e;
+	Observer o;
+
+	memset(&e, 0, sizeof(e));
+	if (actions == NULL || !ResetEnv(&e, n, 1, NULL)) {
+		printf("observe: out of memory\n");
+		free(actions);
+		return;
+	}
+
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+		for (p = 0; p < 2; p++) {
+			byte frame[RESOLUTION * RESOLUTION];
+			unsigned int wrong = 0, checks = steps < 16 ? steps : 16;
+			size_t plane = (size_t)sizes[s] * sizes[s];
+			double start, elapsed[2], stepped;
+
+			if (!InitObserver(&o, sizes[s], planes[p], 4))
+				break;
+			free(tensor);
+			free(history);
+			tensor = malloc(ObserveSize(&o, n));
+			history = malloc(plane * o.stack * watched);
+			if (tensor == NULL || history == NULL) {
+				printf("observe: out of memory\n");
+				FreeObserver(&o);
+				break;
+			}
+
+			//Every match's newest frame and every stacked frame of the first ones
+			ResetEnv(&e, n, s * 2 + p + 1, NULL);
+			for (t = 0; t < checks; t++) {
+				for (i = 0; i < n; i++)
+					actions[i] = (signed char)(Random(t, i) % 3) - 1;
+				StepEnv(&e, actions, NULL, NULL, NULL);
+				ObserveEnv(&o, &e, tensor);
+
+				for (i = 0; i < n; i++) {
+					ReferenceFrame(&e, i, sizes[s], frame);
+					if (i < watched)
+						memcpy(history + (i * o.stack + t % o.stack) * plane, frame, plane);
+					for (k = 0; k < o.planes; k++)
+						wrong += memcmp(tensor + ObserveSize(&o, i) + (ObserveSlot(&o, 0) * o.planes + k) * plane, frame, plane) != 0;
+				}
+				for (i = 0; i < watched; i++)
+					for (a = 1; a < o.stack && a <= t; a++)
+						wrong += memcmp(tensor + ObserveSize(&o, i) + ObserveSlot(&o, a) * o.planes * plane,
+							history + (i * o.stack + (t - a) % o.stack) * plane, plane) != 0;
+			}
+
+			//Rendering only, then stepping the env too
+			for (k = 0; k < 2; k++) {
+				o.threads = threads[k];
+				start = Now();
+				for (t = 0; t < steps; t++)
+					ObserveEnv(&o, &e, tensor);
+				elapsed[k] = Now() - start;
+			}
+			memset(actions, ACTION_STAY, n);
+			start = Now();
+			for (t = 0; t < steps; t++) {
+				StepEnv(&e, actions, NULL, NULL, NULL);
+				ObserveEnv(&o, &e, tensor);
+			}
+			stepped = Now() - start;
+
+			Check(wrong == 0);
+			printf("observe: %3ux%-3u x%u x%u stack %u frames wrong, %6.2f M frames/s on 1 thread, %6.2f M on all, %6.2f M stepping too, %.1f pixels a frame\n",
+				sizes[s], sizes[s], planes[p], o.stack, wrong, (double)n * steps / elapsed[0] * 1e-6, (double)n * steps / elapsed[1] * 1e-6,
+				(double)n * steps / stepped * 1e-6, (double)o.pixels / o.frames);
+			FreeObserver(&o);
+		}
+
+	FreeEnv(&e);
+	free(actions);
+	free(tensor);
+	free(history);
+}
+
+/*
+ *void BenchText(unsigned int)
+ *This function plays AI against AI matches and puts the text on the table
+ *every frame, once composited only when it changes and once redrawn
+ *from scratch every frame like it used to be, and reports the cost per frame
+*/
+static void BenchText(unsigned int frames) {
+	static uint32_t pixels[RESOLUTION * RESOLUTION];
+	const char *names[] = { "on change", "every frame" };
+	unsigned int f, i, draws;
+	double start, elapsed;
+	Raster r;
+	Game g;
+
+	for (f = 0; f < 2; f++) {
+		InitGame(&g, 1);
+		InitRaster(&r, pixels, RASTER_32);
+		draws = 0;
+
+		start = Now();
+		for (i = 0; i < frames; i++) {
+			if (g.state == STATE_HOME || g.state == STATE_READY || g.state == STATE_END)
+				AdvanceState(&g);
+			TickGame(&g, 0, 0);
+			UpdateAI(&g.player, g.ball, g.state);
+
+			if (f == 1)
+				r.textReady = false;
+			draws += !r.textReady || r.textScore != g.score || r.textState != g.state;
+			RasterTableText(&r, g.score, g.state, g.mode);
+		}
+		elapsed = Now() - start;
+
+		printf("text: %-11s %8.1f ns per frame (with a tick), text drawn in %u of %u frames\n",
+			names[f], elapsed / frames * 1e9, draws, frames);
+	}
+}
+
+/*
+ *bool SameSnapshot(const Game*, const Game*)
+ *This function compares two matches field by field (not their padding)
+*/
+static bool SameSnapshot(const Game *a, const Game *b) {
+	byte x[SNAPSHOT_SIZE], y[SNAPSHOT_SIZE];
+
+	SaveSnapshot(a, x);
+	SaveSnapshot(b, y);
+
+	return memcmp(x, y, SNAPSHOT_SIZE) == 0;
+}
+
+/*
+ *uint64_t FakeNow(void*)
+ *This function is a clock that only moves when the benchmark moves it
+*/
+static uint64_t FakeNow(void *ctx) {
+	return *(uint64_t*)ctx;
+}
+
+/*
+ *void FollowTick(Game*)
+ *This function runs one tick of a match where the player simply
+ *follows the ball and the space bar is pressed whenever it's needed
+*/
+static void FollowTick(Game *g) {
+	if (g->state == STATE_HOME || g->state == STATE_READY || g->state == STATE_END)
+		AdvanceState(g);
+
+	TickGame(g, g->ball.y > g->player.height + 1 ? 1 : (g->ball.y < g->player.height - 1 ? -1 : 0), 0);
+}
+
+/*
+ *void BenchLoop(unsigned int)
+ *This function drives matches through the fixed timestep with a made up
+ *clock whose frames come at random intervals and checks that they end up
+ *exactly where matches simply stepped tick after tick do. It also shows
+ *that the ball covers the same distance per second at every tick rate.
+*/
+static void BenchLoop(unsigned int ticks) {
+	unsigned int rates[] = { TICK_RATE, 240, 1000 }, r, t, frameCount;
+	uint64_t now;
+	Clock fake = { FakeNow, &now };
+	Timestep step;
+	Game a, b;
+	double start, elapsed;
+
+	for (r = 0; r < 3; r++) {
+		//Straight
+		InitGame(&a, 7);
+		SetTickRate(&a, rates[r]);
+		for (t = 0; t < ticks; t++)
+			FollowTick(&a);
+
+		//Through the scheduler, with frames from 0 to 50 ms apart
+		InitGame(&b, 7);
+		SetTickRate(&b, rates[r]);
+		now = 0;
+		InitTimestep(&step, rates[r], 1000000, fake);
+		frameCount = 0;
+		start = Now();
+		while (step.ticks < ticks) {
+			unsigned int due;
+
+			now += Random(rates[r], frameCount++) % (50 * 1000000ull);
+			for (due = AdvanceTimestep(&step); due > 0 && step.ticks - due < ticks; due--)
+				FollowTick(&b);
+		}
+		elapsed = Now() - start;
+
+		printf("loop: %4u Hz %u ticks in %u random frames %s, %.1f ns per tick\n", rates[r], ticks, frameCount,
+			Check(SameSnapshot(&a, &b)) ? "same as straight" : "DIFFERENT FROM STRAIGHT", elapsed / ticks * 1e9);
+	}
+
+	//Half a second of a serve at each rate, not long enough to reach a paddle
+	for (r = 0; r < 3; r++) {
+		InitGame(&a, 7);
+		SetTickRate(&a, rates[r]);
+		a.mode = MODE_TWO;
+		a.state = STATE_SERVE;
+		ServeBall(&a);
+		b = a;
+		for (t = 0; t < rates[r] / 2; t++)
+			TickGame(&a, 0, 0);
+
+		printf("loop: %4u Hz ball moved %.3f across and %.3f down in half a second\n", rates[r],
+			fabsf(a.ball.x - b.ball.x), a.ball.y - b.ball.y);
+	}
+}
+
+//A backend that paints every operation's box in a colour of its own, to
+//compare what two ways of drawing leave on the screen
+typedef struct PaintCtx {
+	uint32_t *layers[MAX_LAYERS];
+	unsigned int width, height;
+	byte layer;
+} PaintCtx;
+
+static bool PaintStyle(void *ctx, byte id, const Style *style) {
+	(void)ctx; (void)id; (void)style;
+	return true;
+}
+
+static bool PaintFont(void *ctx, byte id, const FontDesc *font) {
+	(void)ctx; (void)id; (void)font;
+	return true;
+}
+
+static void PaintFree(void *ctx) {
+	(void)ctx;
+}
+
+static void PaintBox(void *ctx, uint32_t color, int left, int top, int right, int bottom) {
+	PaintCtx *p = ctx;
+	int x, y;
+
+	left = left < 0 ? 0 : left;
+	top = top < 0 ? 0 : top;
+	right = right > (int)p->width ? (int)p->width : right;
+	bottom = bottom > (int)p->height ? (int)p->height : bottom;
+	for (y = top; y < bottom; y++)
+		for (x = left; x < right; x++)
+			p->layers[p->layer][y * p->width + x] = color;
+}
+
+static void PaintClear(void *ctx, int left, int top, int right, int bottom) {
+	PaintBox(ctx, 0, left, top, right, bottom);
+}
+
+static void PaintRectangle(void *ctx, byte style, int left, int top, int right, int bottom) {
+	PaintBox(ctx, 0x100 + style, left, top, right, bottom);
+}
+
+static void PaintEllipse(void *ctx, byte style, int left, int top, int right, int bottom) {
+	PaintBox(ctx, 0x200 + style, left, top, right, bottom);
+}
+
+static void PaintLines(void *ctx, byte style, const int *points, byte count) {
+	byte i;
+
+	for (i = 0; i + 1 < count; i++)
+		PaintBox(ctx, 0x300 + style, points[i * 2] < points[i * 2 + 2] ? points[i * 2] : points[i * 2 + 2], points[i * 2 + 1] < points[i * 2 + 3] ? points[i * 2 + 1] : points[i * 2 + 3],
+			(points[i * 2] > points[i * 2 + 2] ? points[i * 2] : points[i * 2 + 2]) + 1, (points[i * 2 + 1] > points[i * 2 + 3] ? points[i * 2 + 1] : points[i * 2 + 3]) + 1);
+}
+
+static void PaintText(void *ctx, byte font, int x, int y, int width, int height, byte format, const char *str) {
+	(void)format;
+	PaintBox(ctx, 0x400 + font + (byte)str[0], x, y, x + width, y + height);
+}
+
+static void PaintLayer(void *ctx, byte layer) {
+	((PaintCtx*)ctx)->layer = layer;
+}
+
+static void PaintCopy(void *ctx, byte from, int left, int top, int right, int bottom) {
+	PaintCtx *p = ctx;
+	int y;
+
+	for (y = top; y < bottom; y++)
+		memcpy(p->layers[p->layer] + y * p->width + left, p->layers[from] + y * p->width + left, (right - left) * sizeof(uint32_t));
+}
+
+static const RenderBackend PaintBackend = {
+	PaintStyle, PaintFont, PaintFree, PaintClear, PaintRectangle, PaintEllipse, PaintLines, PaintText, PaintLayer, PaintCopy
+};
+
+/*
+ *void BenchLayers(unsigned int)
+ *This function plays a two player match on touch screens with the
+ *controls composed on layers and drawn from scratch every frame, counts
+ *the pixels each way touches a frame and checks that the screens come out
+ *the same
+*/
+static void BenchLayers(unsigned int frames) {
+	unsigned short sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+	unsigned int z, i, k, wrong, redraws, count;
+	uint64_t before, composed, scratch, inPlay, playFrames, worst;
+	PaintCtx paint, fresh;
+	Renderer r, full;
+	TouchLayers l;
+	Rect rects[TOUCH_MAX_RECTS];
+	Game g;
+
+	for (z = 0; z < 2; z++) {
+		unsigned int w = sizes[z][0], h = sizes[z][1];
+
+		memset(&paint, 0, sizeof(paint));
+		memset(&fresh, 0, sizeof(fresh));
+		paint.width = fresh.width = w;
+		paint.height = fresh.height = h;
+		paint.layers[LAYER_SCREEN] = malloc(sizeof(uint32_t) * w * h);
+		paint.layers[LAYER_STATIC] = malloc(sizeof(uint32_t) * w * h);
+		fresh.layers[LAYER_SCREEN] = malloc(sizeof(uint32_t) * w * h);
+		if (paint.layers[LAYER_SCREEN] == NULL || paint.layers[LAYER_STATIC] == NULL || fresh.layers[LAYER_SCREEN] == NULL) {
+			printf("layers: out of memory\n");
+			free(paint.layers[LAYER_SCREEN]);
+			free(paint.layers[LAYER_STATIC]);
+			free(fresh.layers[LAYER_SCREEN]);
+			return;
+		}
+
+		InitRenderer(&r, &PaintBackend, &paint);
+		InitRenderer(&full, &PaintBackend, &fresh);
+		SetupDrawing(&r, w, h);
+		SetupDrawing(&full, w, h);
+		InitTouchLayers(&l);
+		InitGame(&g, 4);
+		g.mode = MODE_TWO;
+		composed = scratch = inPlay = playFrames = worst = 0;
+		wrong = redraws = 0;
+
+		for (i = 0; i < frames; i++) {
+			bool redrawn;
+			byte state;
+
+			FollowTick(&g);
+			//The second player wanders up and down the table
+			g.player2.height = MARGIN + PADDLEHEIGHT / 2 + (i / 3 % 64) * (RESOLUTION - 2 * MARGIN - PADDLEHEIGHT) / 64;
+			state = g.state;
+
+			before = r.stats.pixels;
+			count = ComposeTouchControls(&l, &r, w, h, g.state, g.mode, g.player, g.player2, g.physics.paddleHeight, rects);
+			composed += r.stats.pixels - before;
+			redrawn = count == 2 && rects[0].left == 0 && rects[0].bottom == (short)h;
+			redraws += redrawn;
+			if (state == STATE_PLAY && !redrawn) {
+				inPlay += r.stats.pixels - before;
+				playFrames++;
+				if (r.stats.pixels - before > worst)
+					worst = r.stats.pixels - before;
+			}
+
+			before = full.stats.pixels;
+			DrawTouchControls(&full, w, h, g.state, g.mode, g.player, g.player2, g.physics.paddleHeight);
+			scratch += full.stats.pixels - before;
+
+			//The screen outside the table has to be what drawing from scratch leaves
+			for (k = 0; k < w * h; k++)
+				if (paint.layers[LAYER_SCREEN][k] != fresh.layers[LAYER_SCREEN][k] && (k % w < (unsigned int)(w - h) / 2 || k % w >= (unsigned int)(w + h) / 2)) {
+					wrong++;
+					break;
+				}
+		}
+
+		Check(wrong == 0);
+		printf("layers: %4ux%-4u composed %8.0f pixels a frame (%.0f in play, at most %llu), from scratch %9.0f, static layer drawn %u times in %u frames, %u frames differ\n",
+			w, h, (double)composed / frames, playFrames ? (double)inPlay / playFrames : 0, (unsigned long long)worst, (double)scratch / frames, redraws, frames, wrong);
+
+		free(paint.layers[LAYER_SCREEN]);
+		free(paint.layers[LAYER_STATIC]);
+		free(fresh.layers[LAYER_SCREEN]);
+	}
+}
+
+/*
+ *void BenchAI(unsigned int, unsigned int)
+ *This function checks InterceptY against balls that are really moved,
+ *compares what UpdateAI and UpdateIntercept cost per tick and plays AI
+ *against AI matches at every skill
+*/
+static void BenchAI(unsigned int n, unsigned int maxTicks) {
+	const char *skills[] = { "chase", "easy", "normal", "hard" };
+	Paddle away = { -1000.f }, p;
+	unsigned int i, t, ticks = 0;
+	float worst = 0;
+	double start, chase, predict;
+	volatile float sink;
+	Intercept ai;
+	RunConfig cfg;
+	RunStats stats;
+	Game g;
+
+	//Predicted against real crossings
+	for (i = 0; i < n; i++) {
+		Ball b, ball;
+		float y;
+
+		LaunchBall(&b, ServeAngle(3, i));
+		if (b.vx < 0)
+			b.vx = -b.vx;
+		b.vy *= 1 + (i % 7);
+		y = InterceptY(b, RESOLUTION - PADDLEWIDTH, 1.f);
+
+		ball = b;
+		while (MoveBall(&ball, away, away) == SCORED_NONE)
+			;
+		y -= ball.y;
+		y = y < 0 ? -y : y;
+		if (y > worst)
+			worst = y;
+	}
+	printf("ai: intercept off by at most %.3f pixels over %u flights\n", worst, n);
+
+	//Cost per tick on the same flights
+	for (i = 0; i < 2; i++) {
+		InitGame(&g, 5);
+		InitIntercept(&ai, false, SKILL_HARD, 5);
+		p = g.player2;
+		g.state = STATE_SERVE;
+		ServeBall(&g);
+		ticks = 0;
+
+		start = Now();
+		for (t = 0; t < n * 64; t++) {
+			if (i == 0)
+				UpdateAI(&p, g.ball, STATE_PLAY);
+			else
+				UpdateIntercept(&ai, &p, g.ball, STATE_PLAY, 1.f);
+			if (MoveBall(&g.ball, g.player, p) != SCORED_NONE)
+				ServeBall(&g);
+			g.player.height = g.ball.y;
+			ticks++;
+		}
+		if (i == 0)
+			chase = Now() - start;
+		else
+			predict = Now() - start;
+		sink = p.height;
+	}
+	(void)sink;
+	printf("ai: UpdateAI %.2f ns, UpdateIntercept %.2f ns per tick (with the ball move), %u solves in %u ticks\n",
+		chase / ticks * 1e9, predict / ticks * 1e9, ai.solves, ticks);
+
+	//AI against AI
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.matches = n;
+	cfg.seed = 1;
+	cfg.maxTicks = maxTicks;
+	for (i = SKILL_CHASE; i <= SKILL_HARD; i++) {
+		cfg.skill = i;
+		start = Now();
+		RunMatches(&cfg, &stats);
+		printf("ai: %-6s vs %-6s %6llu unfinished, %7.2f hits per point, %8.0f matches/s\n", skills[i], skills[i],
+			(unsigned long long)stats.unfinished, (double)stats.hits / (stats.points[0] + stats.points[1] + (stats.points[0] + stats.points[1] == 0)),
+			stats.matches / (Now() - start));
+	}
+}
+
+/*
+ *byte FlyBall(Ball*, Paddle, Paddle, float, bool, unsigned int)
+ *This function moves a ball for a number of ticks or until somebody scores
+*/
+static byte FlyBall(Ball *b, Paddle player, Paddle player2, float step, bool swept, unsigned int ticks) {
+	byte scored = SCORED_NONE;
+
+	while (ticks-- > 0 && scored == SCORED_NONE)
+		scored = swept ? SweepBall(b, player, player2, step) : MoveBallStep(b, player, player2, step);
+
+	return scored;
+}
+
+/*
+ *void BenchSweep(unsigned int, unsigned int)
+ *This function flies fast balls at still paddles with the tick rules and
+ *with swept collisions at different tick lengths and counts how often they
+ *end differently from swept collisions with very short ticks (the balls
+ *that end the same can still be apart a little: rounding differs with the
+ *tick length and every paddle hit's english makes it grow). Then it
+ *plays AI against AI matches at the normal rate and at 10 ticks a second.
+*/
+static void BenchSweep(unsigned int n, unsigned int maxTicks) {
+	const struct { float step; bool swept; const char *name; } modes[] = {
+		{ 1.f, false, "tick rules, 100 Hz" }, { 10.f, false, "tick rules,  10 Hz" },
+		{ 1.f, true, "swept,      100 Hz" }, { 10.f, true, "swept,       10 Hz" } };
+	unsigned int m, i, wrong;
+	float worst;
+	RunConfig cfg;
+	RunStats stats;
+	double start, elapsed;
+
+	for (m = 0; m < 4; m++) {
+		wrong = 0;
+		worst = 0;
+		for (i = 0; i < n; i++) {
+			Paddle p1 = { MARGIN + PADDLEHEIGHT + Random(i, 0) % (RESOLUTION - MARGIN - 2 * PADDLEHEIGHT) },
+				p2 = { MARGIN + PADDLEHEIGHT + Random(i, 1) % (RESOLUTION - MARGIN - 2 * PADDLEHEIGHT) };
+			Ball ref, b;
+			byte expected, scored;
+
+			//Up to 8 times the normal speed
+			LaunchBall(&ref, ServeAngle(i, 2));
+			ref.vx *= 1 + i % 8;
+			ref.vy *= 1 + i % 8;
+			b = ref;
+
+			expected = FlyBall(&ref, p1, p2, 1 / 16.f, true, 200 * 16);
+			scored = FlyBall(&b, p1, p2, modes[m].step, modes[m].swept, 200 / modes[m].step);
+
+			if (scored != expected)
+				wrong++;
+			else if (scored == SCORED_NONE) {
+				float off = fabsf(b.x - ref.x) + fabsf(b.y - ref.y);
+				worst = off > worst ? off : worst;
+			}
+		}
+		printf("sweep: %s %5.2f%% of fast balls end wrong, the rest off by at most %.3f pixels\n",
+			modes[m].name, 100.0 * wrong / n, worst);
+	}
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.matches = n;
+	cfg.seed = 1;
+	cfg.maxTicks = maxTicks;
+	cfg.skill = SKILL_NORMAL;
+	for (m = 0; m < 2; m++) {
+		cfg.hz = m == 0 ? TICK_RATE : 10;
+		cfg.swept = m == 1;
+		start = Now();
+		RunMatches(&cfg, &stats);
+		elapsed = Now() - start;
+		printf("sweep: normal AI %s %4u Hz %8.0f matches/s, %8.0f ticks per match, %.2f hits per point, points %llu:%llu\n",
+			cfg.swept ? "swept" : "ticks", cfg.hz, stats.matches / elapsed, (double)stats.ticks / stats.matches,
+			(double)stats.hits / (stats.points[0] + stats.points[1]),
+			(unsigned long long)stats.points[0], (unsigned long long)stats.points[1]);
+	}
+}
+
+/*
+ *void BenchFast(unsigned int, unsigned int)
+ *This function plays AI against AI matches tick by tick and jumping from
+ *event to event, first checking every match comes out exactly the same
+ *both ways, and reports the speedup
+*/
+static void BenchFast(unsigned int matches, unsigned int maxTicks) {
+	const char *skills[] = { "chase", "easy", "normal", "hard" };
+	byte skill;
+	RunConfig cfg;
+	RunStats slow, fast;
+	double start, slowTime, fastTime;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.matches = matches;
+	cfg.seed = 1;
+	cfg.maxTicks = maxTicks;
+
+	for (skill = SKILL_CHASE; skill <= SKILL_HARD; skill++) {
+		cfg.skill = skill;
+
+		cfg.fast = true;
+		cfg.verify = true;
+		RunMatches(&cfg, &fast);
+		Check(fast.mismatches == 0);
+		printf("fast: %-6s %llu matches, %llu differ from tick by tick\n", skills[skill],
+			(unsigned long long)fast.matches, (unsigned long long)fast.mismatches);
+
+		cfg.verify = false;
+		cfg.fast = false;
+		start = Now();
+		RunMatches(&cfg, &slow);
+		slowTime = Now() - start;
+
+		cfg.fast = true;
+		start = Now();
+		RunMatches(&cfg, &fast);
+		fastTime = Now() - start;
+
+		printf("fast: %-6s %9.0f matches/s tick by tick, %9.0f jumping (%.1fx), %.1f of %.0f ticks per match run%s\n",
+			skills[skill], slow.matches / slowTime, fast.matches / fastTime, slowTime / fastTime,
+			(double)fast.played / fast.matches, (double)fast.ticks / fast.matches,
+			Check(memcmp(slow.points, fast.points, sizeof(slow.points)) == 0 && slow.ticks == fast.ticks) ? "" : " RESULTS DIFFER");
+	}
+}
+
+/*
+ *int HumanDir(const Game*, uint64_t, uint32_t, int)
+ *This function plays the left paddle a bit like a person with the keys:
+ *it only makes up its mind every few ticks and holds the key in between
+*/
+static int HumanDir(const Game *g, uint64_t seed, uint32_t tick, int dir) {
+	float aim;
+
+	if (tick % 8 != 0)
+		return dir;
+
+	aim = g->ball.y + (float)(Random(seed, tick) % 9) - 4;
+
+	return aim > g->player.height + 3 ? 1 : (aim < g->player.height - 3 ? -1 : 0);
+}
+
+/*
+ *void BenchReplay(unsigned int, unsigned int)
+ *This function records matches of a made up player against the AI into a
+ *replay archive, reports how small it is per second of play, plays every
+ *replay back from the mapped file checking it ends where the match did,
+ *and checks and times seeking to random ticks
+*/
+static void BenchReplay(unsigned int matches, unsigned int maxTicks) {
+	const char *path = "bench-replays.bin";
+	FILE *file = fopen(path, "wb");
+	Recorder rec;
+	Archive archive;
+	Replay r;
+	Playback p, q;
+	Game g;
+	byte a[SNAPSHOT_SIZE], b[SNAPSHOT_SIZE];
+	unsigned int i, played = 0, differ = 0, seeks = 0, seekDiffer = 0;
+	uint64_t ticks = 0, streamBytes = 0, bytes = 0;
+	double start, elapsed;
+
+	if (file == NULL) {
+		printf("replay: can't write %s\n", path);
+		return;
+	}
+
+	//Record, pressing space a random while after it's needed
+	for (i = 0; i < matches; i++) {
+		uint64_t seed = MatchSeed(11, i);
+		uint32_t wait = 0;
+		int dir = 0;
+
+		InitGame(&g, seed);
+		InitIntercept(&g.ai, false, SKILL_NORMAL, seed);
+		if (!InitRecorder(&rec, &g, 0)) {
+			printf("replay: out of memory\n");
+			break;
+		}
+
+		while (g.state != STATE_END && rec.ticks < maxTicks) {
+			if (g.state == STATE_HOME || g.state == STATE_READY) {
+				if (wait == 0)
+					wait = 20 + Random(seed, rec.ticks) % 100;
+				else if (--wait == 0)
+					RecordEvent(&rec, &g, EVENT_ADVANCE);
+			}
+
+			dir = HumanDir(&g, seed, rec.ticks, dir);
+			RecordTick(&rec, &g, dir, 0);
+		}
+
+		if (!SaveReplay(&rec, &g, file))
+			printf("replay: can't save match %u\n", i);
+		ticks += rec.ticks;
+		streamBytes += rec.streamSize;
+		FreeRecorder(&rec);
+	}
+	bytes = ftell(file);
+	fclose(file);
+
+	printf("replay: %u matches, %.1f s of play each, %.1f bytes per second (%.1f of them inputs)\n", matches,
+		(double)ticks / matches / TICK_RATE, (double)bytes / ticks * TICK_RATE, (double)streamBytes / ticks * TICK_RATE);
+
+	if (!MapArchive(&archive, path)) {
+		printf("replay: can't map %s\n", path);
+		return;
+	}
+
+	//Play every replay back
+	ticks = 0;
+	start = Now();
+	while (NextReplay(&archive, &r)) {
+		SeekReplay(&p, &r, 0);
+		ticks += PlayReplay(&p);
+		SaveSnapshot(&p.g, a);
+		differ += memcmp(a, r.final, SNAPSHOT_SIZE) != 0 || p.tick != r.ticks;
+		played++;
+	}
+	elapsed = Now() - start;
+
+	Check(played == matches && differ == 0);
+	printf("replay: played %u of %u back from the map, %u end differently, %.0f matches/s, %.1f M ticks/s\n",
+		played, matches, differ, played / elapsed, ticks / elapsed * 1e-6);
+
+	//Seek into the middle of replays and compare with playing up to there
+	archive.offset = 0;
+	start = Now();
+	for (i = 0; NextReplay(&archive, &r); i++) {
+		uint32_t tick = (uint32_t)(Random(13, i) % (r.ticks + 1));
+
+		SeekReplay(&p, &r, tick);
+		seeks++;
+
+		if (i % 16 == 0) { //Only some, it's slow
+			SeekReplay(&q, &r, 0);
+			while (q.tick < tick)
+				PlayTick(&q);
+			SaveSnapshot(&p.g, a);
+			SaveSnapshot(&q.g, b);
+			seekDiffer += memcmp(a, b, SNAPSHOT_SIZE) != 0;
+		}
+	}
+	elapsed = Now() - start;
+
+	Check(seekDiffer == 0);
+	printf("replay: %u seeks to random ticks, %u differ from playing there, %.1f us per seek with the checks\n",
+		seeks, seekDiffer, elapsed / seeks * 1e6);
+
+	UnmapArchive(&archive);
+	remove(path);
+}
+
+/*
+ *byte NetInput(const Rollback*, uint64_t, uint32_t*)
+ *This function is a made up player for one side of a network match: it
+ *follows the ball with its paddle every few ticks and presses space a
+ *random while after the match is waiting for it
+*/
+static byte NetInput(const Rollback *r, uint64_t seed, uint32_t *wait) {
+	const Game *g = &r->game;
+	float height = r->left ? g->player.height : g->player2.height;
+	byte input = r->tick % 8 < 6 ? (g->ball.y > height + 2 ? INPUT_DOWN : (g->ball.y < height - 2 ? INPUT_UP : INPUT_STILL)) : INPUT_STILL;
+
+	if (g->state == STATE_HOME || g->state == STATE_READY || g->state == STATE_END) {
+		if (*wait == 0)
+			*wait = 20 + Random(seed, r->tick) % 200;
+		else if (--*wait == 0)
+			input |= NET_ADVANCE;
+	}
+
+	return input;
+}
+
+/*
+ *void BenchNet(unsigned int)
+ *This function plays two sides of a network match against each other over
+ *localhost through simulated bad networks, checks that both end up exactly
+ *where the match played straight with the same inputs does, and times the
+ *replays after wrong guesses
+*/
+static void BenchNet(unsigned int ticks) {
+	struct { float loss; unsigned int latency, jitter; } nets[] = { { 0, 0, 0 }, { 0.05f, 40, 20 }, { 0.2f, 80, 60 } };
+	uint64_t now;
+	Clock fake = { FakeNow, &now };
+	byte *inputs[2];
+	unsigned int c, s, frames;
+	Rollback r;
+	Game ref;
+	uint32_t wait[2];
+	double start, elapsed, slowest;
+
+	inputs[0] = malloc(ticks);
+	inputs[1] = malloc(ticks);
+	if (inputs[0] == NULL || inputs[1] == NULL) {
+		printf("net: out of memory\n");
+		return;
+	}
+
+	for (c = 0; c < sizeof(nets) / sizeof(nets[0]); c++) {
+		Netplay *sides = malloc(sizeof(Netplay) * 2);
+
+		wait[0] = wait[1] = 0;
+
+		now = 0;
+		if (sides == NULL || !OpenNetplay(&sides[0], 0, NULL, 0, 21, fake) ||
+			!OpenNetplay(&sides[1], 0, "127.0.0.1", sides[0].port, 0, fake)) {
+			printf("net: can't open localhost UDP ports\n");
+			free(sides);
+			break;
+		}
+		for (s = 0; s < 2; s++)
+			SimulateNetwork(&sides[s], nets[c].loss, nets[c].latency, nets[c].jitter);
+
+		//Ten millisecond frames of a tick each until both sides played them all
+		//and then until both have all the other side's inputs
+		slowest = 0;
+		start = Now();
+		for (frames = 0; frames < ticks * 4; frames++) {
+			bool done = true;
+
+			now += 10000000;
+			for (s = 0; s < 2; s++) {
+				Netplay *n = &sides[s];
+				double frame = Now();
+
+				PollNetplay(n);
+				if (n->started && n->rb.tick < ticks) {
+					byte input = NetInput(&n->rb, s, &wait[s]);
+
+					if (StepNetplay(n, input))
+						inputs[s][n->rb.tick - 1] = input;
+				}
+				else
+					SyncNetplay(n);
+
+				frame = Now() - frame;
+				slowest = frame > slowest ? frame : slowest;
+				done = done && n->started && n->rb.tick == ticks && n->rb.confirmed == ticks;
+			}
+			if (done)
+				break;
+		}
+		elapsed = Now() - start;
+
+		//The same inputs played straight
+		StartNetGame(&ref, 21);
+		for (s = 0; s < ticks; s++)
+			NetTick(&ref, inputs[0][s], inputs[1][s]);
+
+		printf("net: %2.0f%% loss %3u+%-3u ms: %u ticks in %u frames, %s, %s, %llu+%llu packets lost\n",
+			nets[c].loss * 100, nets[c].latency, nets[c].jitter, ticks, frames,
+			Check(SameSnapshot(&sides[0].rb.game, &ref)) ? "host same as straight" : "HOST DIFFERS",
+			Check(SameSnapshot(&sides[1].rb.game, &ref)) ? "guest same as straight" : "GUEST DIFFERS",
+			(unsigned long long)sides[0].lost, (unsigned long long)sides[1].lost);
+		printf("net: %2.0f%% loss %3u+%-3u ms: %llu rollbacks of %.1f ticks on average, %u at most, %.1f us per frame, %.1f us at worst\n",
+			nets[c].loss * 100, nets[c].latency, nets[c].jitter, (unsigned long long)(sides[0].rb.rollbacks + sides[1].rb.rollbacks),
+			(double)(sides[0].rb.replayed + sides[1].rb.replayed) / (sides[0].rb.rollbacks + sides[1].rb.rollbacks + !(sides[0].rb.rollbacks + sides[1].rb.rollbacks)),
+			sides[0].rb.longest > sides[1].rb.longest ? sides[0].rb.longest : sides[1].rb.longest,
+			elapsed / frames / 2 * 1e6, slowest * 1e6);
+
+		CloseNetplay(&sides[0]);
+		CloseNetplay(&sides[1]);
+		free(sides);
+	}
+
+	//The cost of a rollback on its own: put back the state and replay a full window
+	StartNetGame(&ref, 21);
+	InitRollback(&r, &ref, true);
+	wait[0] = 0;
+	while (r.tick < 1000) {
+		AddRemoteInput(&r, r.tick, INPUT_STILL);
+		AdvanceRollback(&r, NetInput(&r, 0, &wait[0]));
+	}
+	start = Now();
+	for (s = 0; s < 100000; s++) {
+		r.replayFrom = r.tick - ROLLBACK_WINDOW;
+		ReplayRollback(&r);
+	}
+	elapsed = Now() - start;
+	printf("net: a rollback of %u ticks takes %.2f us (%.0f ns per tick, the state is a %u byte copy)\n",
+		ROLLBACK_WINDOW, elapsed / s * 1e6, elapsed / s / ROLLBACK_WINDOW * 1e9, (unsigned int)sizeof(Game));
+
+	free(inputs[0]);
+	free(inputs[1]);
+}
+
+/*
+ *void BenchServer(unsigned int, unsigned int)
+ *This function starts a match server and plays it with made up clients
+ *from one socket, one per match against the AI, each sending its input
+ *(or a keepalive while it holds the same direction) ten times a second
+ *and getting the state back ten times a second. It
+ *reports how late the server's ticks ran and what it cost.
+*/
+static void BenchServer(unsigned int matches, unsigned int seconds) {
+	const unsigned short port = 47015;
+	Server server;
+	ShardStats stats;
+	struct { byte state, sent; float y, height; } *clients = calloc(matches, sizeof(*clients));
+	struct mmsghdr msgs[SERVER_BATCH];
+	struct iovec iov[SERVER_BATCH];
+	struct sockaddr_in to[SERVER_BATCH], local;
+	byte data[SERVER_BATCH][SERVER_STATE_SIZE];
+	uint64_t states = 0, ms, i;
+	struct timespec next;
+	int sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+	double start, elapsed;
+
+	if (clients == NULL || sock < 0 || !StartServer(&server, port, 0, matches, TICK_RATE, 10)) {
+		printf("server: can't start\n");
+		free(clients);
+		return;
+	}
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	bind(sock, (struct sockaddr *)&local, sizeof(local));
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	start = Now();
+	for (ms = 0; ms < seconds * 1000ull; ms++) {
+		unsigned int count = 0;
+		int got, k;
+
+		//Every client sends once every 100 ms, a hundredth of them each millisecond
+		for (i = ms % 100; i < matches; i += 100) {
+			byte *out = data[count], input;
+
+			input = clients[i].y > clients[i].height + 2 ? INPUT_DOWN : (clients[i].y < clients[i].height - 2 ? INPUT_UP : INPUT_STILL);
+			if (clients[i].state == STATE_HOME || clients[i].state == STATE_READY || clients[i].state == STATE_END)
+				input |= NET_ADVANCE;
+			//Holding the same direction only keeps the match alive
+			if (input == clients[i].sent)
+				input |= SERVER_KEEPALIVE;
+			else
+				clients[i].sent = input;
+
+			for (k = 0; k < 4; k++) {
+				out[k] = (byte)(SERVER_MAGIC >> 8 * k);
+				out[4 + k] = (byte)(i >> 8 * k);
+			}
+			out[8] = 0;
+			out[9] = MODE_ONE;
+			out[10] = input;
+
+			memset(&to[count], 0, sizeof(to[count]));
+			to[count].sin_family = AF_INET;
+			to[count].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			to[count].sin_port = htons(port + i % server.shardCount);
+			memset(&msgs[count], 0, sizeof(msgs[count]));
+			iov[count].iov_base = out;
+			iov[count].iov_len = SERVER_INPUT_SIZE;
+			msgs[count].msg_hdr.msg_name = &to[count];
+			msgs[count].msg_hdr.msg_namelen = sizeof(to[count]);
+			msgs[count].msg_hdr.msg_iov = &iov[count];
+			msgs[count].msg_hdr.msg_iovlen = 1;
+			if (++count == SERVER_BATCH || i + 100 >= matches) {
+				sendmmsg(sock, msgs, count, 0);
+				count = 0;
+			}
+		}
+
+		//What came back
+		do {
+			for (k = 0; k < SERVER_BATCH; k++) {
+				memset(&msgs[k], 0, sizeof(msgs[k]));
+				iov[k].iov_base = data[k];
+				iov[k].iov_len = SERVER_STATE_SIZE;
+				msgs[k].msg_hdr.msg_iov = &iov[k];
+				msgs[k].msg_hdr.msg_iovlen = 1;
+			}
+			got = recvmmsg(sock, msgs, SERVER_BATCH, MSG_DONTWAIT, NULL);
+			for (k = 0; k < got; k++) {
+				uint32_t id = data[k][4] | data[k][5] << 8 | (uint32_t)data[k][6] << 16 | (uint32_t)data[k][7] << 24;
+
+				if (msgs[k].msg_len != SERVER_STATE_SIZE || id >= matches)
+					continue;
+				clients[id].state = data[k][12];
+				memcpy(&clients[id].y, data[k] + 18, 4);
+				memcpy(&clients[id].height, data[k] + 22, 4);
+				states++;
+			}
+		} while (got == SERVER_BATCH);
+
+		//Until the next millisecond
+		next.tv_nsec += 1000000;
+		if (next.tv_nsec >= 1000000000) {
+			next.tv_nsec -= 1000000000;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+	elapsed = Now() - start;
+
+	StopServer(&server);
+	ServerStats(&server, &stats);
+	printf("server: %u matches on %u shards for %.1f s, %.0f ticks/s of %u expected, %llu state packets back\n",
+		matches, server.shardCount, elapsed, stats.ticks / elapsed, matches * TICK_RATE, (unsigned long long)states);
+	printf("server: ticks late by p50 %.2f ms, p99 %.2f ms, p99.9 %.2f ms, %llu in and %llu out packets/s, %.1f%% of a core\n",
+		LatenessPercentile(&stats, 0.5) * 1e3, LatenessPercentile(&stats, 0.99) * 1e3, LatenessPercentile(&stats, 0.999) * 1e3,
+		(unsigned long long)(stats.received / elapsed), (unsigned long long)(stats.sent / elapsed), stats.cpu * 1e-9 / elapsed * 100);
+
+	free(server.shards);
+	free(clients);
+	close(sock);
+}
+
+/*
+ *bool SameKnown(const SpectateState*, const SpectateState*)
+ *This function compares what two ends of a spectator stream know
+*/
+static bool SameKnown(const SpectateState *a, const SpectateState *b) {
+	return a->x == b->x && a->y == b->y && a->vx == b->vx && a->vy == b->vy && a->player == b->player &&
+		a->player2 == b->player2 && a->playerV == b->playerV && a->player2V == b->player2V &&
+		a->score == b->score && a->state == b->state;
+}
+
+/*
+ *byte SpectatedInput(const Game*, uint64_t, uint32_t, int*)
+ *This function is the made up player of a watched match against the AI
+*/
+static byte SpectatedInput(const Game *g, uint64_t seed, uint32_t tick, int *dir) {
+	byte input;
+
+	*dir = HumanDir(g, seed, tick, *dir);
+	input = *dir < 0 ? INPUT_UP : (*dir > 0 ? INPUT_DOWN : INPUT_STILL);
+	if ((g->state == STATE_HOME || g->state == STATE_READY || g->state == STATE_END) && Random(seed, tick) % 50 == 0)
+		input |= NET_ADVANCE;
+
+	return input;
+}
+
+/*
+ *void BenchSpectateCodec(unsigned int, unsigned int)
+ *This function streams matches to a spectator who sees every packet, one
+ *who joins late and one on a network that loses 1% of them. It checks
+ *that they all know what the sending end knows whenever they are in
+ *sync, how far that is from the real match and how many bytes it costs.
+*/
+static void BenchSpectateCodec(unsigned int matches, unsigned int ticks) {
+	Broadcast b;
+	Spectator all, late, lossy;
+	Game g;
+	unsigned int i, t, k, differ = 0, unsynced = 0;
+	uint64_t packets = 0, bytes = 0, lossyTicks = 0, lost = 0;
+	float worst = 0;
+	double start, elapsed;
+
+	start = Now();
+	for (i = 0; i < matches; i++) {
+		uint64_t seed = MatchSeed(14, i);
+		uint32_t join = ticks / 3 + Random(seed, 0) % (ticks / 3 + 1);
+		int dir = 0;
+
+		memset(&g, 0, sizeof(Game));
+		InitGame(&g, seed);
+		InitIntercept(&g.ai, false, SKILL_NORMAL, seed);
+		InitBroadcast(&b, i);
+		InitSpectator(&all, i);
+		InitSpectator(&late, i);
+		InitSpectator(&lossy, i);
+
+		for (t = 0; t < ticks; t++) {
+			SharedPacket *p;
+			bool got;
+
+			//Joining late, caught up from the history
+			if (t == join)
+				for (k = 0; k < b.historyCount - b.open; k++)
+					ReadSpectate(&late, b.history[k]->data, b.history[k]->size);
+
+			NetTick(&g, SpectatedInput(&g, seed, t, &dir), INPUT_STILL);
+			p = BroadcastTick(&b, &g);
+
+			if (p == NULL)
+				continue;
+
+			packets++;
+			bytes += p->size;
+			ReadSpectate(&all, p->data, p->size);
+			if (t >= join)
+				ReadSpectate(&late, p->data, p->size);
+			got = Random(seed ^ 1, t) % 100 != 0;
+			if (got)
+				ReadSpectate(&lossy, p->data, p->size);
+
+			if (!all.synced || !SameKnown(&all.s, &b.known) || (t >= join && (!late.synced || !SameKnown(&late.s, &b.known))) ||
+				(got && lossy.synced && !SameKnown(&lossy.s, &b.known)))
+				differ++;
+			unsynced += !lossy.synced;
+
+			worst = fmaxf(worst, fabsf(all.s.x / SPECTATE_SCALE - g.ball.x));
+			worst = fmaxf(worst, fabsf(all.s.y / SPECTATE_SCALE - g.ball.y));
+			worst = fmaxf(worst, fabsf(all.s.player / SPECTATE_SCALE - g.player.height));
+			worst = fmaxf(worst, fabsf(all.s.player2 / SPECTATE_SCALE - g.player2.height));
+		}
+
+		lossyTicks += lossy.ticks;
+		lost += lossy.lost;
+		FreeBroadcast(&b);
+	}
+	elapsed = Now() - start;
+
+	printf("spectate: %u matches of %u ticks, %.1f bytes a tick, %.0f bytes/s of payload per spectator (%.0f with UDP/IP headers), %.0f packets/s\n",
+		matches, ticks, (double)bytes / matches / ticks, (double)bytes / matches / ticks * TICK_RATE,
+		(double)(bytes + packets * 28) / matches / ticks * TICK_RATE, (double)TICK_RATE / SPECTATE_TICKS);
+	Check(differ == 0);
+	printf("spectate: %u packets where a spectator knew something else, off by at most %.3f px, encoded at %.1f M ticks/s\n",
+		differ, worst, (double)matches * ticks / elapsed * 1e-6);
+	printf("spectate: losing 1%% of packets broke the stream %llu times, out of sync for %.1f%% of packets (%.1f%% of ticks seen)\n",
+		(unsigned long long)lost, 100.0 * unsynced / packets, 100.0 * lossyTicks / matches / ticks);
+}
+
+/*
+ *void BenchSpectate(unsigned int, unsigned int)
+ *This function checks the spectator stream codec, then runs a match server
+ *twice, once with players only and once with spectators watching too,
+ *decodes everything the spectators were sent and puts a price on
+ *every thousand of them
+*/
+static void BenchSpectate(unsigned int spectators, unsigned int seconds) {
+	enum { MATCHES = 16, SINKS = 64 };
+	const unsigned short port = 48015;
+	unsigned int perSink = (spectators + SINKS - 2) / (SINKS - 1);
+	double cpu[2], packetsIn = 0, bytesIn = 0, elapsed = 1;
+	Spectator *watchers = malloc(sizeof(Spectator) * SINKS * MATCHES);
+	int sinks[SINKS], player = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+	unsigned int run, i, k, synced = 0;
+	uint64_t lost = 0, dropped = 0;
+	struct sockaddr_in local;
+	Game views[MATCHES];
+	int dirs[MATCHES];
+
+	BenchSpectateCodec(spectators / 16 + 1, 6000);
+
+	perSink = CLAMP(perSink, 1, MATCHES);
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	bind(player, (struct sockaddr *)&local, sizeof(local));
+	for (i = 0; i < SINKS; i++) {
+		int size = 1 << 20;
+
+		sinks[i] = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+		setsockopt(sinks[i], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+		bind(sinks[i], (struct sockaddr *)&local, sizeof(local));
+	}
+	if (watchers == NULL || player < 0) {
+		printf("spectate: can't start\n");
+		free(watchers);
+		return;
+	}
+
+	for (run = 0; run < 2; run++) {
+		Server server;
+		ShardStats stats;
+		struct timespec next;
+		unsigned int ms;
+		double start;
+
+		if (!StartServer(&server, port + run * 100, 1, MATCHES, TICK_RATE, 10)) {
+			printf("spectate: can't start the server\n");
+			break;
+		}
+		memset(views, 0, sizeof(views));
+		memset(dirs, 0, sizeof(dirs));
+		for (i = 0; i < SINKS * MATCHES; i++)
+			InitSpectator(&watchers[i], i % MATCHES);
+
+		clock_gettime(CLOCK_MONOTONIC, &next);
+		start = Now();
+		for (ms = 0; ms < seconds * 1000; ms++) {
+			struct sockaddr_in to;
+			byte out[SERVER_INPUT_SIZE];
+			struct mmsghdr msgs[SERVER_BATCH];
+			struct iovec iov[SERVER_BATCH];
+			static byte data[SERVER_BATCH][SPECTATE_PACKET];
+			int got, j;
+
+			memset(&to, 0, sizeof(to));
+			to.sin_family = AF_INET;
+			to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			to.sin_port = htons(port + run * 100);
+			for (k = 0; k < 4; k++)
+				out[k] = (byte)(SERVER_MAGIC >> 8 * k);
+			out[9] = MODE_ONE;
+
+			//The players send every 10 ms, from what the spectators saw of their match
+			if (ms % 10 == 0) {
+				for (i = 0; i < MATCHES; i++) {
+					for (k = 0; k < 4; k++)
+						out[4 + k] = (byte)(i >> 8 * k);
+					out[8] = 0;
+					if (watchers[i].synced)
+						SpectatorGame(&watchers[i], &views[i]);
+					out[10] = SpectatedInput(&views[i], i, ms, &dirs[i]);
+					if (ms == 0)
+						out[10] = NET_ADVANCE;
+					sendto(player, out, sizeof(out), 0, (struct sockaddr *)&to, sizeof(to));
+				}
+			}
+
+			//Once the matches are there the first sink, the players' eyes,
+			//watches every match. With spectators every other sink watches
+			//perSink of them, a sink a millisecond.
+			k = ms - 5;
+			if (ms >= 5 && k < (run ? SINKS : 1)) {
+				for (i = 0; i < (k ? perSink : MATCHES); i++) {
+					unsigned int id = (k + i) % MATCHES, b;
+
+					for (b = 0; b < 4; b++)
+						out[4 + b] = (byte)(id >> 8 * b);
+					out[8] = 2;
+					sendto(sinks[k], out, sizeof(out), 0, (struct sockaddr *)&to, sizeof(to));
+				}
+			}
+
+			//What the spectators were sent
+			for (k = 0; k < SINKS; k++) {
+				do {
+					for (j = 0; j < SERVER_BATCH; j++) {
+						memset(&msgs[j], 0, sizeof(msgs[j]));
+						iov[j].iov_base = data[j];
+						iov[j].iov_len = SPECTATE_PACKET;
+						msgs[j].msg_hdr.msg_iov = &iov[j];
+						msgs[j].msg_hdr.msg_iovlen = 1;
+					}
+					got = recvmmsg(sinks[k], msgs, SERVER_BATCH, MSG_DONTWAIT, NULL);
+					for (j = 0; j < got; j++) {
+						uint32_t id = data[j][1] | data[j][2] << 8 | (uint32_t)data[j][3] << 16 | (uint32_t)data[j][4] << 24;
+
+						if (msgs[j].msg_len < SPECTATE_HEADER || id >= MATCHES)
+							continue;
+						ReadSpectate(&watchers[k * MATCHES + id], data[j], msgs[j].msg_len);
+						if (run) {
+							packetsIn++;
+							bytesIn += msgs[j].msg_len;
+						}
+					}
+				} while (got == SERVER_BATCH);
+			}
+
+			next.tv_nsec += 1000000;
+			if (next.tv_nsec >= 1000000000) {
+				next.tv_nsec -= 1000000000;
+				next.tv_sec++;
+			}
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+		}
+		elapsed = Now() - start;
+
+		StopServer(&server);
+		ServerStats(&server, &stats);
+		cpu[run] = stats.cpu * 1e-9 / elapsed;
+		dropped += stats.dropped;
+		free(server.shards);
+
+		if (run) {
+			for (k = 0; k < SINKS; k++) {
+				for (i = 0; i < (k ? perSink : MATCHES); i++) {
+					synced += watchers[k * MATCHES + (k + i) % MATCHES].synced;
+					lost += watchers[k * MATCHES + (k + i) % MATCHES].lost;
+				}
+			}
+		}
+	}
+
+	spectators = (SINKS - 1) * perSink;
+	printf("spectate: %u matches watched by %u spectators, %u in sync at the end, %llu stream breaks, %llu packets not sent, %.0f bytes/s each (%.0f packets/s)\n",
+		MATCHES, spectators + MATCHES, synced, (unsigned long long)lost, (unsigned long long)dropped, bytesIn / elapsed / (spectators + MATCHES), packetsIn / elapsed / (spectators + MATCHES));
+	printf("spectate: %.2f%% of a core for the matches alone, %.2f%% with the spectators, %.2f%% per 1000 spectators\n",
+		cpu[0] * 100, cpu[1] * 100, (cpu[1] - cpu[0]) * 100 * 1000 / spectators);
+
+	for (i = 0; i < SINKS; i++)
+		close(sinks[i]);
+	close(player);
+	free(watchers);
+}
+
+/*
+ *void BenchDiff(unsigned int)
+ *This function draws AI against AI matches with their text in 8 and 32
+ *bit, encodes every frame as the tiles that changed and decodes it into
+ *a copy, checking the copy always matches. It reports the bytes and blit
+ *area a frame takes against the whole raster, then checks every tile
+ *compare against the scalar one and times them.
+*/
+static void BenchDiff(unsigned int frames) {
+	static uint32_t pixels[RESOLUTION * RESOLUTION], copy[RESOLUTION * RESOLUTION], previous[RESOLUTION * RESOLUTION];
+	static byte out[FRAME_MAX_SIZE];
+	byte formats[] = { RASTER_8, RASTER_32 };
+	int lanes[] = { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2 };
+	Rect rects[MAX_DIRTY_RECTS];
+	FrameEncoder e;
+	uint32_t dirty[TILE_WORDS], expected[TILE_WORDS];
+	unsigned int f, i, k, differ, wrong, rectCount;
+	uint64_t bytes, tiles, area;
+	double start, elapsed;
+	Raster r;
+	Game g;
+
+	for (f = 0; f < 2; f++) {
+		unsigned int size = RESOLUTION * RESOLUTION * formats[f];
+
+		if (!InitFrameEncoder(&e, formats[f])) {
+			printf("diff: out of memory\n");
+			return;
+		}
+		InitGame(&g, 1);
+		InitRaster(&r, pixels, formats[f]);
+		memset(copy, 0, sizeof(copy));
+		bytes = tiles = area = 0;
+		differ = rectCount = 0;
+
+		start = Now();
+		for (i = 0; i < frames; i++) {
+			unsigned int n;
+
+			if (g.state == STATE_HOME || g.state == STATE_READY || g.state == STATE_END)
+				AdvanceState(&g);
+			TickGame(&g, 0, 0);
+			UpdateAI(&g.player, g.ball, g.state);
+			RasterTableText(&r, g.score, g.state, g.mode);
+			RasterTable(&r, g.ball, g.player, g.player2, g.state);
+
+			n = EncodeFrame(&e, pixels, out);
+			bytes += n;
+			tiles += e.dirtyCount;
+			if (!DecodeFrame(copy, formats[f], out, n, dirty) || memcmp(dirty, e.dirty, sizeof(dirty)) != 0 || memcmp(copy, pixels, size) != 0)
+				differ++;
+
+			n = DirtyRects(e.dirty, rects);
+			rectCount += n;
+			for (k = 0; k < n; k++)
+				area += (rects[k].right - rects[k].left) * (rects[k].bottom - rects[k].top);
+		}
+		elapsed = Now() - start;
+
+		Check(differ == 0);
+		printf("diff: %2d bit %6.1f bytes a frame (%.2f%% of %u), %.1f tiles, %.1f boxes covering %.1f%% of the raster, %u frames decoded wrong\n",
+			formats[f] * 8, (double)bytes / frames, 100.0 * bytes / frames / size, size, (double)tiles / frames,
+			(double)rectCount / frames, 100.0 * area / frames / (RESOLUTION * RESOLUTION), differ);
+		printf("diff: %2d bit %.2f M frames/s drawn, encoded and decoded\n", formats[f] * 8, frames / elapsed * 1e-6);
+		FreeFrameEncoder(&e);
+	}
+
+	//Every compare against the scalar one, on frames apart by a few ticks
+	for (f = 0; f < 2; f++) {
+		for (k = 0; k < sizeof(lanes) / sizeof(lanes[0]); k++) {
+			if (!SimdSupported(lanes[k]))
+				continue;
+
+			InitGame(&g, 2);
+			InitRaster(&r, pixels, formats[f]);
+			wrong = 0;
+			elapsed = 0;
+			for (i = 0; i < frames / 4; i++) {
+				memcpy(previous, pixels, sizeof(pixels));
+				if (g.state == STATE_HOME || g.state == STATE_READY || g.state == STATE_END)
+					AdvanceState(&g);
+				TickGame(&g, 0, 0);
+				UpdateAI(&g.player, g.ball, g.state);
+				RasterTableText(&r, g.score, g.state, g.mode);
+				RasterTable(&r, g.ball, g.player, g.player2, g.state);
+				//A stray pixel now and then
+				if (i % 7 == 0)
+					((byte *)pixels)[Random(3, i) % (RESOLUTION * RESOLUTION * formats[f])] ^= 1;
+
+				DiffTilesWith(SIMD_SCALAR, previous, pixels, formats[f], expected);
+				start = Now();
+				DiffTilesWith(lanes[k], previous, pixels, formats[f], dirty);
+				elapsed += Now() - start;
+				wrong += memcmp(dirty, expected, sizeof(dirty)) != 0;
+			}
+
+			Check(wrong == 0);
+			printf("diff: %2d bit compare %2d lanes %7.1f ns a frame (%.1f GB/s), %u masks differ from scalar\n", formats[f] * 8, lanes[k],
+				elapsed / (frames / 4) * 1e9, (double)(frames / 4) * 2 * RESOLUTION * RESOLUTION * formats[f] / elapsed * 1e-9, wrong);
+		}
+	}
+}
+
+/*
+ *uint32_t NearestPixel(const uint32_t*, const Scaler*, unsigned int, unsigned int)
+ *This function works out the pixel of the screen at (x, y) on its own,
+ *dividing, to check the scaler against
+*/
+static uint32_t NearestPixel(const uint32_t *pixels, const Scaler *s, unsigned int x, unsigned int y) {
+	if (x < s->left || x >= s->left + s->size || y < s->top || y >= s->top + s->size)
+		return 0;
+	x = ((x - s->left + 1) * RESOLUTION + s->size - 1) / s->size - 1;
+	y = ((y - s->top + 1) * RESOLUTION + s->size - 1) / s->size - 1;
+
+	return pixels[y * RESOLUTION + x];
+}
+
+/*
+ *void BenchScale(unsigned int)
+ *This function scales played frames to 1080p and 4K screens with every
+ *store width, checks the screens pixel for pixel against scaling each
+ *pixel on its own, and reports the screen megapixels per second of whole
+ *frames and how many pixels a frame of changed tiles writes
+*/
+static void BenchScale(unsigned int frames) {
+	static uint32_t pixels[RESOLUTION * RESOLUTION];
+	unsigned short sizes[][2] = { { 1920, 1080 }, { 3840, 2160 }, { 1024, 768 }, { 100, 80 } };
+	int lanes[] = { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2 };
+	Rect rects[SCALE_MAX_RECTS];
+	FrameEncoder e;
+	Scaler sc;
+	Raster r;
+	Game g;
+	unsigned int z, k, i, wrong;
+	double start, elapsed;
+
+	if (!InitFrameEncoder(&e, RASTER_32)) {
+		printf("scale: out of memory\n");
+		return;
+	}
+
+	for (z = 0; z < sizeof(sizes) / sizeof(sizes[0]); z++) {
+		unsigned int w = sizes[z][0], h = sizes[z][1], x, y;
+		uint32_t *screen = malloc(sizeof(uint32_t) * w * h);
+
+		if (screen == NULL) {
+			printf("scale: out of memory\n");
+			break;
+		}
+
+		for (k = 0; k < sizeof(lanes) / sizeof(lanes[0]); k++) {
+			uint64_t written = 0;
+
+			if (!SimdSupported(lanes[k]))
+				continue;
+
+			//Played frames, only the changed tiles after the first
+			InitGame(&g, 3);
+			InitRaster(&r, pixels, RASTER_32);
+			ResetFrameEncoder(&e);
+			InitScaler(&sc, w, h);
+			memset(screen, 0x55, sizeof(uint32_t) * w * h);
+			wrong = 0;
+			for (i = 0; i < frames / 16; i++) {
+				FollowTick(&g);
+				RasterTableText(&r, g.score, g.state, g.mode);
+				RasterTable(&r, g.ball, g.player, g.player2, g.state);
+				DiffFrame(&e, pixels);
+				if (i == 1)
+					written = sc.written;
+				ScaleFrameWith(lanes[k], &sc, pixels, screen, w, i == 0 ? NULL : e.dirty, rects);
+			}
+			for (y = 0; y < h; y++)
+				for (x = 0; x < w; x++)
+					wrong += screen[y * w + x] != NearestPixel(pixels, &sc, x, y);
+			written = (sc.written - written) / (frames / 16 - 1);
+
+			//Whole frames
+			start = Now();
+			for (i = 0; i < frames / 16; i++)
+				ScaleFrameWith(lanes[k], &sc, pixels, screen, w, NULL, rects);
+			elapsed = Now() - start;
+
+			Check(wrong == 0);
+			printf("scale: %4ux%-4u %2d lanes %8.1f MP/s whole (%.3f ms a frame), changed tiles %7.0f pixels a frame (%.2f%% of the screen), %u pixels wrong\n",
+				w, h, lanes[k], (double)sc.size * sc.size * (frames / 16) / elapsed * 1e-6, elapsed / (frames / 16) * 1e3,
+				(double)written, 100.0 * written / ((double)w * h), wrong);
+		}
+		free(screen);
+	}
+	FreeFrameEncoder(&e);
+}
+
+/*
+ *void ProbedTicks(Game*, Game*, Recorder*, unsigned int, bool)
+ *This function plays ticks of a recorded match the way the game's RunTick
+ *does, timing each one with a probe if probed is set
+*/
+static void ProbedTicks(Game *g, Game *before, Recorder *r, unsigned int ticks, bool probed) {
+	uint64_t start = 0;
+
+	for (; ticks > 0; ticks--) {
+		if (probed)
+			start = PROBE_START();
+
+		if (g->state == STATE_HOME || g->state == STATE_READY || g->state == STATE_END)
+			RecordEvent(r, g, EVENT_ADVANCE);
+		*before = *g;
+		RecordTick(r, g, g->ball.y > g->player.height + 1 ? 1 : (g->ball.y < g->player.height - 1 ? -1 : 0), 0);
+
+		if (probed)
+			PROBE_STOP(PROBE_TICK, start);
+	}
+}
+
+//What a thread of the probe benchmark does
+typedef struct ProbeWork {
+	pthread_t thread;
+	unsigned int index, count;
+	bool trace;
+} ProbeWork;
+
+/*
+ *void *ProbeWorker(void*)
+ *This function records count values from its own thread. Traced values
+ *carry the thread and how many came before it so a reader can check them.
+*/
+static void *ProbeWorker(void *arg) {
+	ProbeWork *w = arg;
+	unsigned int i;
+
+	for (i = 0; i < w->count; i++)
+		ProbeValue(w->trace ? PROBE_PAINT : PROBE_PRESENT, w->trace ? (uint64_t)w->index << 32 | i : 1000 + i % 5000);
+
+	return NULL;
+}
+
+/*
+ *int CompareU64(const void*, const void*)
+ *This function orders values for qsort
+*/
+static int CompareU64(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ *void BenchProbe(unsigned int)
+ *This function measures what the probes add to a tick while they are off
+ *and on, checks the histograms' percentiles against the real ones and
+ *their totals across threads, and follows the trace ring while threads
+ *write to it, counting any event that comes out torn
+*/
+static void BenchProbe(unsigned int ticks) {
+	double ps[] = { 0.5, 0.9, 0.99, 0.999 }, best[3] = { 1e9, 1e9, 1e9 }, start, elapsed, worst = 0;
+	ProbeWork work[4];
+	TraceReader reader;
+	TraceEvent e;
+	uint64_t *values, expected, next[4] = { 0 }, read = 0, torn = 0, written;
+	unsigned int i, k, round;
+	Recorder recorder;
+	Game g, before;
+
+	//A tick plain, probed while probing is off and probed while it is on,
+	//the best of a few rounds of each
+	InitGame(&g, 3);
+	if (!InitRecorder(&recorder, &g, 0)) {
+		printf("probe: out of memory\n");
+		return;
+	}
+	StartProbes(false);
+	for (round = 0; round < 15; round++)
+		for (k = 0; k < 3; k++) {
+			probing = k == 2;
+			start = Now();
+			ProbedTicks(&g, &before, &recorder, ticks, k > 0);
+			elapsed = (Now() - start) / ticks * 1e9;
+			best[k] = fmin(best[k], elapsed);
+		}
+	probing = false;
+	FreeRecorder(&recorder);
+	printf("probe: %.2f ns per tick, %.2f ns probed while off (%+.2f ns, %+.2f%%), %.2f ns while on (%+.2f ns)\n",
+		best[0], best[1], best[1] - best[0], (best[1] / best[0] - 1) * 100, best[2], best[2] - best[0]);
+
+	//Percentiles of a long tailed spread of times, from 100 ns to about 10 ms
+	values = malloc(sizeof(uint64_t) * ticks);
+	if (values == NULL) {
+		printf("probe: out of memory\n");
+		return;
+	}
+	ResetProbes();
+	for (i = 0; i < ticks; i++) {
+		double u = (Random(11, i) % 1000000) / 1e6;
+
+		values[i] = 100 + (uint64_t)(exp(u * u * 11.5));
+		ProbeValue(PROBE_TABLE, values[i]);
+	}
+	qsort(values, ticks, sizeof(uint64_t), CompareU64);
+	for (k = 0; k < 4; k++) {
+		double real = (double)values[(size_t)(ps[k] * (ticks - 1))], got = (double)ProbePercentile(PROBE_TABLE, ps[k]);
+
+		printf("probe: p%-5g real %8.0f ns histogram %8.0f ns (%+.2f%%)\n", ps[k] * 100, real, got, (got / real - 1) * 100);
+		worst = fmax(worst, fabs(got / real - 1));
+	}
+	printf("probe: worst percentile error %.2f%%, %u buckets of %u bytes per thread\n", worst * 100, PROBE_BUCKETS, (unsigned int)sizeof(ProbeThread));
+	free(values);
+
+	//Times around every power of two, up to the largest, land in a bucket
+	for (k = 0, round = 0; k < 64; k++) {
+		uint64_t t = 1ull << k;
+
+		round += ProbeBucket(t) >= PROBE_BUCKETS || ProbeBucket(t - 1) >= PROBE_BUCKETS || ProbeBucket(t | (t - 1)) >= PROBE_BUCKETS;
+	}
+	Check(round == 0);
+	printf("probe: %u powers of two out of the buckets\n", round);
+
+	//Four threads recording at once
+	expected = ProbeCount(PROBE_PRESENT);
+	for (k = 0; k < 4; k++) {
+		work[k].index = k;
+		work[k].count = ticks;
+		work[k].trace = false;
+		pthread_create(&work[k].thread, NULL, ProbeWorker, &work[k]);
+	}
+	for (k = 0; k < 4; k++)
+		pthread_join(work[k].thread, NULL);
+	expected += 4ull * ticks;
+	printf("probe: 4 threads recorded %llu, the histograms count %llu%s\n", (unsigned long long)(4ull * ticks),
+		(unsigned long long)ProbeCount(PROBE_PRESENT), Check(ProbeCount(PROBE_PRESENT) == expected) ? "" : " WRONG");
+
+	//The trace ring, followed while four threads write to it
+	StopProbes();
+	if (!StartProbes(true) || !OpenTrace(&reader)) {
+		printf("probe: no shared memory for the trace ring\n");
+		StopProbes();
+		return;
+	}
+	start = Now();
+	for (k = 0; k < 4; k++) {
+		work[k].trace = true;
+		pthread_create(&work[k].thread, NULL, ProbeWorker, &work[k]);
+	}
+	written = 4ull * ticks;
+	while (read + reader.lost < written) {
+		if (!ReadTrace(&reader, &e))
+			continue;
+		read++;
+
+		//Each thread's values count up, anything else was torn
+		k = (unsigned int)(e.ns >> 32);
+		if (e.probe != PROBE_PAINT || k >= 4 || e.thread >= PROBE_THREADS || (e.ns & 0xFFFFFFFF) < next[k])
+			torn++;
+		else
+			next[k] = (e.ns & 0xFFFFFFFF) + 1;
+	}
+	for (k = 0; k < 4; k++)
+		pthread_join(work[k].thread, NULL);
+	elapsed = Now() - start;
+
+	Check(torn == 0);
+	printf("probe: trace ring %llu events in %.3f s (%.1f M/s), %llu read, %llu lost to the writers, %llu torn\n",
+		(unsigned long long)written, elapsed, written / elapsed / 1e6, (unsigned long long)read,
+		(unsigned long long)reader.lost, (unsigned long long)torn);
+	CloseTrace(&reader);
+	StopProbes();
+}
+
+/*
+ *void ScriptTicks(const InputEvent*, unsigned int, uint64_t, uint64_t, unsigned int, int*)
+ *This function takes a script through the queue the way the game does,
+ *every tick taking what came in before it was due, and writes where each
+ *tick moves the two paddles. It returns how many presses moved nothing.
+*/
+static unsigned int ScriptTicks(const InputEvent *script, unsigned int count, uint64_t start, uint64_t tick, unsigned int ticks, int *dirs) {
+	static InputQueue q;
+	unsigned int t, next = 0, missed = 0;
+	Buttons b;
+	InputEvent e;
+
+	InitInputQueue(&q);
+	memset(&b, 0, sizeof(b));
+	for (t = 0; t < ticks; t++) {
+		uint64_t due = start + (t + 1) * tick;
+
+		next = PushDueInput(&q, script, count, next, due);
+		while (TakeInput(&q, due, &e)) {
+			TrackButtons(&b, &e);
+			missed += e.type == IN_PRESS && !ButtonDown(&b, e.button);
+		}
+		dirs[t * 2] = ButtonDir(&b, BUTTON_W, BUTTON_S);
+		dirs[t * 2 + 1] = ButtonDir(&b, BUTTON_O, BUTTON_L);
+		EndTick(&b);
+	}
+
+	return missed;
+}
+
+/*
+ *bool HeldAt(const InputEvent*, unsigned int, byte, uint64_t)
+ *This function returns whether a key of a script is down at a time, what
+ *sampling the keyboard then would see
+*/
+static bool HeldAt(const InputEvent *script, unsigned int count, byte button, uint64_t at) {
+	bool held = false;
+	unsigned int i;
+
+	for (i = 0; i < count && script[i].at <= at; i++)
+		if (script[i].button == button)
+			held = script[i].type == IN_PRESS;
+
+	return held;
+}
+
+//The two ends of the threaded input benchmark
+typedef struct InputWork {
+	pthread_t thread;
+	InputQueue *q;
+	const InputEvent *script;
+	unsigned int count;
+	uint64_t events;		//for the throughput run, 0 to play the script
+	volatile bool done;
+} InputWork;
+
+/*
+ *void *InputWriter(void*)
+ *This function is the thread that receives the input: it plays the script
+ *back in real time, or pushes events as fast as the queue takes them
+*/
+static void *InputWriter(void *arg) {
+	InputWork *w = arg;
+	unsigned int next = 0;
+	uint64_t i;
+	InputEvent batch[10];
+	unsigned int k, count;
+
+	//Batches of 1 to 10 like touch messages, each event saying how big its batch is
+	if (w->events > 0) {
+		memset(batch, 0, sizeof(batch));
+		for (i = 0; i < w->events; i += count) {
+			count = (unsigned int)(i % 10 + 1 < w->events - i ? i % 10 + 1 : w->events - i);
+			for (k = 0; k < count; k++) {
+				batch[k].at = i + k;
+				batch[k].x = (short)count;
+				batch[k].y = (short)k;
+			}
+			while (!PushInputs(w->q, batch, count))
+				sched_yield();
+		}
+	}
+	else
+		while (next < w->count) {
+			next = PushDueInput(w->q, w->script, w->count, next, MonotonicNow(NULL));
+			usleep(200);
+		}
+	w->done = true;
+
+	return NULL;
+}
+
+/*
+ *void BenchInput(unsigned int)
+ *This function plays made up key presses through the input queue. It
+ *counts the taps that sampling the keys at each tick (late by up to a
+ *tick, like the old keyboard polling) misses and the queue doesn't, plays
+ *a few seconds of it from another thread in real time to check that the
+ *ticks see exactly what they would offline, and measures the queue's
+ *throughput between two threads
+*/
+static void BenchInput(unsigned int seconds) {
+	static InputQueue q;
+	uint64_t tick = NS_PER_SECOND / TICK_RATE, start, queued = 0, drops, split, lateTotal = 0;
+	unsigned int ticks = seconds * TICK_RATE, count, presses = 0, shortTaps = 0, polledMissed = 0, missed, t, i, same;
+	int rest;
+	bool whole;
+	unsigned int maxEvents = seconds * 40 + 16;
+	InputEvent *script = malloc(sizeof(InputEvent) * maxEvents), e;
+	int *dirs = malloc(sizeof(int) * 2 * ticks), *live = malloc(sizeof(int) * 2 * ticks);
+	InputWork w;
+	Timestep step;
+	Buttons b;
+	double begin, elapsed;
+
+	if (script == NULL || dirs == NULL || live == NULL) {
+		printf("input: out of memory\n");
+		free(script);
+		free(dirs);
+		free(live);
+		return;
+	}
+
+	//Offline, the queue against sampling the keys late
+	count = MakeInputScript(script, maxEvents, 5, 0, (uint64_t)seconds * NS_PER_SECOND);
+	missed = ScriptTicks(script, count, 0, tick, ticks, dirs);
+	for (i = 0; i < count; i++) {
+		uint64_t at, release = (uint64_t)seconds * NS_PER_SECOND;
+		unsigned int k;
+
+		if (script[i].type != IN_PRESS)
+			continue;
+		presses++;
+		for (k = i + 1; k < count; k++)
+			if (script[k].button == script[i].button) {
+				release = script[k].at;
+				break;
+			}
+		shortTaps += release - script[i].at < tick;
+
+		//The first sample after the press, each tick sampled a random time after it was due
+		t = (unsigned int)(script[i].at / tick);
+		do {
+			at = (t + 1) * tick + Random(9, t) % tick;
+			t++;
+		} while (at < script[i].at);
+		polledMissed += !HeldAt(script, count, script[i].button, at);
+	}
+	Check(missed == 0);
+	printf("input: %u presses in %u s, %u shorter than a tick: sampling missed %u, the queue missed %u\n",
+		presses, seconds, shortTaps, polledMissed, missed);
+
+	//Real time, the script played by another thread into the queue while
+	//this one runs the ticks on the monotonic clock
+	if (seconds > 5)
+		ticks = 5 * TICK_RATE;
+	InitInputQueue(&q);
+	InitTimestep(&step, TICK_RATE, 1000000, MonotonicClock);
+	start = step.last;
+	count = MakeInputScript(script, maxEvents, 5, start, (uint64_t)ticks * tick);
+	ScriptTicks(script, count, start, tick, ticks, dirs);
+	memset(&w, 0, sizeof(w));
+	memset(&b, 0, sizeof(b));
+	w.q = &q;
+	w.script = script;
+	w.count = count;
+	pthread_create(&w.thread, NULL, InputWriter, &w);
+	t = 0;
+	while (t < ticks) {
+		for (i = AdvanceTimestep(&step); i > 0 && t < ticks; i--, t++) {
+			uint64_t due = TickDue(&step, i);
+
+			while (TakeInput(&q, due, &e)) {
+				TrackButtons(&b, &e);
+				lateTotal += MonotonicNow(NULL) - e.at;
+				queued++;
+			}
+			live[t * 2] = ButtonDir(&b, BUTTON_W, BUTTON_S);
+			live[t * 2 + 1] = ButtonDir(&b, BUTTON_O, BUTTON_L);
+			EndTick(&b);
+		}
+		usleep(NextTickIn(&step) / 1000);
+	}
+	pthread_join(w.thread, NULL);
+	for (t = same = 0; t < ticks; t++)
+		same += dirs[t * 2] == live[t * 2] && dirs[t * 2 + 1] == live[t * 2 + 1];
+	printf("input: %u s in real time from another thread, %u of %u ticks moved as offline, %llu events %.2f ms from coming in to being taken\n",
+		ticks / TICK_RATE, same, ticks, (unsigned long long)queued, queued ? lateTotal / 1e6 / queued : 0);
+
+	//Throughput, one thread pushing batches as fast as the other takes
+	InitInputQueue(&q);
+	memset(&w, 0, sizeof(w));
+	w.q = &q;
+	w.events = 20000000;
+	begin = Now();
+	pthread_create(&w.thread, NULL, InputWriter, &w);
+	for (queued = drops = split = 0, rest = 0; queued < w.events; ) {
+		if (!TakeInput(&q, UINT64_MAX, &e)) {
+			//The rest of a batch is there as soon as its first event is
+			split += rest > 0;
+			rest = 0;
+			sched_yield();
+			continue;
+		}
+		drops += e.at != queued;
+		rest = e.y == 0 ? e.x - 1 : rest - 1;
+		queued++;
+	}
+	pthread_join(w.thread, NULL);
+	elapsed = Now() - begin;
+	Check(drops == 0 && split == 0);
+	printf("input: %llu events between two threads in %.3f s (%.1f M/s), %llu out of order, %llu batches split\n",
+		(unsigned long long)queued, elapsed, queued / elapsed / 1e6, (unsigned long long)drops, (unsigned long long)split);
+
+	//A batch bigger than the room left goes whole or not at all
+	InitInputQueue(&q);
+	memset(&e, 0, sizeof(e));
+	for (i = 0; i < INPUT_EVENTS - 5; i++)
+		PushInput(&q, &e);
+	memset(script, 0, sizeof(InputEvent) * 6);
+	whole = !PushInputs(&q, script, 6) && q.head == INPUT_EVENTS - 5 && q.dropped == 6 && PushInputs(&q, script, 5) && q.head == INPUT_EVENTS;
+	printf("input: a batch of 6 with room for 5 %s\n", Check(whole) ? "is dropped whole" : "is NOT dropped whole");
+
+	free(script);
+	free(dirs);
+	free(live);
+}
+
+//The two sides of the threads benchmark
+typedef struct ThreadsWork {
+	pthread_t thread;
+	Handoff *h;
+	Timestep frames;
+	uint64_t renderNs;		//how long a frame takes to draw
+	volatile bool running;
+	uint32_t drawn, torn, backwards;
+} ThreadsWork;
+
+/*
+ *void BusyFor(uint64_t)
+ *This function keeps the CPU busy for ns nanoseconds, like drawing would
+*/
+static void BusyFor(uint64_t ns) {
+	uint64_t end = MonotonicNow(NULL) + ns;
+
+	while (MonotonicNow(NULL) < end)
+		;
+}
+
+/*
+ *bool WholeSnapshot(const Snapshot*)
+ *This function checks that a snapshot is one the updates published: its
+ *current match is exactly one tick after its previous one and it has the
+ *number it was stamped with
+*/
+static bool WholeSnapshot(const Snapshot *s) {
+	Game g = s->previous;
+
+	FollowTick(&g);
+
+	return SameSnapshot(&g, &s->current) && s->inputAt == s->seq;
+}
+
+/*
+ *void *ThreadsDrawer(void*)
+ *This function is the drawing thread: it takes the newest snapshot when a
+ *frame is due, draws for a while and checks that the snapshot is still
+ *the same and whole afterwards
+*/
+static void *ThreadsDrawer(void *arg) {
+	ThreadsWork *w = arg;
+	const Snapshot *s;
+	uint32_t seq, last = 0;
+	bool fresh;
+
+	//Below the updates, like the game asks of Windows
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 5);
+	while (w->running) {
+		if (AdvanceTimestep(&w->frames) > 0) {
+			s = TakeSnapshot(w->h, &fresh);
+			seq = s->seq;
+			BusyFor(w->renderNs);
+			w->torn += !WholeSnapshot(s) || s->seq != seq;
+			w->backwards += seq < last;
+			last = seq;
+			w->drawn++;
+		}
+		usleep(NextTickIn(&w->frames) / 1000);
+	}
+
+	return NULL;
+}
+
+/*
+ *void ThreadsCase(const char*, unsigned int, unsigned int, uint64_t, int)
+ *This function runs ticks on the monotonic clock for a few seconds and
+ *reports how late they ran. The frames are drawn in between the ticks on
+ *the same thread (threaded 0), on a thread of their own (1) or not at all
+ *(-1).
+*/
+static void ThreadsCase(const char *name, unsigned int hz, unsigned int seconds, uint64_t renderNs, int threaded) {
+	static Handoff h;
+	unsigned int ticks = hz * seconds, t = 0, i, frameCount = 0;
+	uint64_t wait, *late = malloc(sizeof(uint64_t) * ticks);
+	Timestep step;
+	ThreadsWork w;
+	Game g, before;
+
+	if (late == NULL) {
+		printf("threads: out of memory\n");
+		return;
+	}
+
+	InitGame(&g, 7);
+	SetTickRate(&g, hz);
+	InitHandoff(&h, &g);
+	memset(&w, 0, sizeof(w));
+	w.h = &h;
+	w.renderNs = renderNs;
+	w.running = true;
+	InitTimestep(&step, hz, hz / 4, MonotonicClock);
+	InitTimestep(&w.frames, 60, 1, MonotonicClock);
+	if (threaded > 0)
+		pthread_create(&w.thread, NULL, ThreadsDrawer, &w);
+
+	while (t < ticks) {
+		uint64_t due = 0;
+		Snapshot *s;
+
+		for (i = AdvanceTimestep(&step); i > 0 && t < ticks; i--, t++) {
+			due = TickDue(&step, i);
+			late[t] = MonotonicNow(NULL) - due;
+			before = g;
+			FollowTick(&g);
+		}
+
+		//Published after every batch of ticks, stamped so a mix of two can be told
+		if (due != 0) {
+			s = WriteSnapshot(&h);
+			s->previous = before;
+			s->current = g;
+			s->tick = step.tick;
+			s->due = due;
+			s->inputAt = h.published + 1;
+			PublishSnapshot(&h);
+		}
+
+		if (threaded == 0 && AdvanceTimestep(&w.frames) > 0) {
+			BusyFor(renderNs);
+			frameCount++;
+		}
+		wait = NextTickIn(&step);
+		if (threaded == 0 && NextTickIn(&w.frames) < wait)
+			wait = NextTickIn(&w.frames);
+		usleep(wait / 1000);
+	}
+	w.running = false;
+	if (threaded > 0) {
+		pthread_join(w.thread, NULL);
+		frameCount = w.drawn;
+	}
+
+	qsort(late, ticks, sizeof(uint64_t), CompareU64);
+	printf("threads: %-24s %u ticks late p50 %6.2f ms p99 %6.2f ms max %6.2f ms, %u frames",
+		name, ticks, late[ticks / 2] / 1e6, late[ticks * 99 / 100] / 1e6, late[ticks - 1] / 1e6, frameCount);
+	if (threaded > 0) {
+		Check(w.torn == 0 && w.backwards == 0);
+		printf(", %u snapshots skipped, %u torn, %u out of order", h.skipped, w.torn, w.backwards);
+	}
+	printf("\n");
+
+	free(late);
+}
+
+/*
+ *void BenchThreads(unsigned int)
+ *This function compares how late the ticks run when a slow frame is drawn
+ *on the same thread as them and when it is drawn on a thread of its own
+ *that takes the match through the handoff, and checks that every snapshot
+ *the drawing takes is whole
+*/
+static void BenchThreads(unsigned int seconds) {
+	ThreadsCase("no drawing", 250, seconds, 0, -1);
+	ThreadsCase("25 ms frames inline", 250, seconds, 25000000, 0);
+	ThreadsCase("25 ms frames threaded", 250, seconds, 25000000, 1);
+	ThreadsCase("2 ms frames threaded", 1000, seconds, 2000000, 1);
+}
+
+//What the suite's benchmarks work on
+typedef struct SuiteCtx {
+	Game g;
+	Ball b;
+	Paddle p;
+	Raster r;
+	RunConfig cfg;
+	uint32_t pixels[RESOLUTION * RESOLUTION];
+} SuiteCtx;
+
+volatile float suiteSink;
+
+/*
+ *void SuiteUpdateBall(void*, uint64_t)
+ *This function moves the same ball one tick over and over, which flies
+ *straight, bounces off a wall or hits a paddle depending on where it is put
+*/
+static void SuiteUpdateBall(void *ctx, uint64_t ops) {
+	SuiteCtx *c = ctx;
+
+	for (; ops > 0; ops--) {
+		c->g.ball = c->b;
+		c->g.state = STATE_PLAY;
+		UpdateBall(&c->g);
+	}
+	suiteSink = c->g.ball.x;
+}
+
+static void SuiteApplyEnglish(void *ctx, uint64_t ops) {
+	SuiteCtx *c = ctx;
+
+	for (; ops > 0; ops--) {
+		c->g.ball = c->b;
+		ApplyEnglish(&c->g.ball, c->p);
+	}
+	suiteSink = c->g.ball.vy;
+}
+
+/*
+ *void SuiteUpdateAI(void*, uint64_t)
+ *This function follows a ball that moves up and down the table
+*/
+static void SuiteUpdateAI(void *ctx, uint64_t ops) {
+	SuiteCtx *c = ctx;
+
+	for (; ops > 0; ops--) {
+		c->b.y = MARGIN + (float)(ops & 63) * (RESOLUTION - MARGIN) / 64;
+		UpdateAI(&c->p, c->b, STATE_PLAY);
+	}
+	suiteSink = c->p.height;
+}
+
+static void SuiteServeBall(void *ctx, uint64_t ops) {
+	SuiteCtx *c = ctx;
+
+	for (; ops > 0; ops--)
+		ServeBall(&c->g);
+	suiteSink = c->g.ball.vx;
+}
+
+static void SuiteScoreToStrs(void *ctx, uint64_t ops) {
+	char p[3], p2[3];
+
+	(void)ctx;
+	for (; ops > 0; ops--)
+		ScoreToStrs((byte)MAKE_SCORE(ops % 10, ops / 10 % 10), p, p2);
+	suiteSink = p[1] + p2[0];
+}
+
+/*
+ *void SuiteDrawTable(void*, uint64_t)
+ *This function draws frames of an AI against AI match like Pong's
+ *DrawTable, the text only when it changes
+*/
+static void SuiteDrawTable(void *ctx, uint64_t ops) {
+	SuiteCtx *c = ctx;
+
+	for (; ops > 0; ops--) {
+		if (c->g.state == STATE_HOME || c->g.state == STATE_READY || c->g.state == STATE_END)
+			AdvanceState(&c->g);
+		TickGame(&c->g, 0, 0);
+		UpdateAI(&c->g.player, c->g.ball, c->g.state);
+		RasterTableText(&c->r, c->g.score, c->g.state, c->g.mode);
+		RasterTable(&c->r, c->g.ball, c->g.player, c->g.player2, c->g.state);
+	}
+}
+
+/*
+ *void SuiteMatch(void*, uint64_t)
+ *This function plays whole AI against AI matches, the same ones every
+ *sample so the samples compare
+*/
+static void SuiteMatch(void *ctx, uint64_t ops) {
+	SuiteCtx *c = ctx;
+	RunStats stats;
+	uint64_t match;
+
+	memset(&stats, 0, sizeof(stats));
+	for (match = 0; match < ops; match++) {
+		InitGame(&c->g, MatchSeed(c->cfg.seed, match));
+		PlayMatch(&c->g, &c->cfg, &stats);
+	}
+}
+
+/*
+ *void AddSuite(Suite*, const char*, MeasureBody, SuiteCtx*)
+ *This function measures a benchmark and prints its line
+*/
+static void AddSuite(Suite *s, const char *name, MeasureBody body, SuiteCtx *c) {
+	const Result *r = Measure(s, name, body, c);
+
+	if (r == NULL)
+		return;
+	fprintf(stderr, "suite: %-24s p50 %10.2f ns  p99 %10.2f ns", r->name, r->p50, r->p99);
+	if (r->counted)
+		fprintf(stderr, "  %8.1f cycles %8.1f instructions %6.2f branch misses", r->counters[0], r->counters[1], r->counters[2]);
+	fprintf(stderr, "\n");
+}
+
+/*
+ *void RunSuite(Suite*)
+ *This function runs every benchmark of the suite
+*/
+static void RunSuite(Suite *s) {
+	static SuiteCtx c;
+
+	InitSuite(s);
+	if (!s->counting)
+		fprintf(stderr, "suite: no hardware counters here\n");
+
+	//The ball in the middle of the table, next to the top wall and at the left paddle
+	InitGame(&c.g, 1);
+	c.b.x = RESOLUTION / 2;
+	c.b.y = (RESOLUTION + MARGIN) / 2;
+	c.b.vx = 0.8f;
+	c.b.vy = 0.6f;
+	AddSuite(s, "UpdateBall/flight", SuiteUpdateBall, &c);
+	c.b.y = BALLSIZE + MARGIN + 0.3f;
+	c.b.vy = -0.6f;
+	AddSuite(s, "UpdateBall/wall", SuiteUpdateBall, &c);
+	c.b.x = PADDLEWIDTH + 0.5f;
+	c.b.y = c.g.player.height + 3;
+	c.b.vx = -0.8f;
+	AddSuite(s, "UpdateBall/paddle", SuiteUpdateBall, &c);
+
+	c.p = c.g.player;
+	AddSuite(s, "ApplyEnglish", SuiteApplyEnglish, &c);
+	c.b.vx = 0.8f;
+	AddSuite(s, "UpdateAI", SuiteUpdateAI, &c);
+	AddSuite(s, "ServeBall", SuiteServeBall, &c);
+	AddSuite(s, "ScoreToStrs", SuiteScoreToStrs, &c);
+
+	InitGame(&c.g, 1);
+	InitRaster(&c.r, c.pixels, RASTER_8);
+	AddSuite(s, "DrawTable/8bit", SuiteDrawTable, &c);
+	InitGame(&c.g, 1);
+	InitRaster(&c.r, c.pixels, RASTER_32);
+	AddSuite(s, "DrawTable/32bit", SuiteDrawTable, &c);
+
+	memset(&c.cfg, 0, sizeof(c.cfg));
+	c.cfg.seed = 1;
+	c.cfg.maxTicks = 100000;
+	c.cfg.skill = SKILL_NORMAL;
+	AddSuite(s, "Match/ticked", SuiteMatch, &c);
+	c.cfg.fast = true;
+	AddSuite(s, "Match/fast", SuiteMatch, &c);
+}
+
+/*
+ *int BenchSuite(const char*)
+ *This function runs the suite and writes its JSON to path (stdout for NULL)
+*/
+static int BenchSuite(const char *path) {
+	FILE *file = path != NULL ? fopen(path, "w") : stdout;
+	Suite s;
+
+	if (file == NULL) {
+		printf("suite: can't write %s\n", path);
+		return 1;
+	}
+
+	RunSuite(&s);
+	WriteSuite(&s, file);
+	if (path != NULL)
+		fclose(file);
+	FreeSuite(&s);
+
+	return 0;
+}
+
+/*
+ *int BenchCompare(const char*, double)
+ *This function runs the suite and compares it with a baseline written by
+ *BenchSuite. It returns 1 if anything got slower.
+*/
+static int BenchCompare(const char *path, double tolerance) {
+	FILE *file = fopen(path, "rb");
+	char *baseline;
+	long size;
+	int slower;
+	Suite s;
+
+	if (file == NULL) {
+		printf("compare: can't read %s\n", path);
+		return 1;
+	}
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	baseline = malloc(size + 1);
+	if (baseline == NULL || fread(baseline, 1, size, file) != (size_t)size) {
+		printf("compare: can't read %s\n", path);
+		fclose(file);
+		free(baseline);
+		return 1;
+	}
+	baseline[size] = '\0';
+	fclose(file);
+
+	RunSuite(&s);
+	printf("%-28s %12s %12s  (median ns/op)\n", "", "baseline", "now");
+	slower = CompareSuite(&s, baseline, tolerance, stdout);
+	printf("compare: %d of %u slower by more than %.0f%%\n", slower, s.count, tolerance * 100);
+	FreeSuite(&s);
+	free(baseline);
+
+	return slower > 0;
+}
+
+int main(int argc, char **argv) {
+	const char *which = argc > 1 ? argv[1] : "all";
+	unsigned int n = argc > 2 ? atoi(argv[2]) : 4096, ticks = argc > 3 ? atoi(argv[3]) : 2000;
+	bool all = strcmp(which, "all") == 0;
+
+	if (strcmp(which, "suite") == 0)
+		return BenchSuite(argc > 2 ? argv[2] : NULL);
+	if (strcmp(which, "compare") == 0 && argc > 2)
+		return BenchCompare(argv[2], (argc > 3 ? atof(argv[3]) : 10) / 100);
+
+	if (all || strcmp(which, "env") == 0)
+		BenchEnv(n, ticks);
+	if (all || strcmp(which, "simd") == 0)
+		BenchSimd(n, ticks);
+	if (all || strcmp(which, "runner") == 0)
+		BenchRunner(n, ticks * 10);
+	if (all || strcmp(which, "raster") == 0)
+		BenchRaster(n * ticks / 4);
+	if (all || strcmp(which, "render") == 0)
+		BenchRender(n * ticks / 16);
+	if (all || strcmp(which, "layers") == 0)
+		BenchLayers(ticks / 4);
+	if (all || strcmp(which, "text") == 0)
+		BenchText(n * ticks / 16);
+	if (all || strcmp(which, "loop") == 0)
+		BenchLoop(n * ticks / 16);
+	if (all || strcmp(which, "ai") == 0)
+		BenchAI(n, ticks * 10);
+	if (all || strcmp(which, "sweep") == 0)
+		BenchSweep(n, ticks * 10);
+	if (all || strcmp(which, "fast") == 0)
+		BenchFast(n, ticks * 10);
+	if (all || strcmp(which, "replay") == 0)
+		BenchReplay(n, ticks * 100);
+	if (all || strcmp(which, "net") == 0)
+		BenchNet(ticks * 10);
+	if (all || strcmp(which, "server") == 0)
+		BenchServer(n, ticks / 400);
+	if (all || strcmp(which, "spectate") == 0)
+		BenchSpectate(n / 4, ticks / 400);
+	if (all || strcmp(which, "diff") == 0)
+		BenchDiff(n * ticks / 16);
+	if (all || strcmp(which, "scale") == 0)
+		BenchScale(n * ticks / 256);
+	if (all || strcmp(which, "probe") == 0)
+		BenchProbe(n * ticks / 16);
+	if (all || strcmp(which, "input") == 0)
+		BenchInput(ticks / 20);
+	if (all || strcmp(which, "threads") == 0)
+		BenchThreads(ticks / 400);
+	if (strcmp(which, "touch") == 0 && argc > 2)
+		BenchTouch(argv[2]);
+	else if (all || strcmp(which, "touch") == 0)
+		BenchTouch(NULL);
+	if (all || strcmp(which, "physics") == 0)
+		BenchPhysics(n / 8, ticks * 10);
+	if (all || strcmp(which, "observe") == 0)
+		BenchObserve(n, ticks / 10);
+	if (all || strcmp(which, "fixed") == 0)
+		BenchFixed(n, ticks);
+
+	if (failures > 0)
+		printf("%u checks went wrong\n", failures);
+
+	return failures > 0;
+}
@@ -0,0 +1,253 @@
+#include <string.h>
+#include "Draw.h"
+
+/*
+ *Draw.c
+ *The touch controls, drawn with pens, brushes and a font. The styles and
+ *fonts are only described here, the renderer makes them once per resolution.
+ *Everything but the slider knobs only changes with the state, so it is
+ *drawn once on the static layer and only the knobs are drawn each frame.
+ *The text on the table is blitted by the raster instead (see Glyphs.c).
+*/
+
+
+/*
+ *void SetupDrawing(Renderer*, unsigned short, unsigned short)
+ *This function makes sure the renderer has every style and font
+ *needed for a screen of the given size. It does nothing if it already has.
+*/
+void SetupDrawing(Renderer *r, unsigned short width, unsigned short height) {
+	short arrowWidth = height*TOUCH_WIDTH/5;
+
+	if (!NeedResources(r, width, height))
+		return;
+
+	SetStyle(r, STYLE_GRAY, 0x00808080, 0);
+	SetStyle(r, STYLE_RED, 0x000000FF, 0);
+	SetStyle(r, STYLE_GOLD, 0x0000D7FF, 0);
+	SetStyle(r, STYLE_ARROW, 0x00FFFFFF, arrowWidth > 0 ? arrowWidth : 1); //a 0 wide pen is 1 pixel wide anyway
+
+	SetFont(r, FONT_BUTTON, height/15, FONT_SMOOTH | FONT_CLEAR, "Calibri");
+
+	MakeResources(r);
+}
+
+/*
+ *int PaddleToSlider(Paddle, short, unsigned short, unsigned short)
+ *This function coverts the position of a paddle paddleHeight tall into
+ *a touch slider position, kept on the slider
+*/
+int PaddleToSlider(Paddle p, short paddleHeight, unsigned short width, unsigned short height) {
+	int slider = height / 3 + (int)(height / 3 * (p.height - MARGIN - paddleHeight / 2.f) / (RESOLUTION - MARGIN - paddleHeight));
+
+	(void)width;
+
+	return CLAMP(slider, height / 3, height / 3 * 2);
+}
+
+/*
+ *void SliderToPaddle(unsigned short, Paddle*, short, unsigned short, unsigned short)
+ *This function converts the touch slider position into the position of a
+ *paddle paddleHeight tall, kept on the table like PaddleKernel does
+*/
+void SliderToPaddle(unsigned short slider, Paddle *p, short paddleHeight, unsigned short width, unsigned short height) {
+	float h = 3.f * (RESOLUTION - MARGIN - paddleHeight) * (slider - height / 3) / height + MARGIN + paddleHeight / 2.f;
+
+	(void)width;
+
+	p->height = CLAMP(h, MARGIN + paddleHeight / 2.f + 1, RESOLUTION - paddleHeight / 2.f);
+}
+
+/*
+ *Rect KnobBox(unsigned short, unsigned short, byte, Paddle, short)
+ *This function returns the box of a slider's knob, the left one for
+ *player 1 and the right one for player 2
+*/
+Rect KnobBox(unsigned short width, unsigned short height, byte player, Paddle p, short paddleHeight) {
+	unsigned short margin = (width - height) / 2;
+	int slider = PaddleToSlider(p, paddleHeight, width, height), center = player == 1 ? margin / 2 : width - margin / 2;
+	Rect box;
+
+	box.left = (short)(center - 5 * margin*TOUCH_WIDTH);
+	box.top = (short)(slider - 5 * margin*TOUCH_WIDTH);
+	box.right = (short)(center + 5 * margin*TOUCH_WIDTH);
+	box.bottom = (short)(slider + 5 * margin*TOUCH_WIDTH);
+
+	return box;
+}
+
+/*
+ *byte KnobCount(byte, byte)
+ *This function returns how many slider knobs the state and mode show
+*/
+static byte KnobCount(byte state, byte mode) {
+	if (state != STATE_READY && state != STATE_SERVE && state != STATE_PLAY)
+		return 0;
+
+	return mode == MODE_TWO ? 2 : 1;
+}
+
+/*
+ *void DrawKnob(Renderer*, byte, Rect)
+ *This function draws a slider's knob in its box
+*/
+static void DrawKnob(Renderer *r, byte player, Rect box) {
+	RenderEllipse(r, player == 1 ? STYLE_RED : STYLE_GOLD, box.left, box.top, box.right, box.bottom);
+}
+
+/*
+ *void DrawTouchStatic(Renderer*, unsigned short, unsigned short, byte, byte)
+ *This function will draw the touch controls that don't move, everything
+ *but the slider knobs, onto the left and right edge of the screen
+*/
+void DrawTouchStatic(Renderer *r, unsigned short width, unsigned short height, byte state, byte mode) {
+	unsigned short margin = (width - height) / 2;
+
+	RenderClear(r, 0, 0, width, height);
+
+	if (state == STATE_READY || state == STATE_SERVE || state == STATE_PLAY) {
+		RenderBox(r, STYLE_GRAY, margin / 2 - margin*TOUCH_WIDTH, height * 1 / 3, margin / 2 + margin*TOUCH_WIDTH, height * 2 / 3);
+
+		if (mode == MODE_TWO)
+			RenderBox(r, STYLE_GRAY, width - margin / 2 - margin*TOUCH_WIDTH, height * 1 / 3, width - margin / 2 + margin*TOUCH_WIDTH, height * 2 / 3);
+	}
+
+	if (state != STATE_SERVE && state != STATE_PLAY) {
+		short buttonShift = height / 30 - height / 15 * (state == STATE_HOME);
+
+		RenderBox(r, STYLE_GRAY, margin*TOUCH_WIDTH,
+			buttonShift + height / 2 - height / 30,
+			margin*TOUCH_WIDTH + margin / 4,
+			buttonShift + height / 2 + height / 30);
+		RenderText(r, FONT_BUTTON, (unsigned short)(margin*TOUCH_WIDTH), buttonShift + height / 2 - height / 30, (unsigned short)(margin*TOUCH_WIDTH + margin / 4), height / 15, TEXT_CENTER | TEXT_VCENTER, "Go!");
+	}
+	if (state == STATE_HOME) {
+		int up[6], down[6];
+
+		RenderBox(r, STYLE_GRAY, margin / 2 - 5 * margin*TOUCH_WIDTH,
+			height / 2 - 11 * margin*TOUCH_WIDTH,
+			margin / 2 + 5 * margin*TOUCH_WIDTH,
+			height / 2 - margin*TOUCH_WIDTH);
+		RenderBox(r, STYLE_GRAY, margin / 2 - 5 * margin*TOUCH_WIDTH,
+			height / 2 + 1 * margin*TOUCH_WIDTH,
+			margin / 2 + 5 * margin*TOUCH_WIDTH,
+			height / 2 + 11 * margin*TOUCH_WIDTH);
+
+		up[0] = margin / 2 - 4 * margin*TOUCH_WIDTH;
+		up[1] = height / 2 - 2*margin*TOUCH_WIDTH;
+		up[2] = margin / 2;
+		up[3] = height / 2 - 10 * margin*TOUCH_WIDTH;
+		up[4] = margin / 2 + 4 * margin*TOUCH_WIDTH;
+		up[5] = height / 2 - 2*margin*TOUCH_WIDTH;
+		RenderLines(r, STYLE_ARROW, up, 3);
+
+		down[0] = margin / 2 - 4 * margin*TOUCH_WIDTH;
+		down[1] = height / 2 + 2*margin*TOUCH_WIDTH;
+		down[2] = margin / 2;
+		down[3] = height / 2 + 10 * margin*TOUCH_WIDTH;
+		down[4] = margin / 2 + 4 * margin*TOUCH_WIDTH;
+		down[5] = height / 2 + 2*margin*TOUCH_WIDTH;
+		RenderLines(r, STYLE_ARROW, down, 3);
+	}
+
+	RenderBox(r, STYLE_GRAY, margin*TOUCH_WIDTH,
+		height - margin*TOUCH_WIDTH - height / 15,
+		margin*TOUCH_WIDTH + height/7,
+		height - margin*TOUCH_WIDTH);
+	RenderText(r, FONT_BUTTON, (unsigned short)(margin*TOUCH_WIDTH), (unsigned short)(height - margin*TOUCH_WIDTH - height / 15), height / 7, height / 15, TEXT_VCENTER | TEXT_CENTER, "Close");
+}
+
+/*
+ *void DrawTouchControls(Renderer*, unsigned short, unsigned short, byte, byte, Paddle, Paddle, short)
+ *This function will draw the touch controls onto the left and right edge
+ *of the screen for every game state, all of them from scratch
+*/
+void DrawTouchControls(Renderer *r, unsigned short width, unsigned short height, byte state, byte mode, Paddle player1, Paddle player2, short paddleHeight) {
+	byte knobs = KnobCount(state, mode);
+
+	DrawTouchStatic(r, width, height, state, mode);
+	if (knobs >= 1)
+		DrawKnob(r, 1, KnobBox(width, height, 1, player1, paddleHeight));
+	if (knobs >= 2)
+		DrawKnob(r, 2, KnobBox(width, height, 2, player2, paddleHeight));
+}
+
+/*
+ *void InitTouchLayers(TouchLayers*)
+ *This function makes the next composition draw everything
+*/
+void InitTouchLayers(TouchLayers *l) {
+	memset(l, 0, sizeof(TouchLayers));
+}
+
+/*
+ *unsigned int ComposeTouchControls(TouchLayers*, Renderer*, unsigned short, unsigned short, byte, byte, Paddle, Paddle, short, Rect*)
+ *This function brings the touch controls on LAYER_SCREEN up to date. The
+ *static layer is only drawn again when the state, mode or resolution
+ *changes, and then both edges are copied to the screen. Otherwise only a
+ *knob that moved is wiped out with the static layer and drawn again. It
+ *fills in the boxes of the screen that changed and returns how many there
+ *are, at most TOUCH_MAX_RECTS.
+*/
+unsigned int ComposeTouchControls(TouchLayers *l, Renderer *r, unsigned short width, unsigned short height, byte state, byte mode,
+	Paddle player1, Paddle player2, short paddleHeight, Rect *rects) {
+	unsigned short margin = (width - height) / 2;
+	byte knobs = KnobCount(state, mode), i;
+	Rect boxes[2];
+	unsigned int count = 0;
+
+	boxes[0] = KnobBox(width, height, 1, player1, paddleHeight);
+	boxes[1] = KnobBox(width, height, 2, player2, paddleHeight);
+
+	if (!l->ready || l->width != width || l->height != height || l->state != state || l->mode != mode) {
+		RenderLayer(r, LAYER_STATIC);
+		DrawTouchStatic(r, width, height, state, mode);
+		RenderLayer(r, LAYER_SCREEN);
+
+		rects[0].left = 0;
+		rects[0].right = (short)margin;
+		rects[1].left = (short)(width - margin);
+		rects[1].right = (short)width;
+		for (i = 0; i < 2; i++) {
+			rects[i].top = 0;
+			rects[i].bottom = (short)height;
+			RenderCopy(r, LAYER_STATIC, rects[i].left, rects[i].top, rects[i].right, rects[i].bottom);
+		}
+		count = 2;
+
+		for (i = 0; i < knobs; i++)
+			DrawKnob(r, i + 1, boxes[i]);
+
+		l->ready = true;
+		l->width = width;
+		l->height = height;
+		l->state = state;
+		l->mode = mode;
+	}
+	else {
+		RenderLayer(r, LAYER_SCREEN);
+		for (i = 0; i < knobs; i++) {
+			Rect *was = &l->knobs[i];
+
+			if (was->top == boxes[i].top && was->left == boxes[i].left)
+				continue;
+
+			//What was under the knob comes back before it is drawn again
+			RenderCopy(r, LAYER_STATIC, was->left, was->top, was->right, was->bottom);
+			DrawKnob(r, i + 1, boxes[i]);
+
+			//The knobs only move up and down
+			rects[count] = boxes[i];
+			if (was->top < rects[count].top)
+				rects[count].top = was->top;
+			if (was->bottom > rects[count].bottom)
+				rects[count].bottom = was->bottom;
+			count++;
+		}
+	}
+
+	l->knobs[0] = boxes[0];
+	l->knobs[1] = boxes[1];
+
+	return count;
+}
@@ -0,0 +1,47 @@
+#ifndef DRAW_H
+#define DRAW_H
+
+#include "Render.h"
+#include "Raster.h"
+
+/*
+ *Draw.h
+ *The game's touch controls, drawn through a Renderer. ComposeTouchControls
+ *keeps what doesn't move on LAYER_STATIC and only draws the slider knobs
+ *that moved on the screen.
+*/
+
+
+//Styles
+#define STYLE_GRAY		0
+#define STYLE_RED		1
+#define STYLE_GOLD		2
+#define STYLE_ARROW		3
+
+//Fonts
+#define FONT_BUTTON		0	//touch buttons, sized to the screen
+
+#define TOUCH_MAX_RECTS	2
+
+//What the touch controls on the screen show
+typedef struct TouchLayers {
+	unsigned short width, height;
+	byte state, mode;			//what the static layer was drawn for
+	bool ready;					//false until it is drawn
+	Rect knobs[2];				//where the knobs are drawn
+} TouchLayers;
+
+//Drawing functions
+void SetupDrawing(Renderer *r, unsigned short width, unsigned short height);
+int PaddleToSlider(Paddle p, short paddleHeight, unsigned short width, unsigned short height);
+void SliderToPaddle(unsigned short slider, Paddle *p, short paddleHeight, unsigned short width, unsigned short height);
+Rect KnobBox(unsigned short width, unsigned short height, byte player, Paddle p, short paddleHeight);
+void DrawTouchStatic(Renderer *r, unsigned short width, unsigned short height, byte state, byte mode);
+void DrawTouchControls(Renderer *r, unsigned short width, unsigned short height, byte state, byte mode, Paddle player1, Paddle player2, short paddleHeight);
+
+//Composition functions
+void InitTouchLayers(TouchLayers *l);
+unsigned int ComposeTouchControls(TouchLayers *l, Renderer *r, unsigned short width, unsigned short height, byte state, byte mode,
+	Paddle player1, Paddle player2, short paddleHeight, Rect *rects);
+
+#endif
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include "Env.h"
+
+/*
+ *Env.c
+ *Struct of arrays storage and stepping for many headless matches.
+ *Every match is run through the same TickGame state machine as the window,
+ *so the rules can never drift apart from the real game.
+*/
+
+
+/*
+ *void ResetMatch(Env*, unsigned int)
+ *This function puts one match back at 0-0, ready to serve
+*/
+static void ResetMatch(Env *e, unsigned int i) {
+	e->x[i] = RESOLUTION / 2.f;
+	e->y[i] = (RESOLUTION - MARGIN) / 2.f + MARGIN;
+	e->vx[i] = 0;
+	e->vy[i] = 0;
+	e->player[i] = (RESOLUTION + MARGIN) / 2.f;
+	e->player2[i] = (RESOLUTION + MARGIN) / 2.f;
+	e->state[i] = STATE_SERVE;
+	e->score[i] = 0;
+}
+
+/*
+ *void WriteObs(Env*, unsigned int, float*)
+ *This function writes the observation of one match into its slot
+ *of the caller's buffer
+*/
+static void WriteObs(Env *e, unsigned int i, float *obs) {
+	obs += (size_t)i * ENV_OBS_SIZE;
+
+	obs[0] = e->x[i];
+	obs[1] = e->y[i];
+	obs[2] = e->vx[i];
+	obs[3] = e->vy[i];
+	obs[4] = e->player[i];
+	obs[5] = e->player2[i];
+}
+
+/*
+ *bool ResetEnv(Env*, unsigned int, uint64_t, float*)
+ *This function (re)starts the environment with n matches and writes
+ *their first observations into obs (n * ENV_OBS_SIZE floats) if it isn't NULL.
+ *The env must be zeroed before the first call. Returns false if out of memory.
+*/
+bool ResetEnv(Env *e, unsigned int n, uint64_t seed, float *obs) {
+	unsigned int i;
+
+	if (n > e->capacity) {
+		//One block for everything, widest types first so they stay aligned
+		float *block = realloc(e->x, (size_t)n * (6 * sizeof(float) + sizeof(uint32_t) + sizeof(uint16_t) + 1));
+
+		if (block == NULL)
+			return false;
+
+		e->x = block;
+		e->y = e->x + n;
+		e->vx = e->y + n;
+		e->vy = e->vx + n;
+		e->player = e->vy + n;
+		e->player2 = e->player + n;
+		e->serves = (uint32_t*)(e->player2 + n);
+		e->score = (uint16_t*)(e->serves + n);
+		e->state = (byte*)(e->score + n);
+		e->capacity = n;
+	}
+	e->n = n;
+	e->seed = seed;
+
+	for (i = 0; i < n; i++) {
+		ResetMatch(e, i);
+		e->serves[i] = 0;
+		if (obs != NULL)
+			WriteObs(e, i, obs);
+	}
+
+	return true;
+}
+
+/*
+ *void StepEnv(Env*, const signed char*, float*, float*, byte*)
+ *This function runs one tick of every match. actions holds one ACTION_*
+ *per match. rewards gets +1 when the player scores and -1 when the AI scores,
+ *dones gets 1 when the tick ended the match (which is then reset).
+ *obs, rewards and dones may be NULL if they aren't needed.
+*/
+void StepEnv(Env *e, const signed char *actions, float *obs, float *rewards, byte *dones) {
+	unsigned int i;
+	Game g;
+
+	//A plain one player match with the classic physics, every field set
+	InitGame(&g, e->seed);
+
+	for (i = 0; i < e->n; i++) {
+		float reward = 0;
+		byte done = 0;
+
+		//Pull the match out of the arrays
+		g.ball.x = e->x[i];
+		g.ball.y = e->y[i];
+		g.ball.vx = e->vx[i];
+		g.ball.vy = e->vy[i];
+		g.player.height = e->player[i];
+		g.player2.height = e->player2[i];
+		g.state = e->state[i];
+		g.score = e->score[i];
+		g.seed = MatchSeed(e->seed, i);
+		g.serves = e->serves[i];
+
+		TickGame(&g, actions[i], 0);
+
+		if (g.score != e->score[i])
+			reward = PLAYER_SCORE(g.score) != PLAYER_SCORE(e->score[i]) ? 1.f : -1.f;
+
+		//Nobody is around to press the space bar
+		if (g.state == STATE_READY)
+			AdvanceState(&g);
+
+		//And put it back
+		e->x[i] = g.ball.x;
+		e->y[i] = g.ball.y;
+		e->vx[i] = g.ball.vx;
+		e->vy[i] = g.ball.vy;
+		e->player[i] = g.player.height;
+		e->player2[i] = g.player2.height;
+		e->state[i] = g.state;
+		e->score[i] = g.score;
+		e->serves[i] = g.serves;
+
+		if (g.state == STATE_END) {
+			ResetMatch(e, i);
+			done = 1;
+		}
+
+		if (obs != NULL)
+			WriteObs(e, i, obs);
+		if (rewards != NULL)
+			rewards[i] = reward;
+		if (dones != NULL)
+			dones[i] = done;
+	}
+}
+
+/*
+ *void FreeEnv(Env*)
+ *This function releases the memory of an environment
+*/
+void FreeEnv(Env *e) {
+	free(e->x);
+	e->x = NULL;
+	e->n = 0;
+	e->capacity = 0;
+}
@@ -0,0 +1,43 @@
+#ifndef ENV_H
+#define ENV_H
+
+#include "Game.h"
+
+/*
+ *Env.h
+ *A headless environment that steps N one player matches at once.
+ *The matches are stored as a struct of arrays so that every field of
+ *every match sits next to the same field of its neighbors.
+ *
+ *Each match has the player on the left (controlled by the caller) and
+ *the AI on the right. A match starts already serving, serves again on its
+ *own after every point and starts over as soon as one side wins.
+*/
+
+
+//Number of floats written per match into the observation buffer:
+//ball x, ball y, ball vx, ball vy, player height, AI height
+#define ENV_OBS_SIZE	6
+
+//Action values for the player paddle
+#define ACTION_UP		-1
+#define ACTION_STAY		0
+#define ACTION_DOWN		1
+
+//Match i serves from MatchSeed(seed, i)
+typedef struct Env {
+	unsigned int n, capacity;
+	uint64_t seed;
+	float *x, *y, *vx, *vy;
+	float *player, *player2;
+	uint32_t *serves;
+	uint16_t *score;
+	byte *state;
+} Env;
+
+//Environment functions
+bool ResetEnv(Env *e, unsigned int n, uint64_t seed, float *obs);
+void StepEnv(Env *e, const signed char *actions, float *obs, float *rewards, byte *dones);
+void FreeEnv(Env *e);
+
+#endif
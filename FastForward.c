@@ -0,0 +1,249 @@
+#include <math.h>
+#include <string.h>
+#include "FastForward.h"
+
+/*
+ *FastForward.c
+ *Every bound below is worked out in doubles from the exact float values
+ *and kept a little short of the real limit. Landing one tick early
+ *only costs a real tick, landing one tick late would break the match.
+*/
+
+//How far a tick's worth of movement has to stay from a rule's threshold
+#define SAFETY		1e-3
+
+//The lowest and highest heights MovePaddle leaves the left paddle at,
+//it is the tighter of the two clamps a paddle goes through
+#define LOWEST		(MARGIN + PADDLEHEIGHT / 2.f + 1)
+#define HIGHEST		(RESOLUTION - PADDLEHEIGHT / 2.f)
+
+//How a paddle moves during the skipped ticks
+typedef struct Plan {
+	double d;		//added every tick
+	bool follow;	//or it is always exactly where the ball is
+} Plan;
+
+
+/*
+ *double Binade(float)
+ *This function returns the power of two at the bottom of v's binade
+ *(v must be a positive normal number). One unit in the last place is
+ *that times 2^-23.
+*/
+static double Binade(float v) {
+	uint32_t bits;
+
+	memcpy(&bits, &v, sizeof(bits));
+	bits &= 0x7F800000;
+	memcpy(&v, &bits, sizeof(bits));
+
+	return v;
+}
+
+/*
+ *unsigned int Room(float, double, double, double, unsigned int)
+ *This function returns how many steps of d the value v can take (up to
+ *limit) while staying inside [low, high] and inside its own binade,
+ *a couple of units in the last place away from its ends
+*/
+static unsigned int Room(float v, double d, double low, double high, unsigned int limit) {
+	double bottom = Binade(v), ulp = bottom * 0x1p-23, n;
+
+	low = fmax(low, bottom + 2 * ulp);
+	high = fmin(high, 2 * bottom - 2 * ulp);
+	if (v < low || v > high)
+		return 0;
+
+	if (d > 0)
+		n = (high - v) / d;
+	else if (d < 0)
+		n = (low - v) / d;
+	else
+		return limit;
+
+	return n < limit ? (unsigned int)n : limit;
+}
+
+/*
+ *bool Step(float, float, double*)
+ *This function finds what adding dv to v really adds once rounded. It
+ *fails if that depends on the last bit of v (dv lies exactly halfway
+ *between two representable steps), since then it changes every tick.
+*/
+static bool Step(float v, float dv, double *d) {
+	float next = v + dv, w = v + (float)(Binade(v) * 0x1p-23), wNext = w + dv;
+
+	*d = (double)next - v;
+
+	return (double)wNext - w == *d;
+}
+
+/*
+ *float AIMove(float, float, bool)
+ *This function is one tick of an AI paddle heading for target, exactly
+ *like PlayMatch does it (the left paddle first goes through MovePaddle)
+*/
+static float AIMove(float height, float target, bool left) {
+	float speed;
+
+	//MovePaddle with no input only keeps the paddle on the table
+	if (left)
+		height = CLAMP(height, MARGIN + PADDLEHEIGHT / 2.f + 1, RESOLUTION - PADDLEHEIGHT / 2.f);
+
+	speed = target - height;
+	speed = CLAMP(speed, -AI_SPEED * 1.f, AI_SPEED * 1.f);
+	height = height + speed;
+
+	return CLAMP(height, MARGIN + PADDLEHEIGHT / 2.f, RESOLUTION - PADDLEHEIGHT / 2.f);
+}
+
+/*
+ *unsigned int Saturated(float, double, double, unsigned int, Plan*)
+ *This function plans a paddle that is at least a pixel away from where it
+ *is going and so moves at full speed every tick. reach(j) is how far the
+ *target is in front of the paddle on the j-th tick, before it moves:
+ *first + (j - 1) * slope. It has to stay above 1 for every skipped tick.
+*/
+static unsigned int Saturated(float height, double first, double slope, int s, unsigned int limit, Plan *plan) {
+	unsigned int n;
+
+	if (first < 1 + SAFETY)
+		return 0;
+	if (slope < 0) {
+		double j = (first - 1 - SAFETY) / -slope + 1;
+
+		n = j < limit ? (unsigned int)j : limit;
+		limit = n < limit ? n : limit;
+	}
+
+	plan->d = s;
+	plan->follow = false;
+
+	return Room(height, s, LOWEST, HIGHEST, limit);
+}
+
+/*
+ *unsigned int ChasePlan(float, float, double, unsigned int, Plan*)
+ *This function plans UpdateAI's paddle for the ball at height y moving dy
+ *a tick. It either sits on the ball (while the ball moves less than a pixel
+ *a tick), sits against the top or bottom while the ball is beyond it, or
+ *chases the ball at full speed.
+*/
+static unsigned int ChasePlan(float height, float y, double dy, unsigned int limit, Plan *plan) {
+	double n = limit, ahead = (double)y + dy - height;
+
+	plan->d = 0;
+	plan->follow = false;
+
+	if (height == y && fabs(dy) < 1) {
+		if (y < LOWEST || y > HIGHEST)
+			return 0;
+		if (dy > 0)
+			n = (HIGHEST - y) / dy;
+		else if (dy < 0)
+			n = (LOWEST - y) / dy;
+		plan->follow = true;
+	}
+	else if (height == HIGHEST && y + dy >= HIGHEST) {
+		if (dy < 0)
+			n = (y - HIGHEST) / -dy;
+	}
+	else if (height == MARGIN + PADDLEHEIGHT / 2.f && y + dy <= MARGIN + PADDLEHEIGHT / 2.f) {
+		if (dy > 0)
+			n = (MARGIN + PADDLEHEIGHT / 2.f - y) / dy;
+	}
+	else if (ahead > 0)
+		return Saturated(height, ahead, dy - 1, 1, limit, plan);
+	else
+		return Saturated(height, -ahead, -dy - 1, -1, limit, plan);
+
+	return n < limit ? (unsigned int)n : limit;
+}
+
+/*
+ *unsigned int InterceptPlan(const Intercept*, float, Ball, bool, unsigned int, Plan*)
+ *This function plans UpdateIntercept's paddle. Its target can't change
+ *while the ball flies straight, except when the reaction delay runs out,
+ *so it either stays where it is or moves at full speed.
+*/
+static unsigned int InterceptPlan(const Intercept *ai, float height, Ball b, bool left, unsigned int limit, Plan *plan) {
+	float target = ai->wait > 0 ? ai->target : ai->next;
+	double ahead = (double)target - height;
+
+	//It hasn't seen the ball's new direction yet
+	if (ai->vx != b.vx || fabsf(ai->vy) != fabsf(b.vy))
+		return 0;
+	if (ai->wait > 0 && ai->wait < limit)
+		limit = ai->wait;
+
+	if (AIMove(height, target, left) == height) {
+		plan->d = 0;
+		plan->follow = false;
+		return limit;
+	}
+
+	return ahead > 0 ? Saturated(height, ahead, -1, 1, limit, plan) : Saturated(height, -ahead, -1, -1, limit, plan);
+}
+
+/*
+ *void Apply(float*, const Plan*, float, unsigned int)
+ *This function moves a paddle ticks ticks along its plan
+*/
+static void Apply(float *height, const Plan *plan, float y, unsigned int ticks) {
+	if (plan->follow)
+		*height = y;
+	else
+		*height = (float)(*height + ticks * plan->d);
+}
+
+/*
+ *unsigned int SkipTicks(Game*, Intercept*, unsigned int)
+ *This function jumps the match over as many ticks (up to limit) as it can
+ *without anything happening and returns how many that was, 0 if the
+ *next tick has to be run for real. left is the AI of the left paddle.
+ *The bounds are those of the classic float physics, other profiles and
+ *fixed point physics never skip.
+*/
+unsigned int SkipTicks(Game *g, Intercept *left, unsigned int limit) {
+	double dx, dy;
+	Plan p1, p2;
+	unsigned int n = limit;
+
+	if (g->state != STATE_PLAY || g->mode != MODE_ONE || g->step != 1.f || g->swept || g->fixed || g->physics.profile != PROFILE_CLASSIC)
+		return 0;
+
+	//The ball flies straight, without reaching a wall or a paddle's line
+	if (!Step(g->ball.x, g->ball.vx, &dx) || !Step(g->ball.y, g->ball.vy, &dy))
+		return 0;
+	n = Room(g->ball.x, dx, PADDLEWIDTH, RESOLUTION - PADDLEWIDTH, n);
+	n = Room(g->ball.y, dy, BALLSIZE + MARGIN, RESOLUTION - BALLSIZE + 1, n);
+
+	//And both paddles keep doing the same thing
+	if (n > 0)
+		n = left->on ? InterceptPlan(left, g->player.height, g->ball, true, n, &p1) : ChasePlan(g->player.height, g->ball.y, dy, n, &p1);
+	if (n > 0)
+		n = g->ai.on ? InterceptPlan(&g->ai, g->player2.height, g->ball, false, n, &p2) : ChasePlan(g->player2.height, g->ball.y, dy, n, &p2);
+	if (n == 0)
+		return 0;
+
+	g->ball.x = (float)(g->ball.x + n * dx);
+	g->ball.y = (float)(g->ball.y + n * dy);
+	Apply(&g->player.height, &p1, g->ball.y, n);
+	Apply(&g->player2.height, &p2, g->ball.y, n);
+
+	//The reaction delays run down
+	if (left->on) {
+		if (left->wait > 0)
+			left->wait -= n;
+		else
+			left->target = left->next;
+	}
+	if (g->ai.on) {
+		if (g->ai.wait > 0)
+			g->ai.wait -= n;
+		else
+			g->ai.target = g->ai.next;
+	}
+
+	return n;
+}
@@ -0,0 +1,23 @@
+#ifndef FASTFORWARD_H
+#define FASTFORWARD_H
+
+#include "Game.h"
+
+/*
+ *FastForward.h
+ *Jumps an AI against AI match (as PlayMatch plays it, at the normal rate
+ *with the tick rules) over the ticks in which nothing happens: no wall,
+ *no paddle, no AI changing its mind. The result is bit for bit the same
+ *as running those ticks one by one.
+ *
+ *Floats are what make this possible at all: as long as a value stays in
+ *one binade (between two powers of two) adding the same velocity to it
+ *always rounds the same way, so n ticks of flight are one exact
+ *multiply-add. Every tick where that doesn't hold is left to TickGame.
+*/
+
+
+//FastForward functions
+unsigned int SkipTicks(Game *g, Intercept *left, unsigned int limit);
+
+#endif
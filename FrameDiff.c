@@ -0,0 +1,443 @@
+#include <stdlib.h>
+#include <string.h>
+#include "FrameDiff.h"
+#include "SimdBall.h"
+
+/*
+ *FrameDiff.c
+ *The tile compare, encoder and decoder, see FrameDiff.h. The compares
+ *OR together the differences of a row of tiles a chunk of columns at a
+ *time and test each chunk once for the tile columns that changed.
+*/
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX
+#include <immintrin.h>
+#endif
+
+#define ROW_BYTES(bytes)	(RESOLUTION * (bytes))
+#define TILE_ROW(bytes)		(TILE * (bytes))	//bytes of a tile in one row of pixels
+
+
+/*
+ *uint16_t ChunkTiles(uint32_t, unsigned int, unsigned int, byte)
+ *This function turns the changed bytes of a chunk of a row (bit k set for
+ *byte k) into the tile columns that changed
+*/
+static uint16_t ChunkTiles(uint32_t changed, unsigned int chunk, unsigned int size, byte bytes) {
+	unsigned int tileRow = TILE_ROW(bytes), k;
+	uint16_t tiles = 0;
+
+	//The chunk is part of a single tile
+	if (size <= tileRow)
+		return changed ? (uint16_t)(1u << chunk * size / tileRow) : 0;
+
+	//The chunk holds several tiles
+	for (k = 0; k < size / tileRow; k++)
+		if (changed >> k * tileRow & ((1u << tileRow) - 1))
+			tiles |= 1u << (chunk * size / tileRow + k);
+
+	return tiles;
+}
+
+/*
+ *void SetRowTiles(uint32_t*, unsigned int, uint16_t)
+ *This function marks the changed tile columns of a tile row in a mask
+*/
+static void SetRowTiles(uint32_t *dirty, unsigned int tileRow, uint16_t tiles) {
+	dirty[tileRow * TILES_ACROSS / 32] |= (uint32_t)tiles << (tileRow * TILES_ACROSS % 32);
+}
+
+/*
+ *uint16_t ScalarTiles(const byte*, const byte*, byte)
+ *This function compares a row of tiles 8 bytes at a time, it works on
+ *any CPU. The differences of the TILE rows of pixels are ORed together
+ *first, so a tile column is only tested once.
+*/
+static uint16_t ScalarTiles(const byte *a, const byte *b, byte bytes) {
+	unsigned int c, i;
+	uint16_t tiles = 0;
+
+	for (c = 0; c < ROW_BYTES(bytes) / 8; c++) {
+		uint64_t changed = 0, x, y;
+
+		for (i = 0; i < TILE; i++) {
+			memcpy(&x, a + i * ROW_BYTES(bytes) + c * 8, 8);
+			memcpy(&y, b + i * ROW_BYTES(bytes) + c * 8, 8);
+			changed |= x ^ y;
+		}
+		if (changed != 0)
+			tiles |= 1u << c * 8 / TILE_ROW(bytes);
+	}
+
+	return tiles;
+}
+
+#ifdef HAVE_SSE2
+/*
+ *uint16_t SSE2Tiles(const byte*, const byte*, byte)
+ *This function compares a row of tiles 16 bytes at a time
+*/
+static uint16_t SSE2Tiles(const byte *a, const byte *b, byte bytes) {
+	unsigned int c, i;
+	uint16_t tiles = 0;
+
+	for (c = 0; c < ROW_BYTES(bytes) / 16; c++) {
+		__m128i changed = _mm_setzero_si128();
+
+		for (i = 0; i < TILE; i++) {
+			unsigned int offset = i * ROW_BYTES(bytes) + c * 16;
+
+			changed = _mm_or_si128(changed, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + offset)), _mm_loadu_si128((const __m128i *)(b + offset))));
+		}
+		tiles |= ChunkTiles(~_mm_movemask_epi8(_mm_cmpeq_epi8(changed, _mm_setzero_si128())) & 0xFFFF, c, 16, bytes);
+	}
+
+	return tiles;
+}
+#endif
+
+#ifdef HAVE_AVX
+/*
+ *uint16_t AVX2Tiles(const byte*, const byte*, byte)
+ *This function compares a row of tiles 32 bytes at a time
+*/
+__attribute__((target("avx2")))
+static uint16_t AVX2Tiles(const byte *a, const byte *b, byte bytes) {
+	unsigned int c, i;
+	uint16_t tiles = 0;
+
+	for (c = 0; c < ROW_BYTES(bytes) / 32; c++) {
+		__m256i changed = _mm256_setzero_si256();
+
+		for (i = 0; i < TILE; i++) {
+			unsigned int offset = i * ROW_BYTES(bytes) + c * 32;
+
+			changed = _mm256_or_si256(changed, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + offset)), _mm256_loadu_si256((const __m256i *)(b + offset))));
+		}
+		tiles |= ChunkTiles(~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(changed, _mm256_setzero_si256())), c, 32, bytes);
+	}
+
+	return tiles;
+}
+#endif
+
+/*
+ *unsigned int DiffTilesWith(int, const void*, const void*, byte, uint32_t*)
+ *This function compares two rasters with the compare of the given width
+ *(SIMD_SCALAR, SIMD_SSE2 or SIMD_AVX2, it has to be supported) and fills
+ *in the mask of the tiles that differ. It returns how many do.
+*/
+unsigned int DiffTilesWith(int lanes, const void *a, const void *b, byte bytes, uint32_t *dirty) {
+	const byte *pa = a, *pb = b;
+	unsigned int y, count = 0;
+
+	for (y = 0; y < RESOLUTION; y += TILE) {
+		unsigned int offset = y * ROW_BYTES(bytes);
+		uint16_t tiles;
+
+		switch (lanes) {
+#ifdef HAVE_AVX
+		case SIMD_AVX2:
+			tiles = AVX2Tiles(pa + offset, pb + offset, bytes);
+			break;
+#endif
+#ifdef HAVE_SSE2
+		case SIMD_SSE2:
+			tiles = SSE2Tiles(pa + offset, pb + offset, bytes);
+			break;
+#endif
+		default:
+			tiles = ScalarTiles(pa + offset, pb + offset, bytes);
+			break;
+		}
+
+		//Two tile rows to a word
+		if (y / TILE % 2 == 0)
+			dirty[y / TILE / 2] = 0;
+		SetRowTiles(dirty, y / TILE, tiles);
+
+		for (; tiles != 0; tiles &= tiles - 1)
+			count++;
+	}
+
+	return count;
+}
+
+/*
+ *int DiffLanes()
+ *This function returns the widest compare the CPU can run, the compares
+ *stop at AVX2 because a 32 bit row of a tile is 32 bytes
+*/
+static int DiffLanes(void) {
+	int lanes = SimdLanes();
+
+	return lanes > SIMD_AVX2 ? SIMD_AVX2 : lanes;
+}
+
+/*
+ *unsigned int DiffTiles(const void*, const void*, byte, uint32_t*)
+ *This function compares two rasters with the widest compare the CPU has
+*/
+unsigned int DiffTiles(const void *a, const void *b, byte bytes, uint32_t *dirty) {
+	return DiffTilesWith(DiffLanes(), a, b, bytes, dirty);
+}
+
+/*
+ *bool TileDirty(const uint32_t*, unsigned int)
+ *This function reads a tile's bit in a mask
+*/
+static bool TileDirty(const uint32_t *dirty, unsigned int tile) {
+	return dirty[tile / 32] >> tile % 32 & 1;
+}
+
+/*
+ *unsigned int DirtyRects(const uint32_t*, Rect*)
+ *This function turns a mask of changed tiles into as few boxes as it
+ *simply can: the runs of tiles in each tile row, grown down over the
+ *rows below with exactly the same run. It returns how many there are,
+ *at most MAX_DIRTY_RECTS.
+*/
+unsigned int DirtyRects(const uint32_t *dirty, Rect *rects) {
+	unsigned int tx, ty, k, count = 0;
+
+	for (ty = 0; ty < TILES_ACROSS; ty++) {
+		unsigned int above = count;
+
+		for (tx = 0; tx < TILES_ACROSS; tx++) {
+			Rect box;
+
+			if (!TileDirty(dirty, ty * TILES_ACROSS + tx))
+				continue;
+
+			box.left = (short)(tx * TILE);
+			box.top = (short)(ty * TILE);
+			while (tx + 1 < TILES_ACROSS && TileDirty(dirty, ty * TILES_ACROSS + tx + 1))
+				tx++;
+			box.right = (short)((tx + 1) * TILE);
+			box.bottom = (short)((ty + 1) * TILE);
+
+			//Grow a box that ends on the row above and spans the same columns
+			for (k = 0; k < above; k++) {
+				if (rects[k].left == box.left && rects[k].right == box.right && rects[k].bottom == box.top) {
+					rects[k].bottom = box.bottom;
+					break;
+				}
+			}
+			if (k == above)
+				rects[count++] = box;
+		}
+	}
+
+	return count;
+}
+
+/*
+ *bool InitFrameEncoder(FrameEncoder*, byte)
+ *This function sets up an encoder for rasters of the given format,
+ *false if there is no memory
+*/
+bool InitFrameEncoder(FrameEncoder *e, byte bytes) {
+	memset(e, 0, sizeof(FrameEncoder));
+	e->bytes = bytes;
+	e->lanes = DiffLanes();
+	e->previous = malloc(RESOLUTION * ROW_BYTES(bytes));
+
+	return e->previous != NULL;
+}
+
+/*
+ *void ResetFrameEncoder(FrameEncoder*)
+ *This function makes the next frame whole again, for a viewer who joins
+ *or a window that has to be painted again
+*/
+void ResetFrameEncoder(FrameEncoder *e) {
+	e->started = false;
+}
+
+/*
+ *unsigned int DiffFrame(FrameEncoder*, const void*)
+ *This function finds the tiles of a frame that changed since the last
+ *one (all of them for the first) and keeps the frame for the next.
+ *It returns how many changed, they are in e->dirty.
+*/
+unsigned int DiffFrame(FrameEncoder *e, const void *pixels) {
+	unsigned int ty, tx, y, tileRow = TILE_ROW(e->bytes);
+
+	if (!e->started) {
+		memset(e->dirty, 0xFF, sizeof(e->dirty));
+		memcpy(e->previous, pixels, RESOLUTION * ROW_BYTES(e->bytes));
+		e->started = true;
+		return e->dirtyCount = TILE_COUNT;
+	}
+
+	e->dirtyCount = DiffTilesWith(e->lanes, e->previous, pixels, e->bytes, e->dirty);
+
+	//Only the tiles that changed need to be kept
+	for (ty = 0; ty < TILES_ACROSS; ty++) {
+		for (tx = 0; tx < TILES_ACROSS; tx++) {
+			if (!TileDirty(e->dirty, ty * TILES_ACROSS + tx))
+				continue;
+			for (y = ty * TILE; y < (ty + 1) * TILE; y++) {
+				unsigned int offset = y * ROW_BYTES(e->bytes) + tx * tileRow;
+
+				memcpy((byte *)e->previous + offset, (const byte *)pixels + offset, tileRow);
+			}
+		}
+	}
+
+	return e->dirtyCount;
+}
+
+/*
+ *byte *PutCount(byte*, unsigned int)
+ *This function writes a count 7 bits a byte
+*/
+static byte *PutCount(byte *out, unsigned int v) {
+	for (; v >= 0x80; v >>= 7)
+		*out++ = (byte)(v | 0x80);
+	*out++ = (byte)v;
+
+	return out;
+}
+
+/*
+ *const byte *GetCount(const byte*, const byte*, unsigned int*)
+ *This function reads what PutCount wrote, NULL if it runs past end
+*/
+static const byte *GetCount(const byte *in, const byte *end, unsigned int *v) {
+	unsigned int shift;
+
+	*v = 0;
+	for (shift = 0; in < end && shift < 28; shift += 7) {
+		*v |= (unsigned int)(*in & 0x7F) << shift;
+		if (!(*in++ & 0x80))
+			return in;
+	}
+
+	return NULL;
+}
+
+/*
+ *byte *PutTile(byte*, const byte*, byte)
+ *This function RLE codes the tile whose top left pixel is at pixels
+*/
+static byte *PutTile(byte *out, const byte *pixels, byte bytes) {
+	unsigned int i, run = 0;
+	const byte *last = NULL;
+
+	for (i = 0; i < TILE * TILE; i++) {
+		const byte *p = pixels + i / TILE * ROW_BYTES(bytes) + i % TILE * bytes;
+
+		if (run > 0 && memcmp(p, last, bytes) == 0) {
+			run++;
+			continue;
+		}
+		if (run > 0) {
+			*out++ = (byte)run;
+			memcpy(out, last, bytes);
+			out += bytes;
+		}
+		last = p;
+		run = 1;
+	}
+	*out++ = (byte)run;
+	memcpy(out, last, bytes);
+
+	return out + bytes;
+}
+
+/*
+ *unsigned int EncodeFrame(FrameEncoder*, const void*, byte*)
+ *This function encodes the tiles of a frame that changed since the last
+ *one into out (FRAME_MAX_SIZE bytes) and returns how many bytes it took.
+ *The changed tiles are in e->dirty afterwards.
+*/
+unsigned int EncodeFrame(FrameEncoder *e, const void *pixels, byte *out) {
+	const byte *p = pixels;
+	unsigned int tile, skip = 0, count = 0, runCount = 0, tileRow = TILE_ROW(e->bytes);
+	byte *start = out;
+
+	DiffFrame(e, pixels);
+
+	//The runs
+	for (tile = 0; tile < TILE_COUNT; tile++)
+		runCount += TileDirty(e->dirty, tile) && (tile == 0 || !TileDirty(e->dirty, tile - 1));
+	out = PutCount(out, runCount);
+	for (tile = 0; tile <= TILE_COUNT; tile++) {
+		if (tile < TILE_COUNT && TileDirty(e->dirty, tile)) {
+			count++;
+			continue;
+		}
+		if (count > 0) {
+			out = PutCount(PutCount(out, skip), count);
+			skip = count = 0;
+		}
+		skip++;
+	}
+
+	//Then their tiles
+	for (tile = 0; tile < TILE_COUNT; tile++)
+		if (TileDirty(e->dirty, tile))
+			out = PutTile(out, p + tile / TILES_ACROSS * TILE * ROW_BYTES(e->bytes) + tile % TILES_ACROSS * tileRow, e->bytes);
+
+	return (unsigned int)(out - start);
+}
+
+/*
+ *void FreeFrameEncoder(FrameEncoder*)
+ *This function frees what InitFrameEncoder took
+*/
+void FreeFrameEncoder(FrameEncoder *e) {
+	free(e->previous);
+	e->previous = NULL;
+}
+
+/*
+ *bool DecodeFrame(void*, byte, const byte*, unsigned int, uint32_t*)
+ *This function draws an encoded frame over the last one in pixels and
+ *fills in the mask of the tiles it changed. It returns false if the
+ *frame is damaged, the pixels may be half drawn then.
+*/
+bool DecodeFrame(void *pixels, byte bytes, const byte *data, unsigned int size, uint32_t *dirty) {
+	const byte *in = data, *end = data + size, *tiles;
+	unsigned int runCount, skip, count, tile = 0, k, tileRow = TILE_ROW(bytes);
+	byte *out = pixels;
+
+	memset(dirty, 0, sizeof(uint32_t) * TILE_WORDS);
+	if ((in = GetCount(in, end, &runCount)) == NULL)
+		return false;
+
+	//The tiles start after the last run
+	for (tiles = in, k = 0; k < runCount; k++)
+		if ((tiles = GetCount(tiles, end, &skip)) == NULL || (tiles = GetCount(tiles, end, &count)) == NULL)
+			return false;
+
+	for (k = 0; k < runCount; k++) {
+		in = GetCount(GetCount(in, end, &skip), end, &count);
+		tile += skip;
+		if (tile + count > TILE_COUNT)
+			return false;
+
+		for (; count > 0; count--, tile++) {
+			byte *p = out + tile / TILES_ACROSS * TILE * ROW_BYTES(bytes) + tile % TILES_ACROSS * tileRow;
+			unsigned int i = 0, run;
+
+			while (i < TILE * TILE) {
+				if (end - tiles < 1 + bytes || tiles[0] == 0 || i + tiles[0] > TILE * TILE)
+					return false;
+				for (run = tiles[0]; run > 0; run--, i++)
+					memcpy(p + i / TILE * ROW_BYTES(bytes) + i % TILE * bytes, tiles + 1, bytes);
+				tiles += 1 + bytes;
+			}
+			dirty[tile / 32] |= 1u << tile % 32;
+		}
+	}
+
+	return tiles == end;
+}
@@ -0,0 +1,58 @@
+#ifndef FRAMEDIFF_H
+#define FRAMEDIFF_H
+
+#include <stdint.h>
+#include "Raster.h"
+
+/*
+ *FrameDiff.h
+ *Encodes a stream of RESOLUTION x RESOLUTION rasters as the tiles that
+ *changed since the frame before. The raster is cut into TILE x TILE tiles
+ *and two frames are compared a whole row of pixels at a time with the
+ *widest SIMD compare the CPU has (see SimdBall.h for the widths). A table
+ *in play only changes the tiles under the ball and the paddles, so the
+ *frames cost bytes and blits in proportion to the motion, not the size.
+ *
+ *An encoded frame is a varint count of runs, then every run: a varint of
+ *unchanged tiles to skip, a varint of changed tiles, and those tiles.
+ *Tiles go in raster order (left to right, top to bottom) and each is RLE
+ *coded row after row: a byte of repeats (1 to TILE * TILE) and the pixel
+ *(1 or 4 bytes). The first frame of an encoder has every tile.
+ *
+ *The same changed tile mask gives the presentation step the boxes to blit
+ *(DirtyRects).
+*/
+
+
+#define TILE			8
+#define TILES_ACROSS	(RESOLUTION / TILE)
+#define TILE_COUNT		(TILES_ACROSS * TILES_ACROSS)
+#define TILE_WORDS		(TILE_COUNT / 32)	//of a changed tile mask, tile i is word i/32 bit i%32
+#define FRAME_MAX_SIZE	(8 + TILE_COUNT * (4 + TILE * TILE * (1 + RASTER_32)))
+#define MAX_DIRTY_RECTS	(TILE_COUNT / 2)
+
+typedef struct FrameEncoder {
+	byte bytes;						//RASTER_8 or RASTER_32
+	int lanes;						//the compare used
+	void *previous;					//the last frame encoded
+	bool started;					//false until the first frame
+	uint32_t dirty[TILE_WORDS];		//the tiles that changed in the last frame
+	unsigned int dirtyCount;
+} FrameEncoder;
+
+//Tile functions
+unsigned int DiffTiles(const void *a, const void *b, byte bytes, uint32_t *dirty);
+unsigned int DiffTilesWith(int lanes, const void *a, const void *b, byte bytes, uint32_t *dirty);
+unsigned int DirtyRects(const uint32_t *dirty, Rect *rects);
+
+//Encoder functions
+bool InitFrameEncoder(FrameEncoder *e, byte bytes);
+void ResetFrameEncoder(FrameEncoder *e);
+unsigned int EncodeFrame(FrameEncoder *e, const void *pixels, byte *out);
+unsigned int DiffFrame(FrameEncoder *e, const void *pixels);
+void FreeFrameEncoder(FrameEncoder *e);
+
+//Decoder functions
+bool DecodeFrame(void *pixels, byte bytes, const byte *data, unsigned int size, uint32_t *dirty);
+
+#endif
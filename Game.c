@@ -0,0 +1,982 @@
+#include <math.h>
+#include <string.h>
+#include "Game.h"
+
+/*
+ *Game.c
+ *The game logic that used to run directly on the globals in Pong.c.
+ *Every function takes the match it works on so that the same code can
+ *drive the window, headless environments and benchmarks.
+ *
+ *The physics are written once as kernels taking a Physics. They are
+ *inlined into a copy for each known profile, which reads the values from
+ *Profiles[] and so has them folded in as constants like the old defines,
+ *and into a copy that reads the match's own values. The functions that
+ *don't take a match are the classic copy. The fixed point kernels (see
+ *SetFixed) come first and are copied the same way.
+*/
+
+
+//Kernels are always inlined, that is what makes the copies
+#ifdef _MSC_VER
+#define KERNEL static __forceinline
+#else
+#define KERNEL static inline __attribute__((always_inline))
+#endif
+
+//Runs statement with ph pointing at the physics of the match g: one of
+//Profiles[] for a known profile, a copy of its own otherwise
+#define WITH_PHYSICS(g, ph, statement) \
+	switch ((g)->physics.profile) { \
+	case PROFILE_CLASSIC: { const Physics *ph = &Profiles[PROFILE_CLASSIC]; statement; break; } \
+	case PROFILE_FAST: { const Physics *ph = &Profiles[PROFILE_FAST]; statement; break; } \
+	case PROFILE_LONG: { const Physics *ph = &Profiles[PROFILE_LONG]; statement; break; } \
+	default: { Physics custom = (g)->physics; const Physics *ph = &custom; statement; break; } \
+	}
+
+const Physics Profiles[PROFILE_COUNT] = {
+	{ PROFILE_CLASSIC, BALLSPEED, ENGLISHSCALE, PADDLEHEIGHT, AI_SPEED, PLAYER_SPEED, MAXSCORE },
+	{ PROFILE_FAST, BALLSPEED * 3 / 2, ENGLISHSCALE, PADDLEHEIGHT, AI_SPEED * 1.5f, PLAYER_SPEED * 1.5f, MAXSCORE },
+	{ PROFILE_LONG, BALLSPEED, ENGLISHSCALE, PADDLEHEIGHT, AI_SPEED, PLAYER_SPEED, 21 }
+};
+
+
+/*
+ *uint64_t Random(uint64_t, uint64_t)
+ *This function is a counter based random number generator: it hashes
+ *the key and counter together (splitmix64), so there is no hidden state
+ *and any draw can be made again on its own
+*/
+uint64_t Random(uint64_t key, uint64_t counter) {
+	uint64_t z = key + (counter + 1) * 0x9E3779B97F4A7C15ull;
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+	return z ^ (z >> 31);
+}
+
+/*
+ *uint64_t MatchSeed(uint64_t, uint64_t)
+ *This function derives the seed of one match out of a whole batch
+*/
+uint64_t MatchSeed(uint64_t seed, uint64_t match) {
+	return Random(seed ^ 0x5EED5EED5EED5EEDull, match);
+}
+
+/*
+ *void InitGame(Game*, uint64_t)
+ *This function puts a match on the home screen with centered paddles
+*/
+void InitGame(Game *g, uint64_t seed) {
+	//Every field and the padding start at 0, all of the AI included
+	memset(g, 0, sizeof(Game));
+	g->seed = seed;
+	g->serves = 0;
+	g->score = 0;
+	g->state = STATE_HOME;
+	g->mode = MODE_ONE;
+	g->stateChange = true;
+	g->step = 1.f;
+	g->swept = false;
+	g->fixed = false;
+	g->ai.on = false;
+	g->ai.swept = false;
+	g->physics = Profiles[PROFILE_CLASSIC];
+
+	g->player2.height = (RESOLUTION + MARGIN) / 2.f;
+	g->player.height = (RESOLUTION + MARGIN) / 2.f;
+
+	g->ball.x = RESOLUTION / 2.f;
+	g->ball.y = (RESOLUTION - MARGIN) / 2.f + MARGIN;
+	g->ball.vx = 0;
+	g->ball.vy = 0;
+}
+
+/*
+ *void SetTickRate(Game*, unsigned int)
+ *This function makes a match run at the given number of ticks per second
+ *without changing how fast anything moves in real time
+*/
+void SetTickRate(Game *g, unsigned int hz) {
+	g->step = (float)TICK_RATE / hz;
+}
+
+/*
+ *void SetSwept(Game*, bool)
+ *This function switches a match between the tick rules (MoveBall) and
+ *swept collisions (SweepBall)
+*/
+void SetSwept(Game *g, bool swept) {
+	g->swept = swept;
+	g->ai.swept = swept;
+}
+
+/*
+ *void SetFixed(Game*, bool)
+ *This function switches a match between float physics and fixed point
+ *physics, which play the same ticks on every machine
+*/
+void SetFixed(Game *g, bool fixed) {
+	g->fixed = fixed;
+}
+
+/*
+ *byte FindProfile(const Physics*)
+ *This function returns which of the known profiles the physics are,
+ *PROFILE_CUSTOM if none
+*/
+byte FindProfile(const Physics *ph) {
+	byte i;
+
+	for (i = 0; i < PROFILE_COUNT; i++)
+		if (ph->ballSpeed == Profiles[i].ballSpeed && ph->englishScale == Profiles[i].englishScale &&
+			ph->paddleHeight == Profiles[i].paddleHeight && ph->aiSpeed == Profiles[i].aiSpeed &&
+			ph->playerSpeed == Profiles[i].playerSpeed && ph->maxScore == Profiles[i].maxScore)
+			return i;
+
+	return PROFILE_CUSTOM;
+}
+
+/*
+ *void SetPhysics(Game*, const Physics*)
+ *This function makes a match play with the given physics, with the code
+ *made for them if they are one of the known profiles
+*/
+void SetPhysics(Game *g, const Physics *ph) {
+	g->physics = *ph;
+	g->physics.profile = FindProfile(ph);
+}
+
+/*
+ *void AdvanceState(Game*)
+ *This function moves the state machine forward when the player
+ *presses the space bar or the "Go!" button
+*/
+void AdvanceState(Game *g) {
+	switch (g->state) {
+	case STATE_HOME:
+		g->state = STATE_READY;
+		g->score = 0;
+		break;
+	case STATE_READY:
+		g->state = STATE_SERVE;
+		break;
+	case STATE_END:
+		g->state = STATE_HOME;
+		break;
+	default:
+		return;
+	}
+	g->stateChange = true;
+}
+
+/*
+ *Fixed point physics
+ *The same physics again on Q16.16 numbers. Integer adds, multiplies,
+ *shifts and divides come out the same on every compiler and CPU, so a
+ *match plays bit for bit the same ticks everywhere, which floats with
+ *cos and sin from the C library don't promise. They take the floats of
+ *the match in and put them back after every tick (see Fixed). Where a
+ *product has to be scaled back it is rounded down, always.
+*/
+
+//Q16.16 cos and sin of 0 to 45 degrees, the angles LaunchKernel works out
+static const Fixed serveCos[46] = {
+	65536, 65526, 65496, 65446, 65377, 65287, 65177, 65048,
+	64899, 64730, 64541, 64333, 64105, 63858, 63591, 63305,
+	63000, 62675, 62332, 61969, 61588, 61187, 60769, 60331,
+	59876, 59402, 58910, 58400, 57872, 57327, 56765, 56185,
+	55588, 54974, 54343, 53696, 53032, 52352, 51657, 50945,
+	50218, 49476, 48719, 47947, 47160, 46359
+};
+static const Fixed serveSin[46] = {
+	0, 1143, 2286, 3428, 4569, 5709, 6847, 7983,
+	9116, 10247, 11374, 12499, 13619, 14735, 15847, 16954,
+	18055, 19151, 20242, 21326, 22404, 23475, 24538, 25595,
+	26643, 27684, 28716, 29739, 30753, 31758, 32753, 33738,
+	34713, 35677, 36631, 37573, 38504, 39423, 40331, 41226,
+	42108, 42978, 43834, 44677, 45507, 46322
+};
+
+/*
+ *int64_t FloorShift(int64_t, int)
+ *This function divides by 2^bits rounding down, without leaving the sign
+ *of a right shift up to the compiler
+*/
+KERNEL int64_t FloorShift(int64_t v, int bits) {
+	return v >= 0 ? v >> bits : ~(~v >> bits);
+}
+
+/*
+ *int64_t FloorDiv(int64_t, int64_t)
+ *This function divides rounding down
+*/
+KERNEL int64_t FloorDiv(int64_t a, int64_t b) {
+	int64_t q = a / b;
+
+	return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+/*
+ *Fixed FixedMul(Fixed, Fixed)
+ *This function multiplies two Q16.16 numbers
+*/
+KERNEL Fixed FixedMul(Fixed a, Fixed b) {
+	return (Fixed)FloorShift((int64_t)a * b, 16);
+}
+
+/*
+ *Fixed FixedDiv(Fixed, Fixed)
+ *This function divides two Q16.16 numbers, rounding towards 0
+*/
+KERNEL Fixed FixedDiv(Fixed a, Fixed b) {
+	return (Fixed)((int64_t)a * FIXED_ONE / b);
+}
+
+/*
+ *void FixedPaddleKernel(const Physics*, Paddle*, int, Fixed)
+ *This function is PaddleKernel in fixed point
+*/
+KERNEL void FixedPaddleKernel(const Physics *ph, Paddle *p, int dir, Fixed step) {
+	Fixed height = TO_FIXED(p->height) + FixedMul(TO_FIXED(ph->playerSpeed) * dir, step);
+
+	height = CLAMP(height, (MARGIN + 1) * FIXED_ONE + ph->paddleHeight * (FIXED_ONE / 2), RESOLUTION * FIXED_ONE - ph->paddleHeight * (FIXED_ONE / 2));
+	p->height = FROM_FIXED(height);
+}
+
+/*
+ *void FixedFollow(const Physics*, Paddle*, Fixed, Fixed)
+ *This function moves an AI paddle towards target under the AI speed and
+ *keeps it on the table, like the end of ChaseKernel and InterceptKernel
+*/
+KERNEL void FixedFollow(const Physics *ph, Paddle *p, Fixed target, Fixed step) {
+	Fixed height = TO_FIXED(p->height), limit = FixedMul(TO_FIXED(ph->aiSpeed), step), speed = target - height;
+
+	speed = CLAMP(speed, -limit, limit);
+	height += speed;
+	height = CLAMP(height, MARGIN * FIXED_ONE + ph->paddleHeight * (FIXED_ONE / 2), RESOLUTION * FIXED_ONE - ph->paddleHeight * (FIXED_ONE / 2));
+	p->height = FROM_FIXED(height);
+}
+
+/*
+ *Fixed FixedInterceptY(const FixedBall*, Fixed, Fixed)
+ *This function is InterceptY in fixed point
+*/
+KERNEL Fixed FixedInterceptY(const FixedBall *b, Fixed x, Fixed step) {
+	const int64_t low = (BALLSIZE + MARGIN) * FIXED_ONE, span = (RESOLUTION - BALLSIZE + 1) * FIXED_ONE - low;
+	int64_t time, y, d;
+
+	//In normal ticks (Q16.16)
+	if (step > 0) {
+		d = FixedMul(b->vx, step);
+		time = (d != 0 ? FloorDiv((int64_t)x - b->x, d) + 1 : 1) * step;
+	}
+	else
+		time = ((int64_t)x - b->x) * FIXED_ONE / b->vx;
+	y = (b->y + FloorShift((int64_t)b->vy * time, 16) - low) % (2 * span);
+	if (y < 0)
+		y += 2 * span;
+	if (y > span)
+		y = 2 * span - y;
+
+	return (Fixed)(low + y);
+}
+
+/*
+ *void FixedInterceptKernel(const Physics*, Intercept*, Paddle*, const FixedBall*, byte, Fixed)
+ *This function is InterceptKernel in fixed point
+*/
+KERNEL void FixedInterceptKernel(const Physics *ph, Intercept *ai, Paddle *p, const FixedBall *b, byte state, Fixed step) {
+	if (state < STATE_SERVE)
+		return;
+
+	if (b->vx != TO_FIXED(ai->vx) || (b->vy < 0 ? -b->vy : b->vy) != TO_FIXED(ai->vy < 0 ? -ai->vy : ai->vy)) {
+		Fixed next;
+
+		ai->vx = FROM_FIXED(b->vx);
+		ai->vy = FROM_FIXED(b->vy);
+
+		if (ai->left ? b->vx < 0 : b->vx > 0) { //Coming our way
+			next = FixedInterceptY(b, (ai->left ? PADDLEWIDTH : RESOLUTION - PADDLEWIDTH) * FIXED_ONE, ai->swept ? 0 : step);
+			if (ai->error > 0) //Miss the spot by up to error pixels
+				next += (Fixed)FloorShift(((int64_t)(Random(ai->seed, ai->solves) >> 40) * 2 - (1 << 24)) * TO_FIXED(ai->error), 24);
+		}
+		else //Wait in the middle
+			next = (RESOLUTION + MARGIN) * (FIXED_ONE / 2);
+		ai->next = FROM_FIXED(next);
+
+		ai->solves++;
+		ai->wait = (uint16_t)((int64_t)ai->delay * FIXED_ONE / step);
+	}
+
+	if (ai->wait > 0)
+		ai->wait--;
+	else
+		ai->target = ai->next;
+
+	FixedFollow(ph, p, TO_FIXED(ai->target), step);
+}
+
+/*
+ *void FixedAIKernel(const Physics*, Game*, Intercept*, Paddle*, const FixedBall*)
+ *This function is AIKernel in fixed point
+*/
+KERNEL void FixedAIKernel(const Physics *ph, Game *g, Intercept *ai, Paddle *p, const FixedBall *b) {
+	if (ai->on)
+		FixedInterceptKernel(ph, ai, p, b, g->state, TO_FIXED(g->step));
+	else if (g->state >= STATE_SERVE)
+		FixedFollow(ph, p, b->y, TO_FIXED(g->step));
+}
+
+/*
+ *void FixedLaunchKernel(const Physics*, Ball*, int)
+ *This function is LaunchKernel in fixed point, with the cos and sin out
+ *of the tables. Serves are between -45 and 45 degrees, 180 more to the left.
+*/
+KERNEL void FixedLaunchKernel(const Physics *ph, Ball *b, int degrees) {
+	int side = degrees > 90 ? -1 : 1, angle = degrees > 90 ? degrees - 180 : degrees;
+	Fixed vx = (Fixed)((int64_t)ph->ballSpeed * serveCos[angle < 0 ? -angle : angle] / 100),
+		vy = (Fixed)((int64_t)ph->ballSpeed * serveSin[angle < 0 ? -angle : angle] / 100);
+
+	b->x = RESOLUTION / 2.f;
+	b->y = (RESOLUTION - MARGIN) / 2.f + MARGIN;
+
+	b->vx = FROM_FIXED(side * vx);
+	b->vy = FROM_FIXED(angle < 0 ? -side * vy : side * vy);
+}
+
+/*
+ *void FixedEnglishKernel(const Physics*, FixedBall*, Fixed)
+ *This function is EnglishKernel in fixed point. The scale is taken in
+ *Q20.12 and the distance to the paddle's center cut down to match, so
+ *the product fits in 32 bits like in the SIMD kernels. vy is held to
+ *FIXED_MAX_VY so that the ball stays on the table.
+*/
+KERNEL void FixedEnglishKernel(const Physics *ph, FixedBall *b, Fixed p) {
+	int32_t scale = ph->englishScale * 4096 / 100;
+
+	b->vy += (Fixed)FloorShift((int32_t)FloorShift(b->y - p, 4) * scale, 8);
+	b->vy = CLAMP(b->vy, -FIXED_MAX_VY * FIXED_ONE, FIXED_MAX_VY * FIXED_ONE);
+}
+
+/*
+ *bool FixedHit(const Physics*, Fixed, Fixed)
+ *This function tells whether the ball at y is on the paddle at height p
+*/
+KERNEL bool FixedHit(const Physics *ph, Fixed y, Fixed p) {
+	return y >= p - ph->paddleHeight * (FIXED_ONE / 2) - BALLSIZE * FIXED_ONE && y <= p + ph->paddleHeight * (FIXED_ONE / 2) + BALLSIZE * FIXED_ONE;
+}
+
+/*
+ *byte FixedMoveKernel(const Physics*, FixedBall*, Fixed, Fixed, Fixed)
+ *This function is MoveKernel in fixed point
+*/
+KERNEL byte FixedMoveKernel(const Physics *ph, FixedBall *b, Fixed player, Fixed player2, Fixed step) {
+	b->x += FixedMul(b->vx, step);
+	b->y += FixedMul(b->vy, step);
+
+	//Detect vertical collisions
+	if (b->y < (BALLSIZE + MARGIN) * FIXED_ONE) {
+		b->y = 2 * (BALLSIZE + MARGIN) * FIXED_ONE - b->y;
+		b->vy = -b->vy;
+	}
+	else if (b->y > (RESOLUTION - BALLSIZE + 1) * FIXED_ONE) {
+		b->y = 2 * (RESOLUTION - BALLSIZE + 1) * FIXED_ONE - b->y;
+		b->vy = -b->vy;
+	}
+
+	//Detect paddle collisions and out of bounds conditions (scores)
+	if (b->x < PADDLEWIDTH * FIXED_ONE) {
+		if (!FixedHit(ph, b->y, player))
+			return SCORED_PLAYER2;
+		b->x = 2 * PADDLEWIDTH * FIXED_ONE - b->x;
+		b->vx = -b->vx;
+		FixedEnglishKernel(ph, b, player);
+	}
+	else if (b->x > (RESOLUTION - PADDLEWIDTH) * FIXED_ONE) {
+		if (!FixedHit(ph, b->y, player2))
+			return SCORED_PLAYER;
+		b->x = 2 * (RESOLUTION - PADDLEWIDTH) * FIXED_ONE - b->x;
+		b->vx = -b->vx;
+		FixedEnglishKernel(ph, b, player2);
+	}
+
+	return SCORED_NONE;
+}
+
+/*
+ *byte MoveFixedBall(FixedBall*, Fixed, Fixed)
+ *This function is FixedMoveKernel with the classic physics and a normal tick
+*/
+byte MoveFixedBall(FixedBall *b, Fixed player, Fixed player2) {
+	return FixedMoveKernel(&Profiles[PROFILE_CLASSIC], b, player, player2, FIXED_ONE);
+}
+
+/*
+ *byte FixedSweepKernel(const Physics*, FixedBall*, Fixed, Fixed, Fixed)
+ *This function is SweepKernel in fixed point
+*/
+KERNEL byte FixedSweepKernel(const Physics *ph, FixedBall *b, Fixed player, Fixed player2, Fixed step) {
+	const Fixed low = (BALLSIZE + MARGIN) * FIXED_ONE, high = (RESOLUTION - BALLSIZE + 1) * FIXED_ONE,
+		left = PADDLEWIDTH * FIXED_ONE, right = (RESOLUTION - PADDLEWIDTH) * FIXED_ONE;
+	Fixed wall, side;
+	int bounces;
+
+	for (bounces = 0; bounces < MAXBOUNCES; bounces++) {
+		//Time until the ball reaches a wall and until it reaches a paddle's line
+		wall = b->vy < 0 ? FixedDiv(low - b->y, b->vy) : (b->vy > 0 ? FixedDiv(high - b->y, b->vy) : step);
+		side = b->vx < 0 ? FixedDiv(left - b->x, b->vx) : (b->vx > 0 ? FixedDiv(right - b->x, b->vx) : step);
+		wall = wall > 0 ? wall : 0;
+		side = side > 0 ? side : 0;
+
+		if (wall >= step && side >= step) //Nothing in the way
+			break;
+
+		if (wall <= side) { //Bounce off a wall
+			b->x += FixedMul(b->vx, wall);
+			b->y = b->vy < 0 ? low : high;
+			b->vy = -b->vy;
+			step -= wall;
+		}
+		else { //Reach a paddle's line
+			Fixed p = b->vx < 0 ? player : player2;
+
+			b->x = b->vx < 0 ? left : right;
+			b->y += FixedMul(b->vy, side);
+			step -= side;
+
+			if (!FixedHit(ph, b->y, p))
+				return b->vx < 0 ? SCORED_PLAYER2 : SCORED_PLAYER;
+
+			b->vx = -b->vx;
+			FixedEnglishKernel(ph, b, p);
+		}
+	}
+
+	b->x += FixedMul(b->vx, step);
+	b->y += FixedMul(b->vy, step);
+
+	return SCORED_NONE;
+}
+
+/*
+ *void FixedBallKernel(const Physics*, Game*, FixedBall*)
+ *This function is BallKernel in fixed point on the ball given, which is
+ *put back into the match
+*/
+KERNEL void FixedBallKernel(const Physics *ph, Game *g, FixedBall *b) {
+	Fixed player = TO_FIXED(g->player.height), player2 = TO_FIXED(g->player2.height);
+	byte scored = g->swept ? FixedSweepKernel(ph, b, player, player2, TO_FIXED(g->step)) : FixedMoveKernel(ph, b, player, player2, TO_FIXED(g->step));
+
+	g->ball.x = FROM_FIXED(b->x);
+	g->ball.y = FROM_FIXED(b->y);
+	g->ball.vx = FROM_FIXED(b->vx);
+	g->ball.vy = FROM_FIXED(b->vy);
+	AwardPoint(g, scored);
+}
+
+/*
+ *void FixedTickKernel(const Physics*, Game*, int, int)
+ *This function is TickKernel in fixed point
+*/
+KERNEL void FixedTickKernel(const Physics *ph, Game *g, int playerDir, int player2Dir) {
+	bool serve = g->state == STATE_SERVE;
+	FixedBall b;
+
+	if (g->state != STATE_HOME) {
+		FixedPaddleKernel(ph, &g->player, playerDir, TO_FIXED(g->step));
+
+		if (g->mode == MODE_TWO)
+			FixedPaddleKernel(ph, &g->player2, player2Dir, TO_FIXED(g->step));
+	}
+
+	if (serve)
+		ServeBall(g);
+	else if (g->state != STATE_PLAY)
+		return;
+
+	b.x = TO_FIXED(g->ball.x);
+	b.y = TO_FIXED(g->ball.y);
+	b.vx = TO_FIXED(g->ball.vx);
+	b.vy = TO_FIXED(g->ball.vy);
+	FixedBallKernel(ph, g, &b);
+	if (!serve && g->mode == MODE_ONE) //Update the AI if it's a single player game
+		FixedAIKernel(ph, g, &g->ai, &g->player2, &b);
+}
+
+/*
+ *void PaddleKernel(const Physics*, Paddle*, int, float)
+ *This function moves a player controlled paddle by the player speed
+ *(times the step) in the given direction and keeps it on the table
+*/
+KERNEL void PaddleKernel(const Physics *ph, Paddle *p, int dir, float step) {
+	p->height += ph->playerSpeed * dir * step;
+	p->height = CLAMP(p->height, MARGIN + ph->paddleHeight / 2.f + 1, RESOLUTION - ph->paddleHeight / 2.f);
+}
+
+/*
+ *void MovePaddle(Paddle*, int, float)
+ *This function is PaddleKernel with the classic physics
+*/
+void MovePaddle(Paddle *p, int dir, float step) {
+	PaddleKernel(&Profiles[PROFILE_CLASSIC], p, dir, step);
+}
+
+/*
+ *void UpdateAI(Paddle*, Ball, byte)
+ *This function updates the AI paddle position based on the height of the ball
+ *It will attempt to exactly match the height of the ball at all times
+ *but is limited in maximum speed by the value of AI_SPEED
+*/
+void UpdateAI(Paddle *AI, Ball b, byte state) {
+	UpdateAIStep(AI, b, state, 1.f);
+}
+
+/*
+ *void ChaseKernel(const Physics*, Paddle*, Ball, byte, float)
+ *This function is UpdateAI for any physics and a tick that is step
+ *normal ticks long
+*/
+KERNEL void ChaseKernel(const Physics *ph, Paddle *AI, Ball b, byte state, float step) {
+	float speed = b.y - AI->height, height;
+
+	if (state < STATE_SERVE)
+		return;
+
+	speed = CLAMP(speed, -ph->aiSpeed * step, ph->aiSpeed * step); //Limit the speed
+
+	height = AI->height + speed;
+
+	AI->height = CLAMP(height, MARGIN + ph->paddleHeight/2.f, RESOLUTION - ph->paddleHeight/2.f); //Keep the paddle on the table
+}
+
+/*
+ *void UpdateAIStep(Paddle*, Ball, byte, float)
+ *This function is UpdateAI for a tick that is step normal ticks long
+*/
+void UpdateAIStep(Paddle *AI, Ball b, byte state, float step) {
+	ChaseKernel(&Profiles[PROFILE_CLASSIC], AI, b, state, step);
+}
+
+/*
+ *void InitIntercept(Intercept*, bool, byte, uint64_t)
+ *This function sets up the predictive AI for one side with one of the
+ *SKILL_* levels. SKILL_CHASE turns it off. The delay and error can be
+ *changed afterwards to tune it further.
+*/
+void InitIntercept(Intercept *ai, bool left, byte skill, uint64_t seed) {
+	//Reaction delay and aim error of each skill
+	static const uint16_t delays[] = { 0, 25, 12, 4 };
+	static const float errors[] = { 0, 14.f, 10.f, 8.5f };
+
+	skill = skill <= SKILL_HARD ? skill : SKILL_HARD;
+
+	ai->on = skill != SKILL_CHASE;
+	ai->left = left;
+	ai->swept = false;
+	ai->delay = delays[skill];
+	ai->error = errors[skill];
+	ai->seed = seed;
+	ai->solves = 0;
+	ai->wait = 0;
+	ai->vx = 0;
+	ai->vy = 0;
+	ai->target = ai->next = (RESOLUTION + MARGIN) / 2.f;
+}
+
+/*
+ *float InterceptY(Ball, float, float)
+ *This function returns the height of the ball on the first tick it is past
+ *the line at x, which is where MoveBall checks for the paddle, or with a
+ *step of 0 right on the line, where SweepBall checks for it. The straight
+ *line is followed past the walls and then folded back between them
+ *(MARGIN + BALLSIZE and RESOLUTION - BALLSIZE + 1), which is exactly what
+ *the bounces in MoveBall do.
+*/
+float InterceptY(Ball b, float x, float step) {
+	float low = BALLSIZE + MARGIN, span = (RESOLUTION - BALLSIZE + 1) - low, time, y;
+
+	//In normal ticks
+	time = step > 0 ? (floorf((x - b.x) / (b.vx * step)) + 1) * step : (x - b.x) / b.vx;
+	y = fmodf(b.y + b.vy * time - low, 2 * span);
+	if (y < 0)
+		y += 2 * span;
+	if (y > span)
+		y = 2 * span - y;
+
+	return low + y;
+}
+
+/*
+ *void InterceptKernel(const Physics*, Intercept*, Paddle*, Ball, byte, float)
+ *This function moves the AI paddle towards where the ball will be. The
+ *trajectory only changes when the ball is served or hits a paddle (the
+ *wall bounces only flip vy and are already folded in), so the target is
+ *only worked out again then. Every other tick is a compare and a clamp.
+ *It moves under the same speed limit as UpdateAI.
+*/
+KERNEL void InterceptKernel(const Physics *ph, Intercept *ai, Paddle *p, Ball b, byte state, float step) {
+	float speed, height;
+
+	if (state < STATE_SERVE)
+		return;
+
+	if (b.vx != ai->vx || fabsf(b.vy) != fabsf(ai->vy)) {
+		ai->vx = b.vx;
+		ai->vy = b.vy;
+
+		if (ai->left ? b.vx < 0 : b.vx > 0) { //Coming our way
+			ai->next = InterceptY(b, ai->left ? PADDLEWIDTH : RESOLUTION - PADDLEWIDTH, ai->swept ? 0 : step);
+			if (ai->error > 0) //Miss the spot by up to error pixels
+				ai->next += ((Random(ai->seed, ai->solves) >> 40) / (float)(1 << 24) * 2 - 1) * ai->error;
+		}
+		else //Wait in the middle
+			ai->next = (RESOLUTION + MARGIN) / 2.f;
+
+		ai->solves++;
+		ai->wait = ai->delay / step;
+	}
+
+	if (ai->wait > 0)
+		ai->wait--;
+	else
+		ai->target = ai->next;
+
+	speed = ai->target - p->height;
+	speed = CLAMP(speed, -ph->aiSpeed * step, ph->aiSpeed * step); //Limit the speed
+
+	height = p->height + speed;
+
+	p->height = CLAMP(height, MARGIN + ph->paddleHeight/2.f, RESOLUTION - ph->paddleHeight/2.f); //Keep the paddle on the table
+}
+
+/*
+ *void UpdateIntercept(Intercept*, Paddle*, Ball, byte, float)
+ *This function is InterceptKernel with the classic physics
+*/
+void UpdateIntercept(Intercept *ai, Paddle *p, Ball b, byte state, float step) {
+	InterceptKernel(&Profiles[PROFILE_CLASSIC], ai, p, b, state, step);
+}
+
+/*
+ *void AIKernel(const Physics*, Game*, Intercept*, Paddle*)
+ *This function moves an AI paddle of a match one tick, with the
+ *predictive AI if it's on and the one that chases the ball otherwise
+*/
+KERNEL void AIKernel(const Physics *ph, Game *g, Intercept *ai, Paddle *p) {
+	if (ai->on)
+		InterceptKernel(ph, ai, p, g->ball, g->state, g->step);
+	else
+		ChaseKernel(ph, p, g->ball, g->state, g->step);
+}
+
+/*
+ *void TickAI(Game*, Intercept*, Paddle*)
+ *This function moves an AI paddle of a match one tick with the match's
+ *physics, the way TickGame moves player 2 in one player mode
+*/
+void TickAI(Game *g, Intercept *ai, Paddle *p) {
+	if (g->fixed) {
+		FixedBall b = { TO_FIXED(g->ball.x), TO_FIXED(g->ball.y), TO_FIXED(g->ball.vx), TO_FIXED(g->ball.vy) };
+		WITH_PHYSICS(g, ph, FixedAIKernel(ph, g, ai, p, &b));
+	}
+	else
+		WITH_PHYSICS(g, ph, AIKernel(ph, g, ai, p));
+}
+
+/*
+ *void LaunchKernel(const Physics*, Ball*, int)
+ *This function places the ball in the center of the table and sends it
+ *off at the given angle (in degrees) with the ball speed
+*/
+KERNEL void LaunchKernel(const Physics *ph, Ball *b, int degrees) {
+	float theta = degrees * 3.14f / 180.f;
+
+	b->x = RESOLUTION / 2.f;
+	b->y = (RESOLUTION - MARGIN) / 2.f + MARGIN;
+
+	b->vx = (ph->ballSpeed / 100.f) * cos(theta);
+	b->vy = (ph->ballSpeed / 100.f) * sin(theta);
+}
+
+/*
+ *void LaunchBall(Ball*, int)
+ *This function is LaunchKernel with the classic physics
+*/
+void LaunchBall(Ball *b, int degrees) {
+	LaunchKernel(&Profiles[PROFILE_CLASSIC], b, degrees);
+}
+
+/*
+ *int ServeAngle(uint64_t, uint32_t)
+ *This function picks the angle of a serve: towards one side at random
+ *with a random angle between -45 and 45 degrees
+*/
+int ServeAngle(uint64_t seed, uint32_t serve) {
+	uint64_t r = Random(seed, serve);
+
+	return (int)((uint32_t)r % 90) - 45 + 180*(int)((r >> 32) % 2);
+}
+
+/*
+ *void ServeBall(Game*)
+ *This function serves the ball with the next random angle of the match
+*/
+void ServeBall(Game *g) {
+	if (g->fixed)
+		FixedLaunchKernel(&g->physics, &g->ball, ServeAngle(g->seed, g->serves++));
+	else
+		LaunchKernel(&g->physics, &g->ball, ServeAngle(g->seed, g->serves++));
+
+	g->state = STATE_PLAY;
+	g->stateChange = true;
+}
+
+/*
+ *void EnglishKernel(const Physics*, Ball*, Paddle)
+ *This function simulates the application of english (curve)
+ *to the ball based on where the ball strikes the paddle
+*/
+KERNEL void EnglishKernel(const Physics *ph, Ball *b, Paddle p) {
+	float english;
+
+	english = -(p.height - b->y)*ph->englishScale / 100;
+
+	b->vy += english;
+}
+
+/*
+ *void ApplyEnglish(Ball *b, Paddle p)
+ *This function is EnglishKernel with the classic physics
+*/
+void ApplyEnglish(Ball *b, Paddle p) {
+	EnglishKernel(&Profiles[PROFILE_CLASSIC], b, p);
+}
+
+/*
+ *byte MoveBall(Ball*, Paddle, Paddle)
+ *This function moves the ball one normal tick, see MoveBallStep
+*/
+byte MoveBall(Ball *b, Paddle player, Paddle player2) {
+	return MoveBallStep(b, player, player2, 1.f);
+}
+
+/*
+ *byte MoveKernel(const Physics*, Ball*, Paddle, Paddle, float)
+ *This function updates the position of the ball based its velocity
+ *and handles collisions with the sides and paddles. It returns which
+ *player (if any) scored, but does not touch the score itself.
+ *The velocity is per normal tick, the ball moves step times that.
+*/
+KERNEL byte MoveKernel(const Physics *ph, Ball *b, Paddle player, Paddle player2, float step) {
+	b->x += b->vx * step;
+	b->y += b->vy * step;
+
+	//Detect vertical collisions
+	if (b->y < (BALLSIZE + MARGIN)) {
+		b->y += 2*((BALLSIZE + MARGIN) - b->y);
+		b->vy = -b->vy;
+	}
+	else if (b->y > (RESOLUTION - BALLSIZE + 1)) {
+		b->y += 2 * ((RESOLUTION - BALLSIZE + 1) - b->y);
+		b->vy = -b->vy;
+	}
+
+	//Detect paddle collisions and out of bounds conditions (scores)
+	if (b->x < PADDLEWIDTH) {
+		//If the ball hit the paddle
+		if (b->y >= (player.height - ph->paddleHeight / 2.f - BALLSIZE) && b->y <= (player.height + ph->paddleHeight / 2.f + BALLSIZE)) {
+			b->x += 2 * (PADDLEWIDTH - b->x); //Make it bounce
+			b->vx = -b->vx;
+			EnglishKernel(ph, b, player); //Apply english
+		}
+		else //The opposing player scored!
+			return SCORED_PLAYER2;
+	}
+	else if (b->x > (RESOLUTION - PADDLEWIDTH)) {
+		if (b->y >= (player2.height - ph->paddleHeight / 2.f - BALLSIZE) && b->y <= (player2.height + ph->paddleHeight / 2.f + BALLSIZE)) {
+			b->x += 2 * ((RESOLUTION - PADDLEWIDTH) - b->x);
+			b->vx = -b->vx;
+			EnglishKernel(ph, b, player2);
+		}
+		else
+			return SCORED_PLAYER;
+	}
+
+	return SCORED_NONE;
+}
+
+/*
+ *byte MoveBallStep(Ball*, Paddle, Paddle, float)
+ *This function is MoveKernel with the classic physics
+*/
+byte MoveBallStep(Ball *b, Paddle player, Paddle player2, float step) {
+	return MoveKernel(&Profiles[PROFILE_CLASSIC], b, player, player2, step);
+}
+
+/*
+ *byte SweepKernel(const Physics*, Ball*, Paddle, Paddle, float)
+ *This function moves the ball like MoveKernel, but finds the exact moment
+ *it reaches a wall or a paddle's line inside the tick and bounces it right
+ *there, as many times as it takes. The ball can't skip past a paddle or
+ *bounce from the wrong place however fast it goes or however long the tick
+ *is. It returns which player (if any) scored, with the ball on the line.
+*/
+KERNEL byte SweepKernel(const Physics *ph, Ball *b, Paddle player, Paddle player2, float step) {
+	float low = BALLSIZE + MARGIN, high = RESOLUTION - BALLSIZE + 1, wall, side;
+	int bounces;
+
+	for (bounces = 0; bounces < MAXBOUNCES; bounces++) {
+		//Time until the ball reaches a wall and until it reaches a paddle's line
+		wall = b->vy < 0 ? (low - b->y) / b->vy : (b->vy > 0 ? (high - b->y) / b->vy : step);
+		side = b->vx < 0 ? (PADDLEWIDTH - b->x) / b->vx : (b->vx > 0 ? ((RESOLUTION - PADDLEWIDTH) - b->x) / b->vx : step);
+		wall = wall > 0 ? wall : 0;
+		side = side > 0 ? side : 0;
+
+		if (wall >= step && side >= step) //Nothing in the way
+			break;
+
+		if (wall <= side) { //Bounce off a wall
+			b->x += b->vx * wall;
+			b->y = b->vy < 0 ? low : high;
+			b->vy = -b->vy;
+			step -= wall;
+		}
+		else { //Reach a paddle's line
+			Paddle p = b->vx < 0 ? player : player2;
+
+			b->x = b->vx < 0 ? PADDLEWIDTH : RESOLUTION - PADDLEWIDTH;
+			b->y += b->vy * side;
+			step -= side;
+
+			if (b->y < (p.height - ph->paddleHeight / 2.f - BALLSIZE) || b->y > (p.height + ph->paddleHeight / 2.f + BALLSIZE))
+				return b->vx < 0 ? SCORED_PLAYER2 : SCORED_PLAYER;
+
+			b->vx = -b->vx;
+			EnglishKernel(ph, b, p);
+		}
+	}
+
+	b->x += b->vx * step;
+	b->y += b->vy * step;
+
+	return SCORED_NONE;
+}
+
+/*
+ *byte SweepBall(Ball*, Paddle, Paddle, float)
+ *This function is SweepKernel with the classic physics
+*/
+byte SweepBall(Ball *b, Paddle player, Paddle player2, float step) {
+	return SweepKernel(&Profiles[PROFILE_CLASSIC], b, player, player2, step);
+}
+
+/*
+ *void AwardPoint(Game*, byte)
+ *This function updates the score after MoveBall reported a point. Additionally,
+ *it will detect when the game is over and switches the state accordingly.
+*/
+void AwardPoint(Game *g, byte scored) {
+	byte points;
+
+	if (scored == SCORED_NONE)
+		return;
+
+	if (scored == SCORED_PLAYER) {
+		g->score = MAKE_SCORE(PLAYER_SCORE(g->score) + 1, PLAYER2_SCORE(g->score));
+		points = PLAYER_SCORE(g->score);
+	}
+	else {
+		g->score = MAKE_SCORE(PLAYER_SCORE(g->score), PLAYER2_SCORE(g->score) + 1);
+		points = PLAYER2_SCORE(g->score);
+	}
+
+	if (points >= g->physics.maxScore) //If the game is over
+		g->state = STATE_END; //Switch to end of game state
+	else //Otherwise
+		g->state = STATE_READY; //Switch to ready state
+	g->stateChange = true;
+}
+
+/*
+ *void BallKernel(const Physics*, Game*)
+ *This function moves the ball of a match one tick and scores any points
+*/
+KERNEL void BallKernel(const Physics *ph, Game *g) {
+	if (g->swept)
+		AwardPoint(g, SweepKernel(ph, &g->ball, g->player, g->player2, g->step));
+	else
+		AwardPoint(g, MoveKernel(ph, &g->ball, g->player, g->player2, g->step));
+}
+
+/*
+ *void UpdateBall(Game*)
+ *This function moves the ball of a match one tick with its physics and
+ *scores any points
+*/
+void UpdateBall(Game *g) {
+	if (g->fixed) {
+		FixedBall b = { TO_FIXED(g->ball.x), TO_FIXED(g->ball.y), TO_FIXED(g->ball.vx), TO_FIXED(g->ball.vy) };
+		WITH_PHYSICS(g, ph, FixedBallKernel(ph, g, &b));
+	}
+	else
+		WITH_PHYSICS(g, ph, BallKernel(ph, g));
+}
+
+/*
+ *void TickKernel(const Physics*, Game*, int, int)
+ *This function is TickGame for any physics
+*/
+KERNEL void TickKernel(const Physics *ph, Game *g, int playerDir, int player2Dir) {
+	//If we are not on the home screen
+	//We will udpate the player paddles
+	if (g->state != STATE_HOME) {
+		PaddleKernel(ph, &g->player, playerDir, g->step);
+
+		if (g->mode == MODE_TWO)
+			PaddleKernel(ph, &g->player2, player2Dir, g->step);
+	}
+
+	//Update based on state
+	if (g->state == STATE_SERVE) {
+		ServeBall(g);
+		BallKernel(ph, g);
+	}
+	else if (g->state == STATE_PLAY) {
+		BallKernel(ph, g);
+		if (g->mode == MODE_ONE) //Update the AI if it's a single player game
+			AIKernel(ph, g, &g->ai, &g->player2);
+	}
+}
+
+/*
+ *void TickGame(Game*, int, int)
+ *This function runs one game tick. The directions are -1 (up), 0 or 1 (down)
+ *for each paddle. The direction for player 2 is ignored in one player mode.
+*/
+void TickGame(Game *g, int playerDir, int player2Dir) {
+	if (g->fixed) {
+		WITH_PHYSICS(g, ph, FixedTickKernel(ph, g, playerDir, player2Dir));
+	}
+	else
+		WITH_PHYSICS(g, ph, TickKernel(ph, g, playerDir, player2Dir));
+}
+
+/*
+ *void ScoreToStrs(uint16_t, char*, char*)
+ *This function converts the number containing both scores into two
+ *strings representing the scores. The strings will always be two digits
+ *long (e.g. 0 -> '00' and 7 -> '07').
+*/
+void ScoreToStrs(uint16_t score, char *pStr, char *player2Str) {
+	byte pScore = PLAYER_SCORE(score), player2Score = PLAYER2_SCORE(score); //unpack the scores
+
+	pStr[0] = (pScore / 10) + '0';
+	pStr[1] = (pScore % 10) + '0';
+	pStr[2] = '\0';
+
+	player2Str[0] = (player2Score / 10) + '0';
+	player2Str[1] = (player2Score % 10) + '0';
+	player2Str[2] = '\0';
+}
@@ -0,0 +1,175 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ *Game.h
+ *Platform independent game logic for Pong.
+ *Nothing in here knows about windows, timers or drawing. The whole state
+ *of a match lives in a Game struct so that any number of matches can be
+ *stepped side by side (see Env.h).
+*/
+
+
+//Defines for game properties. The first six are the classic physics
+//profile, a match can run with others (see Physics)
+#define BALLSPEED		100
+#define ENGLISHSCALE	20
+#define BALLSIZE		2
+#define	PADDLEHEIGHT	12
+#define PADDLEWIDTH		2
+#define NETWIDTH		2
+#define	MESHSIZE		4
+#define	MAXSCORE		10
+#define	AI_SPEED		1.f
+#define	PLAYER_SPEED	1.5f
+#define RESOLUTION		128
+#define MARGIN			32
+#define TOUCH_WIDTH		0.02f
+#define TICK_RATE		100		//the speeds above are per tick at this many ticks per second
+#define MAXBOUNCES		64		//most collisions SweepBall handles in one tick
+#define MAX_SCORE_LIMIT	99		//the most points a match can go to, scores are shown with two digits
+#define FIXED_MAX_VY	16		//pixels per tick the ball's vy is held to with fixed point physics
+
+//State definitions
+#define STATE_HOME		0
+#define STATE_READY		1
+#define STATE_SERVE		2
+#define STATE_PLAY		3
+#define	STATE_END		4
+
+//Game mode definitions
+#define MODE_ONE		1
+#define	MODE_TWO		2
+
+//Score events returned by MoveBall
+#define SCORED_NONE		0
+#define SCORED_PLAYER	1
+#define SCORED_PLAYER2	2
+
+//AI skills, see InitIntercept
+#define SKILL_CHASE		0	//the original AI that follows the ball
+#define SKILL_EASY		1
+#define SKILL_NORMAL	2
+#define SKILL_HARD		3
+
+//Physics profiles
+#define PROFILE_CLASSIC	0		//the defines above
+#define PROFILE_FAST	1		//a ball half as fast again
+#define PROFILE_LONG	2		//first to 21
+#define PROFILE_COUNT	3
+#define PROFILE_CUSTOM	0xFF	//any other physics
+
+//Macros
+#define PLAYER_SCORE(s)		((s) >> 8)
+#define	PLAYER2_SCORE(s)	((s) & 0xFF)
+#define MAKE_SCORE(p, a)	((uint16_t)(((p) << 8) | (a)))
+#define CLAMP(n, a, b)		((n) < (a) ? (a) : ((n) > (b) ? (b) : (n)))
+#define TO_FIXED(f)			((Fixed)((f) * (float)FIXED_ONE))
+#define FROM_FIXED(v)		((float)(v) / FIXED_ONE)
+
+//Typedef for a byte
+typedef unsigned char byte;
+
+//Ball struct
+typedef struct Ball {
+	float x, y, vx, vy;
+} Ball;
+
+//Fixed point physics (see SetFixed) work on Q16.16 numbers. Everything on
+//the table stays below 256 pixels, so a float holds any of them exactly
+//and the match keeps them in its floats.
+typedef int32_t Fixed;
+#define FIXED_ONE		65536
+
+typedef struct FixedBall {
+	Fixed x, y, vx, vy;
+} FixedBall;
+
+//What can be changed about the physics without rebuilding. A match with
+//one of the known profiles runs code made for it with the values as
+//constants, with any other values it runs the same code reading them.
+typedef struct Physics {
+	byte profile;			//PROFILE_*, worked out by SetPhysics
+	short ballSpeed;		//BALLSPEED
+	short englishScale;		//ENGLISHSCALE
+	short paddleHeight;		//PADDLEHEIGHT
+	float aiSpeed;			//AI_SPEED
+	float playerSpeed;		//PLAYER_SPEED
+	byte maxScore;			//MAXSCORE
+} Physics;
+
+//Paddle struct
+typedef struct Paddle {
+	float height;
+} Paddle;
+
+//The predictive AI. It works out where the ball will cross its paddle's
+//line once per paddle hit or serve and then just heads there.
+typedef struct Intercept {
+	bool on;			//false keeps the original AI that chases the ball
+	bool left;			//plays the left paddle instead of the right one
+	bool swept;			//the ball is moved by SweepBall
+	uint16_t delay;		//normal ticks it takes to react to a new trajectory
+	float error;		//largest aim error in pixels
+	uint64_t seed;		//for the aim errors
+	uint32_t solves;	//trajectories worked out so far
+	uint16_t wait;		//ticks left before it reacts
+	float vx, vy;		//the ball velocity the plan was made for
+	float target, next;	//where it is heading now and where it will after waiting
+} Intercept;
+
+//Everything needed to play one match
+//Serves are drawn from Random(seed, serves), so a match replays exactly
+//from its seed no matter where or on which thread it runs
+typedef struct Game {
+	Paddle player, player2;
+	Ball ball;
+	byte state, mode;
+	uint16_t score;		//both players', see MAKE_SCORE
+	bool stateChange;
+	uint64_t seed;
+	uint32_t serves;
+	float step;			//TICK_RATE / ticks per second, 1 at the normal rate
+	bool swept;			//move the ball with SweepBall instead of MoveBall
+	bool fixed;			//run the physics in fixed point, see SetFixed
+	Intercept ai;		//the AI for player 2 in one player mode
+	Physics physics;
+} Game;
+
+//The known profiles, by PROFILE_*
+extern const Physics Profiles[PROFILE_COUNT];
+
+//Game functions
+uint64_t Random(uint64_t key, uint64_t counter);
+uint64_t MatchSeed(uint64_t seed, uint64_t match);
+void InitGame(Game *g, uint64_t seed);
+void SetTickRate(Game *g, unsigned int hz);
+void SetSwept(Game *g, bool swept);
+void SetFixed(Game *g, bool fixed);
+byte FindProfile(const Physics *ph);
+void SetPhysics(Game *g, const Physics *ph);
+void AdvanceState(Game *g);
+void TickGame(Game *g, int playerDir, int player2Dir);
+void MovePaddle(Paddle *p, int dir, float step);
+void UpdateAI(Paddle *AI, Ball b, byte state);
+void UpdateAIStep(Paddle *AI, Ball b, byte state, float step);
+void InitIntercept(Intercept *ai, bool left, byte skill, uint64_t seed);
+float InterceptY(Ball b, float x, float step);
+void UpdateIntercept(Intercept *ai, Paddle *p, Ball b, byte state, float step);
+void TickAI(Game *g, Intercept *ai, Paddle *p);
+void LaunchBall(Ball *b, int degrees);
+int ServeAngle(uint64_t seed, uint32_t serve);
+void ServeBall(Game *g);
+void ApplyEnglish(Ball *b, Paddle p);
+byte MoveBall(Ball *b, Paddle player, Paddle player2);
+byte MoveBallStep(Ball *b, Paddle player, Paddle player2, float step);
+byte SweepBall(Ball *b, Paddle player, Paddle player2, float step);
+byte MoveFixedBall(FixedBall *b, Fixed player, Fixed player2);
+void AwardPoint(Game *g, byte scored);
+void UpdateBall(Game *g);
+void ScoreToStrs(uint16_t score, char *pStr, char *player2Str);
+
+#endif
@@ -0,0 +1,59 @@
+#include "Glyphs.h"
+
+/*
+ *Glyphs.c
+ *The font itself. It is indexed by character starting at the space,
+ *characters not listed are left all zero (blank).
+*/
+
+#define FIRST_GLYPH		' '
+#define GLYPH_COUNT		96
+
+static const byte glyphs[GLYPH_COUNT][GLYPH_HEIGHT] = {
+	['!' - FIRST_GLYPH] = { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04, 0x00 },
+	['/' - FIRST_GLYPH] = { 0x01, 0x01, 0x02, 0x04, 0x08, 0x10, 0x10, 0x00 },
+	['0' - FIRST_GLYPH] = { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E, 0x00 },
+	['1' - FIRST_GLYPH] = { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00 },
+	['2' - FIRST_GLYPH] = { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F, 0x00 },
+	['3' - FIRST_GLYPH] = { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E, 0x00 },
+	['4' - FIRST_GLYPH] = { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02, 0x00 },
+	['5' - FIRST_GLYPH] = { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E, 0x00 },
+	['6' - FIRST_GLYPH] = { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E, 0x00 },
+	['7' - FIRST_GLYPH] = { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08, 0x00 },
+	['8' - FIRST_GLYPH] = { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E, 0x00 },
+	['9' - FIRST_GLYPH] = { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C, 0x00 },
+	['>' - FIRST_GLYPH] = { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08, 0x00 },
+	['C' - FIRST_GLYPH] = { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E, 0x00 },
+	['O' - FIRST_GLYPH] = { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00 },
+	['P' - FIRST_GLYPH] = { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10, 0x00 },
+	['T' - FIRST_GLYPH] = { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00 },
+	['W' - FIRST_GLYPH] = { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A, 0x00 },
+	['Y' - FIRST_GLYPH] = { 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04, 0x00 },
+	['a' - FIRST_GLYPH] = { 0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00 },
+	['d' - FIRST_GLYPH] = { 0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F, 0x00 },
+	['e' - FIRST_GLYPH] = { 0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 },
+	['g' - FIRST_GLYPH] = { 0x00, 0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E },
+	['i' - FIRST_GLYPH] = { 0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E, 0x00 },
+	['l' - FIRST_GLYPH] = { 0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00 },
+	['n' - FIRST_GLYPH] = { 0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00 },
+	['o' - FIRST_GLYPH] = { 0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00 },
+	['p' - FIRST_GLYPH] = { 0x00, 0x00, 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10 },
+	['r' - FIRST_GLYPH] = { 0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10, 0x00 },
+	['s' - FIRST_GLYPH] = { 0x00, 0x00, 0x0F, 0x10, 0x0E, 0x01, 0x1E, 0x00 },
+	['t' - FIRST_GLYPH] = { 0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06, 0x00 },
+	['u' - FIRST_GLYPH] = { 0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00 },
+	['w' - FIRST_GLYPH] = { 0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A, 0x00 },
+	['y' - FIRST_GLYPH] = { 0x00, 0x00, 0x11, 0x11, 0x11, 0x0F, 0x01, 0x0E },
+};
+
+
+/*
+ *const byte *Glyph(char)
+ *This function returns the rows of a character's picture
+*/
+const byte *Glyph(char c) {
+	if ((unsigned char)c < FIRST_GLYPH || (unsigned char)c >= FIRST_GLYPH + GLYPH_COUNT)
+		c = ' ';
+
+	return glyphs[c - FIRST_GLYPH];
+}
@@ -0,0 +1,23 @@
+#ifndef GLYPHS_H
+#define GLYPHS_H
+
+#include "Game.h"
+
+/*
+ *Glyphs.h
+ *A tiny bitmap font for the text on the table. Only the characters the
+ *game actually writes have a picture, every other one is blank.
+ *
+ *Each glyph is GLYPH_HEIGHT rows of GLYPH_WIDTH bits, the leftmost pixel
+ *in the highest bit. The last row is only used by descenders (g, p, y).
+*/
+
+
+#define GLYPH_WIDTH		5
+#define GLYPH_HEIGHT	8
+#define GLYPH_ADVANCE	6	//one blank column between characters
+
+//Glyph functions
+const byte *Glyph(char c);
+
+#endif
@@ -0,0 +1,94 @@
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+#include <string.h>
+#include "Handoff.h"
+
+/*
+ *Handoff.c
+ *The triple buffer between the updates and the drawing, see Handoff.h
+*/
+
+
+/*
+ *long Exchange(volatile long*, long)
+ *This function swaps a number shared between threads for another and
+ *returns the one it was. Everything written before is seen by whoever
+ *exchanges it next.
+*/
+static long Exchange(volatile long *n, long v) {
+#ifdef _MSC_VER
+	return InterlockedExchange(n, v);
+#else
+	return __atomic_exchange_n(n, v, __ATOMIC_ACQ_REL);
+#endif
+}
+
+/*
+ *void InitHandoff(Handoff*, const Game*)
+ *This function starts a handoff with every snapshot on the match g, so
+ *there is something to draw before the first one is published
+*/
+void InitHandoff(Handoff *h, const Game *g) {
+	byte i;
+
+	memset(h, 0, sizeof(Handoff));
+	for (i = 0; i < 3; i++) {
+		h->slots[i].previous = *g;
+		h->slots[i].current = *g;
+		h->slots[i].changed = true;
+	}
+	h->front = 0;
+	h->middle = 1;
+	h->back = 2;
+}
+
+/*
+ *Snapshot *WriteSnapshot(Handoff*)
+ *This function returns the snapshot the updating thread fills next
+*/
+Snapshot *WriteSnapshot(Handoff *h) {
+	return &h->slots[h->back];
+}
+
+/*
+ *void PublishSnapshot(Handoff*)
+ *This function makes the filled snapshot the newest one and takes back
+ *the one it replaces to fill next
+*/
+void PublishSnapshot(Handoff *h) {
+	long old;
+
+	h->slots[h->back].seq = ++h->published;
+	old = Exchange(&h->middle, h->back | HANDOFF_FRESH);
+	h->skipped += (old & HANDOFF_FRESH) != 0;
+	h->back = (byte)(old & 3);
+}
+
+/*
+ *const Snapshot *TakeSnapshot(Handoff*, bool*)
+ *This function returns the newest snapshot for the drawing thread, and
+ *whether it is newer than the one it took last. It stays the same until
+ *the next call.
+*/
+const Snapshot *TakeSnapshot(Handoff *h, bool *fresh) {
+	*fresh = (h->middle & HANDOFF_FRESH) != 0;
+	if (*fresh)
+		h->front = (byte)(Exchange(&h->middle, h->front) & 3);
+
+	return &h->slots[h->front];
+}
+
+/*
+ *float SnapshotAlpha(const Snapshot*, uint64_t)
+ *This function returns how far (0 to 1) the clock now is from the
+ *snapshot's tick to the next one, to draw it in between
+*/
+float SnapshotAlpha(const Snapshot *s, uint64_t now) {
+	if (now <= s->due)
+		return 0;
+	if (now - s->due >= s->tick)
+		return 1;
+
+	return (float)(now - s->due) / s->tick;
+}
@@ -0,0 +1,47 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include "Game.h"
+
+/*
+ *Handoff.h
+ *Passes the match from the thread that updates it to the thread that
+ *draws it. The updating thread fills a Snapshot after its ticks and
+ *publishes it, the drawing thread takes the newest one published when it
+ *draws a frame. Neither ever waits for the other.
+ *
+ *It is a triple buffer: one snapshot is being written, one is being
+ *drawn and the third is the newest published one. Publishing and taking
+ *each swap their own snapshot with the middle one in one atomic exchange,
+ *so a snapshot is never written while it is drawn. When the drawing is
+ *slower the snapshots it didn't get to are simply skipped.
+*/
+
+
+//The match as of a tick
+typedef struct Snapshot {
+	Game previous, current;		//the last two ticks, to draw in between
+	uint64_t due;				//the clock when the current tick was due
+	uint64_t tick;				//the length of a tick in nanoseconds
+	uint64_t inputAt;			//when the earliest input not drawn yet came in, 0 if none
+	uint32_t seq;				//published snapshots before this one + 1
+	bool changed;				//something that isn't drawn every frame changed
+} Snapshot;
+
+typedef struct Handoff {
+	Snapshot slots[3];
+	volatile long middle;		//the newest published slot, HANDOFF_FRESH until it is taken
+	byte back, front;			//the writer's slot, the reader's slot
+	uint32_t published, skipped;	//the writer's totals
+} Handoff;
+
+#define HANDOFF_FRESH	4
+
+//Handoff functions
+void InitHandoff(Handoff *h, const Game *g);
+Snapshot *WriteSnapshot(Handoff *h);
+void PublishSnapshot(Handoff *h);
+const Snapshot *TakeSnapshot(Handoff *h, bool *fresh);
+float SnapshotAlpha(const Snapshot *s, uint64_t now);
+
+#endif
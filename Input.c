@@ -0,0 +1,217 @@
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "Input.h"
+
+/*
+ *Input.c
+ *The input queue, the keys and scripts of made up input, see Input.h
+*/
+
+
+/*
+ *void Publish()
+ *This function keeps the loads and stores before it from being seen after
+ *the stores that follow it
+*/
+static void Publish(void) {
+#ifdef _MSC_VER
+	_ReadWriteBarrier();
+#else
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+/*
+ *void Acquire()
+ *This function keeps the loads after it from being done before the ones
+ *that came before it
+*/
+static void Acquire(void) {
+#ifdef _MSC_VER
+	_ReadWriteBarrier();
+#else
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+/*
+ *void InitInputQueue(InputQueue*)
+ *This function empties a queue
+*/
+void InitInputQueue(InputQueue *q) {
+	memset(q, 0, sizeof(InputQueue));
+}
+
+/*
+ *bool PushInput(InputQueue*, const InputEvent*)
+ *This function adds an event, only ever from the writing thread. It
+ *returns false and counts the event as dropped when the queue is full.
+*/
+bool PushInput(InputQueue *q, const InputEvent *e) {
+	uint32_t head = q->head;
+
+	if (head - q->tail >= INPUT_EVENTS) {
+		q->dropped++;
+		return false;
+	}
+
+	q->events[head & (INPUT_EVENTS - 1)] = *e;
+	Publish();
+	q->head = head + 1;
+
+	return true;
+}
+
+/*
+ *bool PushInputs(InputQueue*, const InputEvent*, unsigned int)
+ *This function adds count events at once, only ever from the writing
+ *thread: the reader sees all of them or none. It returns false and
+ *counts them all as dropped when they don't all fit.
+*/
+bool PushInputs(InputQueue *q, const InputEvent *events, unsigned int count) {
+	uint32_t head = q->head, i;
+
+	if (count > INPUT_EVENTS || head - q->tail > INPUT_EVENTS - count) {
+		q->dropped += count;
+		return false;
+	}
+
+	for (i = 0; i < count; i++)
+		q->events[(head + i) & (INPUT_EVENTS - 1)] = events[i];
+	Publish();
+	q->head = head + count;
+
+	return true;
+}
+
+/*
+ *bool TakeInput(InputQueue*, uint64_t, InputEvent*)
+ *This function takes the next event if it came in before the given
+ *time, only ever from the reading thread
+*/
+bool TakeInput(InputQueue *q, uint64_t before, InputEvent *e) {
+	uint32_t tail = q->tail;
+
+	if (tail == q->head)
+		return false;
+	Acquire();
+	if (q->events[tail & (INPUT_EVENTS - 1)].at >= before)
+		return false;
+
+	*e = q->events[tail & (INPUT_EVENTS - 1)];
+	Publish();
+	q->tail = tail + 1;
+
+	return true;
+}
+
+/*
+ *unsigned int PushDueInput(InputQueue*, const InputEvent*, unsigned int, unsigned int, uint64_t)
+ *This function plays a script back in real time: it pushes the events
+ *from next on that are due by now and returns the next one to push
+*/
+unsigned int PushDueInput(InputQueue *q, const InputEvent *events, unsigned int count, unsigned int next, uint64_t now) {
+	for (; next < count && events[next].at <= now; next++)
+		PushInput(q, &events[next]);
+
+	return next;
+}
+
+/*
+ *void TrackButtons(Buttons*, const InputEvent*)
+ *This function follows the keys through an event, and notes when it came
+ *in if nothing since the last frame drawn did
+*/
+void TrackButtons(Buttons *b, const InputEvent *e) {
+	byte bit = (byte)(1 << e->button);
+
+	if (b->changed == 0)
+		b->changed = e->at;
+
+	if (e->type == IN_PRESS) {
+		b->pressed |= b->held & bit ? 0 : bit;	//not the key repeating
+		b->held |= bit;
+	}
+	else if (e->type == IN_RELEASE)
+		b->held &= ~bit;
+	else if (e->type == IN_RESET)
+		b->held = 0;
+}
+
+/*
+ *bool ButtonDown(const Buttons*, byte)
+ *This function returns whether a key counts as down for this tick: it is
+ *held, or it was pressed since the last tick
+*/
+bool ButtonDown(const Buttons *b, byte button) {
+	return ((b->held | b->pressed) >> button) & 1;
+}
+
+/*
+ *int ButtonDir(const Buttons*, byte, byte)
+ *This function returns where a pair of keys moves a paddle for this tick,
+ *-1 up, 1 down or 0
+*/
+int ButtonDir(const Buttons *b, byte up, byte down) {
+	return ButtonDown(b, down) - ButtonDown(b, up);
+}
+
+/*
+ *void EndTick(Buttons*)
+ *This function forgets the presses the last tick has seen
+*/
+void EndTick(Buttons *b) {
+	b->pressed = 0;
+}
+
+/*
+ *int CompareEvents(const void*, const void*)
+ *This function orders events by time for qsort
+*/
+static int CompareEvents(const void *a, const void *b) {
+	const InputEvent *x = a, *y = b;
+
+	return (x->at > y->at) - (x->at < y->at);
+}
+
+/*
+ *unsigned int MakeInputScript(InputEvent*, unsigned int, uint64_t, uint64_t, uint64_t)
+ *This function makes up length nanoseconds of both players pressing
+ *their keys from start on: holds of up to half a second and taps, many of
+ *them shorter than a tick. Each player's presses follow one another and
+ *the two players overlap. It returns how many events were made.
+*/
+unsigned int MakeInputScript(InputEvent *events, unsigned int max, uint64_t seed, uint64_t start, uint64_t length) {
+	unsigned int count = 0, n = 0;
+	byte side;
+
+	for (side = 0; side < 2; side++) {
+		uint64_t at = start + Random(seed, side) % 50000000;
+
+		while (at < start + length && count + 2 <= max) {
+			uint64_t r = Random(seed + side + 1, n++), held;
+			InputEvent e;
+
+			//A third are taps of 1 to 12 ms, the rest holds of up to 500 ms
+			held = r % 3 == 0 ? 1000000 + (r >> 8) % 11000000 : 20000000 + (r >> 8) % 480000000;
+
+			memset(&e, 0, sizeof(e));
+			e.button = (byte)(side * 2 + (r >> 40) % 2);
+			e.type = IN_PRESS;
+			e.at = at;
+			events[count++] = e;
+			e.type = IN_RELEASE;
+			e.at = at + held;
+			events[count++] = e;
+
+			at += held + 5000000 + (r >> 32) % 200000000;
+		}
+	}
+
+	qsort(events, count, sizeof(InputEvent), CompareEvents);
+
+	return count;
+}
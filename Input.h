@@ -0,0 +1,82 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "Game.h"
+
+/*
+ *Input.h
+ *Keys and touches as timestamped events. Whatever receives them (the
+ *window procedure in the game, a script in the benchmarks) pushes each one
+ *into an InputQueue the moment it comes in, stamped with the monotonic
+ *clock (see Loop.h). The match takes them out at the start of each tick,
+ *only those that came in before the tick was due, so a late batch of
+ *ticks still sees every key on the tick it belongs to.
+ *
+ *The queue is a ring with one writer and one reader that never lock or
+ *wait for each other: each side only moves its own index, after the event
+ *it covers is written or read. PushInputs moves it once for a whole batch,
+ *so the reader never takes part of one.
+ *
+ *The keys are tracked in Buttons. A key pressed and let go between two
+ *ticks still moves its paddle for one tick, where sampling the keyboard
+ *at each tick would have missed it.
+*/
+
+
+#define INPUT_EVENTS		256		//events, a power of two
+
+//Events
+#define IN_PRESS		0		//a key went down
+#define IN_RELEASE		1		//a key went up
+#define IN_TOUCH		2		//a finger is at (x, y) on the screen
+#define IN_RESET		3		//every key is up (the window lost the keyboard)
+
+//Keys the match reads
+#define BUTTON_W		0
+#define BUTTON_S		1
+#define BUTTON_O		2
+#define BUTTON_L		3
+#define BUTTON_UP		4
+#define BUTTON_DOWN		5
+#define BUTTON_SPACE	6
+#define BUTTON_COUNT	7
+
+typedef struct InputEvent {
+	uint64_t at;				//nanoseconds on the monotonic clock
+	byte type, button;
+	short x, y;					//IN_TOUCH, in pixels
+} InputEvent;
+
+typedef struct InputQueue {
+	volatile uint32_t head;		//events pushed, only the writer moves it
+	uint32_t unused[15];		//keeps the indexes on lines of their own
+	volatile uint32_t tail;		//events taken, only the reader moves it
+	uint32_t unused2[15];
+	uint64_t dropped;			//pushed while it was full, the writer's
+	InputEvent events[INPUT_EVENTS];
+} InputQueue;
+
+//What the keys have done
+typedef struct Buttons {
+	byte held;					//a bit per key that is down
+	byte pressed;				//a bit per key that went down since the last tick
+	uint64_t changed;			//when the earliest event not drawn yet came in, 0 if none
+} Buttons;
+
+//Queue functions
+void InitInputQueue(InputQueue *q);
+bool PushInput(InputQueue *q, const InputEvent *e);
+bool PushInputs(InputQueue *q, const InputEvent *events, unsigned int count);
+bool TakeInput(InputQueue *q, uint64_t before, InputEvent *e);
+unsigned int PushDueInput(InputQueue *q, const InputEvent *events, unsigned int count, unsigned int next, uint64_t now);
+
+//Button functions
+void TrackButtons(Buttons *b, const InputEvent *e);
+bool ButtonDown(const Buttons *b, byte button);
+int ButtonDir(const Buttons *b, byte up, byte down);
+void EndTick(Buttons *b);
+
+//Synthetic input
+unsigned int MakeInputScript(InputEvent *events, unsigned int max, uint64_t seed, uint64_t start, uint64_t length);
+
+#endif
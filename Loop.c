@@ -0,0 +1,130 @@
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+#include "Loop.h"
+
+/*
+ *Loop.c
+ *The fixed timestep scheduler and the monotonic clock it normally runs on
+*/
+
+
+/*
+ *uint64_t MonotonicNow(void*)
+ *This function reads the system's monotonic clock in nanoseconds
+*/
+uint64_t MonotonicNow(void *ctx) {
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER count;
+	uint64_t c, f;
+
+	(void)ctx;
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&count);
+	c = count.QuadPart;
+	f = frequency.QuadPart;
+
+	//Split up so that the multiplication can't overflow
+	return c / f * NS_PER_SECOND + c % f * NS_PER_SECOND / f;
+#else
+	struct timespec t;
+
+	(void)ctx;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return (uint64_t)t.tv_sec * NS_PER_SECOND + t.tv_nsec;
+#endif
+}
+
+const Clock MonotonicClock = { MonotonicNow, NULL };
+
+/*
+ *void InitTimestep(Timestep*, unsigned int, unsigned int, Clock)
+ *This function starts a scheduler for hz ticks per second that never pays
+ *out more than maxTicks at once. Time starts counting now.
+*/
+void InitTimestep(Timestep *t, unsigned int hz, unsigned int maxTicks, Clock clock) {
+	t->clock = clock;
+	t->tick = NS_PER_SECOND / hz;
+	t->last = clock.Now(clock.ctx);
+	t->accumulator = 0;
+	t->maxTicks = maxTicks;
+	t->ticks = 0;
+	t->dropped = 0;
+}
+
+/*
+ *unsigned int AdvanceTimestep(Timestep*)
+ *This function collects the time since the last call and returns how many
+ *ticks are due. If more than maxTicks are due (the window was dragged, the
+ *machine slept...) the extra ones are dropped instead of being caught up,
+ *so the game pauses rather than fast forwarding.
+*/
+unsigned int AdvanceTimestep(Timestep *t) {
+	uint64_t now = t->clock.Now(t->clock.ctx), due;
+
+	t->accumulator += now - t->last;
+	t->last = now;
+
+	due = t->accumulator / t->tick;
+	if (due > t->maxTicks) {
+		t->dropped += due - t->maxTicks;
+		due = t->maxTicks;
+		t->accumulator = due * t->tick + t->accumulator % t->tick; //keep what's left over within this tick
+	}
+	t->accumulator -= due * t->tick;
+	t->ticks += due;
+
+	return (unsigned int)due;
+}
+
+/*
+ *uint64_t TickDue(const Timestep*, unsigned int)
+ *This function returns the clock when a tick paid out by the last
+ *AdvanceTimestep was due, left being how many of them are still to run
+ *counting this one
+*/
+uint64_t TickDue(const Timestep *t, unsigned int left) {
+	return t->last - t->accumulator - (left - 1) * t->tick;
+}
+
+/*
+ *uint64_t NextTickIn(const Timestep*)
+ *This function returns the nanoseconds until the next tick is due,
+ *counted from the last AdvanceTimestep
+*/
+uint64_t NextTickIn(const Timestep *t) {
+	return t->accumulator < t->tick ? t->tick - t->accumulator : 0;
+}
+
+/*
+ *float TickAlpha(const Timestep*)
+ *This function returns how far (0 to 1) the time is between the last tick
+ *and the next one
+*/
+float TickAlpha(const Timestep *t) {
+	return (float)t->accumulator / t->tick;
+}
+
+/*
+ *void BlendGame(const Game*, const Game*, float, Game*)
+ *This function makes the match to draw alpha of the way from the previous
+ *tick to the current one. The ball and paddles are only blended while
+ *nothing jumped in between (a serve or a state change), otherwise the
+ *current tick is shown as it is.
+*/
+void BlendGame(const Game *previous, const Game *current, float alpha, Game *shown) {
+	*shown = *current;
+
+	if (previous->state != current->state || previous->serves != current->serves)
+		return;
+
+	shown->ball.x = previous->ball.x + (current->ball.x - previous->ball.x) * alpha;
+	shown->ball.y = previous->ball.y + (current->ball.y - previous->ball.y) * alpha;
+	shown->player.height = previous->player.height + (current->player.height - previous->player.height) * alpha;
+	shown->player2.height = previous->player2.height + (current->player2.height - previous->player2.height) * alpha;
+}
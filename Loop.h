@@ -0,0 +1,48 @@
+#ifndef LOOP_H
+#define LOOP_H
+
+#include "Game.h"
+
+/*
+ *Loop.h
+ *A fixed timestep scheduler. Time from a monotonic clock is collected in
+ *an accumulator and paid out as whole ticks, so the game runs the same
+ *number of ticks per second however late or early the caller wakes up.
+ *What is left over tells the renderer how far it is into the next tick,
+ *which it uses to draw the ball and paddles in between two ticks.
+ *
+ *The clock is a function pointer so that anything can drive it: the real
+ *monotonic clock in the game, a made up one in benchmarks.
+*/
+
+
+#define NS_PER_SECOND	1000000000ull
+
+//A monotonic clock in nanoseconds
+typedef struct Clock {
+	uint64_t (*Now)(void *ctx);
+	void *ctx;
+} Clock;
+
+typedef struct Timestep {
+	Clock clock;
+	uint64_t tick;			//length of a tick in nanoseconds
+	uint64_t last;			//the clock when time was last collected
+	uint64_t accumulator;	//time not yet paid out as ticks
+	unsigned int maxTicks;	//most ticks paid out at once, the rest is dropped
+	uint64_t ticks, dropped;	//totals
+} Timestep;
+
+//Clocks
+uint64_t MonotonicNow(void *ctx);
+extern const Clock MonotonicClock;
+
+//Timestep functions
+void InitTimestep(Timestep *t, unsigned int hz, unsigned int maxTicks, Clock clock);
+unsigned int AdvanceTimestep(Timestep *t);
+uint64_t TickDue(const Timestep *t, unsigned int left);
+uint64_t NextTickIn(const Timestep *t);
+float TickAlpha(const Timestep *t);
+void BlendGame(const Game *previous, const Game *current, float alpha, Game *shown);
+
+#endif
@@ -0,0 +1,247 @@
+#define _GNU_SOURCE
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "Measure.h"
+
+/*
+ *Measure.c
+ *The benchmark harness, see Measure.h. The JSON it reads back is only the
+ *JSON it writes, so the baseline is searched rather than fully parsed.
+*/
+
+
+const char *const CounterNames[MEASURE_COUNTERS] = { "cycles", "instructions", "branch_misses", "cache_misses" };
+
+/*
+ *double Seconds()
+ *This function reads the monotonic clock in seconds
+*/
+static double Seconds(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*
+ *void OpenCounters(Suite*)
+ *This function opens the hardware counters as one group counting this
+ *thread in user space. Without all of them there are none.
+*/
+static void OpenCounters(Suite *s) {
+	const uint64_t configs[MEASURE_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+	};
+	struct perf_event_attr attr;
+	unsigned int i;
+
+	s->counting = true;
+	for (i = 0; i < MEASURE_COUNTERS; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = configs[i];
+		attr.disabled = i == 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+
+		s->counters[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : s->counters[0], 0);
+		if (s->counters[i] < 0)
+			s->counting = false;
+	}
+}
+
+/*
+ *void InitSuite(Suite*)
+ *This function starts an empty suite
+*/
+void InitSuite(Suite *s) {
+	memset(s, 0, sizeof(Suite));
+	OpenCounters(s);
+}
+
+/*
+ *int CompareNs(const void*, const void*)
+ *This function orders samples for qsort
+*/
+static int CompareNs(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ *double Percentile(const double*, unsigned int, double)
+ *This function returns the sample at p (0 to 1) of sorted samples,
+ *between the two closest ones
+*/
+static double Percentile(const double *sorted, unsigned int count, double p) {
+	double at = p * (count - 1);
+	unsigned int i = (unsigned int)at;
+
+	return i + 1 < count ? sorted[i] + (sorted[i + 1] - sorted[i]) * (at - i) : sorted[count - 1];
+}
+
+/*
+ *const Result *Measure(Suite*, const char*, MeasureBody, void*)
+ *This function times a benchmark and adds it to the suite. It returns the
+ *result, or NULL without memory.
+*/
+const Result *Measure(Suite *s, const char *name, MeasureBody body, void *ctx) {
+	double samples[MEASURE_SAMPLES], start, elapsed, total = 0;
+	uint64_t ops = 1, counts[1 + MEASURE_COUNTERS], sum[MEASURE_COUNTERS] = { 0 };
+	unsigned int i, k;
+	Result *r;
+
+	if (s->count == s->capacity) {
+		unsigned int capacity = s->capacity ? s->capacity * 2 : 32;
+		Result *results = realloc(s->results, sizeof(Result) * capacity);
+
+		if (results == NULL)
+			return NULL;
+		s->results = results;
+		s->capacity = capacity;
+	}
+	r = &s->results[s->count++];
+	memset(r, 0, sizeof(Result));
+	strncpy(r->name, name, MEASURE_NAME - 1);
+
+	//Enough operations to fill a sample, which also warms up
+	for (;;) {
+		start = Seconds();
+		body(ctx, ops);
+		elapsed = Seconds() - start;
+		if (elapsed >= MEASURE_SAMPLE_TIME / 4)
+			break;
+		ops *= 2;
+	}
+	ops = (uint64_t)(ops * MEASURE_SAMPLE_TIME / elapsed) + 1;
+
+	for (i = 0; i < MEASURE_SAMPLES; i++) {
+		if (s->counting) {
+			ioctl(s->counters[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(s->counters[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+		start = Seconds();
+		body(ctx, ops);
+		elapsed = Seconds() - start;
+		if (s->counting) {
+			ioctl(s->counters[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+			if (read(s->counters[0], counts, sizeof(counts)) == sizeof(counts))
+				for (k = 0; k < MEASURE_COUNTERS; k++)
+					sum[k] += counts[1 + k];
+		}
+
+		samples[i] = elapsed * 1e9 / ops;
+		total += elapsed;
+	}
+
+	qsort(samples, MEASURE_SAMPLES, sizeof(double), CompareNs);
+	r->ops = ops * MEASURE_SAMPLES;
+	r->mean = total * 1e9 / r->ops;
+	r->min = samples[0];
+	r->p50 = Percentile(samples, MEASURE_SAMPLES, 0.5);
+	r->p90 = Percentile(samples, MEASURE_SAMPLES, 0.9);
+	r->p99 = Percentile(samples, MEASURE_SAMPLES, 0.99);
+	r->max = samples[MEASURE_SAMPLES - 1];
+	r->counted = s->counting;
+	for (k = 0; k < MEASURE_COUNTERS; k++)
+		r->counters[k] = (double)sum[k] / r->ops;
+
+	return r;
+}
+
+/*
+ *void WriteSuite(const Suite*, FILE*)
+ *This function writes every result as JSON
+*/
+void WriteSuite(const Suite *s, FILE *file) {
+	unsigned int i, k;
+
+	fprintf(file, "{\n\t\"suite\": \"pong\",\n\t\"unit\": \"ns/op\",\n\t\"samples\": %u,\n\t\"counters\": %s,\n\t\"results\": [\n",
+		MEASURE_SAMPLES, s->counting ? "true" : "false");
+	for (i = 0; i < s->count; i++) {
+		const Result *r = &s->results[i];
+
+		fprintf(file, "\t\t{\"name\": \"%s\", \"ops\": %llu, \"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f",
+			r->name, (unsigned long long)r->ops, r->mean, r->min, r->p50, r->p90, r->p99, r->max);
+		if (r->counted) {
+			for (k = 0; k < MEASURE_COUNTERS; k++)
+				fprintf(file, ", \"%s\": %.3f", CounterNames[k], r->counters[k]);
+			fprintf(file, ", \"ipc\": %.3f", r->counters[0] > 0 ? r->counters[1] / r->counters[0] : 0);
+		}
+		fprintf(file, "}%s\n", i + 1 < s->count ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+}
+
+/*
+ *bool BaselineMedian(const char*, const char*, double*)
+ *This function finds the median of a result in the text of a suite
+*/
+static bool BaselineMedian(const char *baseline, const char *name, double *p50) {
+	char key[MEASURE_NAME + 16];
+	const char *at, *next;
+
+	snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+	at = strstr(baseline, key);
+	if (at == NULL)
+		return false;
+
+	next = strstr(at + 1, "\"name\"");
+	at = strstr(at, "\"p50\":");
+	if (at == NULL || (next != NULL && at > next))
+		return false;
+	*p50 = strtod(at + 6, NULL);
+
+	return *p50 > 0;
+}
+
+/*
+ *int CompareSuite(const Suite*, const char*, double, FILE*)
+ *This function compares the results with the baseline (the text of a
+ *suite written before) and reports every one. It returns how many are
+ *slower by more than tolerance (0.1 for 10%).
+*/
+int CompareSuite(const Suite *s, const char *baseline, double tolerance, FILE *report) {
+	unsigned int i;
+	int slower = 0;
+
+	for (i = 0; i < s->count; i++) {
+		const Result *r = &s->results[i];
+		double before, change;
+
+		if (!BaselineMedian(baseline, r->name, &before)) {
+			fprintf(report, "%-28s %12s %12.2f  new\n", r->name, "", r->p50);
+			continue;
+		}
+
+		change = r->p50 / before - 1;
+		fprintf(report, "%-28s %12.2f %12.2f %+7.1f%%%s\n", r->name, before, r->p50, change * 100,
+			change > tolerance ? "  SLOWER" : (change < -tolerance ? "  faster" : ""));
+		slower += change > tolerance;
+	}
+
+	return slower;
+}
+
+/*
+ *void FreeSuite(Suite*)
+ *This function frees the results and closes the counters
+*/
+void FreeSuite(Suite *s) {
+	unsigned int i;
+
+	for (i = 0; i < MEASURE_COUNTERS; i++)
+		if (s->counters[i] >= 0)
+			close(s->counters[i]);
+	free(s->results);
+	memset(s, 0, sizeof(Suite));
+}
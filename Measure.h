@@ -0,0 +1,56 @@
+#ifndef MEASURE_H
+#define MEASURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "Game.h"
+
+/*
+ *Measure.h
+ *A small harness for timing one operation at a time on Linux. A body runs
+ *ops operations per call. The harness works out how many operations fill
+ *MEASURE_SAMPLE_TIME and times MEASURE_SAMPLES such samples, giving the
+ *nanoseconds per operation at a few percentiles. Hardware counters
+ *(cycles, instructions, branch and cache misses) are read with
+ *perf_event_open where the kernel allows it.
+ *
+ *A suite of results is written as JSON and can be compared against one
+ *written before. A result is flagged when its median is slower than the
+ *baseline's by more than the tolerance.
+*/
+
+
+#define MEASURE_SAMPLES		31
+#define MEASURE_SAMPLE_TIME	0.002	//seconds
+#define MEASURE_COUNTERS	4
+#define MEASURE_NAME		48
+
+//Runs ops operations of a benchmark
+typedef void (*MeasureBody)(void *ctx, uint64_t ops);
+
+typedef struct Result {
+	char name[MEASURE_NAME];
+	uint64_t ops;							//operations timed in all
+	double mean, min, p50, p90, p99, max;	//nanoseconds per operation
+	bool counted;							//the counters were read
+	double counters[MEASURE_COUNTERS];		//per operation
+} Result;
+
+typedef struct Suite {
+	Result *results;
+	unsigned int count, capacity;
+	int counters[MEASURE_COUNTERS];			//perf event descriptors, the first leads the group
+	bool counting;
+} Suite;
+
+//Names of the counters in the JSON
+extern const char *const CounterNames[MEASURE_COUNTERS];
+
+//Suite functions
+void InitSuite(Suite *s);
+const Result *Measure(Suite *s, const char *name, MeasureBody body, void *ctx);
+void WriteSuite(const Suite *s, FILE *file);
+int CompareSuite(const Suite *s, const char *baseline, double tolerance, FILE *report);
+void FreeSuite(Suite *s);
+
+#endif
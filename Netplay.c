@@ -0,0 +1,402 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include <string.h>
+#include "Netplay.h"
+#include "Replay.h"
+#include "Wire.h"
+
+/*
+ *Netplay.c
+ *Rollback and the UDP link between the two sides. A packet is the magic,
+ *the match seed, how many of the other side's inputs we have (ack), the
+ *first tick of the inputs it carries and how many there are, then the
+ *inputs a byte each. Numbers are little endian.
+*/
+
+
+#define NET_MAGIC	0x54454E50	//"PNET"
+#define NO_REPLAY	UINT32_MAX
+
+/*
+ *int InputDir(byte)
+ *This function returns the paddle direction of an input
+*/
+static int InputDir(byte input) {
+	input &= 3;
+	return input == INPUT_UP ? -1 : (input == INPUT_DOWN ? 1 : 0);
+}
+
+/*
+ *void StartNetGame(Game*, uint64_t)
+ *This function sets up a two player match ready to serve, the same way
+ *on both sides. It runs fixed point physics, so the sides don't have to
+ *be built the same way or run on the same kind of CPU.
+*/
+void StartNetGame(Game *g, uint64_t seed) {
+	memset(g, 0, sizeof(Game));
+	InitGame(g, seed);
+	SetFixed(g, true);
+	g->mode = MODE_TWO;
+	AdvanceState(g);
+}
+
+/*
+ *void NetTick(Game*, byte, byte)
+ *This function plays one tick of a network match with both sides' inputs
+*/
+void NetTick(Game *g, byte left, byte right) {
+	if ((left | right) & NET_ADVANCE)
+		AdvanceState(g);
+
+	TickGame(g, InputDir(left), InputDir(right));
+}
+
+/*
+ *void InitRollback(Rollback*, const Game*, bool)
+ *This function starts a side of a match from g
+*/
+void InitRollback(Rollback *r, const Game *g, bool left) {
+	unsigned int i;
+
+	memset(r, 0, sizeof(Rollback));
+	r->game = *g;
+	r->left = left;
+	r->replayFrom = NO_REPLAY;
+	for (i = 0; i < ROLLBACK_SIZE; i++)
+		r->remoteTick[i] = UINT32_MAX;
+}
+
+/*
+ *byte Guess(const Rollback*, uint32_t)
+ *This function returns the other side's input for a tick: the real one if
+ *it came in, otherwise the direction it was last known to hold
+*/
+static byte Guess(const Rollback *r, uint32_t tick) {
+	if (r->remoteTick[tick % ROLLBACK_SIZE] == tick)
+		return r->remote[tick % ROLLBACK_SIZE];
+	if (r->confirmed > 0)
+		return r->remote[(r->confirmed - 1) % ROLLBACK_SIZE] & 3;
+
+	return INPUT_STILL;
+}
+
+/*
+ *void AddRemoteInput(Rollback*, uint32_t, byte)
+ *This function takes in the other side's input for a tick. If that tick
+ *was already played with a wrong guess, the match will be replayed from it.
+*/
+void AddRemoteInput(Rollback *r, uint32_t tick, byte input) {
+	//Already known, or so far ahead it would overwrite the last known input
+	if (tick < r->confirmed || tick - r->confirmed >= ROLLBACK_SIZE - 1 || r->remoteTick[tick % ROLLBACK_SIZE] == tick)
+		return;
+
+	r->remote[tick % ROLLBACK_SIZE] = input;
+	r->remoteTick[tick % ROLLBACK_SIZE] = tick;
+
+	if (tick < r->tick && r->used[tick % ROLLBACK_SIZE] != input && tick < r->replayFrom)
+		r->replayFrom = tick;
+
+	while (r->remoteTick[r->confirmed % ROLLBACK_SIZE] == r->confirmed)
+		r->confirmed++;
+}
+
+/*
+ *void RollTick(Rollback*, uint32_t)
+ *This function saves the match before a tick and plays it with our input
+ *and the best guess for the other side's
+*/
+static void RollTick(Rollback *r, uint32_t tick) {
+	byte local = r->local[tick % ROLLBACK_SIZE], remote = Guess(r, tick);
+
+	r->states[tick % ROLLBACK_SIZE] = r->game;
+	r->used[tick % ROLLBACK_SIZE] = remote;
+
+	if (r->left)
+		NetTick(&r->game, local, remote);
+	else
+		NetTick(&r->game, remote, local);
+}
+
+/*
+ *uint32_t ReplayRollback(Rollback*)
+ *This function puts the match back to the first wrongly guessed tick and
+ *plays it up to now again, returning how many ticks that took
+*/
+uint32_t ReplayRollback(Rollback *r) {
+	uint32_t tick, count;
+
+	if (r->replayFrom == NO_REPLAY)
+		return 0;
+
+	r->game = r->states[r->replayFrom % ROLLBACK_SIZE];
+	for (tick = r->replayFrom; tick < r->tick; tick++)
+		RollTick(r, tick);
+
+	count = r->tick - r->replayFrom;
+	r->replayFrom = NO_REPLAY;
+	r->rollbacks++;
+	r->replayed += count;
+	if (count > r->longest)
+		r->longest = count;
+
+	return count;
+}
+
+/*
+ *bool AdvanceRollback(Rollback*, byte)
+ *This function plays the next tick with our input. It doesn't when that
+ *would get more than ROLLBACK_WINDOW ticks ahead of the other side.
+*/
+bool AdvanceRollback(Rollback *r, byte input) {
+	ReplayRollback(r);
+
+	if (r->tick >= r->confirmed + ROLLBACK_WINDOW)
+		return false;
+
+	r->local[r->tick % ROLLBACK_SIZE] = input;
+	RollTick(r, r->tick++);
+
+	return true;
+}
+
+/*
+ *bool OpenNetplay(Netplay*, unsigned short, const char*, unsigned short, uint64_t, Clock)
+ *This function opens a UDP port (0 for any) for one side of a match. The
+ *host passes NULL as the address and waits for the other side, which passes
+ *the host's IPv4 address and port. The host's seed is the one played.
+*/
+bool OpenNetplay(Netplay *n, unsigned short port, const char *address, unsigned short remotePort, uint64_t seed, Clock clock) {
+	struct sockaddr_in local;
+	socklen_t size = sizeof(local);
+#ifdef _WIN32
+	WSADATA wsa;
+	SOCKET s;
+	u_long on = 1;
+
+	memset(n, 0, sizeof(Netplay));
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+		return false;
+	s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s == INVALID_SOCKET) {
+		WSACleanup();
+		return false;
+	}
+	n->socket = (intptr_t)s;
+	ioctlsocket(s, FIONBIO, &on);
+#else
+	int s;
+
+	memset(n, 0, sizeof(Netplay));
+	s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s < 0)
+		return false;
+	n->socket = s;
+	fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+#endif
+
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(port);
+	if (bind(s, (struct sockaddr *)&local, sizeof(local)) != 0 || getsockname(s, (struct sockaddr *)&local, &size) != 0) {
+		CloseNetplay(n);
+		return false;
+	}
+
+	n->port = ntohs(local.sin_port);
+	n->clock = clock;
+	n->seed = seed;
+	n->host = address == NULL;
+	if (!n->host) {
+		n->peerAddress = inet_addr(address);
+		n->peerPort = htons(remotePort);
+		n->hasPeer = true;
+	}
+
+	return true;
+}
+
+/*
+ *void SimulateNetwork(Netplay*, float, unsigned int, unsigned int)
+ *This function makes the packets this side sends get lost (loss is 0 to 1)
+ *or arrive latency plus up to jitter milliseconds late, in any order
+*/
+void SimulateNetwork(Netplay *n, float loss, unsigned int latencyMs, unsigned int jitterMs) {
+	n->loss = loss;
+	n->latency = latencyMs * 1000000ull;
+	n->jitter = jitterMs * 1000000ull;
+}
+
+/*
+ *void SendNow(Netplay*, const byte*, unsigned int)
+ *This function sends a packet to the other side
+*/
+static void SendNow(Netplay *n, const byte *data, unsigned int size) {
+	struct sockaddr_in peer;
+
+	memset(&peer, 0, sizeof(peer));
+	peer.sin_family = AF_INET;
+	peer.sin_addr.s_addr = n->peerAddress;
+	peer.sin_port = n->peerPort;
+	sendto(n->socket, (const char *)data, size, 0, (struct sockaddr *)&peer, sizeof(peer));
+	n->bytes += size;
+}
+
+/*
+ *void Send(Netplay*, const byte*, unsigned int)
+ *This function sends a packet through the simulated network, if any
+*/
+static void Send(Netplay *n, const byte *data, unsigned int size) {
+	uint64_t r = Random(n->port, n->sent++);
+
+	if (n->loss <= 0 && n->latency == 0 && n->jitter == 0) {
+		SendNow(n, data, size);
+		return;
+	}
+
+	if ((r >> 11) * 0x1p-53 < n->loss || n->queued == NET_QUEUE) {
+		n->lost++;
+		return;
+	}
+
+	n->queue[n->queued].due = n->clock.Now(n->clock.ctx) + n->latency + (n->jitter ? (r & 0xFFFFFFFF) % n->jitter : 0);
+	n->queue[n->queued].size = (uint16_t)size;
+	memcpy(n->queue[n->queued].data, data, size);
+	n->queued++;
+}
+
+/*
+ *void Receive(Netplay*, const byte*, unsigned int, const struct sockaddr_in*)
+ *This function handles a packet from the other side, starting the match
+ *with the first one
+*/
+static void Receive(Netplay *n, const byte *data, unsigned int size, const struct sockaddr_in *from) {
+	uint32_t ack, first, i;
+	Game g;
+
+	if (size < 21 || Get32(data) != NET_MAGIC || size < 21u + data[20])
+		return;
+
+	//The host takes the first side to say hello as the other side
+	if (!n->hasPeer) {
+		n->peerAddress = from->sin_addr.s_addr;
+		n->peerPort = from->sin_port;
+		n->hasPeer = true;
+	}
+	if (from->sin_addr.s_addr != n->peerAddress || from->sin_port != n->peerPort)
+		return;
+
+	if (!n->started) {
+		if (!n->host)
+			n->seed = Get32(data + 4) | (uint64_t)Get32(data + 8) << 32;
+		StartNetGame(&g, n->seed);
+		InitRollback(&n->rb, &g, n->host);
+		n->started = true;
+	}
+
+	ack = Get32(data + 12);
+	first = Get32(data + 16);
+	if (ack > n->acked && ack <= n->rb.tick)
+		n->acked = ack;
+	for (i = 0; i < data[20]; i++)
+		AddRemoteInput(&n->rb, first + i, data[21 + i]);
+}
+
+/*
+ *void PollNetplay(Netplay*)
+ *This function sends the held back packets that are due and handles every
+ *packet that came in
+*/
+void PollNetplay(Netplay *n) {
+	uint64_t now = n->clock.Now(n->clock.ctx);
+	unsigned int i;
+	byte data[NET_PACKET];
+	struct sockaddr_in from;
+	socklen_t size = sizeof(from);
+	int got;
+
+	for (i = 0; i < n->queued;) {
+		if (n->queue[i].due <= now) {
+			SendNow(n, n->queue[i].data, n->queue[i].size);
+			n->queue[i] = n->queue[--n->queued];
+		}
+		else
+			i++;
+	}
+
+	while ((got = recvfrom(n->socket, (char *)data, sizeof(data), 0, (struct sockaddr *)&from, &size)) > 0) {
+		Receive(n, data, got, &from);
+		size = sizeof(from);
+	}
+}
+
+/*
+ *void SyncNetplay(Netplay*)
+ *This function replays the match if a guess was wrong and sends the other
+ *side every input it doesn't have yet (just a hello before the match)
+*/
+void SyncNetplay(Netplay *n) {
+	byte data[NET_PACKET];
+	uint32_t first = 0, count = 0, i;
+
+	if (!n->hasPeer)
+		return;
+
+	if (n->started) {
+		ReplayRollback(&n->rb);
+
+		first = n->acked;
+		if (n->rb.tick - first > ROLLBACK_SIZE - 1)
+			first = n->rb.tick - (ROLLBACK_SIZE - 1);
+		count = n->rb.tick - first;
+	}
+
+	Put32(data, NET_MAGIC);
+	Put32(data + 4, (uint32_t)n->seed);
+	Put32(data + 8, (uint32_t)(n->seed >> 32));
+	Put32(data + 12, n->rb.confirmed);
+	Put32(data + 16, first);
+	data[20] = (byte)count;
+	for (i = 0; i < count; i++)
+		data[21 + i] = n->rb.local[(first + i) % ROLLBACK_SIZE];
+
+	Send(n, data, 21 + count);
+}
+
+/*
+ *bool StepNetplay(Netplay*, byte)
+ *This function plays our next tick with input (an INPUT_* direction, plus
+ *NET_ADVANCE for space) and tells the other side. It returns false when
+ *the match hasn't started or is waiting for the other side to catch up.
+*/
+bool StepNetplay(Netplay *n, byte input) {
+	bool played = false;
+
+	if (n->started)
+		played = AdvanceRollback(&n->rb, input);
+	SyncNetplay(n);
+
+	return played;
+}
+
+/*
+ *void CloseNetplay(Netplay*)
+ *This function closes a side's socket
+*/
+void CloseNetplay(Netplay *n) {
+#ifdef _WIN32
+	closesocket((SOCKET)n->socket);
+	WSACleanup();
+#else
+	close((int)n->socket);
+#endif
+	n->socket = -1;
+}
@@ -0,0 +1,88 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include "Game.h"
+#include "Loop.h"
+
+/*
+ *Netplay.h
+ *Two player matches over UDP with rollback. Each side runs the match
+ *without waiting for the other: the other side's input is guessed (it is
+ *assumed to keep doing what it last did) and when the real input turns out
+ *different, the match is put back to the tick it changed on and played
+ *forward again with what is now known. A Game is plain data, so putting
+ *it back is a struct copy out of a ring of the last ROLLBACK_SIZE ticks.
+ *
+ *Every packet carries all of a side's inputs the other hasn't confirmed
+ *yet, so a lost packet is made up for by the next one. Packets can be sent
+ *through a simulated bad network (loss, latency and jitter) to try it all
+ *out over localhost.
+*/
+
+
+#define ROLLBACK_SIZE	64		//ticks of states and inputs kept, a power of two
+#define ROLLBACK_WINDOW	24		//most ticks played ahead of the other side's input
+#define NET_QUEUE		256		//packets the simulated network can hold back
+#define NET_PACKET		(21 + ROLLBACK_SIZE)
+
+//Input of one side for one tick: an INPUT_* direction (see Replay.h)
+//and whether space was pressed before it
+#define NET_ADVANCE		4
+
+//The match from one side's point of view
+typedef struct Rollback {
+	Game game;							//before tick, with guesses for what isn't known yet
+	Game states[ROLLBACK_SIZE];			//the match before tick t is at t % ROLLBACK_SIZE
+	byte local[ROLLBACK_SIZE];			//our inputs
+	byte remote[ROLLBACK_SIZE];			//the other side's inputs that came in
+	byte used[ROLLBACK_SIZE];			//what was played for the other side, known or guessed
+	uint32_t remoteTick[ROLLBACK_SIZE];	//which tick each remote input is for
+	uint32_t tick;						//the next tick to play
+	uint32_t confirmed;					//the other side's inputs are all known before this tick
+	uint32_t replayFrom;				//the earliest wrong guess, tick when there is none
+	bool left;							//we play the left paddle
+	uint64_t rollbacks, replayed;		//totals
+	uint32_t longest;					//most ticks replayed at once
+} Rollback;
+
+//A packet held back by the simulated network
+typedef struct NetPacket {
+	uint64_t due;
+	uint16_t size;
+	byte data[NET_PACKET];
+} NetPacket;
+
+//One side of a network match
+typedef struct Netplay {
+	Rollback rb;
+	intptr_t socket;
+	uint32_t peerAddress;			//network byte order
+	uint16_t peerPort, port;		//network byte order, host byte order
+	bool host, hasPeer, started;
+	uint64_t seed;					//of the match, picked by the host
+	uint32_t acked;					//the other side has our inputs before this tick
+	Clock clock;
+	float loss;						//simulated network
+	uint64_t latency, jitter;
+	NetPacket queue[NET_QUEUE];
+	unsigned int queued;
+	uint64_t sent, lost, bytes;		//totals
+} Netplay;
+
+//Rollback functions
+void StartNetGame(Game *g, uint64_t seed);
+void NetTick(Game *g, byte left, byte right);
+void InitRollback(Rollback *r, const Game *g, bool left);
+void AddRemoteInput(Rollback *r, uint32_t tick, byte input);
+uint32_t ReplayRollback(Rollback *r);
+bool AdvanceRollback(Rollback *r, byte input);
+
+//Netplay functions
+bool OpenNetplay(Netplay *n, unsigned short port, const char *address, unsigned short remotePort, uint64_t seed, Clock clock);
+void SimulateNetwork(Netplay *n, float loss, unsigned int latencyMs, unsigned int jitterMs);
+void PollNetplay(Netplay *n);
+void SyncNetplay(Netplay *n);
+bool StepNetplay(Netplay *n, byte input);
+void CloseNetplay(Netplay *n);
+
+#endif
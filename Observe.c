@@ -0,0 +1,269 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Observe.h"
+
+/*
+ *Observe.c
+ *The batch renderer, see Observe.h. The boxes of a match are worked out
+ *like RasterTable does it and every frame pixel they reach is counted
+ *again from the empty table and the boxes, so overlaps with the net or
+ *the borders come out as they would downsampling the whole table.
+*/
+
+#define NEVER		0xFF	//in counts
+
+//A part of the matches for one thread
+typedef struct ObserveWork {
+	Observer *o;
+	const Env *e;
+	byte *tensor;
+	unsigned int first, last;
+	uint64_t pixels;
+	pthread_t thread;
+} ObserveWork;
+
+
+/*
+ *bool InitObserver(Observer*, unsigned short, byte, byte)
+ *This function sets up frames of size x size pixels (up to RESOLUTION)
+ *with 1 or 3 planes, stack of them per match. It returns false if the
+ *sizes are wrong or it is out of memory.
+*/
+bool InitObserver(Observer *o, unsigned short size, byte planes, byte stack) {
+	Raster r;
+	unsigned int s, x, y;
+
+	memset(o, 0, sizeof(Observer));
+	if (size == 0 || size > RESOLUTION || (planes != 1 && planes != 3) || stack == 0 || stack > OBSERVE_MAX_STACK)
+		return false;
+
+	o->size = size;
+	o->planes = planes;
+	o->stack = stack;
+	o->frameSize = (size_t)planes * size * size;
+	o->matchSize = o->frameSize * stack;
+	o->head = stack - 1;
+
+	//Every table pixel goes to the frame pixel its center is in
+	for (s = 0; s < RESOLUTION; s++)
+		o->owners[s] = (byte)((2 * s + 1) * size / (2 * RESOLUTION));
+	for (s = RESOLUTION; s > 0; s--)
+		o->starts[o->owners[s - 1]] = (uint16_t)(s - 1);
+	o->starts[size] = RESOLUTION;
+
+	InitRaster(&r, o->table, RASTER_8);
+	o->background = malloc((size_t)size * size);
+	if (o->background == NULL)
+		return false;
+	for (y = 0; y < size; y++)
+		for (x = 0; x < size; x++) {
+			unsigned int white = 0, area = (o->starts[x + 1] - o->starts[x]) * (o->starts[y + 1] - o->starts[y]), i, k;
+
+			for (k = o->starts[y]; k < o->starts[y + 1]; k++)
+				for (i = o->starts[x]; i < o->starts[x + 1]; i++)
+					white += o->table[k * RESOLUTION + i] != 0;
+			o->background[y * size + x] = (byte)((white * 255 + area / 2) / area);
+		}
+
+	return true;
+}
+
+/*
+ *size_t ObserveSize(const Observer*, unsigned int)
+ *This function returns how many bytes the tensor for n matches takes
+*/
+size_t ObserveSize(const Observer *o, unsigned int n) {
+	return o->matchSize * n;
+}
+
+/*
+ *byte ObserveSlot(const Observer*, byte)
+ *This function returns which of the stack frames of a match (a C index
+ *over the planes) is the one age steps old, 0 being the newest
+*/
+byte ObserveSlot(const Observer *o, byte age) {
+	return (byte)((o->head + o->stack - age % o->stack) % o->stack);
+}
+
+/*
+ *void PutBack(const Observer*, byte*, Rect)
+ *This function copies a box of the empty table into every plane of a frame
+*/
+static void PutBack(const Observer *o, byte *frame, Rect box) {
+	unsigned int y, p, plane = (unsigned int)o->size * o->size;
+
+	for (p = 0; p < o->planes; p++)
+		for (y = box.top; y < (unsigned int)box.bottom; y++)
+			memcpy(frame + p * plane + y * o->size + box.left, o->background + y * o->size + box.left, box.right - box.left);
+}
+
+/*
+ *void DrawBox(const Observer*, byte*, Rect, const Rect*, byte)
+ *This function works out every frame pixel a box of the table reaches
+ *from the empty table and all the boxes drawn
+*/
+static void DrawBox(const Observer *o, byte *frame, Rect frameBox, const Rect *boxes, byte count) {
+	unsigned int x, y, i, k, p, plane = (unsigned int)o->size * o->size;
+	byte b;
+
+	for (y = frameBox.top; y < (unsigned int)frameBox.bottom; y++)
+		for (x = frameBox.left; x < (unsigned int)frameBox.right; x++) {
+			unsigned int white = 0, area = (o->starts[x + 1] - o->starts[x]) * (o->starts[y + 1] - o->starts[y]);
+			byte value;
+
+			for (k = o->starts[y]; k < o->starts[y + 1]; k++)
+				for (i = o->starts[x]; i < o->starts[x + 1]; i++) {
+					bool lit = o->table[k * RESOLUTION + i] != 0;
+
+					for (b = 0; b < count && !lit; b++)
+						lit = (int)i >= boxes[b].left && (int)i < boxes[b].right && (int)k >= boxes[b].top && (int)k < boxes[b].bottom;
+					white += lit;
+				}
+
+			value = (byte)((white * 255 + area / 2) / area);
+			for (p = 0; p < o->planes; p++)
+				frame[p * plane + y * o->size + x] = value;
+		}
+}
+
+/*
+ *uint64_t ObserveMatch(Observer*, const Env*, unsigned int, byte*)
+ *This function renders match i into the newest slot of its stack and
+ *returns how many frame pixels it wrote
+*/
+static uint64_t ObserveMatch(Observer *o, const Env *e, unsigned int i, byte *tensor) {
+	byte *frame = tensor + o->matchSize * i + o->frameSize * o->head;
+	Rect *drawn = o->drawn + ((size_t)i * o->stack + o->head) * OBSERVE_OBJECTS, boxes[OBSERVE_OBJECTS];
+	byte *count = &o->counts[(size_t)i * o->stack + o->head], b, drawing = 2;
+	uint64_t pixels = 0;
+	unsigned int p;
+
+	//Take what was drawn stack steps ago off, or start the slot
+	if (*count == NEVER) {
+		for (p = 0; p < o->planes; p++)
+			memcpy(frame + (size_t)p * o->size * o->size, o->background, (size_t)o->size * o->size);
+		pixels += o->frameSize;
+	}
+	else
+		for (b = 0; b < *count; b++) {
+			PutBack(o, frame, drawn[b]);
+			pixels += (uint64_t)(drawn[b].right - drawn[b].left) * (drawn[b].bottom - drawn[b].top) * o->planes;
+		}
+
+	//The same boxes as RasterTable
+	boxes[0] = RectangleBox(0, e->player[i] - PADDLEHEIGHT / 2, PADDLEWIDTH, e->player[i] + PADDLEHEIGHT / 2);
+	boxes[1] = RectangleBox(RESOLUTION - PADDLEWIDTH, e->player2[i] - PADDLEHEIGHT / 2, RESOLUTION, e->player2[i] + PADDLEHEIGHT / 2);
+	if (e->state[i] == STATE_PLAY)
+		boxes[drawing++] = RectangleBox(e->x[i] - BALLSIZE, e->y[i] - BALLSIZE, e->x[i] + BALLSIZE, e->y[i] + BALLSIZE);
+
+	*count = 0;
+	for (b = 0; b < drawing; b++) {
+		Rect f;
+
+		if (boxes[b].right <= boxes[b].left || boxes[b].bottom <= boxes[b].top)
+			continue;
+		f.left = o->owners[boxes[b].left];
+		f.top = o->owners[boxes[b].top];
+		f.right = o->owners[boxes[b].right - 1] + 1;
+		f.bottom = o->owners[boxes[b].bottom - 1] + 1;
+		DrawBox(o, frame, f, boxes, drawing);
+		drawn[(*count)++] = f;
+		pixels += (uint64_t)(f.right - f.left) * (f.bottom - f.top) * o->planes;
+	}
+
+	return pixels;
+}
+
+/*
+ *void *ObserveWorker(void*)
+ *This function renders one thread's part of the matches
+*/
+static void *ObserveWorker(void *arg) {
+	ObserveWork *w = arg;
+	unsigned int i;
+
+	for (i = w->first; i < w->last; i++)
+		w->pixels += ObserveMatch(w->o, w->e, i, w->tensor);
+
+	return NULL;
+}
+
+/*
+ *void ObserveEnv(Observer*, const Env*, byte*)
+ *This function renders the newest frame of every match of the env into
+ *the tensor (ObserveSize bytes). The tensor has to be the same one every
+ *step, or its stacks start over.
+*/
+void ObserveEnv(Observer *o, const Env *e, byte *tensor) {
+	ObserveWork *work;
+	unsigned int count = o->threads, i, k;
+
+	//New matches or a new tensor start with the empty table
+	if (e->n > o->capacity) {
+		Rect *drawn = realloc(o->drawn, sizeof(Rect) * OBSERVE_OBJECTS * o->stack * e->n);
+		byte *counts;
+
+		if (drawn == NULL)
+			return;
+		o->drawn = drawn;
+		counts = realloc(o->counts, (size_t)o->stack * e->n);
+		if (counts == NULL)
+			return;
+		o->counts = counts;
+		o->capacity = e->n;
+	}
+	if (e->n != o->n || tensor != o->tensor) {
+		memset(o->counts, NEVER, (size_t)o->stack * e->n);
+		o->n = e->n;
+		o->tensor = tensor;
+	}
+	o->head = (o->head + 1) % o->stack;
+
+	if (count == 0) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		count = cores > 0 ? (unsigned int)cores : 1;
+	}
+	if (count > o->n)
+		count = o->n > 0 ? o->n : 1;
+	work = calloc(count, sizeof(ObserveWork));
+	if (work == NULL)
+		count = 0;
+
+	for (i = 0; i < count; i++) {
+		work[i].o = o;
+		work[i].e = e;
+		work[i].tensor = tensor;
+		work[i].first = (unsigned int)((uint64_t)o->n * i / count);
+		work[i].last = (unsigned int)((uint64_t)o->n * (i + 1) / count);
+	}
+
+	//The calling thread does the first part
+	for (i = 1; i < count; i++)
+		if (pthread_create(&work[i].thread, NULL, ObserveWorker, &work[i]) != 0)
+			break;
+	if (count > 0)
+		ObserveWorker(&work[0]);
+	for (k = 1; k < i; k++)
+		pthread_join(work[k].thread, NULL);
+	//Whatever couldn't get a thread
+	for (; i < count; i++)
+		ObserveWorker(&work[i]);
+
+	for (i = 0; i < count; i++)
+		o->pixels += work[i].pixels;
+	o->frames += o->n;
+	free(work);
+}
+
+/*
+ *void FreeObserver(Observer*)
+ *This function releases the memory of an observer
+*/
+void FreeObserver(Observer *o) {
+	free(o->background);
+	free(o->drawn);
+	free(o->counts);
+	memset(o, 0, sizeof(Observer));
+}
@@ -0,0 +1,61 @@
+#ifndef OBSERVE_H
+#define OBSERVE_H
+
+#include <stddef.h>
+#include "Env.h"
+#include "Raster.h"
+
+/*
+ *Observe.h
+ *Renders the table of every match of an Env as pixels, for controllers
+ *that learn from the picture, straight into a tensor the caller owns:
+ *N x C x H x W bytes, one match after another, one plane after another.
+ *The picture is the table RasterTable draws (borders, net, paddles and
+ *ball, white on black) without the text.
+ *
+ *A frame is size x size pixels. At RESOLUTION it is the table pixel for
+ *pixel. Smaller (84 or 64) every table pixel belongs to the frame pixel
+ *its center falls in and a frame pixel is the share of its table pixels
+ *that are white, so a line one table pixel thin never drops out. Frames
+ *have 1 plane (gray) or 3 (the same gray in R, G and B).
+ *
+ *The last stack frames of every match are kept in the tensor, so C is
+ *stack x planes. They are a ring: each step writes the newest frame over
+ *the oldest one and nothing is moved, ObserveSlot says which frame is
+ *where. Since the slot written last held the same match stack steps
+ *earlier, only the boxes that were drawn into it then are put back and
+ *the new ones drawn, a few dozen pixels a frame.
+ *
+ *The matches are split over threads, each writing its own part of the
+ *tensor.
+*/
+
+
+#define OBSERVE_MAX_STACK	8
+#define OBSERVE_OBJECTS		3		//paddles and ball
+
+typedef struct Observer {
+	unsigned short size;					//frame width and height
+	byte planes, stack;
+	size_t frameSize, matchSize;			//bytes of a frame and of a match's stack
+	uint16_t starts[RESOLUTION + 1];		//the first table pixel of each frame pixel, across and down
+	byte owners[RESOLUTION];				//the frame pixel each table pixel belongs to
+	byte table[RESOLUTION * RESOLUTION];	//the empty table
+	byte *background;						//the empty table as a frame
+	unsigned int n, capacity;				//matches
+	Rect *drawn;							//frame boxes drawn, OBSERVE_OBJECTS per match and slot
+	byte *counts;							//how many, 0xFF if the slot was never drawn
+	byte head;								//the slot of the newest frame
+	const byte *tensor;						//the one written last step
+	unsigned int threads;					//0 for one per core
+	uint64_t frames, pixels;				//rendered so far and frame pixels written for them
+} Observer;
+
+//Observer functions
+bool InitObserver(Observer *o, unsigned short size, byte planes, byte stack);
+size_t ObserveSize(const Observer *o, unsigned int n);
+void ObserveEnv(Observer *o, const Env *e, byte *tensor);
+byte ObserveSlot(const Observer *o, byte age);
+void FreeObserver(Observer *o);
+
+#endif
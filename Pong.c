@@ -1,6 +1,25 @@
 #include <Windows.h>
+#pragma comment(lib, "winmm.lib")
 #include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Game.h"
+#include "Raster.h"
+#include "Glyphs.h"
+#include "FrameDiff.h"
+#include "Draw.h"
+#include "Loop.h"
+#include "Replay.h"
+#include "Netplay.h"
+#include "Probe.h"
+#include "Input.h"
+#include "Handoff.h"
+#include "Scale.h"
+#include "Touch.h"
+#include "Profile.h"
 
 /*
  *Pong.c (C) 2014 Eric Middleton
@@ -15,100 +34,133 @@
  *
  *To play, compile and run this code. Use the arrow up and down keys to select one or two player mode.
  *In single player mode, use the W and S keys to control the paddle on the left side of the screen. 
- *	The AI will control the right side paddle.
+ *	The AI will control the right side paddle. It plays normal by default, -ai easy, -ai hard
+ *	or -ai chase (the AI of the first version, which simply follows the ball) change that.
  *In two player mode, player 1 will use the W and S keys to control the left paddle and
  *	player 2 will use the O and L keys to control the right paddle.
  *To serve the ball, press the space bar. The ball will be served from the center to
  *	one of the players at random.
  *The game will continue until one of the players (or the AI) reaches 10 points.
+ *-physics changes the physics: a profile (fast, or long for first to 21), values like
+ *	"maxscore=15 paddle=16" or a file of them (see Profile.h). -fixed runs them in fixed
+ *	point, which plays the same on every machine, so a replay recorded with it does too.
+ *-record file appends a replay of everything played to file when the game closes (see
+ *	Replay.h). Touch moves the paddles directly rather than through the keys, so it is
+ *	turned off while recording.
+ *Two player mode also works over the network: one side starts with -host port and the other
+ *	with -join address port, and each plays with the W and S keys. Neither waits for the
+ *	other (see Netplay.h). Network matches run at the normal rate with the classic physics
+ *	in fixed point, without touch or recording.
+ *-overlay shows the 50th and 99th percentile update (t) and redraw (p) times in microseconds
+ *	and the updates dropped (d) above the table. -trace also shares every one of those times
+ *	for PongTrace to follow while the game runs (see Probe.h).
+ *-touchtrace file appends every touch to file, to play them back elsewhere (see Touch.h).
  *The game can be closed at any time by pressing the escape key.
  *
  *--How the game works--
  *On the highest level, this game is a very simple Finite State Machine.
  *On a lower level, this program uses the Windows API to create a borderless window
  *and uses the Windows GDI (Graphics Device Interface) to display the game on the screen.
- *The game is rendered on a 128x128 back buffer and is stretched onto the screen
- *whenever the window is redrawn.
- *The game is updated approximately 100 times per second using a standard Windows timer event
+ *The game is rendered on a 128x128 back buffer and is scaled onto a screen sized buffer
+ *whenever the window is redrawn. The table itself is drawn straight into the
+ *pixels of that buffer (see Raster.c), GDI only adds the touch controls. Only the
+ *tiles of the buffer that changed are scaled (see Scale.h) and blitted to the screen.
+ *The game is updated 100 times per second by default (-hz 240 or -hz 1000 for more) on a fixed
+ *timestep (see Loop.c) and drawn 60 times per second (-fps), in between two updates.
+ *The updates and the drawing each run on a thread of their own, the window's thread only
+ *handles messages. The updates pass the match on through a triple buffer (see Handoff.h), so
+ *a slow frame never holds up an update.
+ *The rules themselves live in Game.c and do not depend on Windows.
+ *Keys and touches are queued with the time they came in and each update takes the ones that
+ *came in before it was due (see Input.h), so even a tap between two updates moves the paddle.
 */
 
 
-//Defines for game properties
-#define BALLSPEED		100
-#define ENGLISHSCALE	20
-#define BALLSIZE		2
-#define	PADDLEHEIGHT	12
-#define PADDLEWIDTH		2
-#define NETWIDTH		2
-#define	MESHSIZE		4
-#define	MAXSCORE		10
-#define	AI_SPEED		1.f
-#define	PLAYER_SPEED	1.5f
-#define RESOLUTION		128
-#define MARGIN			32
-#define TOUCH_WIDTH		0.02f
-
-//State definitions
-#define STATE_HOME		0
-#define STATE_READY		1
-#define STATE_SERVE		2
-#define STATE_PLAY		3
-#define	STATE_END		4
-
-//Game mode definitions
-#define MODE_ONE		1
-#define	MODE_TWO		2
-
-//Macros
-#define PLAYER_SCORE(s)		((s) >> 4)
-#define	PLAYER2_SCORE(s)	((s) & 0x0F)
-#define MAKE_SCORE(p, a)	( ((p) << 4) | (a))
-#define CLAMP(n, a, b)		(min(max( (n), (a) ), (b) ))
-
-//Typedef for a byte
-typedef unsigned char byte;
-
-//Ball struct
-typedef struct Ball {
-	float x, y, vx, vy;
-} Ball;
-
-//Paddle struct
-typedef struct Paddle {
-	float height;
-} Paddle;
-
 typedef struct Buffer {
 	HDC hdc;
 	HBITMAP bitmap, old;
 	unsigned short x, y;
 } Buffer;
 
+//The GDI objects behind the renderer's styles and fonts
+typedef struct Gdi {
+	HDC hdc;						//drawn on, one of the layers
+	HDC layers[MAX_LAYERS];
+	HBRUSH brushes[MAX_STYLES];
+	HPEN pens[MAX_STYLES];
+	HPEN nullPen;
+	HFONT fonts[MAX_FONTS];
+	byte fontFlags[MAX_FONTS];
+} Gdi;
+
 //Global variables
 //These are needed because all of the processing
 //is done inside the Windows event loop system
-Paddle player2, player;
-Ball ball;
-Buffer gameBuffer, touchBuffer;
-byte state, score, mode;
+//The match and everything it uses belong to the update thread,
+//the table, the buffers and the renderer to the drawing thread
+Game game, previous;
+Timestep simulation, frames;
+Handoff handoff;
+HANDLE updater, drawer;
+volatile bool running;
+volatile uint32_t drawn;			//the last snapshot drawn
+uint32_t redrawFrom, inputFrom;	//the first snapshot that has to be drawn for each
+uint64_t inputAt;
+Raster table;
+FrameEncoder presented;
+volatile bool exposed;
+Recorder recorder;
+const char *recordPath;
+Netplay net;
+bool netplay, netAdvance;
+Gdi gdi;
+Renderer renderer;
+Buffer gameBuffer, screenBuffer, staticBuffer;
+TouchLayers layers;
+TouchMap touchMap;
+FILE *touchTrace;
+Scaler scaler;
+uint32_t *screen;
 unsigned short width, height;
-bool stateChange, touch;
+bool touch;
+InputQueue input;
+Buttons buttons;
+HWND window;
+bool overlay;
+uint64_t overlayAt;
 
 //Windows event loop function
 LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
-//Game functions
-void UpdateAI(Paddle *AI, Ball b);
-void ScoreToStrs(byte score, char *pStr, char*AIStr);
-void ServeBall(Ball *b);
-void ApplyEnglish(Ball *b, Paddle p);
-void UpdateBall(Ball *b, Paddle player, Paddle player2);
-void DrawTableText(HDC hdc, HFONT font, unsigned short x, unsigned short y, unsigned short width, unsigned short height, byte format, char *str);
-void DrawTable(HDC hdc, Ball b, Paddle player, Paddle player2, byte score, byte state, byte mode);
-int PaddleToSlider(Paddle p, unsigned short height);
-void SliderToPaddle(unsigned short slider, Paddle *p, unsigned short width);
-void DrawTouchControls(HDC hdc, unsigned short width, unsigned short height, byte state, byte mode);
-void ProcessTouch(HWND hWnd, WPARAM wParam, LPARAM lParam, Paddle *player1, Paddle *player2, unsigned short width, unsigned short height);
+//Game, drawing and input functions
+DWORD WINAPI Update(LPVOID arg);
+DWORD WINAPI Draw(LPVOID arg);
+void RunTick(uint64_t due);
+void Publish(uint64_t due);
+void DrawFrame(const Snapshot *s);
+void PressButton(byte button);
+void ApplyTouches(const InputEvent *points, unsigned int count);
+int KeyButton(WPARAM key);
+void QueueInput(byte type, int button, short x, short y);
+void DrawTable(Raster *r, Ball b, Paddle player, Paddle player2, uint16_t score, byte state, byte mode);
+void DrawOverlay(Raster *r);
+void ProcessTouch(WPARAM wParam, LPARAM lParam);
+
+//GDI renderer backend
+bool GdiMakeStyle(void *ctx, byte id, const Style *style);
+bool GdiMakeFont(void *ctx, byte id, const FontDesc *font);
+void GdiFreeResources(void *ctx);
+void GdiClear(void *ctx, int left, int top, int right, int bottom);
+void GdiBox(void *ctx, byte style, int left, int top, int right, int bottom);
+void GdiEllipse(void *ctx, byte style, int left, int top, int right, int bottom);
+void GdiLines(void *ctx, byte style, const int *points, byte count);
+void GdiText(void *ctx, byte font, int x, int y, int width, int height, byte format, const char *str);
+void GdiLayer(void *ctx, byte layer);
+void GdiCopy(void *ctx, byte from, int left, int top, int right, int bottom);
+
+const RenderBackend GdiBackend = {
+	GdiMakeStyle, GdiMakeFont, GdiFreeResources, GdiClear, GdiBox, GdiEllipse, GdiLines, GdiText, GdiLayer, GdiCopy
+};
 
 /*
  *int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
@@ -121,19 +173,65 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	HWND hWnd;
 	MSG msg;
 	HDC hdc;
+	BITMAPINFO info;
+	void *pixels;
 	char **argv;
 	int argc, i;
-
-	//Check the command line parameters for '-touch'
-	//which will enable touch mode
+	unsigned int hz = TICK_RATE, fps = 60;
+	const char *netAddress = NULL;
+	unsigned short netPort = 0;
+	byte skill = SKILL_NORMAL;
+	bool trace = false, fixed = false;
+	Physics physics = Profiles[PROFILE_CLASSIC];
+
+	//Check the command line parameters for '-notouch'
+	//which will disable touch mode, and for the update and frame rates
 	touch = true;
 	argv = CommandLineToArgvW(lpCmdLine, &argc);
 	for (i = 0; i < argc; i++) {
-		if (strcmp(argv[i], "-notouch") == 0) {
+		if (strcmp(argv[i], "-notouch") == 0)
+			touch = false;
+		else if (strcmp(argv[i], "-hz") == 0 && i + 1 < argc)
+			hz = CLAMP(atoi(argv[++i]), 10, 1000);
+		else if (strcmp(argv[i], "-fps") == 0 && i + 1 < argc)
+			fps = CLAMP(atoi(argv[++i]), 10, 1000);
+		else if (strcmp(argv[i], "-record") == 0 && i + 1 < argc) {
+			recordPath = argv[++i];
 			touch = false;
-			break;
 		}
+		else if (strcmp(argv[i], "-host") == 0 && i + 1 < argc) {
+			netplay = true;
+			touch = false;
+			netPort = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-join") == 0 && i + 2 < argc) {
+			netplay = true;
+			touch = false;
+			netAddress = argv[++i];
+			netPort = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-ai") == 0 && i + 1 < argc) {
+			i++;
+			skill = strcmp(argv[i], "chase") == 0 ? SKILL_CHASE : strcmp(argv[i], "easy") == 0 ? SKILL_EASY :
+				strcmp(argv[i], "hard") == 0 ? SKILL_HARD : SKILL_NORMAL;
+		}
+		else if (strcmp(argv[i], "-overlay") == 0)
+			overlay = true;
+		else if (strcmp(argv[i], "-trace") == 0)
+			trace = true;
+		else if (strcmp(argv[i], "-touchtrace") == 0 && i + 1 < argc)
+			touchTrace = fopen(argv[++i], "ab");
+		else if (strcmp(argv[i], "-physics") == 0 && i + 1 < argc) {
+			i++;
+			if (!ParsePhysics(&physics, argv[i]))
+				LoadPhysics(&physics, argv[i]);
+		}
+		else if (strcmp(argv[i], "-fixed") == 0)
+			fixed = true;
 	}
+	//Both sides of a network match have to run the same ticks
+	if (netplay)
+		hz = TICK_RATE;
 
 	wc.cbSize = sizeof(WNDCLASSEX);
 	wc.style = 0;
@@ -166,58 +264,339 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 		MessageBox(NULL, "Error: Window Creation Failed!", "Pong", MB_ICONEXCLAMATION | MB_OK);
 		return -1;
 	}
+	window = hWnd;
 	
 	//Set up our off-screen drawing buffers
+	//The game buffer is a 32 bit top-down DIB so that we can draw into its pixels
+	ZeroMemory(&info, sizeof(info));
+	info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	info.bmiHeader.biWidth = RESOLUTION;
+	info.bmiHeader.biHeight = -RESOLUTION;
+	info.bmiHeader.biPlanes = 1;
+	info.bmiHeader.biBitCount = 32;
+	info.bmiHeader.biCompression = BI_RGB;
+
 	hdc = GetDC(hWnd);
 	gameBuffer.hdc = CreateCompatibleDC(hdc);
-	gameBuffer.bitmap = CreateCompatibleBitmap(hdc, RESOLUTION, RESOLUTION);
+	gameBuffer.bitmap = CreateDIBSection(hdc, &info, DIB_RGB_COLORS, &pixels, NULL, 0);
 	gameBuffer.old = SelectObject(gameBuffer.hdc, gameBuffer.bitmap);
+	InitRaster(&table, pixels, RASTER_32);
+	exposed = !InitFrameEncoder(&presented, RASTER_32);
 	gameBuffer.x = RESOLUTION;
 	gameBuffer.y = RESOLUTION;
 
-	if (touch) { //We use an extra buffer for the touch controls
-		touchBuffer.hdc = CreateCompatibleDC(hdc);
-		touchBuffer.bitmap = CreateCompatibleBitmap(hdc, width, height);
-		touchBuffer.old = SelectObject(touchBuffer.hdc, touchBuffer.bitmap);
-		touchBuffer.x = width;
-		touchBuffer.y = height;
+	//The screen buffer is a screen sized DIB the table is scaled into (see Scale.h),
+	//with the touch controls drawn beside it if touch mode is enabled
+	info.bmiHeader.biWidth = width;
+	info.bmiHeader.biHeight = -height;
+	screenBuffer.hdc = CreateCompatibleDC(hdc);
+	screenBuffer.bitmap = CreateDIBSection(hdc, &info, DIB_RGB_COLORS, &pixels, NULL, 0);
+	screenBuffer.old = SelectObject(screenBuffer.hdc, screenBuffer.bitmap);
+	screenBuffer.x = width;
+	screenBuffer.y = height;
+	screen = pixels;
+	InitScaler(&scaler, width, height);
+	scaler.bars = touch; //the touch controls fill them
+
+	//The touch controls are drawn around the table, never over it
+	ExcludeClipRect(screenBuffer.hdc, scaler.left, scaler.top, scaler.left + scaler.size, scaler.top + scaler.size);
+
+	if (touch) { //We keep the touch controls that don't move in an extra buffer
+		staticBuffer.hdc = CreateCompatibleDC(hdc);
+		staticBuffer.bitmap = CreateCompatibleBitmap(hdc, width, height);
+		staticBuffer.old = SelectObject(staticBuffer.hdc, staticBuffer.bitmap);
+		staticBuffer.x = width;
+		staticBuffer.y = height;
+		InitTouchLayers(&layers);
+		InitTouchMap(&touchMap, width, height);
 
 		//Tell Windows to send us touch messages
 		RegisterTouchWindow(hWnd, 0);
 	}
+	gdi.layers[LAYER_SCREEN] = screenBuffer.hdc;
+	gdi.layers[LAYER_STATIC] = staticBuffer.hdc;
+	gdi.hdc = screenBuffer.hdc;
 	//Clean it up
 	ReleaseDC(hWnd, hdc);
 
-	//initialize variables
-	score = 0;
-	state = STATE_HOME;
-	mode = MODE_ONE;
-	stateChange = true;
+	//initialize variables, seeding the serves with the time
+	InitGame(&game, time(NULL));
+	SetTickRate(&game, hz);
+	if (!netplay) {
+		SetPhysics(&game, &physics);
+		SetFixed(&game, fixed);
+	}
+	table.paddleHeight = game.physics.paddleHeight;
+	InitIntercept(&game.ai, false, skill, game.seed);
+	previous = game;
+	InitInputQueue(&input);
+
+	//Every tick and state change goes through the recorder, it only costs a
+	//few bytes a second and is only saved with -record
+	InitRecorder(&recorder, &game, 0);
+
+	//Open the network match, the host's seed is the one played
+	if (netplay) {
+		if (!OpenNetplay(&net, netAddress == NULL ? netPort : 0, netAddress, netPort, game.seed, MonotonicClock)) {
+			MessageBox(NULL, "Error: Could not open the network port!", "Pong", MB_ICONEXCLAMATION | MB_OK);
+			return -1;
+		}
+		recordPath = NULL;
+	}
 
-	player2.height = (RESOLUTION + MARGIN) / 2.f;
-	player.height = (RESOLUTION + MARGIN) / 2.f;
+	//Make the fonts, pens and brushes once
+	InitRenderer(&renderer, &GdiBackend, &gdi);
+	SetupDrawing(&renderer, width, height);
 
 	//Hide the cursor
 	ShowCursor(false);
 
-	//Set the update timer
-	SetTimer(hWnd, 1, 10, NULL);
-
 	//Show the window
 	ShowWindow(hWnd, nCmdShow);
 	UpdateWindow(hWnd);
 
+	//The probes cost next to nothing until they are started
+	if (overlay || trace)
+		StartProbes(trace);
+
+	//Start the clocks, never catching up on more than a quarter second of updates
+	InitTimestep(&simulation, hz, hz / 4, MonotonicClock);
+	InitTimestep(&frames, fps, 1, MonotonicClock);
+
+	//Sleep() only wakes on the system tick, 15.6ms unless it is made finer
+	timeBeginPeriod(1);
+
+	//Start the updates and the drawing, the updates first whenever both are due
+	InitHandoff(&handoff, &game);
+	running = true;
+	updater = CreateThread(NULL, 0, Update, NULL, 0, NULL);
+	drawer = CreateThread(NULL, 0, Draw, NULL, 0, NULL);
+	if (updater == NULL || drawer == NULL) {
+		MessageBox(NULL, "Error: Could not start the game!", "Pong", MB_ICONEXCLAMATION | MB_OK);
+		//WM_DESTROY stops the thread that did start
+		DestroyWindow(hWnd);
+		return -1;
+	}
+	SetThreadPriority(updater, THREAD_PRIORITY_ABOVE_NORMAL);
+
 	//Enter the event loop
-	while (GetMessage(&msg, NULL, 0, 0)) {
+	//We only leave it if the process is terminated or closed in some way
+	while (GetMessage(&msg, NULL, 0, 0) > 0) {
 		TranslateMessage(&msg);
 		DispatchMessage(&msg);
 	}
 
-	//We only get to this point if the process is terminated or closed
-	//in some way
 	return msg.wParam;
 }
 
+/*
+ *DWORD WINAPI Update(LPVOID)
+ *This is the update thread. It runs the updates that are due, hands the
+ *match on to the drawing and sleeps until the next update.
+*/
+DWORD WINAPI Update(LPVOID arg) {
+	uint64_t start, due = 0;
+	unsigned int i;
+
+	(void)arg;
+	while (running) {
+		for (i = AdvanceTimestep(&simulation); i > 0; i--) {
+			//How long after it was due this update runs
+			due = TickDue(&simulation, i);
+			if (probing)
+				ProbeValue(PROBE_LATE, MonotonicNow(NULL) - due);
+
+			start = PROBE_START();
+			RunTick(due);
+			PROBE_STOP(PROBE_TICK, start);
+		}
+		if (due != 0)
+			Publish(due);
+		due = 0;
+
+		Sleep((DWORD)((NextTickIn(&simulation) + 999999) / 1000000));
+	}
+
+	return 0;
+}
+
+/*
+ *void Publish(uint64_t)
+ *This function hands the match as of the tick that was due at due on to
+ *the drawing. A state change or input stays marked in every snapshot
+ *until one that has it is drawn, as the drawing may skip some.
+*/
+void Publish(uint64_t due) {
+	Snapshot *s = WriteSnapshot(&handoff);
+
+	if (inputAt != 0 && drawn >= inputFrom)
+		inputAt = 0;
+	if (buttons.changed != 0) {
+		if (inputAt == 0) {
+			inputAt = buttons.changed;
+			inputFrom = handoff.published + 1;
+		}
+		buttons.changed = 0;
+	}
+	if (game.stateChange) {
+		redrawFrom = handoff.published + 1;
+		game.stateChange = false;
+	}
+
+	s->previous = previous;
+	s->current = game;
+	s->due = due;
+	s->tick = simulation.tick;
+	s->inputAt = inputAt;
+	s->changed = redrawFrom > drawn;
+	PublishSnapshot(&handoff);
+}
+
+/*
+ *DWORD WINAPI Draw(LPVOID)
+ *This is the drawing thread. When a frame is due it draws the newest
+ *match if we are playing the ball, ready for a serve, or if the state has
+ *changed, or if Windows lost what was on the screen.
+*/
+DWORD WINAPI Draw(LPVOID arg) {
+	const Snapshot *s;
+	uint64_t shownInput = 0;
+	bool fresh;
+
+	(void)arg;
+	while (running) {
+		if (AdvanceTimestep(&frames) > 0) {
+			s = TakeSnapshot(&handoff, &fresh);
+			if (exposed || (fresh && (s->changed || s->current.state == STATE_PLAY || s->current.state == STATE_READY))) {
+				DrawFrame(s);
+				drawn = s->seq;
+
+				//The input taken by the updates shown is on the screen now
+				if (s->inputAt != 0 && s->inputAt != shownInput) {
+					if (probing)
+						ProbeValue(PROBE_INPUT, MonotonicNow(NULL) - s->inputAt);
+					shownInput = s->inputAt;
+				}
+			}
+		}
+
+		Sleep((DWORD)((NextTickIn(&frames) + 999999) / 1000000));
+	}
+
+	return 0;
+}
+
+/*
+ *void RunTick(uint64_t)
+ *This function runs the game one update with the keys and touches that
+ *came in before it was due
+*/
+void RunTick(uint64_t due) {
+	static InputEvent touches[TOUCH_POOL];
+	unsigned int touched = 0;
+	InputEvent e;
+
+	while (TakeInput(&input, due, &e)) {
+		TrackButtons(&buttons, &e);
+		if (e.type == IN_PRESS)
+			PressButton(e.button);
+		else if (e.type == IN_TOUCH && touch && touched < TOUCH_POOL)
+			touches[touched++] = e;
+	}
+
+	//The touches that came in for this tick all go at once
+	if (touched > 0)
+		ApplyTouches(touches, touched);
+
+	//Over the network the match is whatever the rollback makes of it
+	if (netplay) {
+		int dir = ButtonDir(&buttons, BUTTON_W, BUTTON_S);
+		byte move = dir > 0 ? INPUT_DOWN : (dir < 0 ? INPUT_UP : INPUT_STILL);
+
+		PollNetplay(&net);
+		if (StepNetplay(&net, move | (netAdvance ? NET_ADVANCE : 0))) {
+			previous = game;
+			netAdvance = false;
+		}
+		if (net.started)
+			game = net.rb.game;
+	}
+	else {
+		previous = game;
+		RecordTick(&recorder, &game, ButtonDir(&buttons, BUTTON_W, BUTTON_S), ButtonDir(&buttons, BUTTON_O, BUTTON_L));
+	}
+
+	EndTick(&buttons);
+}
+
+/*
+ *void PressButton(byte)
+ *This function does what a key does on the screen the match is on
+*/
+void PressButton(byte button) {
+	//Over the network space goes out with the next tick
+	if (netplay) {
+		if (button == BUTTON_SPACE)
+			netAdvance = true;
+	} //If we are on the home screen
+	else if (game.state == STATE_HOME) {
+		switch (button) {
+			//Move the cursor up
+			case BUTTON_UP:
+				RecordEvent(&recorder, &game, EVENT_MODE_ONE);
+				break;
+			//Move the cursor down
+			case BUTTON_DOWN:
+				RecordEvent(&recorder, &game, EVENT_MODE_TWO);
+				break;
+			//Use current selection and change state to ready
+			case BUTTON_SPACE:
+				RecordEvent(&recorder, &game, EVENT_ADVANCE);
+				break;
+			default:
+				break;
+		}
+	} //If the game is over or ready to serve the ball and the space bar is pressed
+	else if (button == BUTTON_SPACE) {
+		RecordEvent(&recorder, &game, EVENT_ADVANCE); //change state to home or serve
+	}
+}
+
+/*
+ *int KeyButton(WPARAM)
+ *This function returns the BUTTON_* of a virtual key, -1 for the keys
+ *the game doesn't use
+*/
+int KeyButton(WPARAM key) {
+	switch (key) {
+		case 'W': return BUTTON_W;
+		case 'S': return BUTTON_S;
+		case 'O': return BUTTON_O;
+		case 'L': return BUTTON_L;
+		case VK_UP: return BUTTON_UP;
+		case VK_DOWN: return BUTTON_DOWN;
+		case VK_SPACE: return BUTTON_SPACE;
+		default: return -1;
+	}
+}
+
+/*
+ *void QueueInput(byte, int, short, short)
+ *This function queues an event for the next update, stamped with now
+*/
+void QueueInput(byte type, int button, short x, short y) {
+	InputEvent e;
+
+	if (button < 0)
+		return;
+	e.at = MonotonicNow(NULL);
+	e.type = type;
+	e.button = (byte)button;
+	e.x = x;
+	e.y = y;
+	PushInput(&input, &e);
+}
+
 /*
  *LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM)
  *This is the function that is automatically called by windows to
@@ -229,12 +608,6 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 	//We will switch through the only ones we need and have Windows automatically
 	//deal with the rest.
 	switch (msg) {
-		//The window was just created
-		case WM_CREATE:
-			//Seed the random number generator with the time
-			srand(time());
-		break;
-
 		//The window has been asked to close
 		case WM_CLOSE:
 			DestroyWindow(hWnd);
@@ -242,122 +615,91 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 
 		case WM_TOUCH:
 			if (touch)
-				ProcessTouch(hWnd, wParam, lParam, &player, &player2, width, height);
+				ProcessTouch(wParam, lParam);
 
 				return DefWindowProc(hWnd, msg, wParam, lParam);
 		break;
 
 		//The program is closing
 		case WM_DESTROY:
+			//Let the updates and the drawing finish first, every way out comes through here
+			running = false;
+			if (updater != NULL) {
+				WaitForSingleObject(updater, INFINITE);
+				CloseHandle(updater);
+			}
+			if (drawer != NULL) {
+				WaitForSingleObject(drawer, INFINITE);
+				CloseHandle(drawer);
+			}
+			timeEndPeriod(1);
+
+			if (recordPath != NULL) {
+				FILE *file = fopen(recordPath, "ab");
+
+				if (file != NULL) {
+					SaveReplay(&recorder, &game, file);
+					fclose(file);
+				}
+			}
+			FreeRecorder(&recorder);
+			if (touchTrace != NULL)
+				fclose(touchTrace);
+			if (netplay)
+				CloseNetplay(&net);
+			FreeRenderer(&renderer);
+			FreeFrameEncoder(&presented);
+
 			SelectObject(gameBuffer.hdc, gameBuffer.old);
 			DeleteObject(gameBuffer.bitmap);
 			DeleteDC(gameBuffer.hdc);
 
+			SelectObject(screenBuffer.hdc, screenBuffer.old);
+			DeleteObject(screenBuffer.bitmap);
+			DeleteDC(screenBuffer.hdc);
+
 			if (touch) {
-				SelectObject(touchBuffer.hdc, touchBuffer.old);
-				DeleteObject(touchBuffer.bitmap);
-				DeleteDC(touchBuffer.hdc);
+				SelectObject(staticBuffer.hdc, staticBuffer.old);
+				DeleteObject(staticBuffer.bitmap);
+				DeleteDC(staticBuffer.hdc);
 			}
 			PostQuitMessage(0);
 		break;
 
-		//If a key has been pressed down
+		//If a key has been pressed down, not repeating
 		case WM_KEYDOWN:
-			//If escape is pressed at any time, exit the program
+			//If escape is pressed at any time, exit the program the same way
+			//closing the window does, so that the replay is saved
 			if (wParam == VK_ESCAPE) {
-				PostQuitMessage(0);
+				PostMessage(hWnd, WM_CLOSE, 0, 0);
 				return 0;
-			} //If we are on the home screen
-			else if (state == STATE_HOME) {
-				switch (wParam) {
-					//Move the cursor up
-					case VK_UP:
-						mode = MODE_ONE;
-						stateChange = true;
-						break;
-					//Move the cursor down
-					case VK_DOWN:
-						mode = MODE_TWO;
-						stateChange = true;
-						break;
-					//Use current selection and change state to ready
-					case VK_SPACE:
-						state = STATE_READY;
-						stateChange = true;
-						score = 0;
-						break;
-					default:
-						break;
-				}
-			} //If the game is over and the space bar is pressed
-			else if (state == STATE_END && wParam == VK_SPACE) {
-				state = STATE_HOME; //change state to home
-				stateChange = true;
-			} //If the game is ready to serve the ball and the space bar is pressed
-			else if (state == STATE_READY && wParam == VK_SPACE) {
-				state = STATE_SERVE; //change state to serve
-				stateChange = true;
 			}
+			if (!(lParam & (1 << 30)))
+				QueueInput(IN_PRESS, KeyButton(wParam), 0, 0);
 		break;
 
-		//The timer has expired
-		case WM_TIMER:
-			//If we are not on the home screen
-			//We will udpate the player paddles
-			//When the appropriate keys are pressed
-			if (state != STATE_HOME) {
-				player.height += PLAYER_SPEED * (!!(GetAsyncKeyState('S') & 0x8000) - !!(GetAsyncKeyState('W') & 0x8000));
-				player.height = CLAMP(player.height, MARGIN + PADDLEHEIGHT / 2.f + 1, RESOLUTION - PADDLEHEIGHT / 2.f);
-
-				if(mode == MODE_TWO) {
-					player2.height += PLAYER_SPEED * (!!(GetAsyncKeyState('L') & 0x8000) - !!(GetAsyncKeyState('O') & 0x8000));
-					player2.height = CLAMP(player2.height, MARGIN + PADDLEHEIGHT / 2.f + 1, RESOLUTION - PADDLEHEIGHT / 2.f);
-				}
-			}
-
-			//Update based on state
-			if (state == STATE_SERVE) {
-				ServeBall(&ball);
-				UpdateBall(&ball, player, player2);
-			}
-			else if (state == STATE_PLAY) {
-				UpdateBall(&ball, player, player2);
-				if (mode == MODE_ONE) //Update the AI if it's a single player game
-					UpdateAI(&player2, ball);
-			}
-
-			//Tell windows the screen needs to be redrawn
-			//if we are playing the ball, ready for a serve, or if the state has changed
-			if (stateChange || state == STATE_PLAY || state == STATE_READY) {
-				InvalidateRect(hWnd, NULL, 0);
-				stateChange = false;
-			}
+		case WM_KEYUP:
+			QueueInput(IN_RELEASE, KeyButton(wParam), 0, 0);
+		break;
 
-			//Reset the timer
-			SetTimer(hWnd, 1, 10, NULL);
+		//Keys let go of in another window never come up here
+		case WM_KILLFOCUS:
+			QueueInput(IN_RESET, 0, 0, 0);
 		break;
 
-		//The window needs to be redrawn
+		//Windows lost what was on the screen, the next paint has to be whole
+		case WM_ERASEBKGND:
+			exposed = true;
+			return DefWindowProc(hWnd, msg, wParam, lParam);
+
+		//The window needs to be redrawn, the drawing thread does it whole
 		case WM_PAINT:
 		{
-			//Create the back buffer for flicker-free drawing
 			PAINTSTRUCT ps;
-			HDC hdc = BeginPaint(hWnd, &ps);
-
-			//Render the game on the back buffer
-			DrawTable(gameBuffer.hdc, ball, player, player2, score, state, mode);
-
-			//Render the touch controls if touch mode is enabled
-			if (touch) {
-				DrawTouchControls(touchBuffer.hdc, width, height, state, mode, player, player2);
-				StretchBlt(touchBuffer.hdc, (width - height) / 2, 0, height, height, gameBuffer.hdc, 0, 0, RESOLUTION, RESOLUTION, SRCCOPY);
-				BitBlt(hdc, 0, 0, width, height, touchBuffer.hdc, 0, 0, SRCCOPY);
-
-			}
-			else
-				StretchBlt(hdc, (width - height) / 2, 0, height, height, gameBuffer.hdc, 0, 0, RESOLUTION, RESOLUTION, SRCCOPY);
 
+			BeginPaint(hWnd, &ps);
 			EndPaint(hWnd, &ps);
+			exposed = true;
 		}
 		break;
 
@@ -372,431 +714,290 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 }
 
 /*
- *void UpdateAI(Paddle*, Ball)
- *This function updates the AI paddle position based on the height of the ball
- *It will attempt to exactly match the height of the ball at all times
- *but is limited in maximum speed by the value of AI_SPEED
+ *void ProcessTouch(WPARAM, LPARAM)
+ *This function processes Windows touch messages, queueing every point
+ *(up to TOUCH_POOL) as one batch with the same time without allocating
+ *anything, and adds them to the touch trace with -touchtrace. A batch the
+ *queue has no room for is dropped whole, the next message has the same
+ *fingers again.
 */
-void UpdateAI(Paddle *AI, Ball b) {
-	float speed = b.y - AI->height, height;
+void ProcessTouch(WPARAM wParam, LPARAM lParam) {
+	static TOUCHINPUT points[TOUCH_POOL];
+	static InputEvent batch[TOUCH_POOL];
+	UINT nPoints = min(LOWORD(wParam), TOUCH_POOL), i;
+	uint64_t now = MonotonicNow(NULL);
 
-	if (state < STATE_SERVE)
+	if (!GetTouchInputInfo((HTOUCHINPUT)lParam, nPoints, points, sizeof(TOUCHINPUT)))
 		return;
 
-	speed = CLAMP(speed, -AI_SPEED, AI_SPEED); //Limit the speed
-
-	height = AI->height + speed;
-	
-	AI->height = CLAMP(height, MARGIN + PADDLEHEIGHT/2.f, RESOLUTION - PADDLEHEIGHT/2.f); //Keep the paddle on the table
-}
-
-/*
- *void ServeBall(Ball*)
- *This function serves the ball towards one side at random
- *with a random angle and a set speed of BALLSPEED
-*/
-void ServeBall(Ball *b) {
-	float theta;
-
-	b->x = RESOLUTION / 2.f;
-	b->y = (RESOLUTION - MARGIN) / 2.f + MARGIN;
-
-	theta = (rand() % 90 - 45 + 180*(rand() % 2)) * 3.14f / 180.f;
-
-	b->vx = (BALLSPEED / 100.f) * cos(theta);
-	b->vy = (BALLSPEED / 100.f) * sin(theta);
-
-	state = STATE_PLAY;
-	stateChange = true;
+	//Every point of the message has the same time and they are pushed at once, so they are taken by the same update
+	for (i = 0; i < nPoints; i++) {
+		batch[i].at = now;
+		batch[i].type = IN_TOUCH;
+		batch[i].button = 0;
+		batch[i].x = (short)(points[i].x / 100);
+		batch[i].y = (short)(points[i].y / 100);
+	}
+	PushInputs(&input, batch, nPoints);
+	if (touchTrace != NULL)
+		WriteTouchTrace(touchTrace, batch, nPoints);
 }
 
 /*
- *void ApplyEnglish(Ball *b, Paddle p)
- *This function simulates the application of english (curve)
- *to the ball based on where the ball strikes the paddle
+ *void ApplyTouches(const InputEvent*, unsigned int)
+ *This function does what a batch of touches does on the screen the match
+ *is on: the sliders follow the last finger on them and each button is
+ *pressed once
 */
-void ApplyEnglish(Ball *b, Paddle p) {
-	float english;
-
-	english = -(p.height - b->y)*ENGLISHSCALE / 100;
-
-	b->vy += english;
+void ApplyTouches(const InputEvent *points, unsigned int count) {
+	TouchActions a;
+
+	ResolveTouches(&touchMap, points, count, game.state, game.mode, &a);
+
+	if (a.slid[0])
+		SliderToPaddle(a.slider[0], &game.player, game.physics.paddleHeight, width, height);
+	if (a.slid[1])
+		SliderToPaddle(a.slider[1], &game.player2, game.physics.paddleHeight, width, height);
+	if (a.pressed & (1 << WIDGET_GO | 1 << WIDGET_GO_HOME))
+		RecordEvent(&recorder, &game, EVENT_ADVANCE);
+	if (a.pressed & 1 << WIDGET_MODE_ONE)
+		RecordEvent(&recorder, &game, EVENT_MODE_ONE);
+	else if (a.pressed & 1 << WIDGET_MODE_TWO)
+		RecordEvent(&recorder, &game, EVENT_MODE_TWO);
+	if (a.pressed & 1 << WIDGET_CLOSE)
+		PostMessage(window, WM_CLOSE, 0, 0);
 }
 
 /*
- *void UpdateBall(Ball*, Paddle, Paddle)
- *This function updates the position of the ball based its velocity
- *and handles collisions with the sides and paddles. It also detects when a
- *player has scored and updates the score accordingly. Additionally, it will
- *detect when the game is over and switches the state accordingly.
+ *void DrawFrame(const Snapshot*)
+ *This function draws a snapshot of the match on the screen
 */
-void UpdateBall(Ball *b, Paddle player, Paddle player2) {
-	b->x += b->vx;
-	b->y += b->vy;
-
-	//Detect vertical collisions
-	if (b->y < (BALLSIZE + MARGIN)) {
-		b->y += 2*((BALLSIZE + MARGIN) - b->y);
-		b->vy = -b->vy;
-	}
-	else if (b->y > (RESOLUTION - BALLSIZE + 1)) {
-		b->y += 2 * ((RESOLUTION - BALLSIZE + 1) - b->y);
-		b->vy = -b->vy;
+void DrawFrame(const Snapshot *s) {
+	HDC hdc = GetDC(window);
+	Game shown;
+	Rect rects[TOUCH_MAX_RECTS + SCALE_MAX_RECTS];
+	unsigned int count = 0, k;
+	uint64_t paint = PROBE_START(), start;
+
+	//Draw the match between the last two updates
+	BlendGame(&s->previous, &s->current, SnapshotAlpha(s, MonotonicNow(NULL)), &shown);
+
+	//Only remakes the fonts, pens and brushes if the resolution changed
+	SetupDrawing(&renderer, width, height);
+
+	//Render the game on the back buffer
+	start = PROBE_START();
+	DrawTable(&table, shown.ball, shown.player, shown.player2, shown.score, shown.state, shown.mode);
+	if (overlay)
+		DrawOverlay(&table);
+	PROBE_STOP(PROBE_TABLE, start);
+
+	//Bring the touch controls beside the table up to date if touch mode is enabled,
+	//most frames only a knob moves
+	if (touch) {
+		start = PROBE_START();
+		count = ComposeTouchControls(&layers, &renderer, width, height, shown.state, shown.mode, shown.player, shown.player2, shown.physics.paddleHeight, rects);
+		GdiFlush();
+		PROBE_STOP(PROBE_TOUCH, start);
 	}
 
-	//Detect paddle collisions and out of bounds conditions (scores)
-	if (b->x < PADDLEWIDTH) {
-		//If the ball hit the paddle
-		if (b->y >= (player.height - PADDLEHEIGHT / 2.f - BALLSIZE) && b->y <= (player.height + PADDLEHEIGHT / 2.f + BALLSIZE)) {
-			b->x += 2 * (PADDLEWIDTH - b->x); //Make it bounce
-			b->vx = -b->vx;
-			ApplyEnglish(b, player); //Apply english
-		}
-		else { //The opposing player scored!
-			score = MAKE_SCORE(PLAYER_SCORE(score), PLAYER2_SCORE(score) + 1); //Update the score
-			if (PLAYER2_SCORE(score) >= MAXSCORE) { //If the game is over
-				state = STATE_END; //Switch to end of game state
-				stateChange = true;
-			}
-			else { //Otherwise
-				state = STATE_READY; //Switch to ready state
-				stateChange = true;
-			}
-		}
+	//Only the tiles that changed since the last frame are scaled and blitted with
+	//the controls that changed, and all of the screen buffer when Windows lost what
+	//was on the screen
+	start = PROBE_START();
+	k = presented.previous != NULL ? DiffFrame(&presented, table.pixels) : TILE_COUNT;
+	count += ScaleFrame(&scaler, table.pixels, screen, width, k == TILE_COUNT ? NULL : presented.dirty, rects + count);
+	if (exposed) {
+		exposed = false;
+		BitBlt(hdc, 0, 0, width, height, screenBuffer.hdc, 0, 0, SRCCOPY);
 	}
-	else if (b->x > (RESOLUTION - PADDLEWIDTH)) {
-		if (b->y >= (player2.height - PADDLEHEIGHT / 2.f - BALLSIZE) && b->y <= (player2.height + PADDLEHEIGHT / 2.f + BALLSIZE)) {
-			b->x += 2 * ((RESOLUTION - PADDLEWIDTH) - b->x);
-			b->vx = -b->vx;
-			ApplyEnglish(b, player2);
-		}
-		else {
-			score = MAKE_SCORE(PLAYER_SCORE(score) + 1, PLAYER2_SCORE(score));
-			if (PLAYER_SCORE(score) >= MAXSCORE) {
-				state = STATE_END;
-				stateChange = true;
-			}
-			else {
-				state = STATE_READY;
-				stateChange = true;
-			}
-		}
+	else {
+		for (k = 0; k < count; k++)
+			BitBlt(hdc, rects[k].left, rects[k].top, rects[k].right - rects[k].left, rects[k].bottom - rects[k].top,
+				screenBuffer.hdc, rects[k].left, rects[k].top, SRCCOPY);
 	}
+	PROBE_STOP(PROBE_PRESENT, start);
+
+	ReleaseDC(window, hdc);
+	PROBE_STOP(PROBE_PAINT, paint);
 }
 
 /*
- *void ScoreToStrs(byte, char*, char*)
- *This function converts the byte containing both scores into two
- *strings representing the scores. The strings will always be two digits
- *long (e.g. 0 -> '00' and 7 -> '07').
+ *void DrawTable(Raster*, Ball, Paddle, Paddle, uint16_t, byte, byte)
+ *This function draws the game for every state. The raster has to be on
+ *the pixels of the game buffer's bitmap.
 */
-void ScoreToStrs(byte score, char *pStr, char *player2Str) {
-	byte pScore = PLAYER_SCORE(score), player2Score = PLAYER2_SCORE(score); //unpack the scores
+void DrawTable(Raster *r, Ball b, Paddle player, Paddle player2, uint16_t score, byte state, byte mode) {
+	//Make sure GDI is done with the pixels before we touch them
+	GdiFlush();
 
-	pStr[0] = (pScore / 10) + '0';
-	pStr[1] = (pScore % 10) + '0';
-	pStr[2] = NULL;
+	//The text is only drawn when it changes
+	RasterTableText(r, score, state, mode);
 
-	player2Str[0] = (player2Score / 10) + '0';
-	player2Str[1] = (player2Score % 10) + '0';
-	player2Str[2] = NULL;
+	//Draw the paddles and the ball
+	RasterTable(r, b, player, player2, state);
 }
 
-
 /*
- *void DrawTableText(HDC, HFONT, unsigned short, unsigned short, unsigned short, unsigned short, byte, char*)
- *This function will draw text at a specified location
+ *void DrawOverlay(Raster*)
+ *This function writes the update and redraw times above the table, four
+ *times a second. It is padded to the whole width so it covers the last one.
 */
-void DrawTableText(HDC hdc, HFONT font, unsigned short x, unsigned short y, unsigned short width, unsigned short height, byte format, char *str) {
-	RECT r;
-	HFONT oldFont;
+void DrawOverlay(Raster *r) {
+	char line[64];
+	uint64_t now = MonotonicNow(NULL);
+	size_t len;
 
-	r.bottom = y + height;
-	r.left = x;
-	r.right = x + width;
-	r.top = y;
-
-	oldFont = SelectObject(hdc, font);
+	if (now - overlayAt < NS_PER_SECOND / 4)
+		return;
+	overlayAt = now;
 
-	DrawText(hdc, str, -1, &r, format);
+	sprintf(line, "t%u/%u p%u/%u d%u",
+		(unsigned int)min(ProbePercentile(PROBE_TICK, 0.5) / 1000, 99999), (unsigned int)min(ProbePercentile(PROBE_TICK, 0.99) / 1000, 99999),
+		(unsigned int)min(ProbePercentile(PROBE_PAINT, 0.5) / 1000, 99999), (unsigned int)min(ProbePercentile(PROBE_PAINT, 0.99) / 1000, 99999),
+		(unsigned int)min(simulation.dropped, 99999));
+	for (len = strlen(line); len < RESOLUTION / GLYPH_ADVANCE; len++)
+		line[len] = ' ';
+	line[RESOLUTION / GLYPH_ADVANCE] = '\0';
 
-	SelectObject(hdc, oldFont);
+	RasterText(r, 0, MARGIN - GLYPH_HEIGHT - 2, RESOLUTION, 1, ALIGN_LEFT, line);
 }
 
 /*
- *void PaddleToSlider(Paddle, unsigned short, unsigned short)
- *This function coverts the paddle position into a touch slider position
+ *The GDI backend of the renderer
+ *Brushes, pens and fonts are made once by the renderer and kept here.
+ *Filled styles get a brush and the null pen, line styles a pen and the null brush.
 */
-int PaddleToSlider(Paddle p, unsigned short width, unsigned short height) {
-	unsigned short margin = (width - height) / 2;
+bool GdiMakeStyle(void *ctx, byte id, const Style *style) {
+	Gdi *gdi = ctx;
+
+	if (gdi->nullPen == NULL)
+		gdi->nullPen = CreatePen(PS_NULL, 0, 0x00000000);
 
-	return height / 3 + height / 3 * (p.height - MARGIN - PADDLEHEIGHT / 2) / (RESOLUTION - MARGIN - PADDLEHEIGHT);
+	if (style->lineWidth == 0) {
+		gdi->brushes[id] = CreateSolidBrush(style->color);
+		gdi->pens[id] = gdi->nullPen;
+	}
+	else {
+		gdi->brushes[id] = GetStockObject(NULL_BRUSH);
+		gdi->pens[id] = CreatePen(PS_SOLID, style->lineWidth, style->color);
+	}
+
+	return gdi->brushes[id] != NULL && gdi->pens[id] != NULL;
 }
 
-/*
- *void SliderToPaddle(unsigned short, Paddle*, unsigned short, unsigned short)
- *This function converts the touch slider position into a paddle position
-*/
-void SliderToPaddle(unsigned short slider, Paddle *p, unsigned short width, unsigned short height) {
-	unsigned short margin = (width - height) / 2;
-	
-	p->height = 3 * (RESOLUTION - MARGIN - PADDLEHEIGHT)*(slider - height / 3) / height + MARGIN + PADDLEHEIGHT / 2;
+bool GdiMakeFont(void *ctx, byte id, const FontDesc *font) {
+	Gdi *gdi = ctx;
+
+	gdi->fonts[id] = CreateFontA(font->height, 0, 0, 0, 0, false, false, false, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
+		(font->flags & FONT_SMOOTH) ? ANTIALIASED_QUALITY : NONANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, font->face);
+	gdi->fontFlags[id] = font->flags;
 
+	return gdi->fonts[id] != NULL;
 }
 
-/*
- *void DrawTouchControls(hdc, unsigned short, unsigned short, byte, byte, Paddle, Paddle)
- *This function will draw the touch controls onto the left and right edge
- *of the screen for every game state
-*/
-void DrawTouchControls(HDC hdc, unsigned short width, unsigned short height, byte state, byte mode, Paddle player1, Paddle player2) {
-	HBRUSH oldBrush, redBrush = CreateSolidBrush(0x000000FF), goldBrush = CreateSolidBrush(0x0000D7FF);
-	HPEN oldPen, nullPen = CreatePen(PS_NULL, 0, 0x00000000), whitePen = CreatePen(PS_SOLID, height*TOUCH_WIDTH/5, 0x00FFFFFF);
-	HFONT oldFont, font = CreateFontA(height/15, 0, 0, 0, 0, 0, 0, 0, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Calibri");
-	unsigned short margin = (width - height) / 2, slider;
-	RECT r;
-	
-	r.bottom = height;
-	r.left = 0;
-	r.right = width;
-	r.top = 0;
-	
-	FillRect(hdc, &r, GetStockObject(BLACK_BRUSH));
-
-	SetTextColor(hdc, 0x00FFFFFF);
-	SetBkMode(hdc, TRANSPARENT);
-
-	if (state == STATE_READY || state == STATE_SERVE || state == STATE_PLAY) {
-		oldBrush = SelectObject(hdc, GetStockObject(GRAY_BRUSH));
-		oldPen = SelectObject(hdc, nullPen);
-
-		slider = PaddleToSlider(player1, width, height);
-
-		Rectangle(hdc, margin / 2 - margin*TOUCH_WIDTH, height * 1 / 3, margin / 2 + margin*TOUCH_WIDTH, height * 2 / 3);
-		SelectObject(hdc, redBrush);
-		Ellipse(hdc,
-			margin / 2 - 5 * margin*TOUCH_WIDTH,
-			slider - 5 * margin*TOUCH_WIDTH,
-			margin / 2 + 5 * margin*TOUCH_WIDTH,
-			slider + 5 * margin*TOUCH_WIDTH);
-			
-		if (mode == MODE_TWO) {
-			slider = PaddleToSlider(player2, width, height);
-
-			SelectObject(hdc, GetStockObject(GRAY_BRUSH));
-			Rectangle(hdc, width - margin / 2 - margin*TOUCH_WIDTH, height * 1 / 3, width - margin / 2 + margin*TOUCH_WIDTH, height * 2 / 3);
-			SelectObject(hdc, goldBrush);
-			Ellipse(hdc,
-				width - margin / 2 - 5 * margin*TOUCH_WIDTH,
-				slider - 5 * margin*TOUCH_WIDTH,
-				width - margin / 2 + 5 * margin*TOUCH_WIDTH,
-				slider + 5 * margin*TOUCH_WIDTH);
-		}
-		SelectObject(hdc, oldBrush);
-		SelectObject(hdc, oldPen);
-	}
+void GdiFreeResources(void *ctx) {
+	Gdi *gdi = ctx;
+	byte i;
 
-	if (state != STATE_SERVE && state != STATE_PLAY) {
-		short buttonShift = height / 30 - height / 15 * (state == STATE_HOME);
-		oldFont = SelectObject(hdc, font);
-		oldPen = SelectObject(hdc, nullPen);
-		oldBrush = SelectObject(hdc, GetStockObject(GRAY_BRUSH));
-
-		Rectangle(hdc, margin*TOUCH_WIDTH, 
-			buttonShift + height / 2 - height / 30, 
-			margin*TOUCH_WIDTH + margin / 4, 
-			buttonShift + height / 2 + height / 30);
-		DrawTableText(hdc, font, margin*TOUCH_WIDTH, buttonShift + height / 2 - height / 30, margin*TOUCH_WIDTH + margin / 4, height / 15, DT_CENTER | DT_VCENTER, "Go!");
-		
-		SelectObject(hdc, oldFont);
-		SelectObject(hdc, oldPen);
-		SelectObject(hdc, oldBrush);
+	//Deleting stock objects is harmless
+	for (i = 0; i < MAX_STYLES; i++) {
+		if (gdi->brushes[i] != NULL)
+			DeleteObject(gdi->brushes[i]);
+		if (gdi->pens[i] != NULL && gdi->pens[i] != gdi->nullPen)
+			DeleteObject(gdi->pens[i]);
+		gdi->brushes[i] = NULL;
+		gdi->pens[i] = NULL;
 	}
-	if (state == STATE_HOME) {
-		oldPen = SelectObject(hdc, nullPen);
-		oldBrush = SelectObject(hdc, GetStockObject(GRAY_BRUSH));
-
-		Rectangle(hdc, margin / 2 - 5 * margin*TOUCH_WIDTH,
-			height / 2 - 11 * margin*TOUCH_WIDTH,
-			margin / 2 + 5 * margin*TOUCH_WIDTH,
-			height / 2 - margin*TOUCH_WIDTH);
-		Rectangle(hdc, margin / 2 - 5 * margin*TOUCH_WIDTH,
-			height / 2 + 1 * margin*TOUCH_WIDTH,
-			margin / 2 + 5 * margin*TOUCH_WIDTH,
-			height / 2 + 11 * margin*TOUCH_WIDTH);
-
-		SelectObject(hdc, whitePen);
-
-		MoveToEx(hdc, margin / 2 - 4 * margin*TOUCH_WIDTH, height / 2 - 2*margin*TOUCH_WIDTH, NULL);
-		LineTo(hdc, margin / 2, height / 2 - 10 * margin*TOUCH_WIDTH);
-		LineTo(hdc, margin / 2 + 4 * margin*TOUCH_WIDTH, height / 2 - 2*margin*TOUCH_WIDTH);
-
-		MoveToEx(hdc, margin / 2 - 4 * margin*TOUCH_WIDTH, height / 2 + 2*margin*TOUCH_WIDTH, NULL);
-		LineTo(hdc, margin / 2, height / 2 + 10 * margin*TOUCH_WIDTH);
-		LineTo(hdc, margin / 2 + 4 * margin*TOUCH_WIDTH, height / 2 + 2*margin*TOUCH_WIDTH);
-
-		SelectObject(hdc, oldPen);
-		SelectObject(hdc, oldBrush);
+	for (i = 0; i < MAX_FONTS; i++) {
+		if (gdi->fonts[i] != NULL)
+			DeleteObject(gdi->fonts[i]);
+		gdi->fonts[i] = NULL;
 	}
+	if (gdi->nullPen != NULL)
+		DeleteObject(gdi->nullPen);
+	gdi->nullPen = NULL;
+}
 
-	oldBrush = SelectObject(hdc, GetStockObject(GRAY_BRUSH));
-	oldPen = SelectObject(hdc, nullPen);
-	
-	Rectangle(hdc, margin*TOUCH_WIDTH,
-		height - margin*TOUCH_WIDTH - height / 15,
-		margin*TOUCH_WIDTH + height/7,
-		height - margin*TOUCH_WIDTH);
-	DrawTableText(hdc, font, margin*TOUCH_WIDTH, height - margin*TOUCH_WIDTH - height / 15, height / 7, height / 15, DT_VCENTER | DT_CENTER, "Close");
-
-	DeleteObject(redBrush);
-	DeleteObject(goldBrush);
-	DeleteObject(nullPen);
-	DeleteObject(whitePen);
-	DeleteObject(font);
+void GdiClear(void *ctx, int left, int top, int right, int bottom) {
+	RECT r;
+
+	r.left = left;
+	r.top = top;
+	r.right = right;
+	r.bottom = bottom;
+
+	FillRect(((Gdi*)ctx)->hdc, &r, GetStockObject(BLACK_BRUSH));
 }
 
-/*
- *void ProcessTouch(HWND, WPARAM, LPARAM, Paddle *, Paddle*, unsigned short, unsigned short)
- *This function processes Windows touch messages
-*/
-void ProcessTouch(HWND hWnd, WPARAM wParam, LPARAM lParam, Paddle *player1, Paddle* player2, unsigned short width, unsigned short height) {
-	UINT nPoints = LOWORD(wParam), i, slider1 = PaddleToSlider(*player1, width, height),
-		slider2 = PaddleToSlider(*player2, width, height), margin = (width - height) / 2;
-	PTOUCHINPUT points = malloc(sizeof(TOUCHINPUT) * nPoints);
-	short buttonShift = height / 30 - height / 15 * (state == STATE_HOME);
-	
-	//Uh oh...
-	if (points == NULL)
-		return;
+void GdiBox(void *ctx, byte style, int left, int top, int right, int bottom) {
+	Gdi *gdi = ctx;
+	HBRUSH oldBrush = SelectObject(gdi->hdc, gdi->brushes[style]);
+	HPEN oldPen = SelectObject(gdi->hdc, gdi->pens[style]);
 
-	GetTouchInputInfo((HTOUCHINPUT)lParam, nPoints, points, sizeof(TOUCHINPUT));
-	for (i = 0; i < nPoints; i++) {
-		TOUCHINPUT point = points[i];
-		point.x /= 100;
-		point.y /= 100;
-
-		if (state == STATE_READY || state == STATE_SERVE || state == STATE_PLAY) {
-			if ((point.x >= (margin / 2 - 10 * TOUCH_WIDTH*margin)) && (point.x <= (margin / 2 + 10 * TOUCH_WIDTH*margin)) &&
-				(point.y >= (height / 3)) && (point.y <= (height * 2 / 3))) {
-				SliderToPaddle(point.y, player1, width, height);
-			}
-			else if ((mode == MODE_TWO) && (point.x >= (width - margin / 2 - 10 * TOUCH_WIDTH*margin)) && (point.x <= (width - margin / 2 + 10 * TOUCH_WIDTH*margin)) &&
-				(point.y >= (height / 3)) && (point.y <= (height * 2 / 3))) {
-				SliderToPaddle(point.y, player2, width, height);
-			}
-		}
-		if (state != STATE_PLAY && state != STATE_SERVE && (point.x >= (margin*TOUCH_WIDTH)) && (point.x <= (margin*TOUCH_WIDTH + margin / 4)) &&
-				(point.y >= (height / 2 - height / 30 + buttonShift)) && (point.y <= (height / 2 + height / 30 + buttonShift))) {
-			switch (state) {
-			case STATE_HOME:
-				state = STATE_READY;
-				score = 0;
-				break;
-			case STATE_READY:
-				state = STATE_SERVE;
-				break;
-			case STATE_END:
-				state = STATE_HOME;
-				break;
-			}
-			stateChange = true;
-		}
-		if (state == STATE_HOME) {
-			if ((point.x >= (margin / 2 - 5 * margin*TOUCH_WIDTH)) && (point.x <= (margin / 2 + 5 * margin*TOUCH_WIDTH)) &&
-				(point.y >= (height / 2 - 11 * margin*TOUCH_WIDTH)) && (point.y <= (height / 2 - margin*TOUCH_WIDTH))) {
-				mode = MODE_ONE;
-				stateChange = true;
-			}
-			else if ((point.x >= (margin / 2 - 5 * margin*TOUCH_WIDTH)) && (point.x <= (margin / 2 + 5 * margin*TOUCH_WIDTH)) &&
-				(point.y >= (height / 2 + margin*TOUCH_WIDTH)) && (point.y <= (height / 2 + 11 * margin*TOUCH_WIDTH))) {
-				mode = MODE_TWO;
-				stateChange = true;
-			}
-		}
-		if ((point.x >= (margin*TOUCH_WIDTH)) && (point.x <= (margin*TOUCH_WIDTH + margin / 3)) &&
-			(point.y >= (height - margin*TOUCH_WIDTH - height / 15)) && (point.y <= (height - margin*TOUCH_WIDTH))) {
-			DestroyWindow(hWnd);
-		}
-	}
+	Rectangle(gdi->hdc, left, top, right, bottom);
+
+	SelectObject(gdi->hdc, oldBrush);
+	SelectObject(gdi->hdc, oldPen);
 }
 
-/*
- *void DrawTable(HDC, Ball, Paddle, Paddle, byte, byte, byte)
- *This function draws the game for every state
-*/
-void DrawTable(HDC hdc, Ball b, Paddle player, Paddle player2, byte score, byte state, byte mode) {
-	byte i;
-	char pStr[3], player2Str[3];
-	HBRUSH brush = GetStockObject(WHITE_BRUSH), oldBrush;
-	HPEN pen = CreatePen(PS_NULL, 1, 0x00000000), oldPen, whitePen = GetStockObject(WHITE_PEN);
-	HFONT bigFont = CreateFontA(20, 0, 0, 0, 0, false, false, false, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, NONANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Courier New");
-	HFONT smallFont = CreateFontA(15, 0, 0, 0, 0, false, false, false, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, NONANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Courier New");
-	RECT r;
+void GdiEllipse(void *ctx, byte style, int left, int top, int right, int bottom) {
+	Gdi *gdi = ctx;
+	HBRUSH oldBrush = SelectObject(gdi->hdc, gdi->brushes[style]);
+	HPEN oldPen = SelectObject(gdi->hdc, gdi->pens[style]);
 
-	r.bottom = RESOLUTION;
-	r.left = 0;
-	r.right = RESOLUTION;
-	r.top = 0;
+	Ellipse(gdi->hdc, left, top, right, bottom);
 
-	//Sets text appearance
-	SetBkColor(hdc, 0x00000000);
-	SetTextColor(hdc, 0x00FFFFFF);
+	SelectObject(gdi->hdc, oldBrush);
+	SelectObject(gdi->hdc, oldPen);
+}
 
-	//Fill the screen with black
-	FillRect(hdc, &r, GetStockObject(BLACK_BRUSH));
+void GdiLines(void *ctx, byte style, const int *points, byte count) {
+	Gdi *gdi = ctx;
+	HPEN oldPen = SelectObject(gdi->hdc, gdi->pens[style]);
+	byte i;
 
-	//Use a white brush
-	oldBrush = SelectObject(hdc, brush);
-	//Use a white pen
-	oldPen = SelectObject(hdc, whitePen);
+	MoveToEx(gdi->hdc, points[0], points[1], NULL);
+	for (i = 1; i < count; i++)
+		LineTo(gdi->hdc, points[2*i], points[2*i + 1]);
 
-	//Draw the top and bottom table borders
-	MoveToEx(hdc, 0, MARGIN, NULL);
-	LineTo(hdc, RESOLUTION, MARGIN);
-	MoveToEx(hdc, 0, RESOLUTION - 1, NULL);
-	LineTo(hdc, RESOLUTION, RESOLUTION - 1);
+	SelectObject(gdi->hdc, oldPen);
+}
 
-	//Use an invisible pen
-	SelectObject(hdc, pen);
-	
-	//Always draw both paddles
-	Rectangle(hdc, 0, player.height - PADDLEHEIGHT / 2, PADDLEWIDTH, player.height + PADDLEHEIGHT / 2);
-	Rectangle(hdc, RESOLUTION - PADDLEWIDTH, player2.height - PADDLEHEIGHT / 2, RESOLUTION, player2.height + PADDLEHEIGHT / 2);
+void GdiText(void *ctx, byte font, int x, int y, int width, int height, byte format, const char *str) {
+	Gdi *gdi = ctx;
+	HFONT oldFont;
+	RECT r;
 
-	//Always draw the screen
-	for (i = MARGIN + MESHSIZE/2; i < (RESOLUTION - MESHSIZE); i += 2 * MESHSIZE) {
-		Rectangle(hdc, RESOLUTION / 2 - NETWIDTH / 2, i, RESOLUTION / 2 + NETWIDTH / 2, i + MESHSIZE);
+	r.bottom = y + height;
+	r.left = x;
+	r.right = x + width;
+	r.top = y;
+
+	SetTextColor(gdi->hdc, 0x00FFFFFF);
+	if (gdi->fontFlags[font] & FONT_CLEAR)
+		SetBkMode(gdi->hdc, TRANSPARENT);
+	else {
+		SetBkMode(gdi->hdc, OPAQUE);
+		SetBkColor(gdi->hdc, 0x00000000);
 	}
 
-	ScoreToStrs(score, pStr, player2Str);
+	oldFont = SelectObject(gdi->hdc, gdi->fonts[font]);
 
-	DrawTableText(hdc, bigFont, 0, 0, MARGIN, MARGIN, DT_LEFT, pStr);
-	DrawTableText(hdc, bigFont, RESOLUTION - MARGIN, 0, MARGIN, MARGIN, DT_RIGHT, player2Str);
-	DrawTableText(hdc, bigFont, RESOLUTION / 2 - MARGIN, 0, 2 * MARGIN, MARGIN, DT_CENTER, "CyPong");
+	DrawTextA(gdi->hdc, str, -1, &r,
+		((format & TEXT_CENTER) ? DT_CENTER : 0) | ((format & TEXT_RIGHT) ? DT_RIGHT : 0) | ((format & TEXT_VCENTER) ? DT_VCENTER : 0));
 
-	//Draw different things based on state
-	if (state == STATE_PLAY) //If the state is play
-		Rectangle(hdc, b.x - BALLSIZE, b.y - BALLSIZE, b.x + BALLSIZE, b.y + BALLSIZE); //Draw the ball
-	else if(state == STATE_HOME) { //If the state is home
-		DrawTableText(hdc, smallFont, RESOLUTION / 2 - 2*MARGIN, 1.5*MARGIN, 4 * MARGIN, MARGIN/2, DT_CENTER, "One Player"); //Draw the menu
-		DrawTableText(hdc, smallFont, RESOLUTION / 2 - 2*MARGIN, 2*MARGIN, 4 * MARGIN, MARGIN/2, DT_CENTER, "Two Player");
-		DrawTableText(hdc, smallFont, RESOLUTION / 2 - 2 * MARGIN, (1.5 + 0.5*(mode == MODE_TWO) )*MARGIN, 16, MARGIN / 2, DT_RIGHT, ">");
-	}
-	else if (state == STATE_END) { //If the state is end
-		//Draw the appropriate end message based on mode and score
-		if (mode == MODE_ONE)
-			DrawTableText(hdc, smallFont, RESOLUTION / 2 - 2 * MARGIN, 1.5*MARGIN, 4 * MARGIN, MARGIN / 2, DT_CENTER, PLAYER_SCORE(score) > PLAYER2_SCORE(score) ? "You won!" : "You lost!");
-		else {
-			DrawTableText(hdc, smallFont, RESOLUTION / 2 - 2 * MARGIN, 1.5*MARGIN, 4 * MARGIN, MARGIN / 2, DT_CENTER, PLAYER_SCORE(score) > PLAYER2_SCORE(score) ? "Player 1" : "Player 2");
-			DrawTableText(hdc, smallFont, RESOLUTION / 2 - 2 * MARGIN, 2 * MARGIN, 4 * MARGIN, MARGIN / 2, DT_CENTER, "Wins!");
-		}
-	}
+	SelectObject(gdi->hdc, oldFont);
+}
+
+void GdiLayer(void *ctx, byte layer) {
+	Gdi *gdi = ctx;
+
+	gdi->hdc = gdi->layers[layer];
+}
+
+void GdiCopy(void *ctx, byte from, int left, int top, int right, int bottom) {
+	Gdi *gdi = ctx;
 
-	//Delete drawing objects to avoid a memory leak
-	SelectObject(hdc, oldPen);
-	SelectObject(hdc, oldBrush);
-	DeleteObject(brush);
-	DeleteObject(pen);
-	DeleteObject(bigFont);
-	DeleteObject(smallFont);
+	BitBlt(gdi->hdc, left, top, right - left, bottom - top, gdi->layers[from], left, top, SRCCOPY);
 }
@@ -0,0 +1,59 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "Server.h"
+
+/*
+ *PongServer.c
+ *The dedicated match server (see Server.h). Runs on Linux:
+ *
+ *	gcc -O2 -pthread -o pong-server PongServer.c Server.c Spectate.c Game.c Netplay.c -lm
+ *	./pong-server [port] [shards] [matches per shard] [hz] [ticks between state packets]
+ *
+ *It prints what it has done every few seconds until it is interrupted.
+*/
+
+
+volatile sig_atomic_t interrupted;
+
+/*
+ *void Interrupt(int)
+ *This function is the SIGINT and SIGTERM handler
+*/
+static void Interrupt(int signal) {
+	(void)signal;
+	interrupted = 1;
+}
+
+int main(int argc, char **argv) {
+	Server server;
+	ShardStats stats;
+	unsigned short port = argc > 1 ? atoi(argv[1]) : 27015;
+	unsigned int shards = argc > 2 ? atoi(argv[2]) : 0, matches = argc > 3 ? atoi(argv[3]) : 16384;
+	unsigned int hz = argc > 4 ? atoi(argv[4]) : TICK_RATE, sendEvery = argc > 5 ? atoi(argv[5]) : 1;
+	uint64_t ticks = 0;
+
+	if (!StartServer(&server, port, shards, matches, hz, sendEvery)) {
+		printf("pong-server: can't start on port %u\n", port);
+		return 1;
+	}
+	signal(SIGINT, Interrupt);
+	signal(SIGTERM, Interrupt);
+	printf("pong-server: %u shards on ports %u to %u, %u matches each at %u Hz\n",
+		server.shardCount, port, port + server.shardCount - 1, matches, server.hz);
+
+	while (!interrupted) {
+		sleep(5);
+		ServerStats(&server, &stats);
+		printf("pong-server: %llu matches made, %llu dropped, %.0f ticks/s, p50 %.2f ms p99 %.2f ms late, %llu packets in %llu out\n",
+			(unsigned long long)stats.made, (unsigned long long)stats.idled, (stats.ticks - ticks) / 5.0,
+			LatenessPercentile(&stats, 0.5) * 1e3, LatenessPercentile(&stats, 0.99) * 1e3,
+			(unsigned long long)stats.received, (unsigned long long)stats.sent);
+		ticks = stats.ticks;
+	}
+
+	StopServer(&server);
+
+	return 0;
+}
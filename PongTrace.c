@@ -0,0 +1,80 @@
+#include <stdio.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "Probe.h"
+#include "Loop.h"
+
+/*
+ *PongTrace.c
+ *Follows the trace of a game started with -trace (see Probe.h) and prints
+ *what each probe measured every second. On Linux:
+ *
+ *	gcc -O2 -o pong-trace PongTrace.c Probe.c Loop.c
+ *	./pong-trace
+ *
+ *Every event is read, so the numbers are exact for the second they cover
+ *unless the game wrote faster than it could follow (lost).
+*/
+
+
+const char *const ProbeNames[PROBE_COUNT] = { "tick", "late", "table", "touch", "present", "paint", "input" };
+
+//What a probe measured in the last second
+typedef struct Window {
+	uint64_t count, total, max;
+} Window;
+
+/*
+ *void Pause(unsigned int)
+ *This function sleeps for some milliseconds
+*/
+static void Pause(unsigned int ms) {
+#ifdef _WIN32
+	Sleep(ms);
+#else
+	usleep(ms * 1000);
+#endif
+}
+
+int main(void) {
+	Window windows[PROBE_COUNT] = { { 0 } };
+	TraceReader reader;
+	TraceEvent e;
+	uint64_t second = MonotonicNow(NULL), lost = 0;
+	byte i;
+
+	while (!OpenTrace(&reader)) {
+		printf("pong-trace: waiting for a game started with -trace\n");
+		Pause(1000);
+	}
+
+	for (;;) {
+		while (ReadTrace(&reader, &e)) {
+			Window *w = &windows[e.probe < PROBE_COUNT ? e.probe : 0];
+
+			w->count++;
+			w->total += e.ns;
+			if (e.ns > w->max)
+				w->max = e.ns;
+		}
+
+		if (MonotonicNow(NULL) - second < NS_PER_SECOND) {
+			Pause(10);
+			continue;
+		}
+		second = MonotonicNow(NULL);
+
+		for (i = 0; i < PROBE_COUNT; i++) {
+			if (windows[i].count > 0)
+				printf("%s %llu x %.1f us (max %.1f)  ", ProbeNames[i], (unsigned long long)windows[i].count,
+					windows[i].total / 1e3 / windows[i].count, windows[i].max / 1e3);
+			windows[i].count = windows[i].total = windows[i].max = 0;
+		}
+		printf("lost %llu\n", (unsigned long long)(reader.lost - lost));
+		fflush(stdout);
+		lost = reader.lost;
+	}
+}
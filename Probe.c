@@ -0,0 +1,457 @@
+#ifdef _WIN32
+#include <Windows.h>
+#include <intrin.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "Probe.h"
+#include "Loop.h"
+
+/*
+ *Probe.c
+ *The probes, their histograms and the trace ring, see Probe.h
+*/
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL	__declspec(thread)
+#else
+#define THREAD_LOCAL	_Thread_local
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HAVE_TSC
+#endif
+
+
+volatile bool probing;
+static bool tracing;
+static ProbeThread *threads[PROBE_THREADS];
+static volatile long threadCount;
+static THREAD_LOCAL ProbeThread *mine;
+static THREAD_LOCAL byte mineIndex;
+static THREAD_LOCAL bool noSlot;		//every slot was taken when it first recorded
+static uint64_t nsPerCycle;		//32.32 fixed point
+static TraceRing *trace;
+#ifdef _WIN32
+static HANDLE traceHandle;
+#endif
+
+/*
+ *uint64_t ProbeCycles()
+ *This function reads the cycle counter, or the monotonic clock in
+ *nanoseconds where there is none
+*/
+uint64_t ProbeCycles(void) {
+#ifdef HAVE_TSC
+	return __rdtsc();
+#else
+	return MonotonicNow(NULL);
+#endif
+}
+
+/*
+ *void Publish()
+ *This function keeps the stores before it from being seen after the ones
+ *that follow it
+*/
+static void Publish(void) {
+#ifdef _MSC_VER
+	_WriteBarrier();
+#else
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+/*
+ *void Acquire()
+ *This function keeps the loads after it from being done before the ones
+ *that came before it
+*/
+static void Acquire(void) {
+#ifdef _MSC_VER
+	_ReadBarrier();
+#else
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+/*
+ *void Calibrate()
+ *This function times the cycle counter against the monotonic clock
+*/
+static void Calibrate(void) {
+#ifdef HAVE_TSC
+	uint64_t start = MonotonicNow(NULL), cycles = ProbeCycles(), ns;
+
+	do
+		ns = MonotonicNow(NULL) - start;
+	while (ns < 20000000);
+	cycles = ProbeCycles() - cycles;
+	nsPerCycle = (ns << 32) / (cycles ? cycles : 1);
+#else
+	nsPerCycle = 1ull << 32;
+#endif
+}
+
+/*
+ *TraceRing *MapTrace(bool, void**)
+ *This function maps the trace ring, making it first if make is set
+*/
+static TraceRing *MapTrace(bool make, void **handle) {
+	TraceRing *ring;
+#ifdef _WIN32
+	HANDLE h = make ? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(TraceRing), TRACE_NAME) :
+		OpenFileMappingA(FILE_MAP_READ, FALSE, TRACE_NAME);
+
+	if (h == NULL)
+		return NULL;
+	ring = MapViewOfFile(h, make ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, sizeof(TraceRing));
+	if (ring == NULL) {
+		CloseHandle(h);
+		return NULL;
+	}
+	*handle = h;
+#else
+	int file = shm_open(TRACE_NAME, make ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+	void *data;
+
+	*handle = NULL;
+	if (file < 0)
+		return NULL;
+	if (make && ftruncate(file, sizeof(TraceRing)) != 0) {
+		close(file);
+		return NULL;
+	}
+	data = mmap(NULL, sizeof(TraceRing), make ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (data == MAP_FAILED)
+		return NULL;
+	ring = data;
+#endif
+
+	return ring;
+}
+
+/*
+ *void UnmapTrace(TraceRing*, void*)
+ *This function unmaps the trace ring
+*/
+static void UnmapTrace(TraceRing *ring, void *handle) {
+#ifdef _WIN32
+	UnmapViewOfFile(ring);
+	CloseHandle(handle);
+#else
+	(void)handle;
+	munmap(ring, sizeof(TraceRing));
+#endif
+}
+
+/*
+ *bool StartProbes(bool)
+ *This function turns the probes on, and with trace the trace ring too.
+ *It returns false if the ring couldn't be made, the probes are on anyway.
+*/
+bool StartProbes(bool withTrace) {
+	void *handle = NULL;
+
+	if (nsPerCycle == 0)
+		Calibrate();
+
+	if (withTrace && trace == NULL) {
+		trace = MapTrace(true, &handle);
+#ifdef _WIN32
+		traceHandle = handle;
+#endif
+		if (trace != NULL) {
+			memset(trace, 0, sizeof(TraceRing));
+			trace->events = TRACE_EVENTS;
+			trace->threads = TRACE_THREADS;
+			trace->magic = TRACE_MAGIC;
+		}
+	}
+	tracing = trace != NULL;
+	probing = true;
+
+	return !withTrace || tracing;
+}
+
+/*
+ *void StopProbes()
+ *This function turns the probes off and lets go of the trace ring. The
+ *histograms stay readable.
+*/
+void StopProbes(void) {
+	probing = false;
+	tracing = false;
+	if (trace != NULL) {
+#ifdef _WIN32
+		UnmapTrace(trace, traceHandle);
+#else
+		UnmapTrace(trace, NULL);
+		shm_unlink(TRACE_NAME);
+#endif
+		trace = NULL;
+	}
+}
+
+/*
+ *unsigned int ProbeBucket(uint64_t)
+ *This function returns the histogram bucket of a number of nanoseconds
+*/
+unsigned int ProbeBucket(uint64_t ns) {
+	unsigned int top = 0;
+	uint64_t v;
+
+	if (ns < (1u << PROBE_SUB_BITS))
+		return (unsigned int)ns;
+
+	for (v = ns; v >> 1 != 0; v >>= 1)
+		top++;
+	//2^40 ns and up all go in the last bucket
+	if (top >= 40)
+		return PROBE_BUCKETS - 1;
+
+	return ((top - PROBE_SUB_BITS + 1) << PROBE_SUB_BITS) + (unsigned int)(ns >> (top - PROBE_SUB_BITS) & ((1u << PROBE_SUB_BITS) - 1));
+}
+
+/*
+ *uint64_t ProbeBucketValue(unsigned int)
+ *This function returns the middle of a histogram bucket in nanoseconds
+*/
+uint64_t ProbeBucketValue(unsigned int bucket) {
+	unsigned int shift;
+
+	if (bucket < (1u << PROBE_SUB_BITS))
+		return bucket;
+
+	shift = (bucket >> PROBE_SUB_BITS) - 1;
+
+	return ((uint64_t)((1u << PROBE_SUB_BITS) + (bucket & ((1u << PROBE_SUB_BITS) - 1))) << shift) + (1ull << shift) / 2;
+}
+
+/*
+ *ProbeThread *ThisThread()
+ *This function returns the calling thread's histograms, made the first
+ *time it records something. NULL once every slot is taken, and from then
+ *on for that thread without trying again.
+*/
+static ProbeThread *ThisThread(void) {
+	uint64_t slot;
+
+	if (mine != NULL || noSlot)
+		return mine;
+	if (threadCount >= PROBE_THREADS) {
+		noSlot = true;
+		return NULL;
+	}
+
+	mine = calloc(1, sizeof(ProbeThread));
+	if (mine == NULL)
+		return NULL;
+
+#ifdef _MSC_VER
+	slot = (uint64_t)InterlockedIncrement(&threadCount) - 1;
+#else
+	slot = (uint64_t)__atomic_fetch_add(&threadCount, 1, __ATOMIC_ACQ_REL);
+#endif
+	if (slot >= PROBE_THREADS) {
+		free(mine);
+		mine = NULL;
+		noSlot = true;
+		return NULL;
+	}
+	mineIndex = (byte)slot;
+	threads[slot] = mine;
+
+	return mine;
+}
+
+/*
+ *void ProbeValue(byte, uint64_t)
+ *This function records a measurement in nanoseconds
+*/
+void ProbeValue(byte probe, uint64_t ns) {
+	ProbeThread *t = ThisThread();
+
+	if (t == NULL)
+		return;
+	t->counts[probe][ProbeBucket(ns)]++;
+	t->total[probe]++;
+
+	if (tracing && mineIndex < TRACE_THREADS) {
+		TraceLane *lane = &trace->lanes[mineIndex];
+		uint64_t i = lane->head;
+		TraceEvent *e = &lane->ring[i & (TRACE_EVENTS - 1)];
+
+		e->seq = 0;
+		Publish();
+		e->probe = probe;
+		e->thread = mineIndex;
+		e->at = MonotonicNow(NULL) - ns;
+		e->ns = ns;
+		Publish();
+		e->seq = (uint32_t)i + 1;
+		Publish();
+		lane->head = i + 1;
+	}
+}
+
+/*
+ *void ProbeStop(byte, uint64_t)
+ *This function records the time since start (from ProbeCycles)
+*/
+void ProbeStop(byte probe, uint64_t start) {
+	uint64_t cycles = ProbeCycles() - start;
+
+	//Split up so that the multiplication can't overflow
+	ProbeValue(probe, (cycles >> 32) * nsPerCycle + ((cycles & 0xFFFFFFFF) * nsPerCycle >> 32));
+}
+
+/*
+ *uint64_t ProbeCount(byte)
+ *This function returns how many measurements a probe has, all threads
+*/
+uint64_t ProbeCount(byte probe) {
+	uint64_t count = 0;
+	long i;
+
+	for (i = 0; i < threadCount && i < PROBE_THREADS; i++)
+		if (threads[i] != NULL)
+			count += threads[i]->total[probe];
+
+	return count;
+}
+
+/*
+ *uint64_t ProbePercentile(byte, double)
+ *This function returns the time in nanoseconds that p (0 to 1) of a
+ *probe's measurements were under, 0 if it has none. Threads may be adding
+ *to the histograms meanwhile, the answer is as of about now.
+*/
+uint64_t ProbePercentile(byte probe, double p) {
+	uint64_t total = ProbeCount(probe), seen = 0;
+	unsigned int b;
+	long i;
+
+	if (total == 0)
+		return 0;
+
+	for (b = 0; b < PROBE_BUCKETS; b++) {
+		for (i = 0; i < threadCount && i < PROBE_THREADS; i++)
+			if (threads[i] != NULL)
+				seen += threads[i]->counts[probe][b];
+		if (seen >= p * total && seen > 0)
+			return ProbeBucketValue(b);
+	}
+
+	return ProbeBucketValue(PROBE_BUCKETS - 1);
+}
+
+/*
+ *void ResetProbes()
+ *This function empties every histogram. Measurements made at the same
+ *time may be half counted.
+*/
+void ResetProbes(void) {
+	long i;
+
+	for (i = 0; i < threadCount && i < PROBE_THREADS; i++)
+		if (threads[i] != NULL)
+			memset(threads[i], 0, sizeof(ProbeThread));
+}
+
+/*
+ *bool OpenTrace(TraceReader*)
+ *This function maps the trace ring of a running game to follow it from
+ *the next event
+*/
+bool OpenTrace(TraceReader *t) {
+	byte i;
+
+	memset(t, 0, sizeof(TraceReader));
+	t->ring = MapTrace(false, &t->handle);
+	if (t->ring == NULL)
+		return false;
+	if (t->ring->magic != TRACE_MAGIC || t->ring->events != TRACE_EVENTS || t->ring->threads != TRACE_THREADS) {
+		UnmapTrace(t->ring, t->handle);
+		t->ring = NULL;
+		return false;
+	}
+	for (i = 0; i < TRACE_THREADS; i++)
+		t->next[i] = t->ring->lanes[i].head;
+
+	return true;
+}
+
+/*
+ *bool ReadLane(TraceReader*, byte, TraceEvent*)
+ *This function copies the next event of one thread, false if there is
+ *none yet. Events the thread already wrote over are counted as lost.
+*/
+static bool ReadLane(TraceReader *t, byte lane, TraceEvent *e) {
+	const TraceLane *l = &t->ring->lanes[lane];
+	const TraceEvent *at;
+	uint64_t head;
+	uint32_t seq;
+
+	for (;;) {
+		head = l->head;
+		Acquire();
+		if (t->next[lane] >= head)
+			return false;
+		if (head - t->next[lane] > TRACE_EVENTS) {
+			t->lost += head - TRACE_EVENTS - t->next[lane];
+			t->next[lane] = head - TRACE_EVENTS;
+		}
+
+		at = &l->ring[t->next[lane] & (TRACE_EVENTS - 1)];
+		seq = at->seq;
+		Acquire();
+		*e = *at;
+		Acquire();
+
+		//Written over before or while it was copied
+		if (seq != (uint32_t)t->next[lane] + 1 || at->seq != seq) {
+			t->lost++;
+			t->next[lane]++;
+			continue;
+		}
+
+		t->next[lane]++;
+		return true;
+	}
+}
+
+/*
+ *bool ReadTrace(TraceReader*, TraceEvent*)
+ *This function copies the next event of any thread, taking turns between
+ *them, false if there is none yet
+*/
+bool ReadTrace(TraceReader *t, TraceEvent *e) {
+	byte i;
+
+	for (i = 0; i < TRACE_THREADS; i++) {
+		t->lane = (t->lane + 1) % TRACE_THREADS;
+		if (ReadLane(t, t->lane, e))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ *void CloseTrace(TraceReader*)
+ *This function stops following a trace
+*/
+void CloseTrace(TraceReader *t) {
+	if (t->ring != NULL)
+		UnmapTrace(t->ring, t->handle);
+	memset(t, 0, sizeof(TraceReader));
+}
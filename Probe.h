@@ -0,0 +1,116 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <stdint.h>
+#include "Game.h"
+
+/*
+ *Probe.h
+ *Timers for the game's own hot paths. PROBE_START reads the CPU's cycle
+ *counter and PROBE_STOP adds the time since then to the probe's histogram.
+ *While probing is off they cost a test of one flag, and building with
+ *NO_PROBES takes them out altogether.
+ *
+ *Histograms are HDR style: PROBE_SUB_BITS bits of precision at every
+ *power of two of nanoseconds, about 6% everywhere from a nanosecond to
+ *well past a second. Each thread records into histograms of its own with
+ *plain stores and readers add them all up while they run, so nothing is
+ *ever locked.
+ *
+ *With tracing on every measurement also goes into shared memory
+ *(TRACE_NAME, a file mapping on Windows and POSIX shared memory
+ *elsewhere) where another program can map it and follow it while the game
+ *runs (see PongTrace.c). Each of the first TRACE_THREADS threads has a
+ *ring of events there that only it writes. An event is stamped with its
+ *number after it is written and the ring's head moves after that, so a
+ *reader never waits on a writer and can tell an event written over while
+ *it copied it from one that is whole.
+*/
+
+
+//What is measured
+#define PROBE_TICK		0	//a game update
+#define PROBE_LATE		1	//how late an update ran after it was due
+#define PROBE_TABLE		2	//DrawTable
+#define PROBE_TOUCH		3	//DrawTouchControls
+#define PROBE_PRESENT	4	//StretchBlt and BitBlt to the screen
+#define PROBE_PAINT		5	//all of WM_PAINT
+#define PROBE_INPUT		6	//from a key or touch coming in to the frame it is drawn in
+#define PROBE_COUNT		7
+
+#define PROBE_SUB_BITS	4
+#define PROBE_BUCKETS	((41 - PROBE_SUB_BITS) << PROBE_SUB_BITS)	//up to 2^40 ns
+#define PROBE_THREADS	64
+
+#define TRACE_MAGIC		0x43525450	//"PTRC"
+#define TRACE_THREADS	16
+#define TRACE_EVENTS	16384		//per thread, a power of two
+#ifdef _WIN32
+#define TRACE_NAME		"Local\\PongTrace"
+#else
+#define TRACE_NAME		"/pong-trace"
+#endif
+
+//One thread's histograms
+typedef struct ProbeThread {
+	uint32_t counts[PROBE_COUNT][PROBE_BUCKETS];
+	uint64_t total[PROBE_COUNT];
+} ProbeThread;
+
+typedef struct TraceEvent {
+	volatile uint32_t seq;		//the event's number + 1, written last
+	byte probe, thread;
+	uint16_t unused;
+	uint64_t at;				//nanoseconds on the monotonic clock when it started
+	uint64_t ns;				//how long it took
+} TraceEvent;
+
+//One thread's events
+typedef struct TraceLane {
+	volatile uint64_t head;		//events written so far
+	uint64_t unused[7];			//keeps the heads on lines of their own
+	TraceEvent ring[TRACE_EVENTS];
+} TraceLane;
+
+typedef struct TraceRing {
+	uint32_t magic, events, threads, unused;
+	TraceLane lanes[TRACE_THREADS];
+} TraceRing;
+
+//The reading end of a trace
+typedef struct TraceReader {
+	TraceRing *ring;
+	void *handle;
+	uint64_t next[TRACE_THREADS];	//the next event to read from each lane
+	byte lane;						//the lane read last
+	uint64_t lost;					//events written over before they were read
+} TraceReader;
+
+extern volatile bool probing;
+
+#ifdef NO_PROBES
+#define PROBE_START()			0
+#define PROBE_STOP(probe, start)	((void)(start))
+#else
+#define PROBE_START()			(probing ? ProbeCycles() : 0)
+#define PROBE_STOP(probe, start)	do { if (start) ProbeStop(probe, start); } while (0)
+#endif
+
+//Probe functions
+bool StartProbes(bool trace);
+void StopProbes(void);
+uint64_t ProbeCycles(void);
+void ProbeStop(byte probe, uint64_t start);
+void ProbeValue(byte probe, uint64_t ns);
+unsigned int ProbeBucket(uint64_t ns);
+uint64_t ProbeBucketValue(unsigned int bucket);
+uint64_t ProbeCount(byte probe);
+uint64_t ProbePercentile(byte probe, double p);
+void ResetProbes(void);
+
+//Trace functions
+bool OpenTrace(TraceReader *t);
+bool ReadTrace(TraceReader *t, TraceEvent *e);
+void CloseTrace(TraceReader *t);
+
+#endif
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Profile.h"
+
+/*
+ *Profile.c
+ *Reading physics profiles, see Profile.h
+*/
+
+
+//Names of the known profiles, by PROFILE_*
+static const char *names[PROFILE_COUNT] = { "classic", "fast", "long" };
+
+
+/*
+ *const char *ProfileName(byte)
+ *This function returns the name of a known profile, "custom" for any other
+*/
+const char *ProfileName(byte profile) {
+	return profile < PROFILE_COUNT ? names[profile] : "custom";
+}
+
+/*
+ *bool SetValue(Physics*, const char*, size_t, const char*)
+ *This function sets the value with the given name (not NUL terminated)
+ *and returns false if there is no such value or it's out of range
+*/
+static bool SetValue(Physics *ph, const char *name, size_t length, const char *value) {
+	char *end;
+	double v = strtod(value, &end);
+
+	if (end == value)
+		return false;
+
+#define IS(s)	(length == sizeof(s) - 1 && strncmp(name, s, length) == 0)
+	if (IS("ballspeed") && v >= 1 && v <= 400 && v == (short)v)
+		ph->ballSpeed = (short)v;
+	else if (IS("english") && v >= 0 && v <= 100 && v == (short)v)
+		ph->englishScale = (short)v;
+	else if (IS("paddle") && v >= 2 && v <= 64 && v == (short)v)
+		ph->paddleHeight = (short)v;
+	else if (IS("aispeed") && v >= 0.1 && v <= 16)
+		ph->aiSpeed = (float)v;
+	else if (IS("playerspeed") && v >= 0.1 && v <= 16)
+		ph->playerSpeed = (float)v;
+	else if (IS("maxscore") && v >= 1 && v <= MAX_SCORE_LIMIT && v == (byte)v)
+		ph->maxScore = (byte)v;
+	else
+		return false;
+#undef IS
+
+	return true;
+}
+
+/*
+ *bool ParsePhysics(Physics*, const char*)
+ *This function changes the physics as the text of a profile says. It
+ *returns false and leaves them alone if anything in it is wrong.
+*/
+bool ParsePhysics(Physics *ph, const char *text) {
+	Physics parsed = *ph;
+	char word[64];
+	size_t length, name;
+	byte i;
+
+	while (*text != '\0') {
+		//Skip separators and comments
+		if (*text == ' ' || *text == '\t' || *text == ',' || *text == '\r' || *text == '\n') {
+			text++;
+			continue;
+		}
+		if (*text == '#') {
+			while (*text != '\0' && *text != '\n')
+				text++;
+			continue;
+		}
+
+		for (length = 0; text[length] != '\0' && strchr(" \t,\r\n#", text[length]) == NULL; length++)
+			;
+		if (length >= sizeof(word))
+			return false;
+		memcpy(word, text, length);
+		word[length] = '\0';
+		text += length;
+
+		for (name = 0; name < length && word[name] != '='; name++)
+			;
+		if (name < length) {
+			if (!SetValue(&parsed, word, name, word + name + 1))
+				return false;
+			continue;
+		}
+
+		for (i = 0; i < PROFILE_COUNT && strcmp(word, names[i]) != 0; i++)
+			;
+		if (i == PROFILE_COUNT)
+			return false;
+		parsed = Profiles[i];
+	}
+
+	parsed.profile = FindProfile(&parsed);
+	*ph = parsed;
+
+	return true;
+}
+
+/*
+ *bool LoadPhysics(Physics*, const char*)
+ *This function changes the physics as the profile in a file says
+*/
+bool LoadPhysics(Physics *ph, const char *path) {
+	char text[PROFILE_TEXT];
+	size_t size;
+	FILE *file = fopen(path, "r");
+
+	if (file == NULL)
+		return false;
+	size = fread(text, 1, sizeof(text) - 1, file);
+	fclose(file);
+	text[size] = '\0';
+
+	return ParsePhysics(ph, text);
+}
@@ -0,0 +1,33 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "Game.h"
+
+/*
+ *Profile.h
+ *Reads physics profiles from the command line or from a file. A profile
+ *is words separated by spaces, commas or lines. The name of a known
+ *profile (classic, fast or long) starts over from it and name=value
+ *changes one value:
+ *
+ *	ballspeed	hundredths of a pixel per tick, 1 to 400
+ *	english		percent of where the ball hits the paddle added to its vy, 0 to 100
+ *	paddle		paddle height in pixels, 2 to 64
+ *	aispeed		how far the AI paddle moves per tick, 0.1 to 16
+ *	playerspeed	how far a player's paddle moves per tick, 0.1 to 16
+ *	maxscore	points to win, 1 to MAX_SCORE_LIMIT
+ *
+ *Anything after a # on a line is left out, so "long paddle=16" is first
+ *to 21 with longer paddles. Physics that come out the same as a known
+ *profile run its code.
+*/
+
+
+#define PROFILE_TEXT	1024	//longest profile file read
+
+//Profile functions
+bool ParsePhysics(Physics *ph, const char *text);
+bool LoadPhysics(Physics *ph, const char *path);
+const char *ProfileName(byte profile);
+
+#endif
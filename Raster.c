@@ -0,0 +1,251 @@
+#include <string.h>
+#include "Raster.h"
+#include "Glyphs.h"
+
+/*
+ *Raster.c
+ *Span filling for the table. Everything on the table is a white box on
+ *black, so a frame is nothing more than a handful of memset/memcpy calls.
+*/
+
+#define WHITE32		0x00FFFFFF
+
+//The borders and net, built the first time a raster is set up
+static byte background8[RESOLUTION * RESOLUTION];
+static uint32_t background32[RESOLUTION * RESOLUTION];
+static bool baked = false;
+
+
+/*
+ *Rect RectangleBox(int, int, int, int)
+ *This function returns the pixels GDI fills for Rectangle(left, top, right, bottom)
+ *with a null pen: the right and bottom edges are left out and, because there
+ *is no border, the box is one more pixel narrower and shorter. The result
+ *is clipped to the table.
+*/
+Rect RectangleBox(int left, int top, int right, int bottom) {
+	Rect box;
+
+	box.left = CLAMP(left, 0, RESOLUTION);
+	box.top = CLAMP(top, 0, RESOLUTION);
+	box.right = CLAMP(right - 1, box.left, RESOLUTION);
+	box.bottom = CLAMP(bottom - 1, box.top, RESOLUTION);
+
+	return box;
+}
+
+/*
+ *void FillPixels(void*, byte, Rect)
+ *This function fills a box of a pixel buffer with white
+*/
+static void FillPixels(void *pixels, byte bytes, Rect box) {
+	int x, y, w = box.right - box.left;
+
+	for (y = box.top; y < box.bottom; y++) {
+		if (bytes == RASTER_8)
+			memset((byte*)pixels + y*RESOLUTION + box.left, 0xFF, w);
+		else {
+			uint32_t *row = (uint32_t*)pixels + y*RESOLUTION + box.left;
+			for (x = 0; x < w; x++)
+				row[x] = WHITE32;
+		}
+	}
+}
+
+/*
+ *void RestoreBox(Raster*, Rect)
+ *This function copies a box of the background back into the raster
+*/
+static void RestoreBox(Raster *r, Rect box) {
+	int y;
+	size_t offset, size = (size_t)(box.right - box.left) * r->bytes;
+
+	for (y = box.top; y < box.bottom; y++) {
+		offset = (size_t)(y*RESOLUTION + box.left) * r->bytes;
+		memcpy((byte*)r->pixels + offset, (r->bytes == RASTER_8 ? (byte*)background8 : (byte*)background32) + offset, size);
+	}
+}
+
+/*
+ *void BakeBackground()
+ *This function draws the parts of the table that never move
+*/
+static void BakeBackground(void) {
+	Rect line;
+	int i;
+
+	//The top and bottom table borders (one pixel lines)
+	line.left = 0;
+	line.right = RESOLUTION;
+	line.top = MARGIN;
+	line.bottom = MARGIN + 1;
+	FillPixels(background8, RASTER_8, line);
+	FillPixels(background32, RASTER_32, line);
+	line.top = RESOLUTION - 1;
+	line.bottom = RESOLUTION;
+	FillPixels(background8, RASTER_8, line);
+	FillPixels(background32, RASTER_32, line);
+
+	//The net
+	for (i = MARGIN + MESHSIZE/2; i < (RESOLUTION - MESHSIZE); i += 2 * MESHSIZE) {
+		Rect mesh = RectangleBox(RESOLUTION / 2 - NETWIDTH / 2, i, RESOLUTION / 2 + NETWIDTH / 2, i + MESHSIZE);
+		FillPixels(background8, RASTER_8, mesh);
+		FillPixels(background32, RASTER_32, mesh);
+	}
+
+	baked = true;
+}
+
+/*
+ *void InitRaster(Raster*, void*, byte)
+ *This function sets up a raster on a caller owned buffer of
+ *RESOLUTION x RESOLUTION pixels and draws the empty table into it
+*/
+void InitRaster(Raster *r, void *pixels, byte bytes) {
+	if (!baked)
+		BakeBackground();
+
+	r->pixels = pixels;
+	r->bytes = bytes;
+	r->paddleHeight = PADDLEHEIGHT;
+	ClearRaster(r);
+}
+
+/*
+ *void ClearRaster(Raster*)
+ *This function puts back the whole empty table, wiping out anything
+ *that was drawn on it (like text)
+*/
+void ClearRaster(Raster *r) {
+	memcpy(r->pixels, r->bytes == RASTER_8 ? (void*)background8 : (void*)background32, (size_t)RESOLUTION * RESOLUTION * r->bytes);
+	r->count = 0;
+	r->textCount = 0;
+	r->textReady = false;
+}
+
+/*
+ *void FillBox(Raster*, Rect)
+ *This function fills a box with white without remembering it
+*/
+void FillBox(Raster *r, Rect box) {
+	FillPixels(r->pixels, r->bytes, box);
+}
+
+/*
+ *void RasterTable(Raster*, Ball, Paddle, Paddle, byte)
+ *This function draws both paddles and, while the ball is in play, the ball.
+ *Only the boxes that moved are touched.
+*/
+void RasterTable(Raster *r, Ball b, Paddle player, Paddle player2, byte state) {
+	byte i;
+
+	//Take last frame's objects off the table
+	for (i = 0; i < r->count; i++)
+		RestoreBox(r, r->drawn[i]);
+
+	//Always draw both paddles
+	r->drawn[0] = RectangleBox(0, player.height - r->paddleHeight / 2, PADDLEWIDTH, player.height + r->paddleHeight / 2);
+	r->drawn[1] = RectangleBox(RESOLUTION - PADDLEWIDTH, player2.height - r->paddleHeight / 2, RESOLUTION, player2.height + r->paddleHeight / 2);
+	r->count = 2;
+
+	if (state == STATE_PLAY) //Draw the ball
+		r->drawn[r->count++] = RectangleBox(b.x - BALLSIZE, b.y - BALLSIZE, b.x + BALLSIZE, b.y + BALLSIZE);
+
+	for (i = 0; i < r->count; i++)
+		FillBox(r, r->drawn[i]);
+}
+
+/*
+ *Rect RasterText(Raster*, int, int, int, byte, byte, const char*)
+ *This function blits a string in white on black into a box starting at
+ *(x, y) that is width pixels wide, every font pixel scale x scale pixels big.
+ *Each row of glyphs is built once and then copied scale times.
+ *It returns the pixels it covered.
+*/
+Rect RasterText(Raster *r, int x, int y, int width, byte scale, byte align, const char *str) {
+	uint32_t line[RESOLUTION];
+	int len = (int)strlen(str), textWidth = len * GLYPH_ADVANCE * scale - scale, row, px, i;
+	Rect box;
+
+	if (align == ALIGN_CENTER)
+		x += (width - textWidth) / 2;
+	else if (align == ALIGN_RIGHT)
+		x += width - textWidth;
+
+	box.left = CLAMP(x, 0, RESOLUTION);
+	box.top = CLAMP(y, 0, RESOLUTION);
+	box.right = CLAMP(x + textWidth, box.left, RESOLUTION);
+	box.bottom = CLAMP(y + GLYPH_HEIGHT * scale, box.top, RESOLUTION);
+
+	for (row = 0; row < GLYPH_HEIGHT; row++) {
+		//Build this row of the whole string
+		for (px = box.left; px < box.right; px++) {
+			int col = (px - x) / scale;
+			byte bits = Glyph(str[col / GLYPH_ADVANCE])[row];
+			bool lit = col % GLYPH_ADVANCE < GLYPH_WIDTH && (bits >> (GLYPH_WIDTH - 1 - col % GLYPH_ADVANCE)) & 1;
+
+			if (r->bytes == RASTER_8)
+				((byte*)line)[px - box.left] = lit ? 0xFF : 0;
+			else
+				line[px - box.left] = lit ? WHITE32 : 0;
+		}
+
+		//And copy it into the raster
+		for (i = 0; i < scale; i++) {
+			int py = y + row * scale + i;
+
+			if (py >= box.top && py < box.bottom)
+				memcpy((byte*)r->pixels + (size_t)(py*RESOLUTION + box.left) * r->bytes, line, (size_t)(box.right - box.left) * r->bytes);
+		}
+	}
+
+	return box;
+}
+
+/*
+ *void RasterTableText(Raster*, uint16_t, byte, byte)
+ *This function puts the scores, the title and the messages of each state
+ *on the table. Nothing is drawn unless something shown has changed.
+*/
+void RasterTableText(Raster *r, uint16_t score, byte state, byte mode) {
+	char pStr[3], player2Str[3];
+	byte i;
+
+	if (r->textReady && r->textScore == score && r->textState == state && r->textMode == mode)
+		return;
+
+	//The title and messages change with the state and mode
+	if (!r->textReady || r->textState != state || r->textMode != mode) {
+		for (i = 0; i < r->textCount; i++)
+			RestoreBox(r, r->text[i]);
+		r->textCount = 0;
+
+		r->text[r->textCount++] = RasterText(r, RESOLUTION / 2 - MARGIN, 4, 2 * MARGIN, 2, ALIGN_CENTER, "CyPong");
+
+		if (state == STATE_HOME) { //Draw the menu
+			r->text[r->textCount++] = RasterText(r, RESOLUTION / 2 - 2 * MARGIN, 1.5*MARGIN + 2, 4 * MARGIN, 1, ALIGN_CENTER, "One Player");
+			r->text[r->textCount++] = RasterText(r, RESOLUTION / 2 - 2 * MARGIN, 2 * MARGIN + 2, 4 * MARGIN, 1, ALIGN_CENTER, "Two Player");
+			r->text[r->textCount++] = RasterText(r, RESOLUTION / 2 - 2 * MARGIN, (1.5 + 0.5*(mode == MODE_TWO))*MARGIN + 2, 16, 1, ALIGN_RIGHT, ">");
+		}
+		else if (state == STATE_END) { //Draw the appropriate end message based on mode and score
+			if (mode == MODE_ONE)
+				r->text[r->textCount++] = RasterText(r, RESOLUTION / 2 - 2 * MARGIN, 1.5*MARGIN + 2, 4 * MARGIN, 1, ALIGN_CENTER, PLAYER_SCORE(score) > PLAYER2_SCORE(score) ? "You won!" : "You lost!");
+			else {
+				r->text[r->textCount++] = RasterText(r, RESOLUTION / 2 - 2 * MARGIN, 1.5*MARGIN + 2, 4 * MARGIN, 1, ALIGN_CENTER, PLAYER_SCORE(score) > PLAYER2_SCORE(score) ? "Player 1" : "Player 2");
+				r->text[r->textCount++] = RasterText(r, RESOLUTION / 2 - 2 * MARGIN, 2 * MARGIN + 2, 4 * MARGIN, 1, ALIGN_CENTER, "Wins!");
+			}
+		}
+	}
+
+	//The scores are always two digits, so they simply cover the old ones
+	if (!r->textReady || r->textScore != score) {
+		ScoreToStrs(score, pStr, player2Str);
+		RasterText(r, 0, 4, MARGIN, 2, ALIGN_LEFT, pStr);
+		RasterText(r, RESOLUTION - MARGIN, 4, MARGIN, 2, ALIGN_RIGHT, player2Str);
+	}
+
+	r->textScore = score;
+	r->textState = state;
+	r->textMode = mode;
+	r->textReady = true;
+}
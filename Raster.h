@@ -0,0 +1,59 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "Game.h"
+
+/*
+ *Raster.h
+ *Draws the table (borders, net, paddles and ball) straight into a
+ *RESOLUTION x RESOLUTION pixel buffer, without GDI. The pixels come out
+ *exactly like the GDI calls DrawTable used to make.
+ *
+ *The borders and net never move, so they are drawn once into a static
+ *background. Every frame only puts the background back under the ball and
+ *paddles of the previous frame and draws the new ones on top.
+ *
+ *Text is blitted from the bitmap font in Glyphs.c as white on black. It
+ *never overlaps the ball or paddles, so it stays in the raster and is only
+ *drawn again when it changes: the messages with the state or mode and
+ *the scores with the score.
+*/
+
+
+//Pixel formats (bytes per pixel)
+#define RASTER_8		1	//0 is black, 255 is white
+#define RASTER_32		4	//0x00BBGGRR like a 32 bit DIB
+
+//Text alignment inside a box
+#define ALIGN_LEFT		0
+#define ALIGN_CENTER	1
+#define ALIGN_RIGHT		2
+
+//A box of pixels, right and bottom are not included
+typedef struct Rect {
+	short left, top, right, bottom;
+} Rect;
+
+typedef struct Raster {
+	void *pixels;		//rows of RESOLUTION pixels, one after another
+	byte bytes;			//RASTER_8 or RASTER_32
+	Rect drawn[3];		//boxes drawn over the background in the last frame
+	byte count;
+	Rect text[4];		//boxes covered by the messages
+	byte textCount;
+	uint16_t textScore;	//what the text on the raster shows
+	byte textState, textMode;
+	bool textReady;		//false when there is no text on the raster yet
+	short paddleHeight;	//of the match's physics, PADDLEHEIGHT at first
+} Raster;
+
+//Raster functions
+Rect RectangleBox(int left, int top, int right, int bottom);
+void InitRaster(Raster *r, void *pixels, byte bytes);
+void ClearRaster(Raster *r);
+void FillBox(Raster *r, Rect box);
+void RasterTable(Raster *r, Ball b, Paddle player, Paddle player2, byte state);
+Rect RasterText(Raster *r, int x, int y, int width, byte scale, byte align, const char *str);
+void RasterTableText(Raster *r, uint16_t score, byte state, byte mode);
+
+#endif
@@ -0,0 +1,243 @@
+#include <string.h>
+#include "Render.h"
+
+/*
+ *Render.c
+ *The resource cache and the counting backend
+*/
+
+
+/*
+ *void InitRenderer(Renderer*, const RenderBackend*, void*)
+ *This function sets up a renderer on a backend. No resources exist yet.
+*/
+void InitRenderer(Renderer *r, const RenderBackend *backend, void *ctx) {
+	memset(r, 0, sizeof(Renderer));
+	r->backend = backend;
+	r->ctx = ctx;
+}
+
+/*
+ *bool NeedResources(Renderer*, unsigned short, unsigned short)
+ *This function tells whether the resources have to be described and made
+ *(again) for the given resolution. If so, the old ones are released and
+ *the caller should call SetStyle/SetFont and then MakeResources.
+*/
+bool NeedResources(Renderer *r, unsigned short width, unsigned short height) {
+	if (r->ready && r->width == width && r->height == height)
+		return false;
+
+	if (r->ready)
+		r->backend->FreeResources(r->ctx);
+	r->ready = false;
+	r->styleCount = 0;
+	r->fontCount = 0;
+	r->width = width;
+	r->height = height;
+
+	return true;
+}
+
+/*
+ *void SetStyle(Renderer*, byte, uint32_t, short)
+ *This function describes a style. Nothing is created until MakeResources.
+*/
+void SetStyle(Renderer *r, byte id, uint32_t color, short lineWidth) {
+	r->styles[id].color = color;
+	r->styles[id].lineWidth = lineWidth;
+	if (id >= r->styleCount)
+		r->styleCount = id + 1;
+}
+
+/*
+ *void SetFont(Renderer*, byte, short, byte, const char*)
+ *This function describes a font. Nothing is created until MakeResources.
+*/
+void SetFont(Renderer *r, byte id, short height, byte flags, const char *face) {
+	r->fonts[id].height = height;
+	r->fonts[id].flags = flags;
+	r->fonts[id].face = face;
+	if (id >= r->fontCount)
+		r->fontCount = id + 1;
+}
+
+/*
+ *bool MakeResources(Renderer*)
+ *This function has the backend create every described style and font
+*/
+bool MakeResources(Renderer *r) {
+	byte i;
+
+	for (i = 0; i < r->styleCount; i++) {
+		if (!r->backend->MakeStyle(r->ctx, i, &r->styles[i]))
+			return false;
+		r->stats.creations++;
+	}
+	for (i = 0; i < r->fontCount; i++) {
+		if (!r->backend->MakeFont(r->ctx, i, &r->fonts[i]))
+			return false;
+		r->stats.creations++;
+	}
+
+	r->ready = true;
+
+	return true;
+}
+
+/*
+ *void FreeRenderer(Renderer*)
+ *This function releases all resources of the renderer
+*/
+void FreeRenderer(Renderer *r) {
+	if (r->ready)
+		r->backend->FreeResources(r->ctx);
+	r->ready = false;
+}
+
+/*
+ *void CountPixels(Renderer*, int, int, int, int)
+ *This function adds the pixels of a box to the renderer's totals
+*/
+static void CountPixels(Renderer *r, int left, int top, int right, int bottom) {
+	if (right > left && bottom > top)
+		r->stats.pixels += (uint64_t)(right - left) * (bottom - top);
+}
+
+/*
+ *void RenderClear(Renderer*, int, int, int, int)
+ *This function fills a box with black
+*/
+void RenderClear(Renderer *r, int left, int top, int right, int bottom) {
+	r->stats.ops[OP_CLEAR]++;
+	CountPixels(r, left, top, right, bottom);
+	r->backend->Clear(r->ctx, left, top, right, bottom);
+}
+
+/*
+ *void RenderBox(Renderer*, byte, int, int, int, int)
+ *This function fills a box with the color of a style
+*/
+void RenderBox(Renderer *r, byte style, int left, int top, int right, int bottom) {
+	r->stats.ops[OP_BOX]++;
+	CountPixels(r, left, top, right, bottom);
+	r->backend->Box(r->ctx, style, left, top, right, bottom);
+}
+
+/*
+ *void RenderEllipse(Renderer*, byte, int, int, int, int)
+ *This function fills the ellipse inside a box with the color of a style
+*/
+void RenderEllipse(Renderer *r, byte style, int left, int top, int right, int bottom) {
+	r->stats.ops[OP_ELLIPSE]++;
+	CountPixels(r, left, top, right, bottom);
+	r->backend->Ellipse(r->ctx, style, left, top, right, bottom);
+}
+
+/*
+ *void RenderLines(Renderer*, byte, const int*, byte)
+ *This function draws connected lines through count points (x, y pairs)
+*/
+void RenderLines(Renderer *r, byte style, const int *points, byte count) {
+	int left = points[0], top = points[1], right = points[0], bottom = points[1], half = r->styles[style].lineWidth / 2 + 1;
+	byte i;
+
+	//The box around the points, as wide as the pen
+	for (i = 1; i < count; i++) {
+		left = points[i * 2] < left ? points[i * 2] : left;
+		right = points[i * 2] > right ? points[i * 2] : right;
+		top = points[i * 2 + 1] < top ? points[i * 2 + 1] : top;
+		bottom = points[i * 2 + 1] > bottom ? points[i * 2 + 1] : bottom;
+	}
+	r->stats.ops[OP_LINES]++;
+	CountPixels(r, left - half, top - half, right + half, bottom + half);
+	r->backend->Lines(r->ctx, style, points, count);
+}
+
+/*
+ *void RenderText(Renderer*, byte, int, int, int, int, byte, const char*)
+ *This function draws white text inside a box
+*/
+void RenderText(Renderer *r, byte font, int x, int y, int width, int height, byte format, const char *str) {
+	r->stats.ops[OP_TEXT]++;
+	CountPixels(r, x, y, x + width, y + height);
+	r->backend->Text(r->ctx, font, x, y, width, height, format, str);
+}
+
+/*
+ *void RenderLayer(Renderer*, byte)
+ *This function makes everything after it draw on a layer
+*/
+void RenderLayer(Renderer *r, byte layer) {
+	if (r->layer == layer)
+		return;
+	r->layer = layer;
+	r->backend->Layer(r->ctx, layer);
+}
+
+/*
+ *void RenderCopy(Renderer*, byte, int, int, int, int)
+ *This function copies a box of another layer onto the one drawn on
+*/
+void RenderCopy(Renderer *r, byte from, int left, int top, int right, int bottom) {
+	r->stats.ops[OP_COPY]++;
+	CountPixels(r, left, top, right, bottom);
+	r->backend->Copy(r->ctx, from, left, top, right, bottom);
+}
+
+
+/*
+ *The counting backend. Every call is added to the RenderStats it was given.
+*/
+static bool RecordStyle(void *ctx, byte id, const Style *style) {
+	(void)id; (void)style;
+	((RenderStats*)ctx)->creations++;
+	return true;
+}
+
+static bool RecordFont(void *ctx, byte id, const FontDesc *font) {
+	(void)id; (void)font;
+	((RenderStats*)ctx)->creations++;
+	return true;
+}
+
+static void RecordFree(void *ctx) {
+	(void)ctx;
+}
+
+static void RecordClear(void *ctx, int left, int top, int right, int bottom) {
+	(void)left; (void)top; (void)right; (void)bottom;
+	((RenderStats*)ctx)->ops[OP_CLEAR]++;
+}
+
+static void RecordBox(void *ctx, byte style, int left, int top, int right, int bottom) {
+	(void)style; (void)left; (void)top; (void)right; (void)bottom;
+	((RenderStats*)ctx)->ops[OP_BOX]++;
+}
+
+static void RecordEllipse(void *ctx, byte style, int left, int top, int right, int bottom) {
+	(void)style; (void)left; (void)top; (void)right; (void)bottom;
+	((RenderStats*)ctx)->ops[OP_ELLIPSE]++;
+}
+
+static void RecordLines(void *ctx, byte style, const int *points, byte count) {
+	(void)style; (void)points; (void)count;
+	((RenderStats*)ctx)->ops[OP_LINES]++;
+}
+
+static void RecordText(void *ctx, byte font, int x, int y, int width, int height, byte format, const char *str) {
+	(void)font; (void)x; (void)y; (void)width; (void)height; (void)format; (void)str;
+	((RenderStats*)ctx)->ops[OP_TEXT]++;
+}
+
+static void RecordLayer(void *ctx, byte layer) {
+	(void)ctx; (void)layer;
+}
+
+static void RecordCopy(void *ctx, byte from, int left, int top, int right, int bottom) {
+	(void)from; (void)left; (void)top; (void)right; (void)bottom;
+	((RenderStats*)ctx)->ops[OP_COPY]++;
+}
+
+const RenderBackend RecordBackend = {
+	RecordStyle, RecordFont, RecordFree, RecordClear, RecordBox, RecordEllipse, RecordLines, RecordText, RecordLayer, RecordCopy
+};
@@ -0,0 +1,117 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "Game.h"
+
+/*
+ *Render.h
+ *A small drawing interface so that the game's drawing code doesn't have
+ *to know about GDI. A backend supplies the functions below; the renderer
+ *keeps the list of styles (a color plus an optional line width) and fonts
+ *and only asks the backend to create them when they change, which is at
+ *startup and when the screen resolution changes. Drawing refers to them
+ *by their number.
+ *
+ *Drawing goes to one of MAX_LAYERS layers. The game draws what rarely
+ *changes once into LAYER_STATIC and copies boxes of it back onto
+ *LAYER_SCREEN to wipe out what moves (see Draw.c).
+ *
+ *RecordBackend does no drawing at all and only counts what it is asked
+ *to do, so the drawing code can be measured anywhere. The renderer also
+ *counts the pixels each operation covers, its box, on any backend.
+*/
+
+
+#define MAX_STYLES		8
+#define MAX_FONTS		4
+#define MAX_LAYERS		2
+
+//Layers
+#define LAYER_SCREEN	0	//what is shown
+#define LAYER_STATIC	1	//what only changes with the state or the resolution
+
+//Text formats (same meaning as the GDI DT_* flags)
+#define TEXT_LEFT		0x00
+#define TEXT_CENTER		0x01
+#define TEXT_RIGHT		0x02
+#define TEXT_VCENTER	0x04
+
+//Font flags
+#define FONT_SMOOTH		0x01	//antialiased
+#define FONT_CLEAR		0x02	//transparent background instead of black
+
+//Colors are 0x00BBGGRR like GDI's COLORREF
+typedef struct Style {
+	uint32_t color;
+	short lineWidth;	//0 fills shapes with the color, otherwise draws lines this wide
+} Style;
+
+typedef struct FontDesc {
+	short height;
+	byte flags;
+	const char *face;
+} FontDesc;
+
+//Drawing operations, for counting
+#define OP_CLEAR		0
+#define OP_BOX			1
+#define OP_ELLIPSE		2
+#define OP_LINES		3
+#define OP_TEXT			4
+#define OP_COPY			5
+#define OP_COUNT		6
+
+//What a backend has to be able to do. Boxes are given like GDI's
+//Rectangle/Ellipse (right and bottom edges left out) and clearing like FillRect.
+//Everything is drawn on the layer picked last, LAYER_SCREEN at first.
+typedef struct RenderBackend {
+	bool (*MakeStyle)(void *ctx, byte id, const Style *style);
+	bool (*MakeFont)(void *ctx, byte id, const FontDesc *font);
+	void (*FreeResources)(void *ctx);
+	void (*Clear)(void *ctx, int left, int top, int right, int bottom);
+	void (*Box)(void *ctx, byte style, int left, int top, int right, int bottom);
+	void (*Ellipse)(void *ctx, byte style, int left, int top, int right, int bottom);
+	void (*Lines)(void *ctx, byte style, const int *points, byte count);
+	void (*Text)(void *ctx, byte font, int x, int y, int width, int height, byte format, const char *str);
+	void (*Layer)(void *ctx, byte layer);
+	void (*Copy)(void *ctx, byte from, int left, int top, int right, int bottom);
+} RenderBackend;
+
+//Running totals of everything asked of the backend
+typedef struct RenderStats {
+	unsigned long creations;
+	unsigned long ops[OP_COUNT];
+	uint64_t pixels;		//covered by the operations
+} RenderStats;
+
+typedef struct Renderer {
+	const RenderBackend *backend;
+	void *ctx;
+	Style styles[MAX_STYLES];
+	FontDesc fonts[MAX_FONTS];
+	byte styleCount, fontCount;
+	unsigned short width, height;	//the resolution the resources were made for
+	bool ready;
+	byte layer;						//drawn on
+	RenderStats stats;
+} Renderer;
+
+//Renderer functions
+void InitRenderer(Renderer *r, const RenderBackend *backend, void *ctx);
+bool NeedResources(Renderer *r, unsigned short width, unsigned short height);
+void SetStyle(Renderer *r, byte id, uint32_t color, short lineWidth);
+void SetFont(Renderer *r, byte id, short height, byte flags, const char *face);
+bool MakeResources(Renderer *r);
+void FreeRenderer(Renderer *r);
+void RenderClear(Renderer *r, int left, int top, int right, int bottom);
+void RenderBox(Renderer *r, byte style, int left, int top, int right, int bottom);
+void RenderEllipse(Renderer *r, byte style, int left, int top, int right, int bottom);
+void RenderLines(Renderer *r, byte style, const int *points, byte count);
+void RenderText(Renderer *r, byte font, int x, int y, int width, int height, byte format, const char *str);
+void RenderLayer(Renderer *r, byte layer);
+void RenderCopy(Renderer *r, byte from, int left, int top, int right, int bottom);
+
+//The counting backend, its context is a RenderStats
+extern const RenderBackend RecordBackend;
+
+#endif
@@ -0,0 +1,514 @@
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "Replay.h"
+#include "Wire.h"
+
+/*
+ *Replay.c
+ *Recording, reading and seeking replays, see Replay.h for the format.
+ *A replay is laid out as its header, the final snapshot, the keyframes
+ *(stream offset and snapshot) and then the input stream. A stream token
+ *is one byte: the input in the low 4 bits and the run length minus one in
+ *the high 4 bits, 15 meaning the length minus 16 follows 7 bits a byte.
+*/
+
+
+/*
+ *void SaveSnapshot(const Game*, byte*)
+ *This function writes everything there is to a match into SNAPSHOT_SIZE bytes
+*/
+void SaveSnapshot(const Game *g, byte *out) {
+	out = PutFloat(out, g->player.height);
+	out = PutFloat(out, g->player2.height);
+	out = PutFloat(out, g->ball.x);
+	out = PutFloat(out, g->ball.y);
+	out = PutFloat(out, g->ball.vx);
+	out = PutFloat(out, g->ball.vy);
+	*out++ = g->state;
+	out = Put16(out, g->score);
+	*out++ = g->mode;
+	*out++ = g->stateChange;
+	out = Put64(out, g->seed);
+	out = Put32(out, g->serves);
+	out = PutFloat(out, g->step);
+	*out++ = g->swept;
+
+	*out++ = g->ai.on;
+	*out++ = g->ai.left;
+	*out++ = g->ai.swept;
+	out = Put16(out, g->ai.delay);
+	out = PutFloat(out, g->ai.error);
+	out = Put64(out, g->ai.seed);
+	out = Put32(out, g->ai.solves);
+	out = Put16(out, g->ai.wait);
+	out = PutFloat(out, g->ai.vx);
+	out = PutFloat(out, g->ai.vy);
+	out = PutFloat(out, g->ai.target);
+	out = PutFloat(out, g->ai.next);
+
+	out = Put16(out, (uint16_t)g->physics.ballSpeed);
+	out = Put16(out, (uint16_t)g->physics.englishScale);
+	out = Put16(out, (uint16_t)g->physics.paddleHeight);
+	out = PutFloat(out, g->physics.aiSpeed);
+	out = PutFloat(out, g->physics.playerSpeed);
+	*out++ = g->physics.maxScore;
+	*out = g->fixed;
+}
+
+/*
+ *void LoadSnapshot(Game*, const byte*)
+ *This function reads a match back from what SaveSnapshot wrote
+*/
+void LoadSnapshot(Game *g, const byte *in) {
+	memset(g, 0, sizeof(Game));
+
+	g->player.height = GetFloat(in);
+	g->player2.height = GetFloat(in + 4);
+	g->ball.x = GetFloat(in + 8);
+	g->ball.y = GetFloat(in + 12);
+	g->ball.vx = GetFloat(in + 16);
+	g->ball.vy = GetFloat(in + 20);
+	g->state = in[24];
+	g->score = Get16(in + 25);
+	g->mode = in[27];
+	g->stateChange = in[28] != 0;
+	g->seed = Get64(in + 29);
+	g->serves = Get32(in + 37);
+	g->step = GetFloat(in + 41);
+	g->swept = in[45] != 0;
+
+	g->ai.on = in[46] != 0;
+	g->ai.left = in[47] != 0;
+	g->ai.swept = in[48] != 0;
+	g->ai.delay = Get16(in + 49);
+	g->ai.error = GetFloat(in + 51);
+	g->ai.seed = Get64(in + 55);
+	g->ai.solves = Get32(in + 63);
+	g->ai.wait = Get16(in + 67);
+	g->ai.vx = GetFloat(in + 69);
+	g->ai.vy = GetFloat(in + 73);
+	g->ai.target = GetFloat(in + 77);
+	g->ai.next = GetFloat(in + 81);
+
+	g->physics.ballSpeed = (short)Get16(in + 85);
+	g->physics.englishScale = (short)Get16(in + 87);
+	g->physics.paddleHeight = (short)Get16(in + 89);
+	g->physics.aiSpeed = GetFloat(in + 91);
+	g->physics.playerSpeed = GetFloat(in + 95);
+	g->physics.maxScore = in[99];
+	g->physics.profile = FindProfile(&g->physics);
+	g->fixed = in[100] != 0;
+}
+
+/*
+ *byte *Grow(byte**, size_t*, size_t, bool*)
+ *This function makes room for count more bytes after used ones in a
+ *buffer, doubling it when needed. It returns where they go or NULL.
+*/
+static byte *Grow(byte **buffer, size_t *capacity, size_t used, size_t count, bool *failed) {
+	if (used + count > *capacity) {
+		size_t size = *capacity ? *capacity * 2 : 256;
+		byte *bigger;
+
+		while (size < used + count)
+			size *= 2;
+		bigger = realloc(*buffer, size);
+		if (bigger == NULL) {
+			*failed = true;
+			return NULL;
+		}
+		*buffer = bigger;
+		*capacity = size;
+	}
+
+	return *buffer + used;
+}
+
+/*
+ *void Emit(Recorder*, byte, uint32_t)
+ *This function writes one token for a run of an input (or an event with
+ *a run of 0) to the stream
+*/
+static void Emit(Recorder *r, byte input, uint32_t run) {
+	byte *out = Grow(&r->stream, &r->streamCapacity, r->streamSize, 6, &r->failed), *start = out;
+
+	if (out == NULL)
+		return;
+
+	if (run < 16)
+		*out++ = input | (byte)((run ? run - 1 : 0) << 4);
+	else {
+		*out++ = input | 0xF0;
+		for (run -= 16; run >= 0x80; run >>= 7)
+			*out++ = (byte)(run | 0x80);
+		*out++ = (byte)run;
+	}
+
+	r->streamSize += out - start;
+}
+
+/*
+ *void Flush(Recorder*)
+ *This function writes out the run being recorded
+*/
+static void Flush(Recorder *r) {
+	if (r->run > 0)
+		Emit(r, r->input, r->run);
+	r->run = 0;
+}
+
+/*
+ *void AddKeyframe(Recorder*, const Game*)
+ *This function stores a snapshot of the match where the stream is now
+*/
+static void AddKeyframe(Recorder *r, const Game *g) {
+	size_t capacity = (size_t)r->keyCapacity * KEYFRAME_SIZE;
+	byte *out = Grow(&r->keys, &capacity, (size_t)r->keyCount * KEYFRAME_SIZE, KEYFRAME_SIZE, &r->failed);
+
+	r->keyCapacity = (uint32_t)(capacity / KEYFRAME_SIZE);
+	if (out == NULL)
+		return;
+
+	Put32(out, (uint32_t)r->streamSize);
+	SaveSnapshot(g, out + 4);
+	r->keyCount++;
+}
+
+/*
+ *bool InitRecorder(Recorder*, const Game*, uint32_t)
+ *This function starts recording a match from where it is now, with a
+ *keyframe every keyInterval ticks (0 for KEY_INTERVAL)
+*/
+bool InitRecorder(Recorder *r, const Game *g, uint32_t keyInterval) {
+	memset(r, 0, sizeof(Recorder));
+	r->keyInterval = keyInterval ? keyInterval : KEY_INTERVAL;
+	r->seed = g->seed;
+	AddKeyframe(r, g);
+
+	return !r->failed;
+}
+
+/*
+ *byte DirToInput(int)
+ *This function turns a paddle direction into its 2 bit input
+*/
+static byte DirToInput(int dir) {
+	return dir < 0 ? INPUT_UP : (dir > 0 ? INPUT_DOWN : INPUT_STILL);
+}
+
+/*
+ *int InputToDir(byte)
+ *This function turns a 2 bit input back into a paddle direction
+*/
+static int InputToDir(byte input) {
+	return input == INPUT_UP ? -1 : (input == INPUT_DOWN ? 1 : 0);
+}
+
+/*
+ *void RecordTick(Recorder*, Game*, int, int)
+ *This function runs one tick of the match (see TickGame) and records it
+*/
+void RecordTick(Recorder *r, Game *g, int playerDir, int player2Dir) {
+	byte input = 0;
+
+	//Only record what TickGame is going to look at, so that runs stay long
+	if (g->state != STATE_HOME)
+		input = DirToInput(playerDir) | DirToInput(g->mode == MODE_TWO ? player2Dir : 0) << 2;
+
+	if (input != r->input || r->run == UINT32_MAX) {
+		Flush(r);
+		r->input = input;
+	}
+	r->run++;
+
+	TickGame(g, playerDir, player2Dir);
+
+	//A keyframe is taken after the tick, before anything else happens
+	if (++r->ticks % r->keyInterval == 0) {
+		Flush(r);
+		AddKeyframe(r, g);
+	}
+}
+
+/*
+ *void ApplyEvent(Game*, byte)
+ *This function does what happens to the match between two ticks
+*/
+void ApplyEvent(Game *g, byte event) {
+	if (event == EVENT_ADVANCE)
+		AdvanceState(g);
+	else if (event == EVENT_MODE_ONE || event == EVENT_MODE_TWO) {
+		g->mode = event == EVENT_MODE_ONE ? MODE_ONE : MODE_TWO;
+		g->stateChange = true;
+	}
+}
+
+/*
+ *void RecordEvent(Recorder*, Game*, byte)
+ *This function applies an EVENT_* to the match and records it
+*/
+void RecordEvent(Recorder *r, Game *g, byte event) {
+	Flush(r);
+	Emit(r, INPUT_EVENT | event << 2, 0);
+
+	ApplyEvent(g, event);
+}
+
+/*
+ *bool SaveReplay(Recorder*, const Game*, FILE*)
+ *This function ends the recording of the match g and writes it out
+*/
+bool SaveReplay(Recorder *r, const Game *g, FILE *file) {
+	byte header[REPLAY_HEADER_SIZE], final[SNAPSHOT_SIZE], *out = header;
+	size_t keys = (size_t)r->keyCount * KEYFRAME_SIZE;
+
+	Flush(r);
+	if (r->failed)
+		return false;
+
+	out = Put32(out, REPLAY_MAGIC);
+	out = Put16(out, REPLAY_VERSION);
+	out = Put16(out, 0);
+	out = Put32(out, (uint32_t)(REPLAY_HEADER_SIZE + SNAPSHOT_SIZE + keys + r->streamSize));
+	out = Put32(out, r->keyInterval);
+	out = Put32(out, r->ticks);
+	out = Put32(out, r->keyCount);
+	out = Put32(out, (uint32_t)r->streamSize);
+	Put64(out, r->seed);
+	SaveSnapshot(g, final);
+
+	return fwrite(header, 1, sizeof(header), file) == sizeof(header) && fwrite(final, 1, sizeof(final), file) == sizeof(final) &&
+		fwrite(r->keys, 1, keys, file) == keys && fwrite(r->stream, 1, r->streamSize, file) == r->streamSize;
+}
+
+/*
+ *void FreeRecorder(Recorder*)
+ *This function frees a recorder's buffers
+*/
+void FreeRecorder(Recorder *r) {
+	free(r->stream);
+	free(r->keys);
+	memset(r, 0, sizeof(Recorder));
+}
+
+/*
+ *bool OpenReplay(Replay*, const void*, size_t)
+ *This function reads the replay at the start of data (which may go on
+ *with more replays) in place and checks that it holds together
+*/
+bool OpenReplay(Replay *r, const void *data, size_t size) {
+	const byte *in = data;
+
+	if (size < REPLAY_HEADER_SIZE || Get32(in) != REPLAY_MAGIC || Get16(in + 4) != REPLAY_VERSION)
+		return false;
+
+	r->data = in;
+	r->size = Get32(in + 8);
+	r->keyInterval = Get32(in + 12);
+	r->ticks = Get32(in + 16);
+	r->keyCount = Get32(in + 20);
+	r->streamSize = Get32(in + 24);
+	r->seed = Get64(in + 28);
+	r->final = in + REPLAY_HEADER_SIZE;
+	r->keys = r->final + SNAPSHOT_SIZE;
+	r->stream = r->keys + (size_t)r->keyCount * KEYFRAME_SIZE;
+
+	return r->size <= size && r->keyInterval > 0 && r->keyCount == r->ticks / r->keyInterval + 1 &&
+		(uint64_t)REPLAY_HEADER_SIZE + SNAPSHOT_SIZE + (uint64_t)r->keyCount * KEYFRAME_SIZE + r->streamSize == r->size;
+}
+
+/*
+ *bool NextRun(Playback*)
+ *This function reads tokens until there is a run of ticks to play,
+ *applying the events on the way. It fails at the end of the stream.
+*/
+static bool NextRun(Playback *p) {
+	const byte *end = p->r->stream + p->r->streamSize;
+
+	while (p->run == 0 && p->pos < end) {
+		byte token = *p->pos++;
+
+		if ((token & 3) == INPUT_EVENT) {
+			ApplyEvent(&p->g, token >> 2 & 3);
+			continue;
+		}
+
+		p->input = token & 0x0F;
+		if (token >> 4 < 15)
+			p->run = (token >> 4) + 1;
+		else {
+			uint32_t run = 0;
+			int shift;
+
+			for (shift = 0; p->pos < end && shift < 32; shift += 7) {
+				run |= (uint32_t)(*p->pos & 0x7F) << shift;
+				if (!(*p->pos++ & 0x80))
+					break;
+			}
+			p->run = run + 16;
+		}
+	}
+
+	return p->run > 0;
+}
+
+/*
+ *bool SeekReplay(Playback*, const Replay*, uint32_t)
+ *This function gets ready to play a replay from tick on, starting at the
+ *keyframe before it. It fails past the end of the replay.
+*/
+bool SeekReplay(Playback *p, const Replay *r, uint32_t tick) {
+	uint32_t key = tick / r->keyInterval;
+	const byte *keyframe = r->keys + (size_t)key * KEYFRAME_SIZE;
+
+	if (tick > r->ticks || Get32(keyframe) > r->streamSize)
+		return false;
+
+	p->r = r;
+	LoadSnapshot(&p->g, keyframe + 4);
+	p->tick = key * r->keyInterval;
+	p->pos = r->stream + Get32(keyframe);
+	p->run = 0;
+
+	while (p->tick < tick)
+		if (!PlayTick(p))
+			return false;
+
+	return true;
+}
+
+/*
+ *bool PlayTick(Playback*)
+ *This function plays the next tick of a replay and whatever happened
+ *before it. It returns false at the end of the replay.
+*/
+bool PlayTick(Playback *p) {
+	if (!NextRun(p))
+		return false;
+
+	p->run--;
+	p->tick++;
+	TickGame(&p->g, InputToDir(p->input & 3), InputToDir(p->input >> 2));
+
+	return true;
+}
+
+/*
+ *uint32_t PlayReplay(Playback*)
+ *This function plays the rest of a replay, which leaves p->g where the
+ *match was when it was saved, and returns the ticks played
+*/
+uint32_t PlayReplay(Playback *p) {
+	uint32_t start = p->tick;
+
+	//Whole runs at a time
+	while (NextRun(p)) {
+		int playerDir = InputToDir(p->input & 3), player2Dir = InputToDir(p->input >> 2);
+
+		p->tick += p->run;
+		for (; p->run > 0; p->run--)
+			TickGame(&p->g, playerDir, player2Dir);
+	}
+
+	return p->tick - start;
+}
+
+/*
+ *bool MapArchive(Archive*, const char*)
+ *This function maps a file of replays into memory to be read in place
+*/
+bool MapArchive(Archive *a, const char *path) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER size;
+
+	memset(a, 0, sizeof(Archive));
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		return false;
+	}
+	if (size.QuadPart == 0) { //Nothing to map, but an empty archive all the same
+		CloseHandle(file);
+		return true;
+	}
+
+	a->handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (a->handle == NULL)
+		return false;
+	a->data = MapViewOfFile(a->handle, FILE_MAP_READ, 0, 0, 0);
+	a->size = (size_t)size.QuadPart;
+	if (a->data == NULL) {
+		CloseHandle(a->handle);
+		return false;
+	}
+#else
+	int file = open(path, O_RDONLY);
+	struct stat info;
+	void *data;
+
+	memset(a, 0, sizeof(Archive));
+	if (file < 0)
+		return false;
+	if (fstat(file, &info) != 0) {
+		close(file);
+		return false;
+	}
+	if (info.st_size == 0) { //Nothing to map, but an empty archive all the same
+		close(file);
+		return true;
+	}
+
+	data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED)
+		return false;
+	a->data = data;
+	a->size = info.st_size;
+
+	//Replays are mostly read front to back
+	madvise(data, a->size, MADV_SEQUENTIAL);
+#endif
+
+	return true;
+}
+
+/*
+ *bool NextReplay(Archive*, Replay*)
+ *This function opens the next replay in an archive, false at its end
+ *or at anything that isn't a replay
+*/
+bool NextReplay(Archive *a, Replay *r) {
+	if (!OpenReplay(r, a->data + a->offset, a->size - a->offset))
+		return false;
+
+	a->offset += r->size;
+
+	return true;
+}
+
+/*
+ *void UnmapArchive(Archive*)
+ *This function unmaps an archive
+*/
+void UnmapArchive(Archive *a) {
+	if (a->data != NULL) {
+#ifdef _WIN32
+		UnmapViewOfFile(a->data);
+		CloseHandle(a->handle);
+#else
+		munmap((void *)a->data, a->size);
+#endif
+	}
+	memset(a, 0, sizeof(Archive));
+}
@@ -0,0 +1,109 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "Game.h"
+
+/*
+ *Replay.h
+ *Records matches as their starting state plus what was pressed on every
+ *tick, which is all it takes to play them again exactly: the serves come
+ *from the match's seed and everything else follows from the inputs.
+ *
+ *An input is 2 bits per paddle (still, up or down) and inputs are run
+ *length encoded, so holding a key or not touching anything at all costs
+ *a byte or two however long it lasts. The state changes that happen
+ *between ticks (space bar, picking a mode) are stored in the same stream
+ *as inputs that take no time.
+ *
+ *Every keyInterval ticks a snapshot of the whole match is stored in an
+ *index together with where its ticks start in the stream, so seeking to
+ *any tick is one lookup plus at most keyInterval ticks of simulation.
+ *
+ *A replay is one self-contained block of bytes with its size in its
+ *header, so an archive is simply replays written one after another, and
+ *it is read in place (mapped from the file) without copying anything.
+ *All numbers are stored little endian.
+*/
+
+
+#define REPLAY_MAGIC		0x4C505250	//"PRPL"
+#define REPLAY_VERSION		3
+#define REPLAY_HEADER_SIZE	36
+#define SNAPSHOT_SIZE		101
+#define KEYFRAME_SIZE		(4 + SNAPSHOT_SIZE)
+#define KEY_INTERVAL		3000		//30 s at the normal rate, a few bytes a second
+
+//Input of one paddle
+#define INPUT_STILL		0
+#define INPUT_UP		1
+#define INPUT_DOWN		2
+#define INPUT_EVENT		3	//in the player's bits, the player 2 bits say which event
+
+//Things that happen between two ticks
+#define EVENT_ADVANCE	0	//AdvanceState
+#define EVENT_MODE_ONE	1	//pick one player on the home screen
+#define EVENT_MODE_TWO	2	//pick two players on the home screen
+
+//A replay being recorded, growing in memory
+typedef struct Recorder {
+	uint32_t keyInterval, ticks;
+	uint64_t seed;
+	byte *stream, *keys;
+	size_t streamSize, streamCapacity;
+	uint32_t keyCount, keyCapacity;
+	byte input;			//the run being recorded
+	uint32_t run;
+	bool failed;		//ran out of memory at some point
+} Recorder;
+
+//A replay read in place, pointing into someone else's memory
+typedef struct Replay {
+	const byte *data;
+	uint32_t size, keyInterval, ticks, keyCount, streamSize;
+	uint64_t seed;
+	const byte *final, *keys, *stream;
+} Replay;
+
+//Plays a replay back tick by tick
+typedef struct Playback {
+	const Replay *r;
+	Game g;
+	uint32_t tick;
+	const byte *pos;	//the next token in the stream
+	byte input;			//the run being played
+	uint32_t run;
+} Playback;
+
+//A mapped file of replays written one after another
+typedef struct Archive {
+	const byte *data;
+	size_t size, offset;
+	void *handle;
+} Archive;
+
+//Snapshot functions
+void SaveSnapshot(const Game *g, byte *out);
+void LoadSnapshot(Game *g, const byte *in);
+
+//Recorder functions
+bool InitRecorder(Recorder *r, const Game *g, uint32_t keyInterval);
+void RecordTick(Recorder *r, Game *g, int playerDir, int player2Dir);
+void RecordEvent(Recorder *r, Game *g, byte event);
+bool SaveReplay(Recorder *r, const Game *g, FILE *file);
+void FreeRecorder(Recorder *r);
+
+//Playback functions
+void ApplyEvent(Game *g, byte event);
+bool OpenReplay(Replay *r, const void *data, size_t size);
+bool SeekReplay(Playback *p, const Replay *r, uint32_t tick);
+bool PlayTick(Playback *p);
+uint32_t PlayReplay(Playback *p);
+
+//Archive functions
+bool MapArchive(Archive *a, const char *path);
+bool NextReplay(Archive *a, Replay *r);
+void UnmapArchive(Archive *a);
+
+#endif
@@ -0,0 +1,274 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Runner.h"
+#include "FastForward.h"
+
+/*
+ *Runner.c
+ *Every worker owns a range of match numbers packed into one atomic word
+ *(first match in the low half, end in the high half). The owner takes
+ *small batches off the front and idle workers steal the back half of
+ *somebody else's range, both with a single compare and swap. Statistics
+ *are only ever added to the worker's own copy and summed after the join.
+*/
+
+//Matches an owner takes off its own range at a time
+#define BATCH	16
+
+#define RANGE(lo, hi)	((uint64_t)(hi) << 32 | (lo))
+#define RANGE_LO(r)		((unsigned int)(r))
+#define RANGE_HI(r)		((unsigned int)((r) >> 32))
+
+//Aligned to a cache line so workers never share one
+typedef struct Worker {
+	_Alignas(64) _Atomic uint64_t range;
+	RunStats stats;
+	const RunConfig *cfg;
+	struct Worker *all;
+	unsigned int index, count;
+	pthread_t thread;
+} Worker;
+
+
+/*
+ *void PlayMatch(Game*, const RunConfig*, RunStats*)
+ *This function plays a match from the first serve to the end (or maxTicks)
+ *and adds it to the statistics. The game must be initialized.
+*/
+void PlayMatch(Game *g, const RunConfig *cfg, RunStats *stats) {
+	unsigned int ticks = 0, hits = 0, played = 0;
+	bool fast = cfg->fast && cfg->player == NULL;
+	Intercept left;
+
+	g->mode = MODE_ONE;
+	g->state = STATE_SERVE;
+	g->score = 0;
+	InitIntercept(&g->ai, false, cfg->skill, g->seed);
+	InitIntercept(&left, true, cfg->skill, ~g->seed);
+	if (cfg->hz != 0)
+		SetTickRate(g, cfg->hz);
+	SetSwept(g, cfg->swept);
+	left.swept = cfg->swept;
+
+	while (g->state != STATE_END && (cfg->maxTicks == 0 || ticks < cfg->maxTicks)) {
+		byte before = g->state;
+		uint16_t score = g->score;
+		bool right = g->ball.vx > 0;
+
+		//Jump straight to the next tick where something happens
+		if (fast) {
+			unsigned int skipped = SkipTicks(g, &left, cfg->maxTicks == 0 ? UINT_MAX : cfg->maxTicks - ticks);
+
+			if (skipped > 0) {
+				ticks += skipped;
+				continue;
+			}
+		}
+
+		TickGame(g, cfg->player != NULL ? cfg->player(g, cfg->ctx) : 0, 0);
+		if (cfg->player == NULL && before == STATE_PLAY) //The same rule TickGame uses for the other AI
+			TickAI(g, &left, &g->player);
+		ticks++;
+		played++;
+
+		if (g->score != score) { //Somebody scored
+			stats->points[PLAYER_SCORE(g->score) == PLAYER_SCORE(score)]++;
+			stats->rallies[hits < RALLY_BUCKETS ? hits : RALLY_BUCKETS - 1]++;
+			stats->hits += hits;
+			hits = 0;
+		}
+		else if (before == STATE_PLAY && right != (g->ball.vx > 0)) //The ball came off a paddle
+			hits++;
+
+		//Nobody is around to press the space bar
+		if (g->state == STATE_READY)
+			AdvanceState(g);
+	}
+
+	stats->matches++;
+	stats->ticks += ticks;
+	stats->played += played;
+	if (g->state == STATE_END)
+		stats->wins[PLAYER_SCORE(g->score) < PLAYER2_SCORE(g->score)]++;
+	else
+		stats->unfinished++;
+}
+
+/*
+ *void AddStats(RunStats*, const RunStats*)
+ *This function adds one set of statistics to another
+*/
+static void AddStats(RunStats *to, const RunStats *from) {
+	unsigned int k;
+
+	to->matches += from->matches;
+	to->unfinished += from->unfinished;
+	to->ticks += from->ticks;
+	to->hits += from->hits;
+	to->played += from->played;
+	to->mismatches += from->mismatches;
+	for (k = 0; k < 2; k++) {
+		to->points[k] += from->points[k];
+		to->wins[k] += from->wins[k];
+	}
+	for (k = 0; k < RALLY_BUCKETS; k++)
+		to->rallies[k] += from->rallies[k];
+}
+
+/*
+ *bool SameGame(const Game*, const Game*)
+ *This function tells whether two matches ended up exactly the same
+*/
+static bool SameGame(const Game *a, const Game *b) {
+	return memcmp(&a->ball, &b->ball, sizeof(Ball)) == 0 &&
+		memcmp(&a->player, &b->player, sizeof(Paddle)) == 0 &&
+		memcmp(&a->player2, &b->player2, sizeof(Paddle)) == 0 &&
+		a->state == b->state && a->score == b->score && a->serves == b->serves &&
+		a->ai.target == b->ai.target && a->ai.next == b->ai.next && a->ai.wait == b->ai.wait && a->ai.solves == b->ai.solves;
+}
+
+/*
+ *void VerifyMatch(Game*, const RunConfig*, RunStats*)
+ *This function plays a match as configured and again tick by tick, keeps
+ *the first result and counts a mismatch if the two differ in any way
+*/
+static void VerifyMatch(Game *g, const RunConfig *cfg, RunStats *stats) {
+	RunConfig slow = *cfg;
+	RunStats a, b;
+	Game copy = *g;
+
+	memset(&a, 0, sizeof(a));
+	memset(&b, 0, sizeof(b));
+	slow.fast = false;
+
+	PlayMatch(g, cfg, &a);
+	PlayMatch(&copy, &slow, &b);
+
+	//How many ticks were actually run is the only thing allowed to differ
+	b.played = a.played;
+	if (memcmp(&a, &b, sizeof(RunStats)) != 0 || !SameGame(g, &copy))
+		a.mismatches++;
+
+	AddStats(stats, &a);
+}
+
+/*
+ *bool TakeMatches(Worker*, unsigned int*, unsigned int*)
+ *This function takes the next batch of matches off the worker's own range
+*/
+static bool TakeMatches(Worker *w, unsigned int *lo, unsigned int *hi) {
+	uint64_t r = atomic_load(&w->range);
+
+	while (RANGE_LO(r) < RANGE_HI(r)) {
+		unsigned int end = RANGE_HI(r) - RANGE_LO(r) > BATCH ? RANGE_LO(r) + BATCH : RANGE_HI(r);
+
+		if (atomic_compare_exchange_weak(&w->range, &r, RANGE(end, RANGE_HI(r)))) {
+			*lo = RANGE_LO(r);
+			*hi = end;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ *bool StealMatches(Worker*)
+ *This function moves the back half of another worker's range into
+ *this (empty) worker's range. It returns false once nobody has anything left.
+*/
+static bool StealMatches(Worker *w) {
+	unsigned int i;
+
+	for (i = 1; i < w->count; i++) {
+		Worker *victim = &w->all[(w->index + i) % w->count];
+		uint64_t r = atomic_load(&victim->range);
+
+		while (RANGE_LO(r) < RANGE_HI(r)) {
+			unsigned int mid = RANGE_LO(r) + (RANGE_HI(r) - RANGE_LO(r)) / 2;
+
+			if (atomic_compare_exchange_weak(&victim->range, &r, RANGE(RANGE_LO(r), mid))) {
+				atomic_store(&w->range, RANGE(mid, RANGE_HI(r)));
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/*
+ *void *Work(void*)
+ *This function is the body of every worker thread
+*/
+static void *Work(void *arg) {
+	Worker *w = arg;
+	unsigned int lo, hi;
+	Game g;
+
+	do {
+		while (TakeMatches(w, &lo, &hi)) {
+			for (; lo < hi; lo++) {
+				InitGame(&g, MatchSeed(w->cfg->seed, lo));
+				if (w->cfg->verify)
+					VerifyMatch(&g, w->cfg, &w->stats);
+				else
+					PlayMatch(&g, w->cfg, &w->stats);
+			}
+		}
+	} while (StealMatches(w));
+
+	return NULL;
+}
+
+/*
+ *bool RunMatches(const RunConfig*, RunStats*)
+ *This function plays all matches of the config and fills in the totals.
+ *Returns false if the workers could not be created.
+*/
+bool RunMatches(const RunConfig *cfg, RunStats *stats) {
+	unsigned int count = cfg->threads, i, k;
+	Worker *workers;
+
+	if (count == 0) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		count = cores > 0 ? (unsigned int)cores : 1;
+	}
+	if (count > cfg->matches)
+		count = cfg->matches > 0 ? cfg->matches : 1;
+
+	workers = aligned_alloc(_Alignof(Worker), sizeof(Worker) * count);
+	if (workers == NULL)
+		return false;
+
+	//Give everybody an equal share to start with
+	for (i = 0; i < count; i++) {
+		memset(&workers[i].stats, 0, sizeof(RunStats));
+		atomic_init(&workers[i].range, RANGE((uint64_t)cfg->matches * i / count, (uint64_t)cfg->matches * (i + 1) / count));
+		workers[i].cfg = cfg;
+		workers[i].all = workers;
+		workers[i].index = i;
+		workers[i].count = count;
+	}
+
+	//The calling thread is worker 0
+	for (i = 1; i < count; i++) {
+		if (pthread_create(&workers[i].thread, NULL, Work, &workers[i]) != 0)
+			break;
+	}
+	Work(&workers[0]);
+	for (k = 1; k < i; k++)
+		pthread_join(workers[k].thread, NULL);
+
+	memset(stats, 0, sizeof(RunStats));
+	for (i = 0; i < count; i++)
+		AddStats(stats, &workers[i].stats);
+
+	free(workers);
+
+	return true;
+}
@@ -0,0 +1,50 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include "Game.h"
+
+/*
+ *Runner.h
+ *Plays a large batch of independent one player matches on every core.
+ *Match i is seeded with MatchSeed(seed, i), so the statistics come out
+ *exactly the same for any number of threads.
+*/
+
+
+//Rally lengths (paddle hits before a point) are counted up to this many
+//buckets, the last bucket holds every longer rally
+#define RALLY_BUCKETS	16
+
+//Picks the direction (-1, 0 or 1) of the left paddle. It is called from
+//several threads at once, so it must not change anything shared.
+typedef int (*Controller)(const Game *g, void *ctx);
+
+typedef struct RunConfig {
+	unsigned int matches;
+	uint64_t seed;
+	unsigned int threads;	//0 runs one thread per core
+	unsigned int maxTicks;	//a match is given up after this many ticks, 0 for no limit
+	Controller player;		//NULL lets a second AI play the left side
+	void *ctx;
+	byte skill;				//SKILL_* of the AI paddles, SKILL_CHASE for the original AI
+	unsigned int hz;		//ticks per second, 0 for TICK_RATE
+	bool swept;				//move the ball with SweepBall, needed for much lower rates
+	bool fast;				//jump over the ticks where nothing happens (see FastForward.h), only
+							//AI against AI at the normal rate with the tick rules, ignored otherwise
+	bool verify;			//also play every match tick by tick and count the ones that differ
+} RunConfig;
+
+//Totals over all matches, index 0 is the left player and 1 the right one
+typedef struct RunStats {
+	uint64_t matches, unfinished, ticks, hits;
+	uint64_t played;		//ticks actually run, the rest were jumped over
+	uint64_t mismatches;	//matches that came out differently tick by tick (verify)
+	uint64_t points[2], wins[2];
+	uint64_t rallies[RALLY_BUCKETS];
+} RunStats;
+
+//Runner functions
+void PlayMatch(Game *g, const RunConfig *cfg, RunStats *stats);
+bool RunMatches(const RunConfig *cfg, RunStats *stats);
+
+#endif
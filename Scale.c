@@ -0,0 +1,219 @@
+#include <string.h>
+#include "Scale.h"
+#include "SimdBall.h"
+
+/*
+ *Scale.c
+ *The nearest neighbour scaler, see Scale.h. The wide stores only work
+ *while every table pixel is at least a screen pixel wide, so a screen
+ *smaller than the table is scaled a pixel at a time.
+*/
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX
+#include <immintrin.h>
+#endif
+
+
+/*
+ *void ScalarRow(const uint32_t*, uint32_t*, const uint16_t*, unsigned int, unsigned int)
+ *This function scales the table pixels first to last of a row a screen
+ *pixel at a time, it works on any CPU and any size
+*/
+static void ScalarRow(const uint32_t *row, uint32_t *out, const uint16_t *starts, unsigned int first, unsigned int last) {
+	unsigned int x, o;
+
+	for (x = first; x < last; x++)
+		for (o = starts[x]; o < starts[x + 1]; o++)
+			out[o] = row[x];
+}
+
+#ifdef HAVE_SSE2
+/*
+ *void SSE2Row(const uint32_t*, uint32_t*, const uint16_t*, unsigned int, unsigned int)
+ *This function scales a row storing 4 screen pixels at a time. The last
+ *store of a table pixel goes up to 3 pixels past it, which the next 3
+ *table pixels write over, so the last 3 are done a pixel at a time.
+*/
+static void SSE2Row(const uint32_t *row, uint32_t *out, const uint16_t *starts, unsigned int first, unsigned int last) {
+	unsigned int x = first, o;
+
+	for (; x + SIMD_SSE2 <= last; x++) {
+		__m128i v = _mm_set1_epi32((int)row[x]);
+
+		for (o = starts[x]; o < starts[x + 1]; o += SIMD_SSE2)
+			_mm_storeu_si128((__m128i *)(out + o), v);
+	}
+	ScalarRow(row, out, starts, x, last);
+}
+#endif
+
+#ifdef HAVE_AVX
+/*
+ *void AVX2Row(const uint32_t*, uint32_t*, const uint16_t*, unsigned int, unsigned int)
+ *This function scales a row storing 8 screen pixels at a time
+*/
+__attribute__((target("avx2")))
+static void AVX2Row(const uint32_t *row, uint32_t *out, const uint16_t *starts, unsigned int first, unsigned int last) {
+	unsigned int x = first, o;
+
+	for (; x + SIMD_AVX2 <= last; x++) {
+		__m256i v = _mm256_set1_epi32((int)row[x]);
+
+		for (o = starts[x]; o < starts[x + 1]; o += SIMD_AVX2)
+			_mm256_storeu_si256((__m256i *)(out + o), v);
+	}
+	ScalarRow(row, out, starts, x, last);
+}
+#endif
+
+/*
+ *void InitScaler(Scaler*, unsigned short, unsigned short)
+ *This function sets up a scaler for a screen of the given size
+*/
+void InitScaler(Scaler *s, unsigned short width, unsigned short height) {
+	unsigned int i;
+
+	memset(s, 0, sizeof(Scaler));
+	s->width = width;
+	s->height = height;
+	s->size = width < height ? width : height;
+	s->left = (width - s->size) / 2;
+	s->top = (height - s->size) / 2;
+	for (i = 0; i <= RESOLUTION; i++)
+		s->starts[i] = (uint16_t)(i * s->size / RESOLUTION);
+
+	//The stores stop at AVX2, a table pixel is rarely 16 screen pixels wide
+	s->lanes = SimdLanes() > SIMD_AVX2 ? SIMD_AVX2 : SimdLanes();
+}
+
+/*
+ *Rect MakeRect(int, int, int, int)
+ *This function returns a box as it is given, unlike RectangleBox it
+ *isn't kept on the table
+*/
+static Rect MakeRect(int left, int top, int right, int bottom) {
+	Rect r;
+
+	r.left = (short)left;
+	r.top = (short)top;
+	r.right = (short)right;
+	r.bottom = (short)bottom;
+
+	return r;
+}
+
+/*
+ *Rect ScaledRect(const Scaler*, Rect)
+ *This function returns where a box of the table is on the screen
+*/
+Rect ScaledRect(const Scaler *s, Rect box) {
+	return MakeRect(s->left + s->starts[box.left], s->top + s->starts[box.top], s->left + s->starts[box.right], s->top + s->starts[box.bottom]);
+}
+
+/*
+ *void FillScreen(Scaler*, uint32_t*, unsigned int, Rect)
+ *This function blackens a box of the screen
+*/
+static void FillScreen(Scaler *s, uint32_t *out, unsigned int stride, Rect box) {
+	int y;
+
+	for (y = box.top; y < box.bottom; y++)
+		memset(out + (size_t)y * stride + box.left, 0, (box.right - box.left) * sizeof(uint32_t));
+	s->written += (uint64_t)(box.right - box.left) * (box.bottom - box.top);
+}
+
+/*
+ *void ScaleBox(int, Scaler*, const uint32_t*, uint32_t*, unsigned int, Rect)
+ *This function scales a box of the table onto the screen: the first
+ *screen row of each table row is scaled and the others are copies of it
+*/
+static void ScaleBox(int lanes, Scaler *s, const uint32_t *pixels, uint32_t *out, unsigned int stride, Rect box) {
+	uint32_t *square = out + (size_t)s->top * stride + s->left;
+	unsigned int from = s->starts[box.left], length = (s->starts[box.right] - from) * sizeof(uint32_t), y, o;
+
+	for (y = box.top; y < (unsigned int)box.bottom; y++) {
+		const uint32_t *row = pixels + y * RESOLUTION;
+		uint32_t *first = square + (size_t)s->starts[y] * stride;
+
+		if (s->starts[y + 1] == s->starts[y])
+			continue;
+
+		switch (lanes) {
+#ifdef HAVE_AVX
+		case SIMD_AVX2:
+			AVX2Row(row, first, s->starts, box.left, box.right);
+			break;
+#endif
+#ifdef HAVE_SSE2
+		case SIMD_SSE2:
+			SSE2Row(row, first, s->starts, box.left, box.right);
+			break;
+#endif
+		default:
+			ScalarRow(row, first, s->starts, box.left, box.right);
+			break;
+		}
+
+		for (o = s->starts[y] + 1; o < s->starts[y + 1]; o++)
+			memcpy(square + (size_t)o * stride + from, first + from, length);
+	}
+	s->written += (uint64_t)(s->starts[box.right] - from) * (s->starts[box.bottom] - s->starts[box.top]);
+}
+
+/*
+ *unsigned int ScaleFrameWith(int, Scaler*, const uint32_t*, uint32_t*, unsigned int, const uint32_t*, Rect*)
+ *This function scales the tiles of a RASTER_32 table set in dirty (every
+ *tile if it's NULL) onto a screen of stride pixels per row with the stores
+ *of the given width (SIMD_SCALAR, SIMD_SSE2 or SIMD_AVX2, it has to be
+ *supported), and the bars the first time. It fills in the boxes of the
+ *screen it wrote and returns how many there are, at most SCALE_MAX_RECTS.
+*/
+unsigned int ScaleFrameWith(int lanes, Scaler *s, const uint32_t *pixels, uint32_t *out, unsigned int stride, const uint32_t *dirty, Rect *rects) {
+	Rect boxes[MAX_DIRTY_RECTS], bars[4];
+	unsigned int count, i, k = 0;
+
+	//The wide stores need every table pixel to be a screen pixel wide at least
+	if (s->size < RESOLUTION)
+		lanes = SIMD_SCALAR;
+
+	if (!s->bars) {
+		bars[0] = MakeRect(0, 0, s->left, s->height);
+		bars[1] = MakeRect(s->left + s->size, 0, s->width, s->height);
+		bars[2] = MakeRect(s->left, 0, s->left + s->size, s->top);
+		bars[3] = MakeRect(s->left, s->top + s->size, s->left + s->size, s->height);
+		for (i = 0; i < 4; i++)
+			if (bars[i].right > bars[i].left && bars[i].bottom > bars[i].top) {
+				FillScreen(s, out, stride, bars[i]);
+				rects[k++] = bars[i];
+			}
+		s->bars = true;
+	}
+
+	if (dirty != NULL)
+		count = DirtyRects(dirty, boxes);
+	else {
+		boxes[0] = MakeRect(0, 0, RESOLUTION, RESOLUTION);
+		count = 1;
+	}
+
+	for (i = 0; i < count; i++) {
+		ScaleBox(lanes, s, pixels, out, stride, boxes[i]);
+		rects[k++] = ScaledRect(s, boxes[i]);
+	}
+
+	return k;
+}
+
+/*
+ *unsigned int ScaleFrame(Scaler*, const uint32_t*, uint32_t*, unsigned int, const uint32_t*, Rect*)
+ *This function scales the changed tiles with the widest stores the CPU has
+*/
+unsigned int ScaleFrame(Scaler *s, const uint32_t *pixels, uint32_t *out, unsigned int stride, const uint32_t *dirty, Rect *rects) {
+	return ScaleFrameWith(s->lanes, s, pixels, out, stride, dirty, rects);
+}
@@ -0,0 +1,45 @@
+#ifndef SCALE_H
+#define SCALE_H
+
+#include <stdint.h>
+#include "FrameDiff.h"
+
+/*
+ *Scale.h
+ *Blows the RESOLUTION x RESOLUTION table up to the screen with nearest
+ *neighbour scaling, straight into a 32 bit screen sized buffer. The table
+ *fills the largest square in the middle of the screen and the bars beside
+ *it are black.
+ *
+ *Where each pixel of the table starts on the screen is worked out once,
+ *across and down, so sizes that aren't a multiple of RESOLUTION (1080 is
+ *8.4375 times) cost no division per pixel. A row is made by storing each
+ *table pixel 4 or 8 at a time (SSE2 or AVX2) from its start, the next one
+ *writing over what went too far, and then copied down to the other screen
+ *rows of the same table row.
+ *
+ *Only the tiles that changed (a mask from FrameDiff.h) are scaled and the
+ *bars are only written the first time, so a frame costs screen pixels in
+ *proportion to the motion. The boxes written come back in screen pixels
+ *to present.
+*/
+
+
+#define SCALE_MAX_RECTS	(MAX_DIRTY_RECTS + 4)	//the table's boxes and the bars
+
+typedef struct Scaler {
+	unsigned short width, height;		//the screen
+	unsigned short size, left, top;		//the square the table fills
+	uint16_t starts[RESOLUTION + 1];	//where each table pixel starts across and down the square
+	int lanes;							//the stores used
+	bool bars;							//the bars have been written
+	uint64_t written;					//screen pixels written so far
+} Scaler;
+
+//Scaler functions
+void InitScaler(Scaler *s, unsigned short width, unsigned short height);
+unsigned int ScaleFrame(Scaler *s, const uint32_t *pixels, uint32_t *out, unsigned int stride, const uint32_t *dirty, Rect *rects);
+unsigned int ScaleFrameWith(int lanes, Scaler *s, const uint32_t *pixels, uint32_t *out, unsigned int stride, const uint32_t *dirty, Rect *rects);
+Rect ScaledRect(const Scaler *s, Rect box);
+
+#endif
@@ -0,0 +1,668 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "Server.h"
+#include "Replay.h"
+#include "Netplay.h"
+#include "Loop.h"
+#include "Wire.h"
+
+/*
+ *Server.c
+ *The shards of the match server, see Server.h. Everything a shard touches
+ *is its own, the only thing shared is the stop flag.
+*/
+
+
+#define NO_MATCH	UINT32_MAX
+#define TOMBSTONE	UINT32_MAX	//in the table, a match that was dropped
+#define MS			1000000ull
+
+/*
+ *uint32_t *Find(Shard*, uint32_t, bool)
+ *This function returns the table entry of a match id, or with add the
+ *entry to put it in when it isn't there
+*/
+static uint32_t *Find(Shard *sh, uint32_t id, bool add) {
+	uint32_t i = (uint32_t)Random(id, 0) & sh->tableMask, *grave = NULL;
+
+	for (;; i = (i + 1) & sh->tableMask) {
+		uint32_t entry = sh->table[i];
+
+		if (entry == 0)
+			return add && grave != NULL ? grave : (add ? &sh->table[i] : NULL);
+		if (entry == TOMBSTONE) {
+			if (grave == NULL)
+				grave = &sh->table[i];
+		}
+		else if (sh->matches[entry - 1].id == id)
+			return &sh->table[i];
+	}
+}
+
+/*
+ *void Schedule(Shard*, uint32_t)
+ *This function puts a match in the wheel slot of its next tick, or the
+ *next slot to come if that one is already done (the shard fell behind)
+*/
+static void Schedule(Shard *sh, uint32_t m) {
+	uint64_t at = sh->matches[m].due / MS;
+	uint32_t slot = (uint32_t)(at > sh->slotTime ? at : sh->slotTime + 1) & (WHEEL_SLOTS - 1);
+
+	sh->matches[m].next = sh->wheel[slot];
+	sh->wheel[slot] = m;
+}
+
+/*
+ *void Rehash(Shard*)
+ *This function builds the table again without the tombstones
+*/
+static void Rehash(Shard *sh) {
+	uint32_t m;
+
+	memset(sh->table, 0, sizeof(uint32_t) * (sh->tableMask + 1));
+	sh->tombstones = 0;
+	for (m = 0; m < sh->capacity; m++)
+		if (sh->matches[m].used)
+			*Find(sh, sh->matches[m].id, true) = m + 1;
+}
+
+/*
+ *uint32_t MakeMatch(Shard*, uint32_t, byte, uint64_t)
+ *This function sets up a new match, on the home screen and due on the next
+ *free phase of the wheel. It returns NO_MATCH when the shard is full.
+*/
+static uint32_t MakeMatch(Shard *sh, uint32_t id, byte mode, uint64_t now) {
+	uint32_t m = sh->free;
+	uint64_t period = 1000000000ull / sh->server->hz;
+	Match *match;
+
+	if (m == NO_MATCH)
+		return NO_MATCH;
+
+	//The table is at least twice the matches, tombstones may not fill it up
+	if (sh->count + sh->tombstones >= (sh->tableMask + 1) / 4 * 3)
+		Rehash(sh);
+
+	match = &sh->matches[m];
+	sh->free = match->next;
+	sh->count++;
+	*Find(sh, id, true) = m + 1;
+
+	memset(match, 0, sizeof(Match));
+	match->used = true;
+	match->id = id;
+	InitGame(&match->g, MatchSeed(sh->server->port, id));
+	match->g.mode = mode == MODE_TWO ? MODE_TWO : MODE_ONE;
+	InitIntercept(&match->g.ai, false, sh->server->skill, match->g.seed);
+	match->heard = now;
+
+	//The first tick due on a whole millisecond, matches spread evenly over the period
+	match->due = (now / MS + 1 + sh->phase++ % (period / MS ? period / MS : 1)) * MS;
+	Schedule(sh, m);
+	sh->stats.made++;
+
+	return m;
+}
+
+/*
+ *void DropMatch(Shard*, uint32_t)
+ *This function frees a match (it must not be in the wheel)
+*/
+static void DropMatch(Shard *sh, uint32_t m) {
+	if (sh->matches[m].watch != NULL) {
+		FreeBroadcast(sh->matches[m].watch);
+		free(sh->matches[m].watch);
+		sh->matches[m].watch = NULL;
+	}
+	*Find(sh, sh->matches[m].id, false) = TOMBSTONE;
+	sh->tombstones++;
+	sh->matches[m].used = false;
+	sh->matches[m].next = sh->free;
+	sh->free = m;
+	sh->count--;
+	sh->stats.idled++;
+}
+
+/*
+ *void FlushOut(Shard*)
+ *This function sends the waiting packets with one system call and lets go
+ *of the spectator packets among them
+*/
+static void FlushOut(Shard *sh) {
+	struct mmsghdr msgs[SERVER_BATCH];
+	struct iovec iov[SERVER_BATCH];
+	struct sockaddr_in to[SERVER_BATCH];
+	unsigned int i;
+	int sent;
+
+	if (sh->outCount == 0)
+		return;
+
+	memset(msgs, 0, sizeof(struct mmsghdr) * sh->outCount);
+	memset(to, 0, sizeof(struct sockaddr_in) * sh->outCount);
+	for (i = 0; i < sh->outCount; i++) {
+		to[i].sin_family = AF_INET;
+		to[i].sin_addr.s_addr = sh->outAddress[i];
+		to[i].sin_port = sh->outPort[i];
+		iov[i].iov_base = (void *)sh->outData[i];
+		iov[i].iov_len = sh->outSize[i];
+		msgs[i].msg_hdr.msg_name = &to[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(to[i]);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	sent = sendmmsg(sh->socket, msgs, sh->outCount, 0);
+	sent = sent < 0 ? 0 : sent;
+	sh->stats.sent += sent;
+	sh->stats.dropped += sh->outCount - sent;
+	for (i = 0; i < sh->outCount; i++)
+		if (sh->outHeld[i] != NULL)
+			ReleasePacket(sh->outHeld[i]);
+	sh->outCount = 0;
+}
+
+/*
+ *void QueueOut(Shard*, const byte*, uint16_t, SharedPacket*, uint32_t, uint16_t)
+ *This function queues a packet to send, holding on to held (if not NULL)
+ *until it is gone
+*/
+static void QueueOut(Shard *sh, const byte *data, uint16_t size, SharedPacket *held, uint32_t address, uint16_t port) {
+	if (held != NULL)
+		RetainPacket(held);
+	sh->outData[sh->outCount] = data;
+	sh->outSize[sh->outCount] = size;
+	sh->outHeld[sh->outCount] = held;
+	sh->outAddress[sh->outCount] = address;
+	sh->outPort[sh->outCount] = port;
+
+	if (++sh->outCount == SERVER_BATCH)
+		FlushOut(sh);
+}
+
+/*
+ *void SendState(Shard*, const Match*, const Side*)
+ *This function queues a state packet for one side of a match
+*/
+static void SendState(Shard *sh, const Match *match, const Side *side) {
+	byte *out = sh->out[sh->outCount];
+
+	Put32(out, SERVER_MAGIC);
+	Put32(out + 4, match->id);
+	Put32(out + 8, match->ticks);
+	out[12] = match->g.state;
+	out[13] = (byte)PLAYER_SCORE(match->g.score);
+	out[14] = (byte)PLAYER2_SCORE(match->g.score);
+	PutFloat(out + 15, match->g.ball.x);
+	PutFloat(out + 19, match->g.ball.y);
+	PutFloat(out + 23, match->g.player.height);
+	PutFloat(out + 27, match->g.player2.height);
+	QueueOut(sh, out, SERVER_STATE_SIZE, NULL, side->address, side->port);
+}
+
+/*
+ *void Cast(Shard*, const Broadcast*, SharedPacket*)
+ *This function queues the same spectator packet for every spectator
+*/
+static void Cast(Shard *sh, const Broadcast *watch, SharedPacket *p) {
+	unsigned int i;
+
+	for (i = 0; i < watch->count; i++)
+		QueueOut(sh, p->data, p->size, p, watch->addresses[i], watch->ports[i]);
+	sh->stats.spectated += watch->count;
+}
+
+/*
+ *byte TakeInput(Side*)
+ *This function returns a side's input for the next tick
+*/
+static byte TakeInput(Side *side) {
+	byte input;
+
+	if (side->count == 0)
+		return side->held;
+
+	input = side->queue[side->head];
+	side->head = (side->head + 1) & (INPUT_QUEUE - 1);
+	side->count--;
+	side->held = input & 3;
+
+	return input;
+}
+
+/*
+ *void TickMatch(Shard*, uint32_t)
+ *This function plays one tick of a match with the inputs waiting for it
+*/
+static void TickMatch(Shard *sh, uint32_t m) {
+	Match *match = &sh->matches[m];
+	byte left = TakeInput(&match->sides[0]), right = TakeInput(&match->sides[1]);
+
+	NetTick(&match->g, left, right);
+	match->ticks++;
+
+	//The state goes out once the whole slot has ticked
+	if (match->ticks % sh->server->sendEvery == 0)
+		sh->sends[sh->sendCount++] = m;
+	if (match->watch != NULL && BroadcastTick(match->watch, &match->g) != NULL)
+		sh->casts[sh->castCount++] = m;
+}
+
+/*
+ *void RunWheel(Shard*, uint64_t)
+ *This function ticks every match that is due by now, slot after slot,
+ *and then sends out the states
+*/
+static void RunWheel(Shard *sh, uint64_t now) {
+	uint64_t period = 1000000000ull / sh->server->hz, end = now / MS;
+	uint32_t i;
+
+	for (; sh->slotTime <= end; sh->slotTime++) {
+		uint32_t slot = (uint32_t)sh->slotTime & (WHEEL_SLOTS - 1), m = sh->wheel[slot];
+
+		sh->wheel[slot] = NO_MATCH;
+		while (m != NO_MATCH) {
+			Match *match = &sh->matches[m];
+			uint32_t next = match->next;
+
+			//A later turn of the wheel
+			if (match->due / MS > sh->slotTime)
+				Schedule(sh, m);
+			else if (now - match->heard > SERVER_IDLE)
+				DropMatch(sh, m);
+			else {
+				uint64_t ran = MonotonicNow(NULL), late;
+
+				//A slot ticks up to a millisecond before the ticks in it are due
+				late = ran > match->due ? (ran - match->due) / 10000 : 0;
+
+				sh->stats.lateness[late < LATENESS_BUCKETS ? late : LATENESS_BUCKETS - 1]++;
+				TickMatch(sh, m);
+				sh->stats.ticks++;
+
+				match->due += period;
+				Schedule(sh, m);
+			}
+			m = next;
+		}
+
+		for (i = 0; i < sh->sendCount; i++) {
+			Match *match = &sh->matches[sh->sends[i]];
+
+			if (match->sides[0].joined)
+				SendState(sh, match, &match->sides[0]);
+			if (match->sides[1].joined)
+				SendState(sh, match, &match->sides[1]);
+		}
+		sh->sendCount = 0;
+
+		//A match ticks once a slot, so the packet it finished is still the
+		//last one of its history
+		for (i = 0; i < sh->castCount; i++) {
+			Broadcast *watch = sh->matches[sh->casts[i]].watch;
+
+			Cast(sh, watch, watch->history[watch->historyCount - 1]);
+		}
+		sh->castCount = 0;
+	}
+
+	FlushOut(sh);
+}
+
+/*
+ *void Watch(Shard*, Match*, bool, const struct sockaddr_in*)
+ *This function starts or stops sending a match to a spectator. A new one
+ *is sent what was streamed since the last keyframe.
+*/
+static void Watch(Shard *sh, Match *match, bool start, const struct sockaddr_in *from) {
+	Broadcast *watch = match->watch;
+	unsigned int i;
+
+	if (!start) {
+		if (watch != NULL)
+			RemoveSpectator(watch, from->sin_addr.s_addr, from->sin_port);
+		return;
+	}
+
+	if (watch == NULL) {
+		watch = match->watch = malloc(sizeof(Broadcast));
+		if (watch == NULL)
+			return;
+		InitBroadcast(watch, match->id);
+	}
+
+	if (!AddSpectator(watch, from->sin_addr.s_addr, from->sin_port))
+		return;
+	for (i = 0; i < watch->historyCount - watch->open; i++) {
+		QueueOut(sh, watch->history[i]->data, watch->history[i]->size, watch->history[i], from->sin_addr.s_addr, from->sin_port);
+		sh->stats.spectated++;
+	}
+}
+
+/*
+ *void Receive(Shard*, const byte*, unsigned int, const struct sockaddr_in*, uint64_t)
+ *This function queues the input in a client's packet, or starts or stops
+ *a spectator's stream
+*/
+static void Receive(Shard *sh, const byte *data, unsigned int size, const struct sockaddr_in *from, uint64_t now) {
+	uint32_t id, *entry, m;
+	Side *side;
+
+	if (size < SERVER_INPUT_SIZE || Get32(data) != SERVER_MAGIC || data[8] > 3)
+		return;
+
+	id = Get32(data + 4);
+	entry = Find(sh, id, false);
+
+	//Spectators only watch matches that are already there
+	if (data[8] > 1) {
+		if (entry != NULL)
+			Watch(sh, &sh->matches[*entry - 1], data[8] == 2, from);
+		return;
+	}
+
+	m = entry != NULL ? *entry - 1 : MakeMatch(sh, id, data[9], now);
+	if (m == NO_MATCH)
+		return;
+
+	side = &sh->matches[m].sides[data[8]];
+	side->joined = true;
+	side->address = from->sin_addr.s_addr;
+	side->port = from->sin_port;
+	sh->matches[m].heard = now;
+	if (data[10] & SERVER_KEEPALIVE)
+		return;
+
+	//A full queue loses its oldest input
+	if (side->count == INPUT_QUEUE) {
+		side->head = (side->head + 1) & (INPUT_QUEUE - 1);
+		side->count--;
+	}
+	side->queue[(side->head + side->count++) & (INPUT_QUEUE - 1)] = data[10];
+}
+
+/*
+ *void ReceiveAll(Shard*)
+ *This function reads every waiting packet, a batch per system call
+*/
+static void ReceiveAll(Shard *sh) {
+	struct mmsghdr msgs[SERVER_BATCH];
+	struct iovec iov[SERVER_BATCH];
+	struct sockaddr_in from[SERVER_BATCH];
+	byte data[SERVER_BATCH][16];
+	int got, i;
+
+	do {
+		uint64_t now;
+
+		memset(msgs, 0, sizeof(msgs));
+		for (i = 0; i < SERVER_BATCH; i++) {
+			iov[i].iov_base = data[i];
+			iov[i].iov_len = sizeof(data[i]);
+			msgs[i].msg_hdr.msg_name = &from[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		got = recvmmsg(sh->socket, msgs, SERVER_BATCH, MSG_DONTWAIT, NULL);
+		now = MonotonicNow(NULL);
+		for (i = 0; i < got; i++)
+			Receive(sh, data[i], msgs[i].msg_len, &from[i], now);
+		sh->stats.received += got > 0 ? got : 0;
+	} while (got == SERVER_BATCH);
+}
+
+/*
+ *void *RunShard(void*)
+ *This function is a shard's thread: its event loop
+*/
+static void *RunShard(void *arg) {
+	Shard *sh = arg;
+	struct epoll_event events[2];
+	struct timespec cpu;
+	cpu_set_t cores;
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	//Pinned to a core of its own (as far as there are enough)
+	CPU_ZERO(&cores);
+	CPU_SET(sh->index % (count > 0 ? count : 1), &cores);
+	pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+
+	while (!sh->server->stop) {
+		int n = epoll_wait(sh->epoll, events, 2, 100), i;
+		bool tick = false;
+
+		//Ticks first, they are the ones that can be late
+		for (i = 0; i < n; i++) {
+			if (events[i].data.fd == sh->timer) {
+				uint64_t expirations;
+
+				tick = read(sh->timer, &expirations, sizeof(expirations)) > 0;
+			}
+		}
+		if (tick)
+			RunWheel(sh, MonotonicNow(NULL));
+		for (i = 0; i < n; i++)
+			if (events[i].data.fd == sh->socket)
+				ReceiveAll(sh);
+	}
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+	sh->stats.cpu = (uint64_t)cpu.tv_sec * 1000000000ull + cpu.tv_nsec;
+
+	return NULL;
+}
+
+/*
+ *bool OpenShard(Shard*, uint32_t)
+ *This function sets up a shard's matches, socket, timer and epoll
+*/
+static bool OpenShard(Shard *sh, uint32_t capacity) {
+	struct sockaddr_in local;
+	struct itimerspec every;
+	struct epoll_event event;
+	uint32_t i, table = 2;
+	uint64_t now = MonotonicNow(NULL);
+
+	while (table < capacity * 2)
+		table *= 2;
+
+	sh->socket = sh->epoll = sh->timer = -1;
+	sh->capacity = capacity;
+	sh->matches = calloc(capacity, sizeof(Match));
+	sh->table = calloc(table, sizeof(uint32_t));
+	sh->tableMask = table - 1;
+	sh->sends = malloc(sizeof(uint32_t) * capacity);
+	sh->casts = malloc(sizeof(uint32_t) * capacity);
+	if (sh->matches == NULL || sh->table == NULL || sh->sends == NULL || sh->casts == NULL)
+		return false;
+
+	for (i = 0; i < capacity; i++) {
+		sh->matches[i].used = false;
+		sh->matches[i].watch = NULL;
+		sh->matches[i].next = i + 1 < capacity ? i + 1 : NO_MATCH;
+	}
+	sh->free = 0;
+	for (i = 0; i < WHEEL_SLOTS; i++)
+		sh->wheel[i] = NO_MATCH;
+	sh->slotTime = now / MS;
+
+	sh->socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+	if (sh->socket < 0)
+		return false;
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(sh->server->port + sh->index);
+	if (bind(sh->socket, (struct sockaddr *)&local, sizeof(local)) != 0)
+		return false;
+
+	//Fires on every whole millisecond
+	sh->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	if (sh->timer < 0)
+		return false;
+	every.it_interval.tv_sec = 0;
+	every.it_interval.tv_nsec = MS;
+	every.it_value.tv_sec = (now / MS + 1) * MS / 1000000000ull;
+	every.it_value.tv_nsec = (now / MS + 1) * MS % 1000000000ull;
+	if (timerfd_settime(sh->timer, TFD_TIMER_ABSTIME, &every, NULL) != 0)
+		return false;
+
+	sh->epoll = epoll_create1(0);
+	if (sh->epoll < 0)
+		return false;
+	event.events = EPOLLIN;
+	event.data.fd = sh->socket;
+	if (epoll_ctl(sh->epoll, EPOLL_CTL_ADD, sh->socket, &event) != 0)
+		return false;
+	event.data.fd = sh->timer;
+
+	return epoll_ctl(sh->epoll, EPOLL_CTL_ADD, sh->timer, &event) == 0;
+}
+
+/*
+ *void CloseShard(Shard*)
+ *This function frees what OpenShard made
+*/
+static void CloseShard(Shard *sh) {
+	uint32_t m;
+
+	FlushOut(sh);
+	for (m = 0; sh->matches != NULL && m < sh->capacity; m++) {
+		if (sh->matches[m].watch != NULL) {
+			FreeBroadcast(sh->matches[m].watch);
+			free(sh->matches[m].watch);
+		}
+	}
+	if (sh->epoll >= 0)
+		close(sh->epoll);
+	if (sh->timer >= 0)
+		close(sh->timer);
+	if (sh->socket >= 0)
+		close(sh->socket);
+	free(sh->matches);
+	free(sh->table);
+	free(sh->sends);
+	free(sh->casts);
+}
+
+/*
+ *bool StartServer(Server*, unsigned short, unsigned int, uint32_t, unsigned int, unsigned int)
+ *This function starts a server with shards threads (0 for one per core)
+ *on ports port to port + shards - 1, each holding up to matchesPerShard
+ *matches ticked hz times a second and sending their state every sendEvery ticks
+*/
+bool StartServer(Server *s, unsigned short port, unsigned int shards, uint32_t matchesPerShard, unsigned int hz, unsigned int sendEvery) {
+	unsigned int i, k;
+
+	if (shards == 0) {
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+		shards = count > 0 ? (unsigned int)count : 1;
+	}
+
+	memset(s, 0, sizeof(Server));
+	s->port = port;
+	s->hz = CLAMP(hz, 1, 1000);
+	s->sendEvery = sendEvery ? sendEvery : 1;
+	s->skill = SKILL_NORMAL;
+	s->shardCount = shards < SERVER_SHARDS ? shards : SERVER_SHARDS;
+	s->shards = calloc(s->shardCount, sizeof(Shard));
+	if (s->shards == NULL)
+		return false;
+
+	for (i = 0; i < s->shardCount; i++) {
+		s->shards[i].server = s;
+		s->shards[i].index = i;
+		if (!OpenShard(&s->shards[i], matchesPerShard) ||
+			pthread_create(&s->shards[i].thread, NULL, RunShard, &s->shards[i]) != 0) {
+			//Undo what was done so far
+			s->stop = true;
+			for (k = 0; k < i; k++)
+				pthread_join(s->shards[k].thread, NULL);
+			for (k = 0; k <= i; k++)
+				CloseShard(&s->shards[k]);
+			free(s->shards);
+			s->shards = NULL;
+			return false;
+		}
+		s->shards[i].running = true;
+	}
+
+	return true;
+}
+
+/*
+ *void ServerStats(const Server*, ShardStats*)
+ *This function adds up the statistics of every shard. While the server
+ *runs they are only roughly up to date.
+*/
+void ServerStats(const Server *s, ShardStats *total) {
+	unsigned int i, b;
+
+	memset(total, 0, sizeof(ShardStats));
+	for (i = 0; i < s->shardCount; i++) {
+		const ShardStats *st = &s->shards[i].stats;
+
+		total->ticks += st->ticks;
+		total->received += st->received;
+		total->sent += st->sent;
+		total->dropped += st->dropped;
+		total->made += st->made;
+		total->idled += st->idled;
+		total->spectated += st->spectated;
+		total->cpu += st->cpu;
+		for (b = 0; b < LATENESS_BUCKETS; b++)
+			total->lateness[b] += st->lateness[b];
+	}
+}
+
+/*
+ *double LatenessPercentile(const ShardStats*, double)
+ *This function returns the tick lateness (in seconds) that p (0 to 1) of
+ *the ticks were under, to the 10 us of a bucket
+*/
+double LatenessPercentile(const ShardStats *stats, double p) {
+	uint64_t total = 0, seen = 0;
+	unsigned int b;
+
+	for (b = 0; b < LATENESS_BUCKETS; b++)
+		total += stats->lateness[b];
+	for (b = 0; b < LATENESS_BUCKETS; b++) {
+		seen += stats->lateness[b];
+		if (seen > 0 && seen >= p * total)
+			break;
+	}
+
+	return (b + 1) * 10e-6;
+}
+
+/*
+ *void StopServer(Server*)
+ *This function stops every shard and frees the server. The statistics
+ *stay readable until the next StartServer.
+*/
+void StopServer(Server *s) {
+	unsigned int i;
+
+	s->stop = true;
+	for (i = 0; i < s->shardCount; i++) {
+		if (s->shards[i].running)
+			pthread_join(s->shards[i].thread, NULL);
+		CloseShard(&s->shards[i]);
+		s->shards[i].matches = NULL;
+		s->shards[i].table = NULL;
+		s->shards[i].sends = NULL;
+		s->shards[i].casts = NULL;
+	}
+}
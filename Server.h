@@ -0,0 +1,124 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <pthread.h>
+#include "Game.h"
+#include "Spectate.h"
+
+/*
+ *Server.h
+ *A dedicated match server for Linux that holds thousands of independent
+ *matches in one process. It is split into shards, each a thread pinned to
+ *a core with its own UDP port (port + shard) and its own epoll loop, so
+ *shards share nothing. Match id i lives on shard i % shards.
+ *
+ *Ticks are driven by a timer wheel of one millisecond slots. A match's
+ *first tick is due on a whole millisecond, spread over the slots, and the
+ *next ones every 1/hz seconds after it. Each tick sits in the slot of the
+ *millisecond it is due in and the slot ticks its batch when the timer
+ *fires, so at rates that don't divide 1000 (240 Hz) a tick can run up to
+ *a millisecond early. How late each tick ran (early ones count as on
+ *time) is kept in a histogram per shard.
+ *
+ *A client sends a SERVER_INPUT_SIZE packet whenever its input changes:
+ *magic, match id, side (0 left, 1 right), mode for a new match, input
+ *(an INPUT_* direction plus NET_ADVANCE, see Replay.h and Netplay.h).
+ *Inputs wait in a small queue per side and each tick takes one, holding
+ *the last direction when there is none. The first packet for a new match
+ *id makes the match, against the AI in one player mode. Every sendEvery
+ *ticks each side gets a SERVER_STATE_SIZE packet: magic, match id, tick,
+ *state, both scores, the ball x and y and both paddle heights. Matches
+ *nobody has sent anything to for SERVER_IDLE are dropped, so a client
+ *that holds still sends its input with SERVER_KEEPALIVE set every so
+ *often. That packet only says the client is still there, nothing is
+ *queued.
+ *
+ *A spectator sends the same packet with side 2 to start watching a match
+ *and side 3 to stop. It is sent the match's spectator stream (see
+ *Spectate.h), caught up from the last keyframe. Each packet of the stream
+ *is encoded once and the same buffer goes out to every spectator.
+*/
+
+
+#define SERVER_MAGIC		0x56525350	//"PSRV"
+#define SERVER_INPUT_SIZE	11
+#define SERVER_STATE_SIZE	31
+#define SERVER_SHARDS		64			//at most
+#define WHEEL_SLOTS			16			//one millisecond each, a power of two
+#define INPUT_QUEUE			8			//inputs a side can have waiting, a power of two
+#define LATENESS_BUCKETS	2048		//10 us each, the last holds everything later
+#define SERVER_BATCH		64			//packets sent or received per system call
+#define SERVER_IDLE			10000000000ull
+#define SERVER_KEEPALIVE	0x80		//in the input, see above
+
+//One side of a match
+typedef struct Side {
+	bool joined;
+	uint32_t address;			//network byte order
+	uint16_t port;
+	byte queue[INPUT_QUEUE];	//inputs not played yet
+	byte head, count;
+	byte held;					//the direction it is holding
+} Side;
+
+typedef struct Match {
+	Game g;
+	uint32_t id;
+	bool used;
+	Side sides[2];
+	uint64_t due;				//the next tick, nanoseconds on the monotonic clock
+	uint64_t heard;				//the last packet
+	uint32_t ticks;
+	uint32_t next;				//the next match in the same wheel slot, or UINT32_MAX
+	Broadcast *watch;			//the spectator stream, NULL until somebody watches
+} Match;
+
+//What a shard has done
+typedef struct ShardStats {
+	uint64_t ticks, received, sent, dropped, made, idled;
+	uint64_t spectated;			//spectator stream packets sent
+	uint32_t lateness[LATENESS_BUCKETS];
+	uint64_t cpu;				//nanoseconds the shard's thread has run
+} ShardStats;
+
+typedef struct Shard {
+	struct Server *server;
+	unsigned int index;
+	int socket, epoll, timer;
+	pthread_t thread;
+	bool running;
+	Match *matches;
+	uint32_t capacity, count, free;	//free is the first unused match, a list through next
+	uint32_t *table, tableMask;		//match ids to matches + 1, open addressed
+	uint32_t tombstones;			//entries of dropped matches
+	uint32_t wheel[WHEEL_SLOTS];	//the first match of each slot
+	uint64_t slotTime;				//the next millisecond the wheel hasn't done
+	unsigned int phase;				//spreads new matches over the slots
+	uint32_t *sends, sendCount;		//matches whose state goes out after this slot
+	uint32_t *casts, castCount;		//matches whose spectators get a packet after this slot
+	byte out[SERVER_BATCH][SERVER_STATE_SIZE];
+	const byte *outData[SERVER_BATCH];	//into out, or a held spectator packet
+	uint16_t outSize[SERVER_BATCH];
+	SharedPacket *outHeld[SERVER_BATCH];
+	uint32_t outAddress[SERVER_BATCH];
+	uint16_t outPort[SERVER_BATCH];
+	unsigned int outCount;
+	ShardStats stats;
+} Shard;
+
+typedef struct Server {
+	unsigned short port;
+	unsigned int hz, sendEvery;
+	byte skill;						//of the AI in one player matches
+	unsigned int shardCount;
+	Shard *shards;
+	volatile bool stop;
+} Server;
+
+//Server functions
+bool StartServer(Server *s, unsigned short port, unsigned int shards, uint32_t matchesPerShard, unsigned int hz, unsigned int sendEvery);
+void ServerStats(const Server *s, ShardStats *total);
+double LatenessPercentile(const ShardStats *stats, double p);
+void StopServer(Server *s);
+
+#endif
@@ -0,0 +1,582 @@
+#include <string.h>
+#include "SimdBall.h"
+
+/*
+ *SimdBall.c
+ *Every kernel does exactly the same float operations in the same order as
+ *MoveBall, it just computes both sides of every branch and blends them
+ *together with the comparison masks. The wider kernels are compiled for
+ *their instruction set on the side and only picked when the CPU has it.
+*/
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX
+#include <immintrin.h>
+#endif
+
+
+/*
+ *void ScalarBalls(...)
+ *This function is the fallback for any CPU and for the balls left over
+ *at the end of the arrays. Masks are only ORed into, never cleared.
+*/
+static void ScalarBalls(float *x, float *y, float *vx, float *vy, const float *player, const float *player2,
+	unsigned int first, unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	unsigned int i;
+
+	for (i = first; i < n; i++) {
+		Ball b = { x[i], y[i], vx[i], vy[i] };
+		Paddle p1 = { player[i] }, p2 = { player2[i] };
+		byte scored = MoveBall(&b, p1, p2);
+
+		x[i] = b.x;
+		y[i] = b.y;
+		vx[i] = b.vx;
+		vy[i] = b.vy;
+
+		if (scored == SCORED_PLAYER)
+			playerScored[i / 32] |= 1u << (i % 32);
+		else if (scored == SCORED_PLAYER2)
+			player2Scored[i / 32] |= 1u << (i % 32);
+	}
+}
+
+#ifdef HAVE_SSE2
+/*
+ *__m128 Blend4(__m128, __m128, __m128)
+ *This function picks b where the mask is set and a everywhere else
+*/
+static __m128 Blend4(__m128 a, __m128 b, __m128 mask) {
+	return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+/*
+ *unsigned int SSE2Balls(...)
+ *This function moves 4 balls per step and returns how many it moved
+*/
+static unsigned int SSE2Balls(float *x, float *y, float *vx, float *vy, const float *player, const float *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	const __m128 top = _mm_set1_ps(BALLSIZE + MARGIN), bottom = _mm_set1_ps(RESOLUTION - BALLSIZE + 1),
+		left = _mm_set1_ps(PADDLEWIDTH), right = _mm_set1_ps(RESOLUTION - PADDLEWIDTH),
+		half = _mm_set1_ps(PADDLEHEIGHT / 2.f), size = _mm_set1_ps(BALLSIZE), two = _mm_set1_ps(2),
+		scale = _mm_set1_ps(ENGLISHSCALE), hundred = _mm_set1_ps(100), sign = _mm_set1_ps(-0.f);
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128 bx = _mm_add_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(vx + i));
+		__m128 by = _mm_add_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(vy + i));
+		__m128 bvx = _mm_loadu_ps(vx + i), bvy = _mm_loadu_ps(vy + i);
+		__m128 p1 = _mm_loadu_ps(player + i), p2 = _mm_loadu_ps(player2 + i);
+		__m128 low, high, wall, inL, inR, p, hit, bounce, edge, english;
+
+		//Vertical collisions
+		low = _mm_cmplt_ps(by, top);
+		high = _mm_cmpgt_ps(by, bottom);
+		wall = _mm_or_ps(low, high);
+		edge = Blend4(bottom, top, low);
+		by = Blend4(by, _mm_add_ps(by, _mm_mul_ps(two, _mm_sub_ps(edge, by))), wall);
+		bvy = Blend4(bvy, _mm_xor_ps(bvy, sign), wall);
+
+		//Paddle collisions
+		inL = _mm_cmplt_ps(bx, left);
+		inR = _mm_andnot_ps(inL, _mm_cmpgt_ps(bx, right));
+		p = Blend4(p2, p1, inL);
+		hit = _mm_and_ps(_mm_cmpge_ps(by, _mm_sub_ps(_mm_sub_ps(p, half), size)),
+			_mm_cmple_ps(by, _mm_add_ps(_mm_add_ps(p, half), size)));
+		bounce = _mm_and_ps(_mm_or_ps(inL, inR), hit);
+		edge = Blend4(right, left, inL);
+		english = _mm_div_ps(_mm_mul_ps(_mm_xor_ps(_mm_sub_ps(p, by), sign), scale), hundred);
+
+		bx = Blend4(bx, _mm_add_ps(bx, _mm_mul_ps(two, _mm_sub_ps(edge, bx))), bounce);
+		bvx = Blend4(bvx, _mm_xor_ps(bvx, sign), bounce);
+		bvy = Blend4(bvy, _mm_add_ps(bvy, english), bounce);
+
+		_mm_storeu_ps(x + i, bx);
+		_mm_storeu_ps(y + i, by);
+		_mm_storeu_ps(vx + i, bvx);
+		_mm_storeu_ps(vy + i, bvy);
+
+		//Misses score for the other side
+		playerScored[i / 32] |= (uint32_t)_mm_movemask_ps(_mm_andnot_ps(hit, inR)) << (i % 32);
+		player2Scored[i / 32] |= (uint32_t)_mm_movemask_ps(_mm_andnot_ps(hit, inL)) << (i % 32);
+	}
+
+	return i;
+}
+#endif
+
+#ifdef HAVE_AVX
+/*
+ *unsigned int AVX2Balls(...)
+ *This function moves 8 balls per step and returns how many it moved
+*/
+__attribute__((target("avx2")))
+static unsigned int AVX2Balls(float *x, float *y, float *vx, float *vy, const float *player, const float *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	const __m256 top = _mm256_set1_ps(BALLSIZE + MARGIN), bottom = _mm256_set1_ps(RESOLUTION - BALLSIZE + 1),
+		left = _mm256_set1_ps(PADDLEWIDTH), right = _mm256_set1_ps(RESOLUTION - PADDLEWIDTH),
+		half = _mm256_set1_ps(PADDLEHEIGHT / 2.f), size = _mm256_set1_ps(BALLSIZE), two = _mm256_set1_ps(2),
+		scale = _mm256_set1_ps(ENGLISHSCALE), hundred = _mm256_set1_ps(100), sign = _mm256_set1_ps(-0.f);
+	unsigned int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256 bx = _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(vx + i));
+		__m256 by = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(vy + i));
+		__m256 bvx = _mm256_loadu_ps(vx + i), bvy = _mm256_loadu_ps(vy + i);
+		__m256 p1 = _mm256_loadu_ps(player + i), p2 = _mm256_loadu_ps(player2 + i);
+		__m256 low, high, wall, inL, inR, p, hit, bounce, edge, english;
+
+		//Vertical collisions
+		low = _mm256_cmp_ps(by, top, _CMP_LT_OQ);
+		high = _mm256_cmp_ps(by, bottom, _CMP_GT_OQ);
+		wall = _mm256_or_ps(low, high);
+		edge = _mm256_blendv_ps(bottom, top, low);
+		by = _mm256_blendv_ps(by, _mm256_add_ps(by, _mm256_mul_ps(two, _mm256_sub_ps(edge, by))), wall);
+		bvy = _mm256_blendv_ps(bvy, _mm256_xor_ps(bvy, sign), wall);
+
+		//Paddle collisions
+		inL = _mm256_cmp_ps(bx, left, _CMP_LT_OQ);
+		inR = _mm256_andnot_ps(inL, _mm256_cmp_ps(bx, right, _CMP_GT_OQ));
+		p = _mm256_blendv_ps(p2, p1, inL);
+		hit = _mm256_and_ps(_mm256_cmp_ps(by, _mm256_sub_ps(_mm256_sub_ps(p, half), size), _CMP_GE_OQ),
+			_mm256_cmp_ps(by, _mm256_add_ps(_mm256_add_ps(p, half), size), _CMP_LE_OQ));
+		bounce = _mm256_and_ps(_mm256_or_ps(inL, inR), hit);
+		edge = _mm256_blendv_ps(right, left, inL);
+		english = _mm256_div_ps(_mm256_mul_ps(_mm256_xor_ps(_mm256_sub_ps(p, by), sign), scale), hundred);
+
+		bx = _mm256_blendv_ps(bx, _mm256_add_ps(bx, _mm256_mul_ps(two, _mm256_sub_ps(edge, bx))), bounce);
+		bvx = _mm256_blendv_ps(bvx, _mm256_xor_ps(bvx, sign), bounce);
+		bvy = _mm256_blendv_ps(bvy, _mm256_add_ps(bvy, english), bounce);
+
+		_mm256_storeu_ps(x + i, bx);
+		_mm256_storeu_ps(y + i, by);
+		_mm256_storeu_ps(vx + i, bvx);
+		_mm256_storeu_ps(vy + i, bvy);
+
+		//Misses score for the other side
+		playerScored[i / 32] |= (uint32_t)_mm256_movemask_ps(_mm256_andnot_ps(hit, inR)) << (i % 32);
+		player2Scored[i / 32] |= (uint32_t)_mm256_movemask_ps(_mm256_andnot_ps(hit, inL)) << (i % 32);
+	}
+
+	return i;
+}
+
+/*
+ *__m512 Negate16(__m512, __mmask16)
+ *This function flips the sign of the masked floats like the unary minus does
+*/
+__attribute__((target("avx512f")))
+static __m512 Negate16(__m512 v, __mmask16 mask) {
+	__m512i bits = _mm512_castps_si512(v);
+
+	return _mm512_castsi512_ps(_mm512_mask_xor_epi32(bits, mask, bits, _mm512_set1_epi32((int)0x80000000)));
+}
+
+/*
+ *unsigned int AVX512Balls(...)
+ *This function moves 16 balls per step and returns how many it moved
+*/
+__attribute__((target("avx512f")))
+static unsigned int AVX512Balls(float *x, float *y, float *vx, float *vy, const float *player, const float *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	const __m512 top = _mm512_set1_ps(BALLSIZE + MARGIN), bottom = _mm512_set1_ps(RESOLUTION - BALLSIZE + 1),
+		left = _mm512_set1_ps(PADDLEWIDTH), right = _mm512_set1_ps(RESOLUTION - PADDLEWIDTH),
+		half = _mm512_set1_ps(PADDLEHEIGHT / 2.f), size = _mm512_set1_ps(BALLSIZE), two = _mm512_set1_ps(2),
+		scale = _mm512_set1_ps(ENGLISHSCALE), hundred = _mm512_set1_ps(100);
+	unsigned int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__m512 bx = _mm512_add_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(vx + i));
+		__m512 by = _mm512_add_ps(_mm512_loadu_ps(y + i), _mm512_loadu_ps(vy + i));
+		__m512 bvx = _mm512_loadu_ps(vx + i), bvy = _mm512_loadu_ps(vy + i);
+		__m512 p1 = _mm512_loadu_ps(player + i), p2 = _mm512_loadu_ps(player2 + i);
+		__m512 p, edge, english;
+		__mmask16 low, wall, inL, inR, hit, bounce;
+
+		//Vertical collisions
+		low = _mm512_cmp_ps_mask(by, top, _CMP_LT_OQ);
+		wall = low | _mm512_cmp_ps_mask(by, bottom, _CMP_GT_OQ);
+		edge = _mm512_mask_blend_ps(low, bottom, top);
+		by = _mm512_mask_blend_ps(wall, by, _mm512_add_ps(by, _mm512_mul_ps(two, _mm512_sub_ps(edge, by))));
+		bvy = Negate16(bvy, wall);
+
+		//Paddle collisions
+		inL = _mm512_cmp_ps_mask(bx, left, _CMP_LT_OQ);
+		inR = ~inL & _mm512_cmp_ps_mask(bx, right, _CMP_GT_OQ);
+		p = _mm512_mask_blend_ps(inL, p2, p1);
+		hit = _mm512_cmp_ps_mask(by, _mm512_sub_ps(_mm512_sub_ps(p, half), size), _CMP_GE_OQ) &
+			_mm512_cmp_ps_mask(by, _mm512_add_ps(_mm512_add_ps(p, half), size), _CMP_LE_OQ);
+		bounce = (inL | inR) & hit;
+		edge = _mm512_mask_blend_ps(inL, right, left);
+		english = _mm512_div_ps(_mm512_mul_ps(Negate16(_mm512_sub_ps(p, by), 0xFFFF), scale), hundred);
+
+		bx = _mm512_mask_blend_ps(bounce, bx, _mm512_add_ps(bx, _mm512_mul_ps(two, _mm512_sub_ps(edge, bx))));
+		bvx = Negate16(bvx, bounce);
+		bvy = _mm512_mask_add_ps(bvy, bounce, bvy, english);
+
+		_mm512_storeu_ps(x + i, bx);
+		_mm512_storeu_ps(y + i, by);
+		_mm512_storeu_ps(vx + i, bvx);
+		_mm512_storeu_ps(vy + i, bvy);
+
+		//Misses score for the other side
+		playerScored[i / 32] |= (uint32_t)(inR & ~hit) << (i % 32);
+		player2Scored[i / 32] |= (uint32_t)(inL & ~hit) << (i % 32);
+	}
+
+	return i;
+}
+#endif
+
+/*
+ *bool SimdSupported(int)
+ *This function checks whether this build and CPU can run the kernel
+ *with the given width
+*/
+bool SimdSupported(int lanes) {
+	switch (lanes) {
+	case SIMD_SCALAR:
+		return true;
+#ifdef HAVE_SSE2
+	case SIMD_SSE2:
+		return true;
+#endif
+#ifdef HAVE_AVX
+	case SIMD_AVX2:
+		return __builtin_cpu_supports("avx2");
+	case SIMD_AVX512:
+		return __builtin_cpu_supports("avx512f");
+#endif
+	default:
+		return false;
+	}
+}
+
+/*
+ *int SimdLanes()
+ *This function returns the widest kernel the CPU can run.
+ *The answer is looked up once and remembered.
+*/
+int SimdLanes(void) {
+	static int lanes = 0;
+
+	if (lanes == 0) {
+		int widths[] = { SIMD_AVX512, SIMD_AVX2, SIMD_SSE2, SIMD_SCALAR }, i;
+
+		for (i = 0; !SimdSupported(widths[i]); i++)
+			;
+		lanes = widths[i];
+	}
+
+	return lanes;
+}
+
+/*
+ *void MoveBallsWith(int, ...)
+ *This function moves n balls one tick with the kernel of the given width
+ *(which has to be supported) and clears and fills in the score masks
+*/
+void MoveBallsWith(int lanes, float *x, float *y, float *vx, float *vy, const float *player, const float *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	unsigned int done = 0;
+
+	memset(playerScored, 0, SCORE_WORDS(n) * sizeof(uint32_t));
+	memset(player2Scored, 0, SCORE_WORDS(n) * sizeof(uint32_t));
+
+	switch (lanes) {
+#ifdef HAVE_SSE2
+	case SIMD_SSE2:
+		done = SSE2Balls(x, y, vx, vy, player, player2, n, playerScored, player2Scored);
+		break;
+#endif
+#ifdef HAVE_AVX
+	case SIMD_AVX2:
+		done = AVX2Balls(x, y, vx, vy, player, player2, n, playerScored, player2Scored);
+		break;
+	case SIMD_AVX512:
+		done = AVX512Balls(x, y, vx, vy, player, player2, n, playerScored, player2Scored);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	//Whatever didn't fill a whole vector
+	ScalarBalls(x, y, vx, vy, player, player2, done, n, playerScored, player2Scored);
+}
+
+/*
+ *void MoveBalls(...)
+ *This function moves n balls one tick with the widest available kernel
+*/
+void MoveBalls(float *x, float *y, float *vx, float *vy, const float *player, const float *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	MoveBallsWith(SimdLanes(), x, y, vx, vy, player, player2, n, playerScored, player2Scored);
+}
+
+/*
+ *Fixed point kernels
+ *The same as MoveFixedBall on int32 lanes. The Q16.16 numbers take as
+ *many bits as floats, so a vector holds as many balls as the float
+ *kernels move, but compares, shifts and multiplies of integers give the
+ *same bits on any CPU whichever kernel runs.
+*/
+
+#define FX(n)		((n) * FIXED_ONE)
+#define ENGLISH_Q12	(ENGLISHSCALE * 4096 / 100)		//as FixedEnglishKernel takes it
+
+/*
+ *void ScalarFixedBalls(...)
+ *This function is the fixed point fallback, like ScalarBalls
+*/
+static void ScalarFixedBalls(Fixed *x, Fixed *y, Fixed *vx, Fixed *vy, const Fixed *player, const Fixed *player2,
+	unsigned int first, unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	unsigned int i;
+
+	for (i = first; i < n; i++) {
+		FixedBall b = { x[i], y[i], vx[i], vy[i] };
+		byte scored = MoveFixedBall(&b, player[i], player2[i]);
+
+		x[i] = b.x;
+		y[i] = b.y;
+		vx[i] = b.vx;
+		vy[i] = b.vy;
+
+		if (scored == SCORED_PLAYER)
+			playerScored[i / 32] |= 1u << (i % 32);
+		else if (scored == SCORED_PLAYER2)
+			player2Scored[i / 32] |= 1u << (i % 32);
+	}
+}
+
+#ifdef HAVE_SSE2
+/*
+ *__m128i BlendInt4(__m128i, __m128i, __m128i)
+ *This function picks b where the mask is set and a everywhere else
+*/
+static __m128i BlendInt4(__m128i a, __m128i b, __m128i mask) {
+	return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+}
+
+/*
+ *__m128i MulInt4(__m128i, __m128i)
+ *This function multiplies 32 bit integers keeping the low 32 bits of
+ *the products, which SSE2 has no instruction for
+*/
+static __m128i MulInt4(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b), odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/*
+ *unsigned int SSE2FixedBalls(...)
+ *This function moves 4 fixed point balls per step and returns how many it moved
+*/
+static unsigned int SSE2FixedBalls(Fixed *x, Fixed *y, Fixed *vx, Fixed *vy, const Fixed *player, const Fixed *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	const __m128i top = _mm_set1_epi32(FX(BALLSIZE + MARGIN)), bottom = _mm_set1_epi32(FX(RESOLUTION - BALLSIZE + 1)),
+		left = _mm_set1_epi32(FX(PADDLEWIDTH)), right = _mm_set1_epi32(FX(RESOLUTION - PADDLEWIDTH)),
+		reach = _mm_set1_epi32(PADDLEHEIGHT * (FIXED_ONE / 2) + FX(BALLSIZE)), scale = _mm_set1_epi32(ENGLISH_Q12),
+		fastest = _mm_set1_epi32(FX(FIXED_MAX_VY)), slowest = _mm_set1_epi32(-FX(FIXED_MAX_VY)), zero = _mm_setzero_si128();
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128i bvx = _mm_loadu_si128((const __m128i*)(vx + i)), bvy = _mm_loadu_si128((const __m128i*)(vy + i));
+		__m128i bx = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(x + i)), bvx);
+		__m128i by = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(y + i)), bvy);
+		__m128i p1 = _mm_loadu_si128((const __m128i*)(player + i)), p2 = _mm_loadu_si128((const __m128i*)(player2 + i));
+		__m128i low, wall, inL, inR, p, hit, bounce, edge, english, curved;
+
+		//Vertical collisions
+		low = _mm_cmplt_epi32(by, top);
+		wall = _mm_or_si128(low, _mm_cmpgt_epi32(by, bottom));
+		edge = BlendInt4(bottom, top, low);
+		by = BlendInt4(by, _mm_sub_epi32(_mm_add_epi32(edge, edge), by), wall);
+		bvy = BlendInt4(bvy, _mm_sub_epi32(zero, bvy), wall);
+
+		//Paddle collisions
+		inL = _mm_cmplt_epi32(bx, left);
+		inR = _mm_andnot_si128(inL, _mm_cmpgt_epi32(bx, right));
+		p = BlendInt4(p2, p1, inL);
+		hit = _mm_andnot_si128(_mm_or_si128(_mm_cmplt_epi32(by, _mm_sub_epi32(p, reach)), _mm_cmpgt_epi32(by, _mm_add_epi32(p, reach))),
+			_mm_set1_epi32(-1));
+		bounce = _mm_and_si128(_mm_or_si128(inL, inR), hit);
+		edge = BlendInt4(right, left, inL);
+		english = _mm_srai_epi32(MulInt4(_mm_srai_epi32(_mm_sub_epi32(by, p), 4), scale), 8);
+		curved = _mm_add_epi32(bvy, english);
+		curved = BlendInt4(curved, fastest, _mm_cmpgt_epi32(curved, fastest));
+		curved = BlendInt4(curved, slowest, _mm_cmplt_epi32(curved, slowest));
+
+		bx = BlendInt4(bx, _mm_sub_epi32(_mm_add_epi32(edge, edge), bx), bounce);
+		bvx = BlendInt4(bvx, _mm_sub_epi32(zero, bvx), bounce);
+		bvy = BlendInt4(bvy, curved, bounce);
+
+		_mm_storeu_si128((__m128i*)(x + i), bx);
+		_mm_storeu_si128((__m128i*)(y + i), by);
+		_mm_storeu_si128((__m128i*)(vx + i), bvx);
+		_mm_storeu_si128((__m128i*)(vy + i), bvy);
+
+		//Misses score for the other side
+		playerScored[i / 32] |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(hit, inR))) << (i % 32);
+		player2Scored[i / 32] |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(hit, inL))) << (i % 32);
+	}
+
+	return i;
+}
+#endif
+
+#ifdef HAVE_AVX
+/*
+ *unsigned int AVX2FixedBalls(...)
+ *This function moves 8 fixed point balls per step and returns how many it moved
+*/
+__attribute__((target("avx2")))
+static unsigned int AVX2FixedBalls(Fixed *x, Fixed *y, Fixed *vx, Fixed *vy, const Fixed *player, const Fixed *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	const __m256i top = _mm256_set1_epi32(FX(BALLSIZE + MARGIN)), bottom = _mm256_set1_epi32(FX(RESOLUTION - BALLSIZE + 1)),
+		left = _mm256_set1_epi32(FX(PADDLEWIDTH)), right = _mm256_set1_epi32(FX(RESOLUTION - PADDLEWIDTH)),
+		reach = _mm256_set1_epi32(PADDLEHEIGHT * (FIXED_ONE / 2) + FX(BALLSIZE)), scale = _mm256_set1_epi32(ENGLISH_Q12),
+		fastest = _mm256_set1_epi32(FX(FIXED_MAX_VY)), slowest = _mm256_set1_epi32(-FX(FIXED_MAX_VY)), zero = _mm256_setzero_si256();
+	unsigned int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256i bvx = _mm256_loadu_si256((const __m256i*)(vx + i)), bvy = _mm256_loadu_si256((const __m256i*)(vy + i));
+		__m256i bx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(x + i)), bvx);
+		__m256i by = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(y + i)), bvy);
+		__m256i p1 = _mm256_loadu_si256((const __m256i*)(player + i)), p2 = _mm256_loadu_si256((const __m256i*)(player2 + i));
+		__m256i low, wall, inL, inR, p, miss, bounce, edge, english;
+
+		//Vertical collisions
+		low = _mm256_cmpgt_epi32(top, by);
+		wall = _mm256_or_si256(low, _mm256_cmpgt_epi32(by, bottom));
+		edge = _mm256_blendv_epi8(bottom, top, low);
+		by = _mm256_blendv_epi8(by, _mm256_sub_epi32(_mm256_add_epi32(edge, edge), by), wall);
+		bvy = _mm256_blendv_epi8(bvy, _mm256_sub_epi32(zero, bvy), wall);
+
+		//Paddle collisions
+		inL = _mm256_cmpgt_epi32(left, bx);
+		inR = _mm256_andnot_si256(inL, _mm256_cmpgt_epi32(bx, right));
+		p = _mm256_blendv_epi8(p2, p1, inL);
+		miss = _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_sub_epi32(p, reach), by), _mm256_cmpgt_epi32(by, _mm256_add_epi32(p, reach)));
+		bounce = _mm256_andnot_si256(miss, _mm256_or_si256(inL, inR));
+		edge = _mm256_blendv_epi8(right, left, inL);
+		english = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_srai_epi32(_mm256_sub_epi32(by, p), 4), scale), 8);
+
+		bx = _mm256_blendv_epi8(bx, _mm256_sub_epi32(_mm256_add_epi32(edge, edge), bx), bounce);
+		bvx = _mm256_blendv_epi8(bvx, _mm256_sub_epi32(zero, bvx), bounce);
+		bvy = _mm256_blendv_epi8(bvy, _mm256_max_epi32(_mm256_min_epi32(_mm256_add_epi32(bvy, english), fastest), slowest), bounce);
+
+		_mm256_storeu_si256((__m256i*)(x + i), bx);
+		_mm256_storeu_si256((__m256i*)(y + i), by);
+		_mm256_storeu_si256((__m256i*)(vx + i), bvx);
+		_mm256_storeu_si256((__m256i*)(vy + i), bvy);
+
+		//Misses score for the other side
+		playerScored[i / 32] |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(miss, inR))) << (i % 32);
+		player2Scored[i / 32] |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(miss, inL))) << (i % 32);
+	}
+
+	return i;
+}
+
+/*
+ *unsigned int AVX512FixedBalls(...)
+ *This function moves 16 fixed point balls per step and returns how many it moved
+*/
+__attribute__((target("avx512f")))
+static unsigned int AVX512FixedBalls(Fixed *x, Fixed *y, Fixed *vx, Fixed *vy, const Fixed *player, const Fixed *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	const __m512i top = _mm512_set1_epi32(FX(BALLSIZE + MARGIN)), bottom = _mm512_set1_epi32(FX(RESOLUTION - BALLSIZE + 1)),
+		left = _mm512_set1_epi32(FX(PADDLEWIDTH)), right = _mm512_set1_epi32(FX(RESOLUTION - PADDLEWIDTH)),
+		reach = _mm512_set1_epi32(PADDLEHEIGHT * (FIXED_ONE / 2) + FX(BALLSIZE)), scale = _mm512_set1_epi32(ENGLISH_Q12),
+		fastest = _mm512_set1_epi32(FX(FIXED_MAX_VY)), slowest = _mm512_set1_epi32(-FX(FIXED_MAX_VY)), zero = _mm512_setzero_si512();
+	unsigned int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__m512i bvx = _mm512_loadu_si512(vx + i), bvy = _mm512_loadu_si512(vy + i);
+		__m512i bx = _mm512_add_epi32(_mm512_loadu_si512(x + i), bvx);
+		__m512i by = _mm512_add_epi32(_mm512_loadu_si512(y + i), bvy);
+		__m512i p1 = _mm512_loadu_si512(player + i), p2 = _mm512_loadu_si512(player2 + i);
+		__m512i p, edge, english;
+		__mmask16 low, wall, inL, inR, hit, bounce;
+
+		//Vertical collisions
+		low = _mm512_cmplt_epi32_mask(by, top);
+		wall = low | _mm512_cmpgt_epi32_mask(by, bottom);
+		edge = _mm512_mask_blend_epi32(low, bottom, top);
+		by = _mm512_mask_sub_epi32(by, wall, _mm512_add_epi32(edge, edge), by);
+		bvy = _mm512_mask_sub_epi32(bvy, wall, zero, bvy);
+
+		//Paddle collisions
+		inL = _mm512_cmplt_epi32_mask(bx, left);
+		inR = ~inL & _mm512_cmpgt_epi32_mask(bx, right);
+		p = _mm512_mask_blend_epi32(inL, p2, p1);
+		hit = _mm512_cmpge_epi32_mask(by, _mm512_sub_epi32(p, reach)) & _mm512_cmple_epi32_mask(by, _mm512_add_epi32(p, reach));
+		bounce = (inL | inR) & hit;
+		edge = _mm512_mask_blend_epi32(inL, right, left);
+		english = _mm512_srai_epi32(_mm512_mullo_epi32(_mm512_srai_epi32(_mm512_sub_epi32(by, p), 4), scale), 8);
+
+		bx = _mm512_mask_sub_epi32(bx, bounce, _mm512_add_epi32(edge, edge), bx);
+		bvx = _mm512_mask_sub_epi32(bvx, bounce, zero, bvx);
+		bvy = _mm512_mask_blend_epi32(bounce, bvy, _mm512_max_epi32(_mm512_min_epi32(_mm512_add_epi32(bvy, english), fastest), slowest));
+
+		_mm512_storeu_si512(x + i, bx);
+		_mm512_storeu_si512(y + i, by);
+		_mm512_storeu_si512(vx + i, bvx);
+		_mm512_storeu_si512(vy + i, bvy);
+
+		//Misses score for the other side
+		playerScored[i / 32] |= (uint32_t)(inR & ~hit) << (i % 32);
+		player2Scored[i / 32] |= (uint32_t)(inL & ~hit) << (i % 32);
+	}
+
+	return i;
+}
+#endif
+
+/*
+ *void MoveFixedBallsWith(int, ...)
+ *This function is MoveBallsWith for fixed point balls
+*/
+void MoveFixedBallsWith(int lanes, Fixed *x, Fixed *y, Fixed *vx, Fixed *vy, const Fixed *player, const Fixed *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	unsigned int done = 0;
+
+	memset(playerScored, 0, SCORE_WORDS(n) * sizeof(uint32_t));
+	memset(player2Scored, 0, SCORE_WORDS(n) * sizeof(uint32_t));
+
+	switch (lanes) {
+#ifdef HAVE_SSE2
+	case SIMD_SSE2:
+		done = SSE2FixedBalls(x, y, vx, vy, player, player2, n, playerScored, player2Scored);
+		break;
+#endif
+#ifdef HAVE_AVX
+	case SIMD_AVX2:
+		done = AVX2FixedBalls(x, y, vx, vy, player, player2, n, playerScored, player2Scored);
+		break;
+	case SIMD_AVX512:
+		done = AVX512FixedBalls(x, y, vx, vy, player, player2, n, playerScored, player2Scored);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	ScalarFixedBalls(x, y, vx, vy, player, player2, done, n, playerScored, player2Scored);
+}
+
+/*
+ *void MoveFixedBalls(...)
+ *This function moves n fixed point balls one tick with the widest available kernel
+*/
+void MoveFixedBalls(Fixed *x, Fixed *y, Fixed *vx, Fixed *vy, const Fixed *player, const Fixed *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored) {
+	MoveFixedBallsWith(SimdLanes(), x, y, vx, vy, player, player2, n, playerScored, player2Scored);
+}
@@ -0,0 +1,41 @@
+#ifndef SIMDBALL_H
+#define SIMDBALL_H
+
+#include <stdint.h>
+#include "Game.h"
+
+/*
+ *SimdBall.h
+ *Branchless versions of MoveBall that move 4, 8 or 16 balls per instruction.
+ *The balls are given as separate arrays (like Env) and the results are
+ *bit-identical to calling MoveBall on every ball. Instead of a return
+ *value, every ball that produced a point sets its bit (ball i -> word i/32,
+ *bit i%32) in one of two masks.
+ *
+ *MoveFixedBalls does the same for balls in fixed point (see SetFixed) and
+ *is bit-identical to MoveFixedBall.
+*/
+
+
+//Kernel widths, also the number of balls moved per instruction
+#define SIMD_SCALAR		1
+#define SIMD_SSE2		4
+#define SIMD_AVX2		8
+#define SIMD_AVX512		16
+
+//Number of mask words needed for n balls
+#define SCORE_WORDS(n)	(((n) + 31) / 32)
+
+//Kernel functions
+int SimdLanes(void);
+bool SimdSupported(int lanes);
+void MoveBalls(float *x, float *y, float *vx, float *vy, const float *player, const float *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored);
+void MoveBallsWith(int lanes, float *x, float *y, float *vx, float *vy, const float *player, const float *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored);
+void MoveFixedBalls(Fixed *x, Fixed *y, Fixed *vx, Fixed *vy, const Fixed *player, const Fixed *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored);
+void MoveFixedBallsWith(int lanes, Fixed *x, Fixed *y, Fixed *vx, Fixed *vy, const Fixed *player, const Fixed *player2,
+	unsigned int n, uint32_t *playerScored, uint32_t *player2Scored);
+
+#endif
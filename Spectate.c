@@ -0,0 +1,461 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Spectate.h"
+#include "Wire.h"
+
+/*
+ *Spectate.c
+ *The spectator stream, see Spectate.h for the format
+*/
+
+
+//Mask bits of a tick, in the order the fields follow
+#define FIELD_VX		0x01
+#define FIELD_VY		0x02
+#define FIELD_X			0x04
+#define FIELD_Y			0x08
+#define FIELD_PLAYER	0x10
+#define FIELD_PLAYER2	0x20
+#define FIELD_SCORE		0x40
+#define FIELD_STATE		0x80
+
+/*
+ *SharedPacket *NewPacket()
+ *This function makes an empty packet held once, NULL without memory
+*/
+SharedPacket *NewPacket(void) {
+	SharedPacket *p = malloc(sizeof(SharedPacket));
+
+	if (p != NULL) {
+		atomic_init(&p->refs, 1);
+		p->size = 0;
+	}
+
+	return p;
+}
+
+/*
+ *void RetainPacket(SharedPacket*)
+ *This function holds on to a packet once more
+*/
+void RetainPacket(SharedPacket *p) {
+	atomic_fetch_add_explicit(&p->refs, 1, memory_order_relaxed);
+}
+
+/*
+ *void ReleasePacket(SharedPacket*)
+ *This function lets go of a packet, freeing it when nobody holds it
+*/
+void ReleasePacket(SharedPacket *p) {
+	if (atomic_fetch_sub_explicit(&p->refs, 1, memory_order_acq_rel) == 1)
+		free(p);
+}
+
+/*
+ *byte *PutVarint(byte*, int32_t)
+ *This function writes a signed number zigzag encoded 7 bits a byte
+*/
+static byte *PutVarint(byte *out, int32_t v) {
+	uint32_t u = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+
+	for (; u >= 0x80; u >>= 7)
+		*out++ = (byte)(u | 0x80);
+	*out++ = (byte)u;
+
+	return out;
+}
+
+/*
+ *const byte *GetVarint(const byte*, const byte*, int32_t*)
+ *This function reads what PutVarint wrote, NULL if it runs past end
+*/
+static const byte *GetVarint(const byte *in, const byte *end, int32_t *v) {
+	uint32_t u = 0;
+	int shift;
+
+	for (shift = 0; in < end && shift < 35; shift += 7) {
+		u |= (uint32_t)(*in & 0x7F) << shift;
+		if (!(*in++ & 0x80)) {
+			*v = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+			return in;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ *int32_t Scaled(float)
+ *This function turns a position or speed into the fixed point spectators get
+*/
+static int32_t Scaled(float v) {
+	return (int32_t)lrintf(v * SPECTATE_SCALE);
+}
+
+/*
+ *bool Correct(int32_t*, int32_t, int32_t)
+ *This function moves a known value to its prediction, or to the real
+ *value if the prediction is too far off. It returns whether it was.
+*/
+static bool Correct(int32_t *known, int32_t predicted, int32_t real) {
+	if (abs(real - predicted) > SPECTATE_TOLERANCE) {
+		*known = real;
+		return true;
+	}
+
+	*known = predicted;
+	return false;
+}
+
+/*
+ *byte *EncodeTick(SpectateState*, const Game*, bool, byte*)
+ *This function writes one tick of a match and updates what spectators
+ *will know once they read it
+*/
+static byte *EncodeTick(SpectateState *k, const Game *g, bool key, byte *out) {
+	byte *mask = out++;
+	int32_t x = Scaled(g->ball.x), y = Scaled(g->ball.y), vx = Scaled(g->ball.vx), vy = Scaled(g->ball.vy);
+	int32_t player = Scaled(g->player.height), player2 = Scaled(g->player2.height), predicted;
+
+	if (key) {
+		*mask = 0xFF;
+		out = PutVarint(out, vx);
+		out = PutVarint(out, vy);
+		out = PutVarint(out, x);
+		out = PutVarint(out, y);
+		out = PutVarint(out, player);
+		out = PutVarint(out, player2);
+		*out++ = (byte)PLAYER_SCORE(g->score);
+		*out++ = (byte)PLAYER2_SCORE(g->score);
+		*out++ = g->state;
+
+		k->vx = vx;
+		k->vy = vy;
+		k->x = x;
+		k->y = y;
+		k->player = player;
+		k->player2 = player2;
+		k->playerV = k->player2V = 0;
+		k->score = g->score;
+		k->state = g->state;
+
+		return out;
+	}
+
+	*mask = 0;
+	if (vx != k->vx) {
+		*mask |= FIELD_VX;
+		out = PutVarint(out, vx - k->vx);
+		k->vx = vx;
+	}
+	if (vy != k->vy) {
+		*mask |= FIELD_VY;
+		out = PutVarint(out, vy - k->vy);
+		k->vy = vy;
+	}
+	predicted = k->x + k->vx;
+	if (Correct(&k->x, predicted, x)) {
+		*mask |= FIELD_X;
+		out = PutVarint(out, x - predicted);
+	}
+	predicted = k->y + k->vy;
+	if (Correct(&k->y, predicted, y)) {
+		*mask |= FIELD_Y;
+		out = PutVarint(out, y - predicted);
+	}
+	predicted = k->player + k->playerV;
+	k->playerV = -k->player;
+	if (Correct(&k->player, predicted, player)) {
+		*mask |= FIELD_PLAYER;
+		out = PutVarint(out, player - predicted);
+	}
+	k->playerV += k->player;
+	predicted = k->player2 + k->player2V;
+	k->player2V = -k->player2;
+	if (Correct(&k->player2, predicted, player2)) {
+		*mask |= FIELD_PLAYER2;
+		out = PutVarint(out, player2 - predicted);
+	}
+	k->player2V += k->player2;
+	if (g->score != k->score) {
+		*mask |= FIELD_SCORE;
+		*out++ = (byte)PLAYER_SCORE(g->score);
+		*out++ = (byte)PLAYER2_SCORE(g->score);
+		k->score = g->score;
+	}
+	if (g->state != k->state) {
+		*mask |= FIELD_STATE;
+		*out++ = k->state = g->state;
+	}
+
+	return out;
+}
+
+/*
+ *const byte *DecodeTick(SpectateState*, bool, const byte*, const byte*)
+ *This function reads one tick into what is known of the match, the
+ *same way EncodeTick worked it out. It returns NULL if the tick is cut off.
+*/
+static const byte *DecodeTick(SpectateState *k, bool key, const byte *in, const byte *end) {
+	byte mask;
+	int32_t v, predicted;
+
+	if (in >= end)
+		return NULL;
+	mask = *in++;
+
+	if (key) {
+		if ((in = GetVarint(in, end, &k->vx)) == NULL || (in = GetVarint(in, end, &k->vy)) == NULL ||
+			(in = GetVarint(in, end, &k->x)) == NULL || (in = GetVarint(in, end, &k->y)) == NULL ||
+			(in = GetVarint(in, end, &k->player)) == NULL || (in = GetVarint(in, end, &k->player2)) == NULL || end - in < 3)
+			return NULL;
+		k->playerV = k->player2V = 0;
+		k->score = MAKE_SCORE(in[0], in[1]);
+		in += 2;
+		k->state = *in++;
+
+		return in;
+	}
+
+	if (mask & FIELD_VX) {
+		if ((in = GetVarint(in, end, &v)) == NULL)
+			return NULL;
+		k->vx += v;
+	}
+	if (mask & FIELD_VY) {
+		if ((in = GetVarint(in, end, &v)) == NULL)
+			return NULL;
+		k->vy += v;
+	}
+
+	v = 0;
+	if ((mask & FIELD_X) && (in = GetVarint(in, end, &v)) == NULL)
+		return NULL;
+	k->x += k->vx + v;
+	v = 0;
+	if ((mask & FIELD_Y) && (in = GetVarint(in, end, &v)) == NULL)
+		return NULL;
+	k->y += k->vy + v;
+
+	v = 0;
+	if ((mask & FIELD_PLAYER) && (in = GetVarint(in, end, &v)) == NULL)
+		return NULL;
+	predicted = k->player + k->playerV + v;
+	k->playerV = predicted - k->player;
+	k->player = predicted;
+	v = 0;
+	if ((mask & FIELD_PLAYER2) && (in = GetVarint(in, end, &v)) == NULL)
+		return NULL;
+	predicted = k->player2 + k->player2V + v;
+	k->player2V = predicted - k->player2;
+	k->player2 = predicted;
+
+	if (mask & FIELD_SCORE) {
+		if (end - in < 2)
+			return NULL;
+		k->score = MAKE_SCORE(in[0], in[1]);
+		in += 2;
+	}
+	if (mask & FIELD_STATE) {
+		if (in >= end)
+			return NULL;
+		k->state = *in++;
+	}
+
+	return in;
+}
+
+/*
+ *void InitBroadcast(Broadcast*, uint32_t)
+ *This function starts the stream of a match with nobody watching yet
+*/
+void InitBroadcast(Broadcast *b, uint32_t id) {
+	memset(b, 0, sizeof(Broadcast));
+	b->id = id;
+}
+
+/*
+ *void ForgetHistory(Broadcast*)
+ *This function lets go of the packets since the last keyframe
+*/
+static void ForgetHistory(Broadcast *b) {
+	while (b->historyCount > 0)
+		ReleasePacket(b->history[--b->historyCount]);
+	b->open = false;
+}
+
+/*
+ *SharedPacket *BroadcastTick(Broadcast*, const Game*)
+ *This function adds the match's latest tick to the stream. When that
+ *finishes a packet it returns it for sending (it stays held by the
+ *broadcast until the next keyframe, retain it to keep it longer).
+*/
+SharedPacket *BroadcastTick(Broadcast *b, const Game *g) {
+	bool key = b->tick % SPECTATE_KEY_INTERVAL == 0;
+	SharedPacket *p;
+
+	if (key)
+		ForgetHistory(b);
+
+	//Start a packet every SPECTATE_TICKS ticks
+	if (!b->open) {
+		p = NewPacket();
+		if (p == NULL) { //The spectators miss this one and catch up at the next keyframe
+			b->tick++;
+			return NULL;
+		}
+
+		p->data[0] = key;
+		Put32(p->data + 1, b->id);
+		Put32(p->data + 5, b->tick);
+		p->data[9] = 0;
+		p->size = SPECTATE_HEADER;
+		b->history[b->historyCount++] = p;
+		b->open = true;
+	}
+
+	p = b->history[b->historyCount - 1];
+	p->size = (uint16_t)(EncodeTick(&b->known, g, key, p->data + p->size) - p->data);
+	p->data[9]++;
+	b->tick++;
+
+	if (b->tick % SPECTATE_TICKS != 0)
+		return NULL;
+
+	b->open = false;
+	b->packets++;
+	b->bytes += p->size;
+
+	return p;
+}
+
+/*
+ *bool AddSpectator(Broadcast*, uint32_t, uint16_t)
+ *This function adds a spectator, false if it was already there or there is
+ *no memory. The caller sends a new one the packets since the last keyframe
+ *(the finished ones in history).
+*/
+bool AddSpectator(Broadcast *b, uint32_t address, uint16_t port) {
+	unsigned int i;
+
+	for (i = 0; i < b->count; i++)
+		if (b->addresses[i] == address && b->ports[i] == port)
+			return false;
+
+	if (b->count == b->capacity) {
+		unsigned int capacity = b->capacity ? b->capacity * 2 : 16;
+		uint32_t *addresses = realloc(b->addresses, sizeof(uint32_t) * capacity);
+		uint16_t *ports;
+
+		if (addresses == NULL)
+			return false;
+		b->addresses = addresses;
+		ports = realloc(b->ports, sizeof(uint16_t) * capacity);
+		if (ports == NULL)
+			return false;
+		b->ports = ports;
+		b->capacity = capacity;
+	}
+
+	b->addresses[b->count] = address;
+	b->ports[b->count++] = port;
+
+	return true;
+}
+
+/*
+ *void RemoveSpectator(Broadcast*, uint32_t, uint16_t)
+ *This function stops sending to a spectator
+*/
+void RemoveSpectator(Broadcast *b, uint32_t address, uint16_t port) {
+	unsigned int i;
+
+	for (i = 0; i < b->count; i++) {
+		if (b->addresses[i] == address && b->ports[i] == port) {
+			b->addresses[i] = b->addresses[--b->count];
+			b->ports[i] = b->ports[b->count];
+			return;
+		}
+	}
+}
+
+/*
+ *void FreeBroadcast(Broadcast*)
+ *This function ends a stream, the packets still held elsewhere live on
+*/
+void FreeBroadcast(Broadcast *b) {
+	ForgetHistory(b);
+	free(b->addresses);
+	free(b->ports);
+	memset(b, 0, sizeof(Broadcast));
+}
+
+/*
+ *void InitSpectator(Spectator*, uint32_t)
+ *This function starts watching a match, waiting for a keyframe
+*/
+void InitSpectator(Spectator *s, uint32_t id) {
+	memset(s, 0, sizeof(Spectator));
+	s->id = id;
+}
+
+/*
+ *bool ReadSpectate(Spectator*, const byte*, unsigned int)
+ *This function reads a packet of the stream. It returns whether the
+ *spectator is in sync afterwards. A missing packet throws it out of sync
+ *until the next keyframe.
+*/
+bool ReadSpectate(Spectator *s, const byte *data, unsigned int size) {
+	const byte *in = data + SPECTATE_HEADER, *end = data + size;
+	SpectateState k;
+	uint32_t first;
+	unsigned int i;
+
+	if (size < SPECTATE_HEADER || Get32(data + 1) != s->id)
+		return s->synced;
+
+	first = Get32(data + 5);
+	if (s->synced && first != s->tick) {
+		s->synced = false;
+		s->lost++;
+	}
+	if (!s->synced && !data[0])
+		return false;
+
+	k = s->s;
+	for (i = 0; i < data[9]; i++) {
+		in = DecodeTick(&k, data[0] && i == 0, in, end);
+		if (in == NULL) {
+			s->synced = false;
+			s->lost++;
+			return false;
+		}
+	}
+
+	s->s = k;
+	s->synced = true;
+	s->tick = first + data[9];
+	s->ticks += data[9];
+
+	return true;
+}
+
+/*
+ *void SpectatorGame(const Spectator*, Game*)
+ *This function fills in what a spectator sees of the match, enough to
+ *draw it
+*/
+void SpectatorGame(const Spectator *s, Game *g) {
+	memset(g, 0, sizeof(Game));
+	g->ball.x = s->s.x / SPECTATE_SCALE;
+	g->ball.y = s->s.y / SPECTATE_SCALE;
+	g->ball.vx = s->s.vx / SPECTATE_SCALE;
+	g->ball.vy = s->s.vy / SPECTATE_SCALE;
+	g->player.height = s->s.player / SPECTATE_SCALE;
+	g->player2.height = s->s.player2 / SPECTATE_SCALE;
+	g->score = s->s.score;
+	g->state = s->s.state;
+	g->mode = MODE_TWO;
+	g->step = 1.f;
+}
@@ -0,0 +1,94 @@
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include <stdatomic.h>
+#include "Game.h"
+
+/*
+ *Spectate.h
+ *A compact live stream of a match for spectators. Positions and speeds
+ *are sent in 1/256 of a table pixel. Both ends keep the same idea of the
+ *match and predict the next tick from it: the ball keeps its velocity and
+ *the paddles keep their last move. Only what the prediction gets more than
+ *SPECTATE_TOLERANCE wrong is sent, so a tick of straight flight costs a
+ *single byte. Everything else (bounces, serves, score, state) is sent as
+ *it happens.
+ *
+ *A tick is a mask byte saying which fields follow, then those fields in
+ *mask bit order: changes in vx and vy, corrections of x, y and the
+ *paddles as zigzag varints, then both players' scores and the state as
+ *they are. A keyframe has every field, absolute.
+ *
+ *Ticks are sent SPECTATE_TICKS to a packet: kind (1 if it starts with a
+ *keyframe), match id and first tick (32 bits little endian), tick count,
+ *ticks. Every SPECTATE_KEY_INTERVAL ticks there is a keyframe. A packet
+ *is encoded once into a reference counted buffer. The buffer is shared by
+ *every spectator it goes out to. The packets since the last keyframe are
+ *kept, so a spectator who joins late is sent those and is in sync at once.
+*/
+
+
+#define SPECTATE_PACKET			256
+#define SPECTATE_HEADER			10
+#define SPECTATE_TICKS			4		//ticks per packet
+#define SPECTATE_KEY_INTERVAL	100		//a multiple of SPECTATE_TICKS
+#define SPECTATE_HISTORY		(SPECTATE_KEY_INTERVAL / SPECTATE_TICKS)
+#define SPECTATE_SCALE			256.f	//fixed point units per pixel
+#define SPECTATE_TOLERANCE		8		//largest error left uncorrected, in fixed point units
+
+//A packet that is shared instead of copied. Whoever holds on to it
+//retains it and releases it when done, the last release frees it.
+typedef struct SharedPacket {
+	atomic_int refs;
+	uint16_t size;
+	byte data[SPECTATE_PACKET];
+} SharedPacket;
+
+//What spectators know of a match, in fixed point
+typedef struct SpectateState {
+	int32_t x, y, vx, vy;
+	int32_t player, player2;		//paddle heights
+	int32_t playerV, player2V;		//their last move
+	uint16_t score;
+	byte state;
+} SpectateState;
+
+//The sending end, one per watched match
+typedef struct Broadcast {
+	uint32_t id, tick;
+	SpectateState known;
+	SharedPacket *history[SPECTATE_HISTORY];	//since the last keyframe, the last one may be open
+	unsigned int historyCount;
+	bool open;									//the last packet isn't finished
+	uint32_t *addresses;						//spectators, network byte order
+	uint16_t *ports;
+	unsigned int count, capacity;
+	uint64_t packets, bytes;					//totals encoded
+} Broadcast;
+
+//The receiving end
+typedef struct Spectator {
+	bool synced;
+	uint32_t id, tick;				//the next tick expected
+	SpectateState s;
+	uint64_t ticks, lost;			//ticks decoded, packets that broke the stream
+} Spectator;
+
+//Shared packet functions
+SharedPacket *NewPacket(void);
+void RetainPacket(SharedPacket *p);
+void ReleasePacket(SharedPacket *p);
+
+//Broadcast functions
+void InitBroadcast(Broadcast *b, uint32_t id);
+SharedPacket *BroadcastTick(Broadcast *b, const Game *g);
+bool AddSpectator(Broadcast *b, uint32_t address, uint16_t port);
+void RemoveSpectator(Broadcast *b, uint32_t address, uint16_t port);
+void FreeBroadcast(Broadcast *b);
+
+//Spectator functions
+void InitSpectator(Spectator *s, uint32_t id);
+bool ReadSpectate(Spectator *s, const byte *data, unsigned int size);
+void SpectatorGame(const Spectator *s, Game *g);
+
+#endif
@@ -0,0 +1,220 @@
+#include <math.h>
+#include <string.h>
+#include "Touch.h"
+
+/*
+ *Touch.c
+ *The widget table, the hit test and touch traces, see Touch.h. The
+ *boxes are the ones the touch handler always tested, to the pixel.
+*/
+
+
+//What an edge is measured from
+#define OF_WIDTH	0
+#define OF_HEIGHT	1
+#define OF_MARGIN	2	//the width of a bar beside the table
+
+//An edge is the sum of up to four whole fractions of the screen, a
+//number of TOUCH_WIDTHs of the margin and a fraction of the margin. The
+//last two are kept apart because the float tests rounded them apart.
+typedef struct Term {
+	byte of;
+	signed char num, den;
+} Term;
+
+typedef struct Edge {
+	Term terms[4];
+	signed char touch;
+	float part;
+} Edge;
+
+typedef struct Widget {
+	byte states;		//a bit per state it is there in
+	byte modes;			//a bit per mode
+	Edge edges[4];		//left, top, right and bottom, all included
+} Widget;
+
+#define W(num, den)		{ OF_WIDTH, num, den }
+#define H(num, den)		{ OF_HEIGHT, num, den }
+#define M(num, den)		{ OF_MARGIN, num, den }
+#define IN(state)		(1 << (state))
+#define PLAYING			(IN(STATE_READY) | IN(STATE_SERVE) | IN(STATE_PLAY))
+#define ANY_MODE		0xFF
+
+static const Widget widgets[WIDGET_COUNT] = {
+	//Player 1's slider on the left
+	{ PLAYING, ANY_MODE, { { { M(1, 2) }, 0, -10 * TOUCH_WIDTH }, { { H(1, 3) }, 0, 0 }, { { M(1, 2) }, 0, 10 * TOUCH_WIDTH }, { { H(2, 3) }, 0, 0 } } },
+	//Player 2's slider on the right
+	{ PLAYING, IN(MODE_TWO), { { { W(1, 1), M(-1, 2) }, 0, -10 * TOUCH_WIDTH }, { { H(1, 3) }, 0, 0 }, { { W(1, 1), M(-1, 2) }, 0, 10 * TOUCH_WIDTH }, { { H(2, 3) }, 0, 0 } } },
+	//Go!
+	{ IN(STATE_READY) | IN(STATE_END), ANY_MODE,
+		{ { { { 0 } }, 1, 0 }, { { H(1, 2), H(-1, 30), H(1, 30) }, 0, 0 }, { { M(1, 4) }, 1, 0 }, { { H(1, 2), H(1, 30), H(1, 30) }, 0, 0 } } },
+	//Go! on the home screen
+	{ IN(STATE_HOME), ANY_MODE,
+		{ { { { 0 } }, 1, 0 }, { { H(1, 2), H(-1, 30), H(1, 30), H(-1, 15) }, 0, 0 }, { { M(1, 4) }, 1, 0 }, { { H(1, 2), H(1, 30), H(1, 30), H(-1, 15) }, 0, 0 } } },
+	//The arrows
+	{ IN(STATE_HOME), ANY_MODE, { { { M(1, 2) }, -5, 0 }, { { H(1, 2) }, -11, 0 }, { { M(1, 2) }, 5, 0 }, { { H(1, 2) }, -1, 0 } } },
+	{ IN(STATE_HOME), ANY_MODE, { { { M(1, 2) }, -5, 0 }, { { H(1, 2) }, 1, 0 }, { { M(1, 2) }, 5, 0 }, { { H(1, 2) }, 11, 0 } } },
+	//Close
+	{ 0xFF, 0xFF, { { { { 0 } }, 1, 0 }, { { H(1, 1), H(-1, 15) }, -1, 0 }, { { M(1, 3) }, 1, 0 }, { { H(1, 1) }, -1, 0 } } }
+};
+
+
+/*
+ *float EdgeAt(const Edge*, unsigned short, unsigned short)
+ *This function works out where an edge is on a screen
+*/
+static float EdgeAt(const Edge *e, unsigned short width, unsigned short height) {
+	int sizes[3], sum = 0;
+	unsigned int i;
+
+	sizes[OF_WIDTH] = width;
+	sizes[OF_HEIGHT] = height;
+	sizes[OF_MARGIN] = (width - height) / 2;
+	for (i = 0; i < 4 && e->terms[i].den != 0; i++)
+		sum += sizes[e->terms[i].of] * e->terms[i].num / e->terms[i].den;
+
+	return sum + e->touch * sizes[OF_MARGIN] * TOUCH_WIDTH + e->part * sizes[OF_MARGIN];
+}
+
+/*
+ *void InitTouchMap(TouchMap*, unsigned short, unsigned short)
+ *This function works out the widgets' boxes on a screen and the grid
+*/
+void InitTouchMap(TouchMap *m, unsigned short width, unsigned short height) {
+	byte i;
+	int x, y;
+
+	memset(m, 0, sizeof(TouchMap));
+	m->width = width;
+	m->height = height;
+	m->cellWidth = (width + TOUCH_GRID - 1) / TOUCH_GRID;
+	m->cellHeight = (height + TOUCH_GRID - 1) / TOUCH_GRID;
+
+	for (i = 0; i < WIDGET_COUNT; i++) {
+		Rect *box = &m->boxes[i];
+
+		//A touch is on an edge if it's on the pixel or past it
+		box->left = (short)ceilf(EdgeAt(&widgets[i].edges[0], width, height));
+		box->top = (short)ceilf(EdgeAt(&widgets[i].edges[1], width, height));
+		box->right = (short)floorf(EdgeAt(&widgets[i].edges[2], width, height)) + 1;
+		box->bottom = (short)floorf(EdgeAt(&widgets[i].edges[3], width, height)) + 1;
+		if (box->right <= box->left || box->bottom <= box->top)
+			continue;
+
+		for (y = box->top / m->cellHeight; y <= (box->bottom - 1) / m->cellHeight && y < TOUCH_GRID; y++)
+			for (x = box->left / m->cellWidth; x <= (box->right - 1) / m->cellWidth && x < TOUCH_GRID; x++)
+				if (x >= 0 && y >= 0)
+					m->cells[y * TOUCH_GRID + x] |= 1 << i;
+	}
+}
+
+/*
+ *byte ActiveWidgets(byte, byte)
+ *This function returns a bit for every widget there is in a state and mode
+*/
+byte ActiveWidgets(byte state, byte mode) {
+	byte i, active = 0;
+
+	for (i = 0; i < WIDGET_COUNT; i++)
+		if ((widgets[i].states & IN(state)) && (widgets[i].modes & IN(mode)))
+			active |= 1 << i;
+
+	return active;
+}
+
+/*
+ *byte HitWidget(const TouchMap*, short, short, byte)
+ *This function returns the first of the active widgets (see
+ *ActiveWidgets) a touch is on, WIDGET_NONE if there is none
+*/
+byte HitWidget(const TouchMap *m, short x, short y, byte active) {
+	byte candidates, i;
+
+	if (x < 0 || y < 0 || x >= m->width || y >= m->height)
+		return WIDGET_NONE;
+
+	candidates = m->cells[y / m->cellHeight * TOUCH_GRID + x / m->cellWidth] & active;
+	for (; candidates != 0; candidates &= candidates - 1) {
+		const Rect *box;
+
+		for (i = 0; !(candidates >> i & 1); i++)
+			;
+		box = &m->boxes[i];
+		if (x >= box->left && x < box->right && y >= box->top && y < box->bottom)
+			return i;
+	}
+
+	return WIDGET_NONE;
+}
+
+/*
+ *void ResolveTouches(const TouchMap*, const InputEvent*, unsigned int, byte, byte, TouchActions*)
+ *This function works out what a batch of IN_TOUCH points does in a
+ *state and mode
+*/
+void ResolveTouches(const TouchMap *m, const InputEvent *points, unsigned int count, byte state, byte mode, TouchActions *a) {
+	byte active = ActiveWidgets(state, mode), hit;
+	unsigned int i;
+
+	memset(a, 0, sizeof(TouchActions));
+	for (i = 0; i < count; i++) {
+		hit = HitWidget(m, points[i].x, points[i].y, active);
+		if (hit == WIDGET_NONE)
+			continue;
+
+		if (hit == WIDGET_SLIDER1 || hit == WIDGET_SLIDER2) {
+			a->slid[hit] = true;
+			a->slider[hit] = points[i].y;
+		}
+		else
+			a->pressed |= 1 << hit;
+	}
+}
+
+/*
+ *bool WriteTouchTrace(FILE*, const InputEvent*, unsigned int)
+ *This function appends touches to a trace, 16 little endian bytes each:
+ *the time, x and y, and 4 bytes left for later
+*/
+bool WriteTouchTrace(FILE *file, const InputEvent *points, unsigned int count) {
+	byte record[16];
+	unsigned int i, k;
+
+	for (i = 0; i < count; i++) {
+		memset(record, 0, sizeof(record));
+		for (k = 0; k < 8; k++)
+			record[k] = (byte)(points[i].at >> k * 8);
+		record[8] = (byte)points[i].x;
+		record[9] = (byte)((unsigned short)points[i].x >> 8);
+		record[10] = (byte)points[i].y;
+		record[11] = (byte)((unsigned short)points[i].y >> 8);
+		if (fwrite(record, sizeof(record), 1, file) != 1)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ *unsigned int ReadTouchTrace(FILE*, InputEvent*, unsigned int)
+ *This function reads up to max touches of a trace and returns how many
+ *it read
+*/
+unsigned int ReadTouchTrace(FILE *file, InputEvent *points, unsigned int max) {
+	byte record[16];
+	unsigned int count, k;
+
+	for (count = 0; count < max && fread(record, sizeof(record), 1, file) == 1; count++) {
+		InputEvent *e = &points[count];
+
+		memset(e, 0, sizeof(InputEvent));
+		for (k = 0; k < 8; k++)
+			e->at |= (uint64_t)record[k] << k * 8;
+		e->type = IN_TOUCH;
+		e->x = (short)(record[8] | record[9] << 8);
+		e->y = (short)(record[10] | record[11] << 8);
+	}
+
+	return count;
+}
@@ -0,0 +1,65 @@
+#ifndef TOUCH_H
+#define TOUCH_H
+
+#include <stdio.h>
+#include "Input.h"
+#include "Raster.h"
+
+/*
+ *Touch.h
+ *What a touch on the screen hits. The touch controls are a table of
+ *widgets, each with the states and modes it is there in. Their boxes
+ *depend only on the screen, so they are worked out once per resolution
+ *into a TouchMap, together with a grid of TOUCH_GRID x TOUCH_GRID cells
+ *that holds the widgets over each cell. A touch only tests the boxes of
+ *the widgets in its cell.
+ *
+ *The points of a touch message are resolved together: a slider follows
+ *the last point on it and a button is pressed once however many fingers
+ *are on it. Nothing here allocates, a message has at most TOUCH_POOL
+ *points and the rest are left out.
+ *
+ *A touch trace is the IN_TOUCH events of a session written one after
+ *another, so a session on a touch screen can be played back anywhere.
+*/
+
+
+//Widgets, in the order they are tested
+#define WIDGET_SLIDER1		0	//player 1's paddle
+#define WIDGET_SLIDER2		1	//player 2's paddle
+#define WIDGET_GO			2	//Go! when ready or at the end
+#define WIDGET_GO_HOME		3	//Go! on the home screen, a little higher
+#define WIDGET_MODE_ONE		4	//the up arrow
+#define WIDGET_MODE_TWO		5	//the down arrow
+#define WIDGET_CLOSE		6
+#define WIDGET_COUNT		7
+#define WIDGET_NONE			0xFF
+
+#define TOUCH_GRID			8		//cells across and down
+#define TOUCH_POOL			64		//points read from a touch message
+
+typedef struct TouchMap {
+	unsigned short width, height;
+	Rect boxes[WIDGET_COUNT];						//in screen pixels
+	unsigned short cellWidth, cellHeight;
+	byte cells[TOUCH_GRID * TOUCH_GRID];			//a bit per widget over the cell
+} TouchMap;
+
+//What the points of a batch do
+typedef struct TouchActions {
+	bool slid[2];				//player 1 and 2's sliders were touched
+	short slider[2];			//the last point on each, down the screen
+	byte pressed;				//a bit per widget pressed
+} TouchActions;
+
+//Map functions
+void InitTouchMap(TouchMap *m, unsigned short width, unsigned short height);
+byte ActiveWidgets(byte state, byte mode);
+byte HitWidget(const TouchMap *m, short x, short y, byte active);
+void ResolveTouches(const TouchMap *m, const InputEvent *points, unsigned int count, byte state, byte mode, TouchActions *a);
+
+//Trace functions
+bool WriteTouchTrace(FILE *file, const InputEvent *points, unsigned int count);
+unsigned int ReadTouchTrace(FILE *file, InputEvent *points, unsigned int max);
+
+#endif
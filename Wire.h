@@ -0,0 +1,61 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <string.h>
+#include "Game.h"
+
+/*
+ *Wire.h
+ *Numbers in files and packets, stored little endian whatever the machine
+ *is. Every Put returns where the next value goes.
+*/
+
+
+#ifdef _MSC_VER
+#define WIRE	static __inline
+#else
+#define WIRE	static inline
+#endif
+
+WIRE byte *Put16(byte *out, uint16_t v) {
+	out[0] = (byte)v;
+	out[1] = (byte)(v >> 8);
+	return out + 2;
+}
+
+WIRE byte *Put32(byte *out, uint32_t v) {
+	return Put16(Put16(out, (uint16_t)v), (uint16_t)(v >> 16));
+}
+
+WIRE byte *Put64(byte *out, uint64_t v) {
+	return Put32(Put32(out, (uint32_t)v), (uint32_t)(v >> 32));
+}
+
+WIRE byte *PutFloat(byte *out, float v) {
+	uint32_t bits;
+
+	memcpy(&bits, &v, sizeof(bits));
+	return Put32(out, bits);
+}
+
+WIRE uint16_t Get16(const byte *in) {
+	return (uint16_t)(in[0] | in[1] << 8);
+}
+
+WIRE uint32_t Get32(const byte *in) {
+	return Get16(in) | (uint32_t)Get16(in + 2) << 16;
+}
+
+WIRE uint64_t Get64(const byte *in) {
+	return Get32(in) | (uint64_t)Get32(in + 4) << 32;
+}
+
+WIRE float GetFloat(const byte *in) {
+	uint32_t bits = Get32(in);
+	float v;
+
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+#endif